@@ -8,12 +8,14 @@
 #include "core/init.h"
 #include "windows/id3dx.h"
 #include "tier0/fasttimer.h"
+#include "tier0/frametask.h"
 #include "tier1/cvar.h"
 #include "tier1/fmtstr.h"
 #include "engine/shared/shared_rcon.h"
 #ifndef CLIENT_DLL
 #include "engine/server/sv_rcon.h"
 #include "engine/server/server.h"
+#include "engine/server/sv_main.h"
 #endif // !CLIENT_DLL
 #ifndef DEDICATED
 #include "engine/gl_screen.h"
@@ -138,7 +140,9 @@ void VPK_Pack_f(const CCommand& args)
 		return;
 	}
 
-	VPKPair_t pair(args.Arg(1), args.Arg(2), args.Arg(3), NULL);
+	const int nPatch = std::clamp(args.FindArgInt("-patch", 0), 0, PACKFILEPATCH_MAX - 1);
+
+	VPKPair_t pair(args.Arg(1), args.Arg(2), args.Arg(3), nPatch);
 	Msg(eDLL_T::FS, "*** Starting VPK build command for: '%s'\n", pair.m_DirName.String());
 
 	CFastTimer timer;
@@ -147,6 +151,9 @@ void VPK_Pack_f(const CCommand& args)
 	CPackedStoreBuilder builder;
 
 	builder.InitLzEncoder(fs_packedstore_max_helper_threads.GetInt(), fs_packedstore_compression_level.GetString());
+	builder.SetNumPackWorkers(args.FindArgInt("-threads", 1));
+	builder.SetIncremental(args.FindArg("-incremental") != nullptr);
+
 	builder.PackStore(pair, workspacePath, "vpk/");
 
 	timer.End();
@@ -170,7 +177,7 @@ void VPK_Unpack_f(const CCommand& args)
 	}
 
 	CUtlString fileName = args.Arg(1);
-	VPKDir_t vpk(fileName, (args.ArgC() > 2));
+	VPKDir_t vpk(fileName, (args.ArgC() > 2 && args.Arg(2)[0] != '-'));
 
 	if (vpk.Failed())
 	{
@@ -186,7 +193,9 @@ void VPK_Unpack_f(const CCommand& args)
 	CPackedStoreBuilder builder;
 
 	builder.InitLzDecoder();
-	builder.UnpackStore(vpk, fs_packedstore_workspace.GetString());
+	builder.SetNumPackWorkers(args.FindArgInt("-threads", 1));
+
+	builder.UnpackStore(vpk, fs_packedstore_workspace.GetString(), args.FindArg("-filter"));
 
 	timer.End();
 	Msg(eDLL_T::FS, "*** Time elapsed: '%lf' seconds\n", timer.GetDuration().GetSeconds());
@@ -490,6 +499,50 @@ void BHit_f(const CCommand& args)
 #endif // !DEDICATED
 }
 
+/*
+=====================
+Host_TaskQueueStats_f
+
+  Shows the depth of the
+  main thread task queue and
+  how long tasks waited and
+  ran
+=====================
+*/
+static void Host_TaskQueueStats_f(const CCommand& args)
+{
+	FrameTaskStats_s stats;
+	g_TaskQueue.GetStats(stats);
+
+	Msg(eDLL_T::ENGINE, "Tasks ran: %lld; deferred by the frame budget: %lld\n", stats.tasksRun, stats.tasksDeferred);
+	Msg(eDLL_T::ENGINE, "Ready: %d (peak %d); delayed: %d\n", stats.readyDepth, stats.peakReadyDepth, stats.delayedDepth);
+	Msg(eDLL_T::ENGINE, "Dispatched last frame: %d (peak %d)\n", stats.lastIntake, stats.peakIntake);
+	Msg(eDLL_T::ENGINE, "Latency: %.3f ms average; %.3f ms peak\n", stats.avgLatency * 1000.0, stats.peakLatency * 1000.0);
+	Msg(eDLL_T::ENGINE, "Time spent last frame: %.3f ms\n", stats.lastFrameTime * 1000.0);
+}
+
+static ConCommand host_taskqueuestats("host_taskqueuestats", Host_TaskQueueStats_f, "Shows the main thread task queue statistics", FCVAR_DEVELOPMENTONLY);
+
+#ifndef CLIENT_DLL
+/*
+=====================
+SV_BanVerdictStats_f
+
+  Shows how many global
+  ban checks were answered
+  by the verdict cache, by
+  pending queries or by the
+  bulk check
+=====================
+*/
+static void SV_BanVerdictStats_f(const CCommand& args)
+{
+	SV_PrintBanVerdictStats();
+}
+
+static ConCommand sv_banverdictstats("sv_banverdictstats", SV_BanVerdictStats_f, "Shows the global ban verdict cache statistics", FCVAR_DEVELOPMENTONLY);
+#endif // !CLIENT_DLL
+
 /*
 =====================
 CVHelp_f
@@ -31,6 +31,7 @@ class CConnectedNetConsoleData
 {
 public:
 	SocketHandle_t m_hSocket;
+	uint32_t m_nSerial;     // Unique per accepted connection, socket handles get reused.
 	int  m_nPayloadLen;     // Num bytes for this message.
 	int  m_nPayloadRead;    // Num read bytes from input buffer.
 	int  m_nFailedAttempts; // Num failed authentication attempts.
@@ -38,11 +39,17 @@ public:
 	bool m_bValidated;      // Revalidates netconsole if false.
 	bool m_bAuthorized;     // Set to true after successful netconsole auth.
 	bool m_bInputOnly;      // If set, don't send spew to this netconsole.
+	bool m_bPendingClose;   // Set when the socket is queued for closing.
+	int  m_nDroppedFrames;  // Num outbound frames dropped while the send queue was full.
+	size_t m_nSendOffset;   // Num sent bytes of the first queued frame, including its length-prefix.
+	size_t m_nSendQueueSize;// Num queued bytes not sent yet, including length-prefixes.
 	vector<uint8_t> m_RecvBuffer;
+	vector<std::shared_ptr<const vector<char>>> m_SendQueue; // Outbound frames, shared between sockets.
 
 	CConnectedNetConsoleData(SocketHandle_t hSocket = -1)
 	{
 		m_hSocket = hSocket;
+		m_nSerial = 0;
 		m_nPayloadLen = 0;
 		m_nPayloadRead = 0;
 		m_nFailedAttempts = 0;
@@ -50,6 +57,10 @@ public:
 		m_bValidated = false;
 		m_bAuthorized = false;
 		m_bInputOnly = true;
+		m_bPendingClose = false;
+		m_nDroppedFrames = 0;
+		m_nSendOffset = 0;
+		m_nSendQueueSize = 0;
 		m_RecvBuffer.resize(sizeof(u_long)); // Reserve enough for length-prefix.
 	}
 };
@@ -6,8 +6,10 @@
 #include "tier0/cpu.h"
 #include "tier0/basetypes.h"
 #include "tier0/crashhandler.h"
+#include "tier0/threadpool.h"
 #include "tier0/commandline.h"
 #include "tier2/crashreporter.h"
+#include "networksystem/pylon.h"
 /*****************************************************************************/
 #ifndef DEDICATED
 #include "windows/id3dx.h"
@@ -173,6 +175,9 @@ void SDK_Shutdown()
 
     Msg(eDLL_T::NONE, "GameSDK shutdown initiated\n");
 
+    // Pending master server requests have to finish before curl goes.
+    g_MasterServer.Shutdown();
+    g_ThreadPool.Shutdown();
     curl_global_cleanup();
 
 #ifndef DEDICATED
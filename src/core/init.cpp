@@ -59,6 +59,7 @@
 #include "engine/server/vengineserver_impl.h"
 #include "engine/server/datablock_sender.h"
 #endif // !CLIENT_DLL
+#include "engine/shared/datablock.h"
 #include "studiorender/studiorendercontext.h"
 #ifndef CLIENT_DLL
 #include "rtech/liveapi/liveapi.h"
@@ -298,6 +299,8 @@ void Systems_Shutdown()
 	LiveAPISystem()->Shutdown();
 #endif// !CLIENT_DLL
 
+	DataBlock_ShutdownCodecs();
+
 	CFastTimer shutdownTimer;
 	shutdownTimer.Start();
 
@@ -442,7 +445,16 @@ void DetourInit() // Run the sigscan
 	bool bInitDivider = false;
 
 	g_SigCache.SetDisabled(bNoSmap);
-	g_SigCache.ReadCache(SIGDB_FILE);
+
+	if (!g_SigCache.ReadCache(SIGDB_FILE))
+	{
+		// No usable cache; look up the signatures of the last cache on the
+		// disk in one pass, most of the searches below are taken from that.
+		vector<string> patterns;
+
+		if (g_SigCache.ReadPatterns(SIGDB_FILE, patterns))
+			g_GameDll.PrescanPatterns(patterns);
+	}
 
 	// No debug logging in non dev builds.
 	const bool bDevMode = !IsCert() && !IsRetail();
@@ -465,6 +477,8 @@ void DetourInit() // Run the sigscan
 		}
 	}
 
+	g_GameDll.ClearPrescan();
+
 #ifdef DEDICATED
 	// Must be performed after detour init as we patch instructions which alters the function signatures.
 	Dedicated_Init();
@@ -9,6 +9,19 @@
 #include "engine/common.h"
 #include "engine/host_cmd.h"
 
+// sent to the server so it can select a codec we can decode
+static ConVar cl_dataBlockCodecs("cl_dataBlockCodecs", "0", FCVAR_HIDDEN | FCVAR_USERINFO | FCVAR_DONTRECORD, "Bit mask of the data block codecs the client can decode");
+static ConVar cl_dataBlockDictId("cl_dataBlockDictId", "0", FCVAR_HIDDEN | FCVAR_USERINFO | FCVAR_DONTRECORD, "The id of the data block dictionary loaded by the client");
+
+//-----------------------------------------------------------------------------
+// Purpose: advertise the codecs and dictionary we support to the server
+//-----------------------------------------------------------------------------
+void ClientDataBlockReceiver::AdvertiseCodecs()
+{
+	cl_dataBlockCodecs.SetValue(int(DataBlock_GetCodecMask()));
+	cl_dataBlockDictId.SetValue(int(DataBlock_GetDictionaryId()));
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: send an ack back to the server to let them know
 // we received the data block
@@ -104,28 +117,28 @@ bool ClientDataBlockReceiver::ProcessDataBlock(const double startTime, const sho
 
 	const ClientDataBlockHeader_s* const pHeader = reinterpret_cast<ClientDataBlockHeader_s*>(m_pScratchBuffer);
 
-	if (pHeader->isCompressed)
+	if (pHeader->codec != DataBlockCodec_e::NONE)
 	{
 		// NOTE: the engine's implementation of this function does NOT free
 		// this buffer when a malformed/corrupt LZ4 packet is sent to the
 		// receiver; wrapped buffer in unique_ptr to make sure it never leaks!
-		std::unique_ptr<char> encodedDataBuf(new char[SNAPSHOT_SCRATCH_BUFFER_SIZE]);
+		std::unique_ptr<uint8_t[]> encodedDataBuf(new uint8_t[SNAPSHOT_SCRATCH_BUFFER_SIZE]);
 
-		char* const pEncodedDataBuf = encodedDataBuf.get();
-		char* const dataLocation = m_pScratchBuffer + sizeof(ClientDataBlockHeader_s);
+		uint8_t* const pEncodedDataBuf = encodedDataBuf.get();
+		uint8_t* const dataLocation = reinterpret_cast<uint8_t*>(m_pScratchBuffer) + sizeof(ClientDataBlockHeader_s);
 
 		// copy the encoded data in the newly allocated buffer so we can decode back
 		// into the data block buffer we copied the encoded data from
 		const int compressedSize = m_nTransferSize -1;
 
 		memcpy(pEncodedDataBuf, dataLocation, compressedSize);
-		const int numDecode = LZ4_decompress_safe(pEncodedDataBuf, dataLocation, compressedSize, SNAPSHOT_SCRATCH_BUFFER_SIZE);
+		const int numDecode = DataBlock_Decompress(pHeader->codec, pEncodedDataBuf, compressedSize, dataLocation, SNAPSHOT_SCRATCH_BUFFER_SIZE);
 
 		if (numDecode < 0)
 		{
 			Assert(0);
 
-			COM_ExplainDisconnection(true, "LZ4 error decompressing data block from server.\n");
+			COM_ExplainDisconnection(true, "%s error decompressing data block from server.\n", DataBlock_GetCodecName(pHeader->codec));
 			v_Host_Disconnect(true);
 
 			return false;
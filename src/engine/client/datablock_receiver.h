@@ -16,12 +16,14 @@ public:
 
 	bool ProcessDataBlock(const double startTime, const short transferId, const int transferSize,
 		const short counter, const short currentBlockId, const void* const blockBuffer, const int blockBufferBytes);
+
+	static void AdvertiseCodecs();
 };
 
 struct ClientDataBlockHeader_s
 {
 	char reserved[3]; // unused in retail
-	bool isCompressed;
+	DataBlockCodec_e codec;
 };
 
 // virtual methods
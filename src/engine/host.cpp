@@ -7,6 +7,7 @@
 
 #include "core/stdafx.h"
 #include "tier0/frametask.h"
+#include "tier1/cvar.h"
 #include "engine/host.h"
 #ifndef DEDICATED
 #include "windows/id3dx.h"
@@ -17,6 +18,8 @@
 
 CCommonHostState* g_pCommonHostState = nullptr;
 
+static ConVar host_taskFrameBudget("host_taskFrameBudget", "4", FCVAR_RELEASE, "Maximum time in milliseconds spent on running queued main thread tasks each frame, the rest run on the next frame.", true, 0.f, false, 0.f, "0 = no limit");
+
 void CCommonHostState::SetWorldModel(model_t* pModel)
 {
 	if (worldmodel == pModel)
@@ -61,6 +64,8 @@ Runs all active servers
 */
 void _Host_RunFrame(void* unused, float time)
 {
+	g_TaskQueue.SetFrameBudget(host_taskFrameBudget.GetFloat() / 1000.0);
+
 	for (IFrameTask* const& task : g_TaskQueueList)
 	{
 		task->RunFrame();
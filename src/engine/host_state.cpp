@@ -23,9 +23,11 @@
 #include "engine/client/cl_rcon.h"
 #include "engine/client/cl_main.h"
 #include "engine/client/clientstate.h"
+#include "engine/client/datablock_receiver.h"
 #endif // DEDICATED
 #include "engine/cmd.h"
 #include "engine/net.h"
+#include "engine/shared/datablock.h"
 #include "engine/gl_screen.h"
 #include "engine/host.h"
 #include "engine/host_cmd.h"
@@ -95,44 +97,32 @@ static void HostState_KeepAlive()
 			).count()
 	};
 
-	std::thread request([&, gameServer]
+	// Applied on the main thread once the request is done.
+	g_MasterServer.PostServerHostAsync(gameServer, [](const bool result,
+		const string& errorMsg, const string& hostToken, const string& hostIp)
 		{
-			string errorMsg;
-			string hostToken;
-			string hostIp;
-
-			const bool result = g_MasterServer.PostServerHost(errorMsg, hostToken, hostIp, gameServer);
-
-			// Apply the data the next frame
-			g_TaskQueue.Dispatch([result, errorMsg, hostToken, hostIp]
+			if (!result)
+			{
+				if (!errorMsg.empty() && g_ServerHostManager.GetCurrentError().compare(errorMsg) != NULL)
 				{
-					if (!result)
-					{
-						if (!errorMsg.empty() && g_ServerHostManager.GetCurrentError().compare(errorMsg) != NULL)
-						{
-							g_ServerHostManager.SetCurrentError(errorMsg);
-							Error(eDLL_T::SERVER, NO_ERROR, "%s\n", errorMsg.c_str());
-						}
-					}
-					else // Attempt to log the token, if there is one.
-					{
-						if (!hostToken.empty() && g_ServerHostManager.GetCurrentToken().compare(hostToken) != NULL)
-						{
-							g_ServerHostManager.SetCurrentToken(hostToken);
-							Msg(eDLL_T::SERVER, "Published server with token: %s'%s%s%s'\n",
-								g_svReset, g_svGreyB,
-								hostToken.c_str(), g_svReset);
-						}
-					}
-
-					if (hostIp.length() != 0)
-						g_ServerHostManager.SetHostIP(hostIp);
-
-				}, 0);
-		}
-	);
+					g_ServerHostManager.SetCurrentError(errorMsg);
+					Error(eDLL_T::SERVER, NO_ERROR, "%s\n", errorMsg.c_str());
+				}
+			}
+			else // Attempt to log the token, if there is one.
+			{
+				if (!hostToken.empty() && g_ServerHostManager.GetCurrentToken().compare(hostToken) != NULL)
+				{
+					g_ServerHostManager.SetCurrentToken(hostToken);
+					Msg(eDLL_T::SERVER, "Published server with token: %s'%s%s%s'\n",
+						g_svReset, g_svGreyB,
+						hostToken.c_str(), g_svReset);
+				}
+			}
 
-	request.detach();
+			if (hostIp.length() != 0)
+				g_ServerHostManager.SetHostIP(hostIp);
+		});
 }
 #endif // DEDICATED
 
@@ -325,6 +315,11 @@ void CHostState::Setup(void)
 	{
 		NET_GenerateKey();
 	}
+
+	DataBlock_InitCodecs();
+#ifndef DEDICATED
+	ClientDataBlockReceiver::AdvertiseCodecs();
+#endif // !DEDICATED
 #if !defined (DEDICATED) && !defined (CLIENT_DLL)
 	// Parallel processing of 'C_BaseAnimating::SetupBones()' is currently
 	// not supported on listen servers running the local client due to an
@@ -9,6 +9,11 @@
 
 static ConVar net_compressDataBlockLzAcceleration("net_compressDataBlockLzAcceleration", "1", FCVAR_DEVELOPMENTONLY, "The acceleration value for LZ4 data block compression");
 
+static ConVar net_compressDataBlockCodec("net_compressDataBlockCodec", "-1", FCVAR_DEVELOPMENTONLY, "The codec used for data block compression, -1 selects one per transfer", true, -1.f, true, float(DataBlockCodec_e::COUNT) - 1.f, "-1 = auto, 0 = none, 1 = LZ4, 2 = LZ4-HC, 3 = zstd");
+static ConVar net_compressDataBlockHCSendTime("net_compressDataBlockHCSendTime", "0.02", FCVAR_DEVELOPMENTONLY, "Estimated send time in seconds above which data blocks are compressed with LZ4-HC", true, 0.f, false, 0.f);
+static ConVar net_compressDataBlockZstdSendTime("net_compressDataBlockZstdSendTime", "0.1", FCVAR_DEVELOPMENTONLY, "Estimated send time in seconds above which data blocks are compressed with zstd", true, 0.f, false, 0.f);
+static ConVar net_compressDataBlockDebug("net_compressDataBlockDebug", "0", FCVAR_DEVELOPMENTONLY, "Log the codec and ratio of each data block transfer");
+
 //-----------------------------------------------------------------------------
 // Purpose: sends the data block
 //-----------------------------------------------------------------------------
@@ -93,6 +98,56 @@ const char* ServerDataBlockSender::GetReceiverName() const
     return m_pClient->m_szServerName;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: selects the codec for a transfer, the slower the link, the more
+//          time we can spend on compressing the data to save on send time
+// Input  : dataSize - 
+//          *useDictionary - 
+//-----------------------------------------------------------------------------
+DataBlockCodec_e ServerDataBlockSender::SelectCodec(const int dataSize, bool* const useDictionary) const
+{
+	*useDictionary = false;
+
+	const CClient* const pClient = m_pClient;
+	KeyValues* const pConVars = pClient->m_ConVars;
+
+	// receivers that don't advertise their codecs only understand LZ4
+	const uint32_t codecMask = pConVars
+		? uint32_t(pConVars->GetInt("cl_dataBlockCodecs", DATABLOCK_CODECS_RETAIL)) | DATABLOCK_CODECS_RETAIL
+		: DATABLOCK_CODECS_RETAIL;
+
+	const int forcedCodec = net_compressDataBlockCodec.GetInt();
+	DataBlockCodec_e codec = DataBlockCodec_e::LZ4;
+
+	if (forcedCodec >= 0)
+	{
+		codec = DataBlockCodec_e(forcedCodec);
+	}
+	else if (const CNetChan* const pChan = pClient->GetNetChan())
+	{
+		// estimate the time it takes to send the raw data over this link, the
+		// rate is the client's bandwidth which we scale by the measured loss
+		const float dataRate = float(pChan->GetDataRate()) * (1.0f - pChan->GetAvgLoss(FLOW_OUTGOING));
+		const float sendTime = dataRate > 0.0f ? float(dataSize) / dataRate : FLT_MAX;
+
+		if (sendTime >= net_compressDataBlockZstdSendTime.GetFloat())
+			codec = DataBlockCodec_e::ZSTD;
+		else if (sendTime >= net_compressDataBlockHCSendTime.GetFloat())
+			codec = DataBlockCodec_e::LZ4HC;
+	}
+
+	if (!(codecMask & DATABLOCK_CODEC_BIT(codec)))
+		codec = DataBlockCodec_e::LZ4;
+
+	if (codec == DataBlockCodec_e::ZSTD)
+	{
+		const uint32_t dictId = DataBlock_GetDictionaryId();
+		*useDictionary = dictId && pConVars && uint32_t(pConVars->GetInt("cl_dataBlockDictId", 0)) == dictId;
+	}
+
+	return codec;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: write the whole data in the data block scratch buffer
 //-----------------------------------------------------------------------------
@@ -102,20 +157,45 @@ void ServerDataBlockSender::WriteDataBlock(const uint8_t* const sourceData, cons
 	AcquireSRWLockExclusive(&m_Lock);
 
 	ServerDataBlockHeader_s* const pHeader = reinterpret_cast<ServerDataBlockHeader_s*>(m_pScratchBuffer);
+	uint8_t* const pEncodeBuf = m_pScratchBuffer + sizeof(ServerDataBlockHeader_s);
+
+	const int encodeCapacity = SNAPSHOT_SCRATCH_BUFFER_SIZE - sizeof(ServerDataBlockHeader_s);
 	bool copyRaw = true;
 
 	int actualDataSize = dataSize;
 
 	if (net_compressDataBlock->GetBool())
 	{
-		const int encodedSize = LZ4_compress_fast((const char*)sourceData, (char*)m_pScratchBuffer + sizeof(ServerDataBlockHeader_s),
-			dataSize, SNAPSHOT_SCRATCH_BUFFER_SIZE, net_compressDataBlockLzAcceleration.GetInt());
+		bool useDictionary;
+		const DataBlockCodec_e codec = SelectCodec(dataSize, &useDictionary);
+
+		int encodedSize = 0;
+
+		if (codec == DataBlockCodec_e::LZ4)
+		{
+			encodedSize = LZ4_compress_fast((const char*)sourceData, (char*)pEncodeBuf,
+				dataSize, encodeCapacity, net_compressDataBlockLzAcceleration.GetInt());
+		}
+		else if (codec != DataBlockCodec_e::NONE)
+		{
+			encodedSize = DataBlock_Compress(codec, useDictionary, sourceData, dataSize, pEncodeBuf, encodeCapacity);
+		}
+
+		if (net_compressDataBlockDebug.GetBool())
+		{
+			Msg(eDLL_T::SERVER, "Data block \"%s\" for client \"%s\": codec '%s'%s, '%d' -> '%d' bytes\n",
+				debugName, GetReceiverName(), DataBlock_GetCodecName(codec),
+				useDictionary ? " (dictionary)" : "", dataSize, encodedSize);
+		}
 
 		// this shouldn't happen at all
 		if (!encodedSize)
 		{
-			Assert(0);
-			Error(eDLL_T::SERVER, 0, "LZ4 error compressing data block for client.\n");
+			if (codec != DataBlockCodec_e::NONE)
+			{
+				Assert(0);
+				Error(eDLL_T::SERVER, 0, "%s error compressing data block for client.\n", DataBlock_GetCodecName(codec));
+			}
 		}
 
 		// make sure the encoded data is smaller than the raw data, in some cases
@@ -124,7 +204,7 @@ void ServerDataBlockSender::WriteDataBlock(const uint8_t* const sourceData, cons
 		{
 			actualDataSize = encodedSize;
 
-			pHeader->isCompressed = true;
+			pHeader->codec = codec;
 			copyRaw = false;
 		}
 	}
@@ -135,8 +215,8 @@ void ServerDataBlockSender::WriteDataBlock(const uint8_t* const sourceData, cons
 		// this should equal the dataSize at this point, even if compression failed
 		Assert(actualDataSize == dataSize);
 
-		pHeader->isCompressed = false;
-		memcpy(m_pScratchBuffer + sizeof(ServerDataBlockHeader_s), sourceData, actualDataSize);
+		pHeader->codec = DataBlockCodec_e::NONE;
+		memcpy(pEncodeBuf, sourceData, actualDataSize);
 	}
 
 	// NOTE: we copy data in the scratch buffer with an offset of
@@ -19,6 +19,9 @@ public:
 	virtual const char* GetReceiverName() const override;
 
 	void WriteDataBlock(const uint8_t* const sourceData, const int dataSize, const bool isMultiplayer, const char* const debugName);
+
+private:
+	DataBlockCodec_e SelectCodec(const int dataSize, bool* const useDictionary) const;
 };
 
 struct ServerDataBlock
@@ -30,7 +33,7 @@ struct ServerDataBlock
 
 struct ServerDataBlockHeader_s
 {
-	bool isCompressed;
+	DataBlockCodec_e codec;
 };
 
 inline void* (*ServerDataBlockSender__SendDataBlock)(ServerDataBlockSender* thisptr,
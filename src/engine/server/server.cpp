@@ -189,11 +189,7 @@ CClient* CServer::ConnectClient(CServer* pServer, user_creds_s* pChallenge)
 	{
 		if (!pClient->GetNetChan()->GetRemoteAddress().IsLoopback())
 		{
-			const string addressBufferCopy(pszAddresBuffer);
-			const string personaNameCopy(pszPersonaName);
-
-			std::thread th(SV_CheckForBanAndDisconnect, pClient, addressBufferCopy, nNucleusID, personaNameCopy, nPort);
-			th.detach();
+			SV_CheckForBanAndDisconnect(pClient, pszAddresBuffer, nNucleusID, pszPersonaName, nPort);
 		}
 	}
 
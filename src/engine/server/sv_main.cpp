@@ -16,50 +16,340 @@
 #include "game/server/gameinterface.h"
 
 //-----------------------------------------------------------------------------
-// Purpose: checks if particular client is banned on the comp server
+// Global ban verdict cache; verdicts of the master server are cached per
+// NucleusID and address, so a lobby reconnecting after a map change doesn't
+// query every client again. Lookups for a key that is already being queried
+// wait on that query, and lookups shortly before the periodic bulk check are
+// answered by it. Only accessed on the main thread.
+//-----------------------------------------------------------------------------
+static ConVar sv_banVerdictCacheTime("sv_banVerdictCacheTime", "60", FCVAR_RELEASE, "Time in seconds a global ban verdict is cached.", true, 0.f, false, 0.f);
+static ConVar sv_banVerdictCacheSize("sv_banVerdictCacheSize", "1024", FCVAR_DEVELOPMENTONLY, "Maximum number of cached global ban verdicts.", true, 1.f, false, 0.f);
+static ConVar sv_banCheckFoldWindow("sv_banCheckFoldWindow", "3.0", FCVAR_DEVELOPMENTONLY, "Ban checks are answered by the bulk check if it is due within this many seconds.", true, 0.f, false, 0.f);
+
+enum BanVerdictState_e
+{
+	VERDICT_RESOLVED = 0,
+	VERDICT_QUERYING, // Checked on its own.
+	VERDICT_FOLDED,   // Waiting for the next bulk check.
+	VERDICT_BULK      // Checked as part of a bulk check.
+};
+
+struct BanVerdictWaiter_s
+{
+	CClient* pClient;
+	int nPort;
+};
+
+struct BanVerdict_s
+{
+	BanVerdict_s()
+		: nNucleusID(0)
+		, flExpireTime(0.0)
+		, flFoldDeadline(0.0)
+		, nState(VERDICT_RESOLVED)
+		, bBanned(false)
+	{}
+
+	string svIPAddr;
+	string svPersonaName;
+	NucleusID_t nNucleusID;
+
+	string svReason;
+	double flExpireTime;
+	double flFoldDeadline;
+
+	BanVerdictState_e nState;
+	bool bBanned;
+
+	vector<BanVerdictWaiter_s> waiters; // Clients connected while unresolved.
+};
+
+static std::unordered_map<string, BanVerdict_s> s_BanVerdicts;
+static double s_flLastBulkCheckTime = 0.0;
+
+static int64_t s_nBanVerdictHits = 0;
+static int64_t s_nBanVerdictMisses = 0;
+static int64_t s_nBanVerdictCoalesced = 0;
+static int64_t s_nBanVerdictFolded = 0;
+static int64_t s_nBanVerdictQueries = 0;
+static int64_t s_nBanVerdictEvictions = 0;
+
+static string SV_GetBanVerdictKey(const NucleusID_t nNucleusID, const char* const pszIPAddr)
+{
+	return Format("%llu@%s", nNucleusID, pszIPAddr);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: disconnects the client if it is still the one that was checked
+//-----------------------------------------------------------------------------
+static void SV_DisconnectGloballyBanned(CClient* const pClient, const string& svIPAddr,
+	const NucleusID_t nNucleusID, const int nPort, const string& svError)
+{
+	// Make sure client isn't already disconnected,
+	// and that if there is a valid netchannel, that
+	// it hasn't been taken by a different client by
+	// the time this task is getting executed.
+	const CNetChan* const pChan = pClient->GetNetChan();
+	if (pChan && pClient->GetNucleusID() == nNucleusID)
+	{
+		const int nUserID = pClient->GetUserID();
+
+		pClient->Disconnect(Reputation_t::REP_MARK_BAD, svError.c_str());
+		Warning(eDLL_T::SERVER, "Removed client '[%s]:%i' from slot #%i ('%llu' is banned globally!)\n",
+			svIPAddr.c_str(), nPort, nUserID, nNucleusID);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: makes room for a new verdict, expired verdicts go first and then
+//          the ones closest to expiring; unresolved verdicts are kept
+//-----------------------------------------------------------------------------
+static void SV_EvictBanVerdicts()
+{
+	const size_t nMaxVerdicts = size_t(sv_banVerdictCacheSize.GetInt());
+
+	if (s_BanVerdicts.size() < nMaxVerdicts)
+		return;
+
+	const double flTime = Plat_FloatTime();
+
+	for (auto it = s_BanVerdicts.begin(); it != s_BanVerdicts.end();)
+	{
+		if (it->second.nState == VERDICT_RESOLVED && it->second.flExpireTime <= flTime)
+		{
+			it = s_BanVerdicts.erase(it);
+			s_nBanVerdictEvictions++;
+		}
+		else
+			++it;
+	}
+
+	while (s_BanVerdicts.size() >= nMaxVerdicts)
+	{
+		auto oldest = s_BanVerdicts.end();
+
+		for (auto it = s_BanVerdicts.begin(); it != s_BanVerdicts.end(); ++it)
+		{
+			if (it->second.nState == VERDICT_RESOLVED &&
+				(oldest == s_BanVerdicts.end() || it->second.flExpireTime < oldest->second.flExpireTime))
+			{
+				oldest = it;
+			}
+		}
+
+		if (oldest == s_BanVerdicts.end())
+			break; // Everything is unresolved.
+
+		s_BanVerdicts.erase(oldest);
+		s_nBanVerdictEvictions++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: stores the verdict for a key and acts on the clients waiting for it
+// Input  : &svKey      -
+//          nNucleusID  -
+//          &svIPAddr   -
+//          bSuccess    - if false, the verdict is dropped and the waiting
+//                        clients are let in
+//          bBanned     -
+//          &svReason   -
+//-----------------------------------------------------------------------------
+static void SV_ResolveBanVerdict(const string& svKey, const NucleusID_t nNucleusID,
+	const string& svIPAddr, const bool bSuccess, const bool bBanned, const string& svReason)
+{
+	auto it = s_BanVerdicts.find(svKey);
+
+	if (it == s_BanVerdicts.end())
+	{
+		if (!bSuccess)
+			return;
+
+		SV_EvictBanVerdicts();
+
+		it = s_BanVerdicts.emplace(svKey, BanVerdict_s()).first;
+		it->second.svIPAddr = svIPAddr;
+		it->second.nNucleusID = nNucleusID;
+	}
+
+	BanVerdict_s& verdict = it->second;
+
+	vector<BanVerdictWaiter_s> waiters;
+	waiters.swap(verdict.waiters);
+
+	verdict.nState = VERDICT_RESOLVED;
+	verdict.bBanned = bBanned;
+	verdict.svReason = svReason;
+	verdict.flExpireTime = Plat_FloatTime() + sv_banVerdictCacheTime.GetFloat();
+
+	if (!bSuccess)
+		s_BanVerdicts.erase(it);
+
+	if (!bBanned)
+		return;
+
+	for (const BanVerdictWaiter_s& waiter : waiters)
+		SV_DisconnectGloballyBanned(waiter.pClient, svIPAddr, nNucleusID, waiter.nPort, svReason);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: queries the master server for the verdict of a single key
+//-----------------------------------------------------------------------------
+static void SV_QueryBanVerdict(const string& svKey, BanVerdict_s& verdict)
+{
+	verdict.nState = VERDICT_QUERYING;
+	s_nBanVerdictQueries++;
+
+	const NucleusID_t nNucleusID = verdict.nNucleusID;
+	const string svIPAddr = verdict.svIPAddr;
+
+	g_MasterServer.CheckForBanAsync(svIPAddr, nNucleusID, verdict.svPersonaName,
+		[svKey, nNucleusID, svIPAddr](const bool bSuccess, const bool bBanned, const string& svReason)
+		{
+			SV_ResolveBanVerdict(svKey, nNucleusID, svIPAddr, bSuccess, bBanned, svReason);
+		});
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: checks if particular client is banned on the comp server, the
+//          client is disconnected on the main thread once the verdict is in
 //-----------------------------------------------------------------------------
 void SV_CheckForBanAndDisconnect(CClient* const pClient, const string& svIPAddr,
 	const NucleusID_t nNucleusID, const string& svPersonaName, const int nPort)
 {
 	Assert(pClient != nullptr);
+	Assert(ThreadInMainThread());
+
+	const string svKey = SV_GetBanVerdictKey(nNucleusID, svIPAddr.c_str());
+	const double flTime = Plat_FloatTime();
 
-	string svError;
-	const bool bCompBanned = g_MasterServer.CheckForBan(svIPAddr, nNucleusID, svPersonaName, svError);
+	auto it = s_BanVerdicts.find(svKey);
 
-	if (bCompBanned)
+	if (it != s_BanVerdicts.end())
 	{
-		g_TaskQueue.Dispatch([pClient, svError, svIPAddr, nNucleusID, nPort]
+		BanVerdict_s& verdict = it->second;
+
+		if (verdict.nState != VERDICT_RESOLVED)
+		{
+			verdict.waiters.push_back({ pClient, nPort });
+			s_nBanVerdictCoalesced++;
+
+			// The bulk check didn't happen in time; check it on its own.
+			if (verdict.nState == VERDICT_FOLDED && flTime > verdict.flFoldDeadline)
+				SV_QueryBanVerdict(svKey, verdict);
+
+			return;
+		}
+
+		if (flTime < verdict.flExpireTime)
+		{
+			s_nBanVerdictHits++;
+
+			if (verdict.bBanned)
 			{
-				// Make sure client isn't already disconnected,
-				// and that if there is a valid netchannel, that
-				// it hasn't been taken by a different client by
-				// the time this task is getting executed.
-				const CNetChan* const pChan = pClient->GetNetChan();
-				if (pChan && pClient->GetNucleusID() == nNucleusID)
-				{
-					const int nUserID = pClient->GetUserID();
+				const string svReason = verdict.svReason;
 
-					pClient->Disconnect(Reputation_t::REP_MARK_BAD, svError.c_str());
-					Warning(eDLL_T::SERVER, "Removed client '[%s]:%i' from slot #%i ('%llu' is banned globally!)\n",
-						svIPAddr.c_str(), nPort, nUserID, nNucleusID);
-				}
-			}, 0);
+				g_TaskQueue.Dispatch([pClient, svIPAddr, nNucleusID, nPort, svReason]
+					{
+						SV_DisconnectGloballyBanned(pClient, svIPAddr, nNucleusID, nPort, svReason);
+					}, 0);
+			}
+
+			return;
+		}
+	}
+	else
+	{
+		SV_EvictBanVerdicts();
+		it = s_BanVerdicts.emplace(svKey, BanVerdict_s()).first;
+	}
+
+	s_nBanVerdictMisses++;
+
+	BanVerdict_s& verdict = it->second;
+
+	verdict.svIPAddr = svIPAddr;
+	verdict.svPersonaName = svPersonaName;
+	verdict.nNucleusID = nNucleusID;
+	verdict.waiters.push_back({ pClient, nPort });
+
+	// If the bulk check is about to run, it'll answer this one too.
+	const float flFoldWindow = sv_banCheckFoldWindow.GetFloat();
+	const double flBulkCheckTime = s_flLastBulkCheckTime + sv_banlistRefreshRate.GetFloat();
+
+	if (s_flLastBulkCheckTime > 0.0 && flFoldWindow > 0.f &&
+		flBulkCheckTime - flTime <= flFoldWindow && flTime < flBulkCheckTime + flFoldWindow)
+	{
+		verdict.nState = VERDICT_FOLDED;
+		verdict.flFoldDeadline = flBulkCheckTime + flFoldWindow;
+
+		s_nBanVerdictFolded++;
+		return;
 	}
+
+	SV_QueryBanVerdict(svKey, verdict);
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: checks if particular client is banned on the master server
+// Purpose: handles the result of a bulk check, the verdicts of all checked
+//          clients are cached
+// Input  : *pCheckedVec  - the clients that were checked, freed here
+//          bSuccess      -
+//          &bannedVec    -
 //-----------------------------------------------------------------------------
-void SV_ProcessBulkCheck(const CBanSystem::BannedList_t* const pBannedVec)
+static void SV_ProcessBulkCheck(CBanSystem::BannedList_t* const pCheckedVec,
+	const bool bSuccess, const CBanSystem::BannedList_t& bannedVec)
 {
-	CBanSystem::BannedList_t* const outBannedVec = new CBanSystem::BannedList_t();
-	g_MasterServer.GetBannedList(*pBannedVec, *outBannedVec);
+	if (bSuccess)
+		SV_CheckClientsForBan(&bannedVec);
 
-	g_TaskQueue.Dispatch([outBannedVec]
+	FOR_EACH_VEC(*pCheckedVec, i)
+	{
+		const CBanSystem::Banned_t& checked = (*pCheckedVec)[i];
+		const string svKey = SV_GetBanVerdictKey(checked.m_NucleusID, checked.m_Address.String());
+
+		if (!bSuccess)
+		{
+			// Check the ones that were waiting for this on their own.
+			auto it = s_BanVerdicts.find(svKey);
+
+			if (it != s_BanVerdicts.end() && it->second.nState == VERDICT_BULK)
+				SV_QueryBanVerdict(svKey, it->second);
+
+			continue;
+		}
+
+		const char* pszReason = nullptr;
+
+		FOR_EACH_VEC(bannedVec, j)
 		{
-			SV_CheckClientsForBan(outBannedVec);
-			delete outBannedVec;
-		}, 0);
+			if (bannedVec[j].m_NucleusID == checked.m_NucleusID)
+			{
+				pszReason = bannedVec[j].m_Address.String();
+				break;
+			}
+		}
+
+		SV_ResolveBanVerdict(svKey, checked.m_NucleusID, checked.m_Address.String(),
+			true, pszReason != nullptr, pszReason ? pszReason : "");
+	}
+
+	delete pCheckedVec;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: prints the global ban verdict cache statistics
+//-----------------------------------------------------------------------------
+void SV_PrintBanVerdictStats()
+{
+	const int64_t nLookups = s_nBanVerdictHits + s_nBanVerdictMisses + s_nBanVerdictCoalesced;
+
+	Msg(eDLL_T::SERVER, "Ban verdicts: '%zu' cached, '%lld' lookups ('%lld' hits, '%lld' misses, '%lld' coalesced; '%.1f%%' answered without a query)\n",
+		s_BanVerdicts.size(), nLookups, s_nBanVerdictHits, s_nBanVerdictMisses, s_nBanVerdictCoalesced,
+		nLookups ? double(nLookups - s_nBanVerdictQueries) * 100.0 / double(nLookups) : 0.0);
+
+	Msg(eDLL_T::SERVER, "Ban verdicts: '%lld' queries, '%lld' folded into bulk checks, '%lld' evicted\n",
+		s_nBanVerdictQueries, s_nBanVerdictFolded, s_nBanVerdictEvictions);
 }
 
 //-----------------------------------------------------------------------------
@@ -99,7 +389,14 @@ void SV_CheckClientsForBan(const CBanSystem::BannedList_t* const pBannedVec /*=
 		// on the server. This will be used for bulk checking so live
 		// bans could be performed, as this function is called periodically.
 		if (bannedVec)
+		{
 			bannedVec->AddToTail(CBanSystem::Banned_t(szIPAddr, nNucleusID));
+
+			auto it = s_BanVerdicts.find(SV_GetBanVerdictKey(nNucleusID, szIPAddr));
+
+			if (it != s_BanVerdicts.end() && it->second.nState == VERDICT_FOLDED)
+				it->second.nState = VERDICT_BULK;
+		}
 		else
 		{
 			// Check if current client is within provided banned list, and
@@ -121,17 +418,27 @@ void SV_CheckClientsForBan(const CBanSystem::BannedList_t* const pBannedVec /*=
 		}
 	}
 
-	if (bannedVec && !bannedVec->IsEmpty())
+	if (!bannedVec)
+		return;
+
+	s_flLastBulkCheckTime = Plat_FloatTime();
+
+	// Checks that were waiting for this bulk check, but whose client isn't
+	// part of it anymore, are done on their own.
+	for (auto& it : s_BanVerdicts)
+	{
+		if (it.second.nState == VERDICT_FOLDED)
+			SV_QueryBanVerdict(it.first, it.second);
+	}
+
+	if (!bannedVec->IsEmpty())
 	{
-		std::thread bulkCheck([bannedVec]()
+		g_MasterServer.GetBannedListAsync(*bannedVec, [bannedVec](const bool bSuccess, const CBanSystem::BannedList_t& outBannedVec)
 			{
-				SV_ProcessBulkCheck(bannedVec);
-				delete bannedVec;
+				SV_ProcessBulkCheck(bannedVec, bSuccess, outBannedVec);
 			});
-
-		bulkCheck.detach();
 	}
-	else if (bannedVec)
+	else
 	{
 		delete bannedVec;
 		bannedVec = nullptr;
@@ -33,6 +33,7 @@ static void RCON_PasswordChanged_f(IConVar* pConVar, const char* pOldString, flo
 static void RCON_WhiteListAddresChanged_f(IConVar* pConVar, const char* pOldString, float flOldValue, ChangeUserData_t pUserData);
 static void RCON_ConnectionCountChanged_f(IConVar* pConVar, const char* pOldString, float flOldValue, ChangeUserData_t pUserData);
 static void RCON_UseLoopbackSocketChanged_f(IConVar* pConVar, const char* pOldString, float flOldValue, ChangeUserData_t pUserData);
+static void RCON_UseIOThreadChanged_f(IConVar* pConVar, const char* pOldString, float flOldValue, ChangeUserData_t pUserData);
 
 static ConVar sv_rcon_password("sv_rcon_password", "", FCVAR_RELEASE, "Remote server access password (rcon server is disabled if empty)", &RCON_PasswordChanged_f);
 static ConVar sv_rcon_sendlogs("sv_rcon_sendlogs", "0", FCVAR_RELEASE, "Network console logs to connected and authenticated sockets");
@@ -40,13 +41,15 @@ static ConVar sv_rcon_sendlogs("sv_rcon_sendlogs", "0", FCVAR_RELEASE, "Network
 
 static ConVar sv_rcon_maxfailures("sv_rcon_maxfailures", "10", FCVAR_RELEASE, "Max number of times an user can fail rcon authentication before being banned", true, 1.f, false, 0.f);
 static ConVar sv_rcon_maxignores("sv_rcon_maxignores", "15", FCVAR_RELEASE, "Max number of times an user can ignore the instruction message before being banned", true, 1.f, false, 0.f);
-static ConVar sv_rcon_maxsockets("sv_rcon_maxsockets", "32", FCVAR_RELEASE, "Max number of accepted sockets before the server starts closing redundant sockets", true, 1.f, true, MAX_PLAYERS);
+static ConVar sv_rcon_maxsockets("sv_rcon_maxsockets", "32", FCVAR_RELEASE, "Max number of accepted sockets before the server starts closing redundant sockets", true, 1.f, true, RCON_MAX_ACCEPTED_SOCKETS);
 
 static ConVar sv_rcon_maxconnections("sv_rcon_maxconnections", "1", FCVAR_RELEASE, "Max number of authenticated connections before the server closes the listen socket", true, 1.f, true, MAX_PLAYERS, &RCON_ConnectionCountChanged_f);
 static ConVar sv_rcon_maxframesize("sv_rcon_maxframesize", "1024", FCVAR_RELEASE, "Max number of bytes allowed in a message frame from a non-authenticated netconsole", true, 0.f, false, 0.f);
+static ConVar sv_rcon_maxsendqueue("sv_rcon_maxsendqueue", "4194304", FCVAR_RELEASE, "Max number of bytes queued for sending to a netconsole before log messages to it are dropped", true, 65536.f, false, 0.f);
 static ConVar sv_rcon_whitelistaddress("sv_rcon_whitelistaddress", "", FCVAR_RELEASE, "This address is not considered a 'redundant' socket and will never be banned for failed authentication attempts", &RCON_WhiteListAddresChanged_f, "Format: '::ffff:127.0.0.1'");
 
 static ConVar sv_rcon_useloopbacksocket("sv_rcon_useloopbacksocket", "0", FCVAR_RELEASE, "Whether to bind rcon server to the loopback socket", &RCON_UseLoopbackSocketChanged_f);
+static ConVar sv_rcon_useiothread("sv_rcon_useiothread", "0", FCVAR_RELEASE, "Whether to wait on and read rcon sockets on a dedicated thread instead of polling them each frame", &RCON_UseIOThreadChanged_f);
 
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -55,6 +58,11 @@ CRConServer::CRConServer(void)
 	: m_nConnIndex(0)
 	, m_nAuthConnections(0)
 	, m_bInitialized(false)
+	, m_bIOThreadRunning(false)
+	, m_nIOThreadGeneration(0)
+	, m_pIOConnData(nullptr)
+	, m_nFrameTimeTotalUs(0)
+	, m_nFrameCount(0)
 {
 	memset(m_PasswordHash, 0, sizeof(m_PasswordHash));
 }
@@ -97,6 +105,11 @@ void CRConServer::Init(const char* pPassword, const char* pNetKey)
 	Msg(eDLL_T::SERVER, "Remote server access initialized ('%s') with key %s'%s%s%s'\n",
 		m_Address.ToString(), g_svReset, g_svGreyB, GetKey(), g_svReset);
 
+	if (sv_rcon_useiothread.GetBool())
+	{
+		StartIOThread();
+	}
+
 	m_bInitialized = true;
 }
 
@@ -115,6 +128,9 @@ void CRConServer::Shutdown(void)
 	}
 
 	m_bInitialized = false;
+	StopIOThread();
+
+	m_PendingFrames.Purge();
 
 	const int nConnCount = m_Socket.GetAcceptedSocketCount();
 	m_Socket.CloseAllAcceptedSockets();
@@ -242,65 +258,542 @@ void CRConServer::RunFrame(void)
 {
 	if (m_bInitialized)
 	{
-		m_Socket.RunFrame();
-		Think();
+		const double flStartTime = Plat_FloatTime();
 
-		const int nCount = m_Socket.GetAcceptedSocketCount();
-		for (m_nConnIndex = nCount - 1; m_nConnIndex >= 0; m_nConnIndex--)
 		{
-			CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(m_nConnIndex);
+			// The I/O thread accepts and reads sockets while holding this lock,
+			// which must be held while we process the sockets below.
+			AUTO_LOCK(m_Socket.GetMutex());
+			const bool bUseIOThread = m_bIOThreadRunning;
+
+			if (bUseIOThread)
+			{
+				ProcessIOEvents();
+			}
+			else
+			{
+				m_Socket.RunFrame();
+			}
+
+			Think();
+
+			const int nCount = m_Socket.GetAcceptedSocketCount();
+			for (m_nConnIndex = nCount - 1; m_nConnIndex >= 0; m_nConnIndex--)
+			{
+				CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(m_nConnIndex);
+
+				if (CheckForBan(data))
+				{
+					SendEncoded(data.m_hSocket, s_BannedMessage, "",
+						netcon::response_e::SERVERDATA_RESPONSE_AUTH, int(eDLL_T::NETCON));
+
+					Disconnect("banned");
+					continue;
+				}
+
+				if (!bUseIOThread)
+				{
+					Recv(data, sv_rcon_maxframesize.GetInt());
+				}
+			}
+
+			FlushSendQueues();
+		}
+
+		m_nFrameTimeTotalUs.fetch_add(int64_t((Plat_FloatTime() - flStartTime) * 1000000.0), std::memory_order_relaxed);
+		m_nFrameCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: process the events queued by the I/O thread
+//-----------------------------------------------------------------------------
+void CRConServer::ProcessIOEvents(void)
+{
+	RConIOEvent_s event;
+
+	while (m_IOEvents.PopItem(&event))
+	{
+		// Socket might have been closed after the event got queued, and its
+		// handle reused by a new connection.
+		m_nConnIndex = m_Socket.FindAcceptedSocket(event.hSocket);
+
+		if (m_nConnIndex == -1 ||
+			m_Socket.GetAcceptedSocketData(m_nConnIndex).m_nSerial != event.nSerial)
+		{
+			continue;
+		}
+
+		if (event.type == RConIOEvent_s::CLOSE)
+		{
+			Disconnect(event.pszReason);
+			continue;
+		}
+
+		CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(m_nConnIndex);
+
+		if (!data.m_bPendingClose)
+		{
+			ProcessRequest(event.request, data);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: starts the I/O thread
+//-----------------------------------------------------------------------------
+void CRConServer::StartIOThread(void)
+{
+	Assert(!m_bIOThreadRunning);
+
+	m_bIOThreadRunning = true;
+	m_IOThread = std::thread(&CRConServer::IOThreadRun, this, ++m_nIOThreadGeneration);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: stops the I/O thread, queued events are dropped
+//-----------------------------------------------------------------------------
+void CRConServer::StopIOThread(void)
+{
+	if (!m_IOThread.joinable())
+	{
+		return;
+	}
+
+	m_bIOThreadRunning = false;
+	m_nIOThreadGeneration++;
+
+	// The I/O thread could be waiting on the socket lock, which we can't
+	// release if we hold it ourselves (e.g. shutting down from RunFrame); let
+	// it finish on its own in that case; the generation tells it to stop
+	// even if a new I/O thread has been started by then.
+	if (m_Socket.GetMutex().GetOwnerId() == ThreadGetCurrentId())
+	{
+		m_IOThread.detach();
+	}
+	else
+	{
+		m_IOThread.join();
+	}
+
+	m_IOEvents.Purge();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: returns whether we are parsing on the I/O thread; the connection
+//			pointer is only read on the I/O thread, which is the one setting it
+//-----------------------------------------------------------------------------
+bool CRConServer::IsIOThread(void) const
+{
+	return std::this_thread::get_id() == m_IOThread.get_id() && m_pIOConnData;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: I/O thread main loop; waits for the sockets to become readable,
+//			accepts new connections and decodes the received requests. The
+//			socket lock is only held while receiving, so the frame thread
+//			isn't blocked on decrypting and parsing the requests
+//-----------------------------------------------------------------------------
+void CRConServer::IOThreadRun(const int nGeneration)
+{
+	// Keyed by connection serial, only accessed on this thread.
+	std::unordered_map<uint32_t, RConIOConnection_s> connections;
+
+	CUtlVector<WSAPOLLFD> pollFds;
+	CUtlVector<RConIOConnection_s*> pollConns; // Null for the listen socket.
+
+	while (m_nIOThreadGeneration == nGeneration)
+	{
+		pollFds.RemoveAll();
+		pollConns.RemoveAll();
+
+		for (auto& it : connections)
+		{
+			it.second.bAccepted = false;
+		}
+
+		{
+			AUTO_LOCK(m_Socket.GetMutex());
+
+			if (m_Socket.IsListening())
+			{
+				WSAPOLLFD& pollFd = pollFds[pollFds.AddToTail()];
+
+				pollFd.fd = SOCKET(m_Socket.GetListenSocketHandle());
+				pollFd.events = POLLRDNORM;
+				pollFd.revents = 0;
+
+				pollConns.AddToTail(nullptr);
+			}
+
+			for (int i = 0, n = m_Socket.GetAcceptedSocketCount(); i < n; i++)
+			{
+				const CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(i);
+				RConIOConnection_s& conn = connections.try_emplace(data.m_nSerial, data).first->second;
+
+				conn.bAccepted = true;
+
+				if (conn.data.m_bPendingClose)
+				{
+					continue;
+				}
+
+				// Authenticated on the frame thread.
+				conn.data.m_bAuthorized = data.m_bAuthorized;
+
+				WSAPOLLFD& pollFd = pollFds[pollFds.AddToTail()];
+
+				pollFd.fd = SOCKET(data.m_hSocket);
+				pollFd.events = POLLRDNORM;
+				pollFd.revents = 0;
+
+				pollConns.AddToTail(&conn);
+			}
+		}
+
+		// Forget the connections that have been closed by the frame thread.
+		for (auto it = connections.begin(); it != connections.end();)
+		{
+			if (it->second.bAccepted)
+				++it;
+			else
+				it = connections.erase(it);
+		}
 
-			if (CheckForBan(data))
+		if (pollFds.IsEmpty())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(RCON_IO_POLL_TIMEOUT_MS));
+			continue;
+		}
+
+		const int nReady = ::WSAPoll(pollFds.Base(), ULONG(pollFds.Count()), RCON_IO_POLL_TIMEOUT_MS);
+
+		if (nReady == SOCKET_ERROR)
+		{
+			// Sockets can get closed by the frame thread while we wait.
+			std::this_thread::sleep_for(std::chrono::milliseconds(RCON_IO_POLL_TIMEOUT_MS));
+			continue;
+		}
+
+		if (nReady == 0)
+		{
+			continue;
+		}
+
+		{
+			AUTO_LOCK(m_Socket.GetMutex());
+
+			FOR_EACH_VEC(pollFds, i)
 			{
-				SendEncoded(data.m_hSocket, s_BannedMessage, "",
-					netcon::response_e::SERVERDATA_RESPONSE_AUTH, int(eDLL_T::NETCON));
+				if (!pollFds[i].revents || m_nIOThreadGeneration != nGeneration)
+				{
+					continue;
+				}
+
+				RConIOConnection_s* const pConn = pollConns[i];
+
+				if (!pConn)
+				{
+					m_Socket.ProcessAccept();
+					continue;
+				}
 
-				Disconnect("banned");
-				continue;
+				// Only read sockets that haven't been closed while we waited.
+				const int nIndex = m_Socket.FindAcceptedSocket(pConn->data.m_hSocket);
+
+				if (nIndex == -1 ||
+					m_Socket.GetAcceptedSocketData(nIndex).m_nSerial != pConn->data.m_nSerial)
+				{
+					continue;
+				}
+
+				IOThreadRecv(*pConn);
 			}
+		}
+
+		FOR_EACH_VEC(pollConns, i)
+		{
+			RConIOConnection_s* const pConn = pollConns[i];
 
-			Recv(data, sv_rcon_maxframesize.GetInt());
+			if (pConn && m_nIOThreadGeneration == nGeneration)
+			{
+				IOThreadParse(*pConn);
+			}
 		}
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: receives data from a readable socket on the I/O thread, the socket
+//			lock must be held
+// Input  : &conn - 
+//-----------------------------------------------------------------------------
+void CRConServer::IOThreadRecv(RConIOConnection_s& conn)
+{
+	vector<char>& recvBuf = conn.recvBuf;
+	recvBuf.resize(RCON_IO_RECV_BUFFER_SIZE);
+
+	const int nRecvLen = ::recv(conn.data.m_hSocket, recvBuf.data(), int(recvBuf.size()), MSG_NOSIGNAL);
+
+	if (nRecvLen == 0) // Socket was closed.
+	{
+		conn.pszCloseReason = "remote closed socket";
+		recvBuf.clear();
+	}
+	else if (nRecvLen < 0)
+	{
+		if (!m_Socket.IsSocketBlocking())
+		{
+			conn.pszCloseReason = "socket closed unexpectedly";
+		}
+
+		recvBuf.clear();
+	}
+	else
+	{
+		recvBuf.resize(nRecvLen);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: decrypts and decodes the data received from a socket on the I/O
+//			thread, this runs without holding the socket lock
+// Input  : &conn - 
+//-----------------------------------------------------------------------------
+void CRConServer::IOThreadParse(RConIOConnection_s& conn)
+{
+	if (conn.recvBuf.empty() && !conn.pszCloseReason)
+	{
+		return;
+	}
+
+	m_pIOConnData = &conn.data;
+
+	if (!conn.recvBuf.empty())
+	{
+		ProcessBuffer(conn.data, conn.recvBuf.data(), int(conn.recvBuf.size()), sv_rcon_maxframesize.GetInt());
+		conn.recvBuf.clear();
+	}
+
+	// Close after the requests received before it have been queued.
+	if (conn.pszCloseReason)
+	{
+		Disconnect(conn.pszCloseReason);
+		conn.pszCloseReason = nullptr;
+	}
+
+	m_pIOConnData = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: queues the connection being parsed on the I/O thread for closing
+// Input  : *szReason - 
+//-----------------------------------------------------------------------------
+void CRConServer::IOThreadQueueClose(const char* szReason)
+{
+	CConnectedNetConsoleData& data = *m_pIOConnData;
+
+	if (data.m_bPendingClose)
+	{
+		return;
+	}
+
+	data.m_bPendingClose = true;
+
+	RConIOEvent_s event;
+	event.type = RConIOEvent_s::CLOSE;
+	event.hSocket = data.m_hSocket;
+	event.nSerial = data.m_nSerial;
+	event.pszReason = szReason;
+
+	m_IOEvents.PushItem(std::move(event));
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: send message to all connected sockets
 // Input  : *pMsgBuf - 
 //			nMsgLen - 
 // Output: true on success, false otherwise
 //-----------------------------------------------------------------------------
-bool CRConServer::SendToAll(const char* pMsgBuf, const int nMsgLen) const
+bool CRConServer::SendToAll(const char* pMsgBuf, const int nMsgLen)
+{
+	return SendToAll(vector<char>(pMsgBuf, pMsgBuf + nMsgLen));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: send message to all connected sockets; the message is queued and
+//			sent on the next frame, this can be called from any thread
+// Input  : &&vecMsg - 
+// Output: true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CRConServer::SendToAll(vector<char>&& vecMsg)
 {
-	ostringstream sendbuf;
-	const u_long nLen = htonl(u_long(nMsgLen));
+	if (!m_bInitialized)
+	{
+		return false;
+	}
 
-	bool bSuccess = true;
+	// Serialized once, the frame is shared by the send queues of all sockets.
+	m_PendingFrames.PushItem(std::make_shared<const vector<char>>(std::move(vecMsg)));
+	return true;
+}
 
-	sendbuf.write(reinterpret_cast<const char*>(&nLen), sizeof(u_long));
-	sendbuf.write(pMsgBuf, nMsgLen);
+//-----------------------------------------------------------------------------
+// Purpose: moves the pending broadcast frames into the send queues of the
+//			authenticated sockets
+//-----------------------------------------------------------------------------
+void CRConServer::DistributePendingFrames(void)
+{
+	RConSendFrame_t frame;
 
-	const int nCount = m_Socket.GetAcceptedSocketCount();
-	for (int i = nCount - 1; i >= 0; i--)
+	while (m_PendingFrames.PopItem(&frame))
+	{
+		const int nCount = m_Socket.GetAcceptedSocketCount();
+		for (int i = nCount - 1; i >= 0; i--)
+		{
+			CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(i);
+
+			if (data.m_bAuthorized && !data.m_bInputOnly && !data.m_bPendingClose)
+			{
+				QueueFrame(data, frame, true);
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: appends a frame to the send queue of a socket
+// Input  : &data - 
+//			&frame - 
+//			bDroppable - whether to drop the frame if the send queue is full
+// Output: true if queued, false if dropped
+//-----------------------------------------------------------------------------
+bool CRConServer::QueueFrame(CConnectedNetConsoleData& data, const RConSendFrame_t& frame, const bool bDroppable)
+{
+	const size_t nFrameSize = sizeof(u_long) + frame->size();
+
+	// Drop messages to netconsoles that don't keep up instead of buffering
+	// without bound; frames are dropped whole so the stream stays in sync.
+	if (bDroppable && !data.m_SendQueue.empty() &&
+		data.m_nSendQueueSize + nFrameSize > size_t(sv_rcon_maxsendqueue.GetInt()))
 	{
-		const CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(i);
+		data.m_nDroppedFrames++;
+		return false;
+	}
+
+	data.m_SendQueue.push_back(frame);
+	data.m_nSendQueueSize += nFrameSize;
+
+	return true;
+}
 
-		if (data.m_bAuthorized && !data.m_bInputOnly)
+//-----------------------------------------------------------------------------
+// Purpose: sends as much of the send queue as the socket accepts without
+//			blocking, gathering the queued frames into as few calls as possible
+// Input  : &data - 
+// Output: false if the socket failed, true otherwise
+//-----------------------------------------------------------------------------
+bool CRConServer::FlushSendQueue(CConnectedNetConsoleData& data)
+{
+	while (!data.m_SendQueue.empty())
+	{
+		WSABUF buffers[RCON_MAX_SEND_FRAMES * 2];
+		u_long prefixes[RCON_MAX_SEND_FRAMES];
+
+		const int nFrames = Min(int(data.m_SendQueue.size()), RCON_MAX_SEND_FRAMES);
+
+		DWORD nBuffers = 0;
+		size_t nSkip = data.m_nSendOffset; // The first frame could be partially sent.
+		size_t nRequested = 0;
+
+		for (int i = 0; i < nFrames; i++)
 		{
-			int ret = ::send(data.m_hSocket, sendbuf.str().data(),
-				int(sendbuf.str().size()), MSG_NOSIGNAL);
+			const vector<char>& frame = *data.m_SendQueue[i];
+			prefixes[i] = htonl(u_long(frame.size()));
 
-			if (ret == SOCKET_ERROR)
+			if (nSkip < sizeof(u_long))
 			{
-				if (!bSuccess)
-				{
-					bSuccess = false;
-				}
+				buffers[nBuffers].buf = reinterpret_cast<char*>(&prefixes[i]) + nSkip;
+				buffers[nBuffers].len = ULONG(sizeof(u_long) - nSkip);
+				nRequested += buffers[nBuffers++].len;
+
+				nSkip = 0;
+			}
+			else
+			{
+				nSkip -= sizeof(u_long);
+			}
+
+			if (frame.size() > nSkip)
+			{
+				buffers[nBuffers].buf = const_cast<char*>(frame.data()) + nSkip;
+				buffers[nBuffers].len = ULONG(frame.size() - nSkip);
+				nRequested += buffers[nBuffers++].len;
+			}
+
+			nSkip = 0;
+		}
+
+		DWORD nSent = 0;
+
+		if (::WSASend(SOCKET(data.m_hSocket), buffers, nBuffers, &nSent, 0, nullptr, nullptr) == SOCKET_ERROR)
+		{
+			// Socket buffer is full; try again next frame.
+			return m_Socket.IsSocketBlocking();
+		}
+
+		// Remove the frames that have been sent completely.
+		size_t nSentTotal = data.m_nSendOffset + nSent;
+		int nCompleted = 0;
+
+		for (; nCompleted < nFrames; nCompleted++)
+		{
+			const size_t nFrameSize = sizeof(u_long) + data.m_SendQueue[nCompleted]->size();
+
+			if (nSentTotal < nFrameSize)
+			{
+				break;
 			}
+
+			nSentTotal -= nFrameSize;
 		}
+
+		data.m_SendQueue.erase(data.m_SendQueue.begin(), data.m_SendQueue.begin() + nCompleted);
+		data.m_nSendOffset = nSentTotal;
+		data.m_nSendQueueSize -= nSent;
+
+		if (nSent < nRequested)
+		{
+			break; // Socket buffer is full.
+		}
+	}
+
+	if (data.m_SendQueue.empty() && data.m_nDroppedFrames)
+	{
+		Warning(eDLL_T::SERVER, "Dropped '%d' RCON messages to a netconsole that couldn't keep up\n", data.m_nDroppedFrames);
+		data.m_nDroppedFrames = 0;
 	}
 
-	return bSuccess;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: flushes the send queues of all connected sockets
+//-----------------------------------------------------------------------------
+void CRConServer::FlushSendQueues(void)
+{
+	DistributePendingFrames();
+
+	const int nCount = m_Socket.GetAcceptedSocketCount();
+	for (m_nConnIndex = nCount - 1; m_nConnIndex >= 0; m_nConnIndex--)
+	{
+		CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(m_nConnIndex);
+
+		if (!data.m_bPendingClose && !FlushSendQueue(data))
+		{
+			Disconnect("send failed");
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -313,7 +806,7 @@ bool CRConServer::SendToAll(const char* pMsgBuf, const int nMsgLen) const
 // Output: true on success, false otherwise
 //-----------------------------------------------------------------------------
 bool CRConServer::SendEncoded(const char* pResponseMsg, const char* pResponseVal,
-	const netcon::response_e responseType, const int nMessageId, const int nMessageType) const
+	const netcon::response_e responseType, const int nMessageId, const int nMessageType)
 {
 	vector<char> vecMsg;
 	if (!Serialize(vecMsg, pResponseMsg, pResponseVal,
@@ -321,17 +814,13 @@ bool CRConServer::SendEncoded(const char* pResponseMsg, const char* pResponseVal
 	{
 		return false;
 	}
-	if (!SendToAll(vecMsg.data(), int(vecMsg.size())))
-	{
-		Error(eDLL_T::SERVER, NO_ERROR, "Failed to send RCON message: (%s)\n", "SOCKET_ERROR");
-		return false;
-	}
 
-	return true;
+	return SendToAll(std::move(vecMsg));
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: encode and send message to specific socket
+// Purpose: encode and send message to specific socket; must be called on the
+//			frame thread as the socket's send queue is modified
 // Input  : hSocket - 
 //			*pResponseMsg - 
 //			*pResponseVal - 
@@ -341,7 +830,7 @@ bool CRConServer::SendEncoded(const char* pResponseMsg, const char* pResponseVal
 // Output: true on success, false otherwise
 //-----------------------------------------------------------------------------
 bool CRConServer::SendEncoded(const SocketHandle_t hSocket, const char* pResponseMsg, const char* pResponseVal,
-	const netcon::response_e responseType, const int nMessageId, const int nMessageType) const
+	const netcon::response_e responseType, const int nMessageId, const int nMessageType)
 {
 	vector<char> vecMsg;
 	if (!Serialize(vecMsg, pResponseMsg, pResponseVal,
@@ -349,12 +838,28 @@ bool CRConServer::SendEncoded(const SocketHandle_t hSocket, const char* pRespons
 	{
 		return false;
 	}
-	if (!Send(hSocket, vecMsg.data(), int(vecMsg.size())))
+
+	const int nIndex = m_Socket.FindAcceptedSocket(hSocket);
+
+	if (nIndex == -1)
 	{
-		Error(eDLL_T::SERVER, NO_ERROR, "Failed to send RCON message: (%s)\n", "SOCKET_ERROR");
-		return false;
+		// Not an accepted socket, send it directly.
+		if (!Send(hSocket, vecMsg.data(), int(vecMsg.size())))
+		{
+			Error(eDLL_T::SERVER, NO_ERROR, "Failed to send RCON message: (%s)\n", "SOCKET_ERROR");
+			return false;
+		}
+
+		return true;
 	}
 
+	// Queue the broadcast frames that are already pending first, so the
+	// messages arrive in the order they were sent.
+	DistributePendingFrames();
+
+	CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(nIndex);
+	QueueFrame(data, std::make_shared<const vector<char>>(std::move(vecMsg)), false);
+
 	return true;
 }
 
@@ -454,8 +959,33 @@ bool CRConServer::ProcessMessage(const char* pMsgBuf, const int nMsgLen)
 		return false;
 	}
 
+	if (IsIOThread())
+	{
+		// Hand the decoded request to the frame thread.
+		RConIOEvent_s event;
+		event.type = RConIOEvent_s::REQUEST;
+		event.hSocket = m_pIOConnData->m_hSocket;
+		event.nSerial = m_pIOConnData->m_nSerial;
+		event.pszReason = nullptr;
+		event.request = std::move(request);
+
+		m_IOEvents.PushItem(std::move(event));
+		return true;
+	}
+
 	CConnectedNetConsoleData& data = m_Socket.GetAcceptedSocketData(m_nConnIndex);
+	ProcessRequest(request, data);
+
+	return true;
+}
 
+//-----------------------------------------------------------------------------
+// Purpose: processes decoded request
+// Input  : &request - 
+//			&data - 
+//-----------------------------------------------------------------------------
+void CRConServer::ProcessRequest(const netcon::request& request, CConnectedNetConsoleData& data)
+{
 	if (!data.m_bAuthorized &&
 		request.requesttype() != netcon::request_e::SERVERDATA_REQUEST_AUTH)
 	{
@@ -465,7 +995,7 @@ bool CRConServer::ProcessMessage(const char* pMsgBuf, const int nMsgLen)
 
 		data.m_bValidated = false;
 		data.m_nIgnoredMessage++;
-		return true;
+		return;
 	}
 	switch (request.requesttype())
 	{
@@ -504,8 +1034,6 @@ bool CRConServer::ProcessMessage(const char* pMsgBuf, const int nMsgLen)
 			break;
 		}
 	}
-
-	return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -588,6 +1116,13 @@ bool CRConServer::CheckForBan(CConnectedNetConsoleData& data)
 //-----------------------------------------------------------------------------
 void CRConServer::Disconnect(const char* szReason) // NETMGR
 {
+	if (IsIOThread())
+	{
+		// Sockets are only closed on the frame thread.
+		IOThreadQueueClose(szReason);
+		return;
+	}
+
 	Disconnect(m_nConnIndex, szReason);
 }
 
@@ -610,6 +1145,8 @@ void CRConServer::Disconnect(const int nIndex, const char* szReason) // NETMGR
 		m_nAuthConnections--;
 	}
 
+	// Send what's still queued, e.g. the reason for closing the connection.
+	FlushSendQueue(data);
 	m_Socket.CloseAcceptedSocket(nIndex);
 }
 
@@ -671,6 +1208,26 @@ int CRConServer::GetAuthenticatedCount(void) const
 	return m_nAuthConnections;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: returns the average time spent in RunFrame in seconds
+//-----------------------------------------------------------------------------
+double CRConServer::GetAverageFrameTime(void) const
+{
+	const int nFrameCount = m_nFrameCount.load(std::memory_order_relaxed);
+	const int64_t nFrameTimeTotalUs = m_nFrameTimeTotalUs.load(std::memory_order_relaxed);
+
+	return nFrameCount ? (nFrameTimeTotalUs / 1000000.0) / nFrameCount : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: resets the RunFrame time statistics
+//-----------------------------------------------------------------------------
+void CRConServer::ResetFrameTime(void)
+{
+	m_nFrameTimeTotalUs.store(0, std::memory_order_relaxed);
+	m_nFrameCount.store(0, std::memory_order_relaxed);
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: change RCON password on server and drop all connections
 //-----------------------------------------------------------------------------
@@ -767,6 +1324,153 @@ static void RCON_UseLoopbackSocketChanged_f(IConVar* pConVar, const char* pOldSt
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: change whether to read sockets on a dedicated thread
+//-----------------------------------------------------------------------------
+static void RCON_UseIOThreadChanged_f(IConVar* pConVar, const char* pOldString, float flOldValue, ChangeUserData_t pUserData)
+{
+	if (ConVar* pConVarRef = g_pCVar->FindVar(pConVar->GetName()))
+	{
+		if (strcmp(pOldString, pConVarRef->GetString()) == NULL)
+			return; // Same value.
+
+#ifndef CLIENT_DLL
+		RCONServer()->Reboot();
+#endif // !CLIENT_DLL
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: opens many local connections to the RCON server, which optionally
+//			send unauthenticated requests, and reports the server frame cost
+// Input  : nConnections - 
+//			flDuration - 
+//			nRequestRate - requests per second for each connection
+//			&netAdr - 
+//-----------------------------------------------------------------------------
+static std::atomic<bool> s_bRConLoadTestRunning(false);
+
+static void RCON_RunLoadTest(const int nConnections, const float flDuration, const int nRequestRate, const netadr_t netAdr)
+{
+	CSocketCreator sockets;
+
+	for (int i = 0; i < nConnections; i++)
+	{
+		if (sockets.ConnectSocket(netAdr, false) == SOCKET_ERROR)
+		{
+			break;
+		}
+	}
+
+	const int nConnected = sockets.GetAcceptedSocketCount();
+
+	vector<char> vecFrame;
+	NetconClient_Serialize(RCONServer(), vecFrame, "", "1", netcon::request_e::SERVERDATA_REQUEST_SEND_CONSOLE_LOG,
+		rcon_encryptframes.GetBool(), false);
+
+	int64_t nRequestsSent = 0;
+	int64_t nBytesReceived = 0;
+
+	char recvBuf[4096];
+
+	const double flStartTime = Plat_FloatTime();
+	double flNextSendTime = flStartTime;
+
+	RCONServer()->ResetFrameTime();
+
+	while (Plat_FloatTime() - flStartTime < flDuration)
+	{
+		const bool bSend = nRequestRate > 0 && Plat_FloatTime() >= flNextSendTime;
+
+		if (bSend)
+		{
+			flNextSendTime += 1.0 / nRequestRate;
+		}
+
+		for (int i = sockets.GetAcceptedSocketCount() - 1; i >= 0; i--)
+		{
+			const SocketHandle_t hSocket = sockets.GetAcceptedSocketHandle(i);
+			bool bClosed = false;
+
+			if (bSend)
+			{
+				if (RCONServer()->Send(hSocket, vecFrame.data(), int(vecFrame.size())))
+					nRequestsSent++;
+				else
+					bClosed = true;
+			}
+
+			while (!bClosed)
+			{
+				const int nRecvLen = ::recv(hSocket, recvBuf, sizeof(recvBuf), MSG_NOSIGNAL);
+
+				if (nRecvLen > 0)
+					nBytesReceived += nRecvLen;
+				else
+				{
+					bClosed = nRecvLen == 0 || !sockets.IsSocketBlocking();
+					break;
+				}
+			}
+
+			if (bClosed)
+			{
+				sockets.CloseAcceptedSocket(i);
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	Msg(eDLL_T::SERVER, "RCON load test: '%d' of '%d' connections established and '%d' remained open\n",
+		nConnected, nConnections, sockets.GetAcceptedSocketCount());
+	Msg(eDLL_T::SERVER, "RCON load test: '%lld' requests sent and '%lld' bytes received in '%.1f' seconds\n",
+		nRequestsSent, nBytesReceived, flDuration);
+	Msg(eDLL_T::SERVER, "RCON load test: average frame time '%.3f' microseconds (I/O thread: %s)\n",
+		RCONServer()->GetAverageFrameTime() * 1000000.0, sv_rcon_useiothread.GetBool() ? "yes" : "no");
+
+	sockets.CloseAllAcceptedSockets();
+	s_bRConLoadTestRunning = false;
+}
+
+static void RCON_LoadTest_f(const CCommand& args)
+{
+	if (!RCONServer()->IsInitialized())
+	{
+		Warning(eDLL_T::SERVER, "RCON server isn't initialized\n");
+		return;
+	}
+
+	if (s_bRConLoadTestRunning.exchange(true))
+	{
+		Warning(eDLL_T::SERVER, "RCON load test is already running\n");
+		return;
+	}
+
+	const int nConnections = args.ArgC() > 1 ? Clamp(atoi(args.Arg(1)), 1, RCON_MAX_ACCEPTED_SOCKETS) : 256;
+	const float flDuration = args.ArgC() > 2 ? Clamp(float(atof(args.Arg(2))), 1.f, 600.f) : 10.f;
+	const int nRequestRate = args.ArgC() > 3 ? Clamp(atoi(args.Arg(3)), 0, 1000) : 0;
+
+	if (nConnections > sv_rcon_maxsockets.GetInt())
+	{
+		Warning(eDLL_T::SERVER, "Opening '%d' connections while '%s' is '%d'; redundant connections will be closed unless the loopback address is whitelisted\n",
+			nConnections, sv_rcon_maxsockets.GetName(), sv_rcon_maxsockets.GetInt());
+	}
+
+	if (nRequestRate > 0)
+	{
+		Warning(eDLL_T::SERVER, "Unauthenticated requests count towards '%s'; whitelist the loopback address to prevent it from getting banned\n",
+			sv_rcon_maxignores.GetName());
+	}
+
+	netadr_t netAdr;
+	netAdr.SetFromString(Format("[%s]:%i", NET_IPV6_LOOPBACK, hostport->GetInt()).c_str(), true);
+
+	std::thread(RCON_RunLoadTest, nConnections, flDuration, nRequestRate, netAdr).detach();
+}
+
+static ConCommand rcon_loadtest("rcon_loadtest", RCON_LoadTest_f, "Opens local connections to the RCON server and reports the server frame cost", FCVAR_DEVELOPMENTONLY, nullptr, "rcon_loadtest <connections> <seconds> <requestsPerSecond>");
+
 ///////////////////////////////////////////////////////////////////////////////
 static CRConServer s_RCONServer;
 CRConServer* RCONServer() // Singleton RCON Server.
@@ -1,4 +1,5 @@
 #pragma once
+#include "tier0/tslist.h"
 #include "tier1/NetAdr.h"
 #include "tier2/socketcreator.h"
 #include "protoc/netcon.pb.h"
@@ -8,6 +9,61 @@
 #define RCON_MAX_BANNEDLIST_SIZE 512
 #define RCON_SHA512_HASH_SIZE 64
 
+// Max number of accepted sockets, this is higher than the max player count so
+// that load tests can keep hundreds of unauthenticated connections open
+#define RCON_MAX_ACCEPTED_SOCKETS 4096
+
+// Max time the I/O thread blocks waiting for socket readiness, this bounds how
+// long it takes to pick up a new listen socket or to shut the thread down
+#define RCON_IO_POLL_TIMEOUT_MS 50
+// Max bytes read from a socket per wakeup, anything beyond that is read after
+// the next poll
+#define RCON_IO_RECV_BUFFER_SIZE 65536
+
+// Max frames gathered into a single send call when flushing a send queue
+#define RCON_MAX_SEND_FRAMES 64
+
+// Serialized outbound frame, shared by all send queues it is in
+typedef std::shared_ptr<const vector<char>> RConSendFrame_t;
+
+//-----------------------------------------------------------------------------
+// Events the I/O thread hands to the frame thread
+//-----------------------------------------------------------------------------
+struct RConIOEvent_s
+{
+	enum Type_e
+	{
+		REQUEST = 0, // Decoded request ready to be processed.
+		CLOSE        // Socket closed, or to be closed for given reason.
+	};
+
+	Type_e type;
+	SocketHandle_t hSocket;
+	uint32_t nSerial; // Connection the event belongs to, the handle may be reused.
+	const char* pszReason;
+	netcon::request request;
+};
+
+//-----------------------------------------------------------------------------
+// Connection as seen by the I/O thread; data is received into it while holding
+// the socket lock, and decrypted and parsed after releasing it
+//-----------------------------------------------------------------------------
+struct RConIOConnection_s
+{
+	RConIOConnection_s(const CConnectedNetConsoleData& socketData)
+		: data(socketData.m_hSocket)
+		, pszCloseReason(nullptr)
+		, bAccepted(true)
+	{
+		data.m_nSerial = socketData.m_nSerial;
+	}
+
+	CConnectedNetConsoleData data; // Parse state, only used on the I/O thread.
+	vector<char> recvBuf;          // Received data that hasn't been parsed yet.
+	const char* pszCloseReason;    // Set when the socket closed while reading.
+	bool bAccepted;                // Cleared once the socket is closed.
+};
+
 class CRConServer : public CNetConBase
 {
 public:
@@ -28,14 +84,15 @@ public:
 	bool SendEncoded(const char* pResponseMsg, const char* pResponseVal,
 		const netcon::response_e responseType,
 		const int nMessageId = static_cast<int>(eDLL_T::NETCON),
-		const int nMessageType = static_cast<int>(LogType_t::LOG_NET)) const;
+		const int nMessageType = static_cast<int>(LogType_t::LOG_NET));
 
 	bool SendEncoded(const SocketHandle_t hSocket, const char* pResponseMsg,
 		const char* pResponseVal, const netcon::response_e responseType,
 		const int nMessageId = static_cast<int>(eDLL_T::NETCON),
-		const int nMessageType = static_cast<int>(LogType_t::LOG_NET)) const;
+		const int nMessageType = static_cast<int>(LogType_t::LOG_NET));
 
-	bool SendToAll(const char* pMsgBuf, const int nMsgLen) const;
+	bool SendToAll(const char* pMsgBuf, const int nMsgLen);
+	bool SendToAll(vector<char>&& vecMsg);
 	bool Serialize(vector<char>& vecBuf, const char* pResponseMsg, const char* pResponseVal, const netcon::response_e responseType,
 		const int nMessageId = static_cast<int>(eDLL_T::NETCON), const int nMessageType = static_cast<int>(LogType_t::LOG_NET)) const;
 
@@ -43,6 +100,7 @@ public:
 	bool Comparator(const string& svPassword) const;
 
 	virtual bool ProcessMessage(const char* pMsgBuf, const int nMsgLen) override;
+	void ProcessRequest(const netcon::request& request, CConnectedNetConsoleData& data);
 
 	void Execute(const netcon::request& request) const;
 	bool CheckForBan(CConnectedNetConsoleData& data);
@@ -57,13 +115,48 @@ public:
 	int GetAuthenticatedCount(void) const;
 	void CloseAllSockets() { m_Socket.CloseAllAcceptedSockets(); }
 
+	double GetAverageFrameTime(void) const;
+	void ResetFrameTime(void);
+
 private:
+	void StartIOThread(void);
+	void StopIOThread(void);
+	bool IsIOThread(void) const;
+
+	void IOThreadRun(const int nGeneration);
+	void IOThreadRecv(RConIOConnection_s& conn);
+	void IOThreadParse(RConIOConnection_s& conn);
+	void IOThreadQueueClose(const char* szReason);
+
+	void ProcessIOEvents(void);
+
+	void DistributePendingFrames(void);
+	bool QueueFrame(CConnectedNetConsoleData& data, const RConSendFrame_t& frame, const bool bDroppable);
+	bool FlushSendQueue(CConnectedNetConsoleData& data);
+	void FlushSendQueues(void);
+
 	int                      m_nConnIndex;
 	int                      m_nAuthConnections;
 	bool                     m_bInitialized;
 	std::unordered_set<std::string> m_BannedList;
 	uint8_t                  m_PasswordHash[RCON_SHA512_HASH_SIZE];
 	netadr_t                 m_WhiteListAddress;
+
+	// Readiness based I/O, sockets are read and requests are decoded on the
+	// I/O thread, the frame thread only processes the queued events
+	std::thread              m_IOThread;
+	std::atomic<bool>        m_bIOThreadRunning;
+	std::atomic<int>         m_nIOThreadGeneration; // Bumped to stop the I/O thread.
+	CTSQueue<RConIOEvent_s>  m_IOEvents;
+	CConnectedNetConsoleData* m_pIOConnData; // Connection being parsed by the I/O thread.
+
+	// Frames broadcast from any thread, these are moved into the send queues
+	// of the connected sockets and flushed once per frame
+	CTSQueue<RConSendFrame_t> m_PendingFrames;
+
+	// Read by the load test thread while the frame thread updates them
+	std::atomic<int64_t>     m_nFrameTimeTotalUs;
+	std::atomic<int>         m_nFrameCount;
 };
 
 CRConServer* RCONServer();
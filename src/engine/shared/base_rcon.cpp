@@ -19,6 +19,9 @@
 //-----------------------------------------------------------------------------
 void CNetConBase::SetKey(const char* pBase64NetKey, const bool bUseDefaultOnFailure/* = false*/)
 {
+	// Sockets could be read on another thread, which decrypts the frames.
+	AUTO_LOCK(m_Socket.GetMutex());
+
 	// Drop all connections as they would be unable to decipher the message
 	// frames once the key has been swapped.
 	m_Socket.CloseAllAcceptedSockets();
@@ -137,7 +140,9 @@ bool CNetConBase::Connect(const char* pHostName, const int nPort)
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: parses input response buffer using length-prefix framing
+// Purpose: parses input response buffer using length-prefix framing; complete
+//			frames that are contiguous in the input are processed in place,
+//			only frames split across calls are copied into the receive buffer
 // Input  : &data - 
 //			*pRecvBuf - 
 //			nRecvLen - 
@@ -147,69 +152,116 @@ bool CNetConBase::Connect(const char* pHostName, const int nPort)
 bool CNetConBase::ProcessBuffer(CConnectedNetConsoleData& data, 
 	const char* pRecvBuf, int nRecvLen, const int nMaxLen)
 {
-	bool bSuccess = true;
-
 	while (nRecvLen > 0)
 	{
-		if (data.m_nPayloadLen)
+		if (data.m_nPayloadLen) // Continue the frame we have partially received.
 		{
+			const int nCopyLen = Min(data.m_nPayloadLen - data.m_nPayloadRead, nRecvLen);
+			memcpy(&data.m_RecvBuffer[data.m_nPayloadRead], pRecvBuf, nCopyLen);
+
+			data.m_nPayloadRead += nCopyLen;
+			pRecvBuf += nCopyLen;
+			nRecvLen -= nCopyLen;
+
 			if (data.m_nPayloadRead < data.m_nPayloadLen)
 			{
-				data.m_RecvBuffer[data.m_nPayloadRead++] = *pRecvBuf;
-
-				pRecvBuf++;
-				nRecvLen--;
+				break; // Wait for more data.
 			}
-			if (data.m_nPayloadRead == data.m_nPayloadLen)
-			{
-				if (!ProcessMessage(
-					reinterpret_cast<const char*>(data.m_RecvBuffer.data()), data.m_nPayloadLen)
-					&& bSuccess)
-				{
-					bSuccess = false;
-				}
 
-				data.m_nPayloadLen = 0;
-				data.m_nPayloadRead = 0;
+			const int nPayloadLen = data.m_nPayloadLen;
+
+			data.m_nPayloadLen = 0;
+			data.m_nPayloadRead = 0;
+
+			// A failed message closes the connection, stop parsing the remainder.
+			if (!ProcessMessage(reinterpret_cast<const char*>(data.m_RecvBuffer.data()), nPayloadLen))
+			{
+				return false;
 			}
+
+			continue;
 		}
-		else if (data.m_nPayloadRead < sizeof(int)) // Read size field.
+
+		u_long nNetLen;
+
+		if (!data.m_nPayloadRead && nRecvLen >= int(sizeof(u_long)))
 		{
-			data.m_RecvBuffer[data.m_nPayloadRead++] = *pRecvBuf;
+			// Size field is complete in the input.
+			memcpy(&nNetLen, pRecvBuf, sizeof(u_long));
 
-			pRecvBuf++;
-			nRecvLen--;
+			pRecvBuf += sizeof(u_long);
+			nRecvLen -= sizeof(u_long);
 		}
-		else // Build prefix.
+		else // Size field is split; buffer it.
 		{
-			data.m_nPayloadLen = int(ntohl(*reinterpret_cast<u_long*>(&data.m_RecvBuffer[0])));
-			data.m_nPayloadRead = 0;
+			const int nCopyLen = Min(int(sizeof(u_long)) - data.m_nPayloadRead, nRecvLen);
+			memcpy(&data.m_RecvBuffer[data.m_nPayloadRead], pRecvBuf, nCopyLen);
+
+			data.m_nPayloadRead += nCopyLen;
+			pRecvBuf += nCopyLen;
+			nRecvLen -= nCopyLen;
 
-			if (!data.m_bAuthorized && nMaxLen > -1)
+			if (data.m_nPayloadRead < int(sizeof(u_long)))
 			{
-				if (data.m_nPayloadLen > nMaxLen)
-				{
-					Disconnect("overflow"); // Sending large messages while not authenticated.
-					return false;
-				}
+				break; // Wait for more data.
 			}
 
-			if (data.m_nPayloadLen < 0 ||
-				data.m_nPayloadLen > data.m_RecvBuffer.max_size())
-			{
-				Error(eDLL_T::ENGINE, NO_ERROR, "RCON Cmd: sync error (%d)\n", data.m_nPayloadLen);
-				Disconnect("desync"); // Out of sync (irrecoverable).
+			memcpy(&nNetLen, data.m_RecvBuffer.data(), sizeof(u_long));
+			data.m_nPayloadRead = 0;
+		}
 
+		const int nPayloadLen = int(ntohl(nNetLen));
+
+		if (!data.m_bAuthorized && nMaxLen > -1)
+		{
+			if (nPayloadLen > nMaxLen)
+			{
+				Disconnect("overflow"); // Sending large messages while not authenticated.
 				return false;
 			}
-			else
+		}
+
+		if (nPayloadLen < 0 || nPayloadLen > RCON_MAX_PAYLOAD_SIZE)
+		{
+			Error(eDLL_T::ENGINE, NO_ERROR, "RCON Cmd: sync error (%d)\n", nPayloadLen);
+			Disconnect("desync"); // Out of sync (irrecoverable).
+
+			return false;
+		}
+
+		if (!nPayloadLen)
+		{
+			continue; // Empty frame.
+		}
+
+		if (nRecvLen >= nPayloadLen)
+		{
+			// Frame is complete in the input; process it without copying.
+			const char* const pPayload = pRecvBuf;
+
+			pRecvBuf += nPayloadLen;
+			nRecvLen -= nPayloadLen;
+
+			if (!ProcessMessage(pPayload, nPayloadLen))
 			{
-				data.m_RecvBuffer.resize(data.m_nPayloadLen);
+				return false;
 			}
+
+			continue;
 		}
+
+		// Frame continues in the next call; the buffer only ever grows so it
+		// gets reused across frames.
+		if (data.m_RecvBuffer.size() < size_t(nPayloadLen))
+		{
+			data.m_RecvBuffer.resize(nPayloadLen);
+		}
+
+		data.m_nPayloadLen = nPayloadLen;
+		data.m_nPayloadRead = 0;
 	}
 
-	return bSuccess;
+	return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -281,14 +333,18 @@ bool CNetConBase::Decode(google::protobuf::MessageLite* pMsg,
 bool CNetConBase::Send(const SocketHandle_t hSocket, const char* pMsgBuf,
 	const int nMsgLen) const
 {
-	std::ostringstream sendbuf;
-	const u_long nLen = htonl(u_long(nMsgLen));
+	u_long nLen = htonl(u_long(nMsgLen));
+
+	// Gather the length-prefix and the payload, so the payload isn't copied.
+	WSABUF buffers[2];
 
-	sendbuf.write(reinterpret_cast<const char*>(&nLen), sizeof(u_long));
-	sendbuf.write(pMsgBuf, nMsgLen);
+	buffers[0].buf = reinterpret_cast<char*>(&nLen);
+	buffers[0].len = sizeof(u_long);
+	buffers[1].buf = const_cast<char*>(pMsgBuf);
+	buffers[1].len = ULONG(nMsgLen);
 
-	int ret = ::send(hSocket, sendbuf.str().data(), int(sendbuf.str().size()),
-		MSG_NOSIGNAL);
+	DWORD nSent = 0;
+	int ret = ::WSASend(SOCKET(hSocket), buffers, DWORD(SDK_ARRAYSIZE(buffers)), &nSent, 0, nullptr, nullptr);
 
 	return (ret != SOCKET_ERROR);
 }
@@ -3,8 +3,19 @@
 // Purpose: data block sender & receiver
 // 
 //===========================================================================//
+#include "thirdparty/lz4/lz4hc.h"
+#include "filesystem/filesystem.h"
 #include "datablock.h"
 
+// compression levels for the LZ4-HC and zstd codecs
+#define DATABLOCK_LZ4HC_LEVEL LZ4HC_CLEVEL_DEFAULT
+#define DATABLOCK_ZSTD_LEVEL 9
+
+// the shared zstd dictionary, digested once for compression and decompression
+static ZSTD_CDict* s_pZstdCDict = nullptr;
+static ZSTD_DDict* s_pZstdDDict = nullptr;
+static uint32_t s_nZstdDictId = 0;
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -110,3 +121,187 @@ void NetDataBlockReceiver::ResetBlockReceiver(const short transferNr)
 
 	memset(m_BlockStatus, 0, sizeof(m_BlockStatus));
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: loads the shared zstd dictionary, codecs that don't use it are
+//          always available
+//-----------------------------------------------------------------------------
+void DataBlock_InitCodecs(void)
+{
+	DataBlock_ShutdownCodecs();
+
+	FileHandle_t hDictFile = FileSystem()->Open(DATABLOCK_ZSTD_DICT_FILE, "rb", "GAME");
+
+	if (hDictFile == FILESYSTEM_INVALID_HANDLE)
+		return;
+
+	const ssize_t nDictSize = FileSystem()->Size(hDictFile);
+	std::unique_ptr<uint8_t[]> pDictBuf(new uint8_t[nDictSize]);
+
+	const ssize_t nRead = FileSystem()->Read(pDictBuf.get(), nDictSize, hDictFile);
+	FileSystem()->Close(hDictFile);
+
+	if (nRead != nDictSize)
+	{
+		Warning(eDLL_T::ENGINE, "%s: failed to read dictionary \"%s\"\n", __FUNCTION__, DATABLOCK_ZSTD_DICT_FILE);
+		return;
+	}
+
+	// frames only carry the id of trained dictionaries, which is required to
+	// make sure both ends use the same one
+	const uint32_t nDictId = ZSTD_getDictID_fromDict(pDictBuf.get(), nDictSize);
+
+	if (!nDictId)
+	{
+		Warning(eDLL_T::ENGINE, "%s: dictionary \"%s\" has no id; not a trained zstd dictionary\n", __FUNCTION__, DATABLOCK_ZSTD_DICT_FILE);
+		return;
+	}
+
+	s_pZstdCDict = ZSTD_createCDict(pDictBuf.get(), nDictSize, DATABLOCK_ZSTD_LEVEL);
+	s_pZstdDDict = ZSTD_createDDict(pDictBuf.get(), nDictSize);
+
+	if (!s_pZstdCDict || !s_pZstdDDict)
+	{
+		Warning(eDLL_T::ENGINE, "%s: failed to digest dictionary \"%s\"\n", __FUNCTION__, DATABLOCK_ZSTD_DICT_FILE);
+		DataBlock_ShutdownCodecs();
+
+		return;
+	}
+
+	s_nZstdDictId = nDictId;
+	DevMsg(eDLL_T::ENGINE, "Loaded data block dictionary \"%s\" (id: '%u', size: '%zd')\n", DATABLOCK_ZSTD_DICT_FILE, nDictId, nDictSize);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: frees the shared zstd dictionary
+//-----------------------------------------------------------------------------
+void DataBlock_ShutdownCodecs(void)
+{
+	if (s_pZstdCDict)
+	{
+		ZSTD_freeCDict(s_pZstdCDict);
+		s_pZstdCDict = nullptr;
+	}
+
+	if (s_pZstdDDict)
+	{
+		ZSTD_freeDDict(s_pZstdDDict);
+		s_pZstdDDict = nullptr;
+	}
+
+	s_nZstdDictId = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the codecs this build can decode
+//-----------------------------------------------------------------------------
+uint32_t DataBlock_GetCodecMask(void)
+{
+	return DATABLOCK_CODECS_RETAIL |
+		DATABLOCK_CODEC_BIT(DataBlockCodec_e::LZ4HC) |
+		DATABLOCK_CODEC_BIT(DataBlockCodec_e::ZSTD);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the id of the loaded zstd dictionary, 0 if none is loaded
+//-----------------------------------------------------------------------------
+uint32_t DataBlock_GetDictionaryId(void)
+{
+	return s_nZstdDictId;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the name of the codec
+//-----------------------------------------------------------------------------
+const char* DataBlock_GetCodecName(const DataBlockCodec_e codec)
+{
+	switch (codec)
+	{
+	case DataBlockCodec_e::NONE: return "none";
+	case DataBlockCodec_e::LZ4: return "lz4";
+	case DataBlockCodec_e::LZ4HC: return "lz4hc";
+	case DataBlockCodec_e::ZSTD: return "zstd";
+	}
+
+	return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compresses the data with given codec
+// Input  : codec - 
+//          useDictionary - whether to use the shared zstd dictionary
+//          *src - 
+//          srcSize - 
+//          *dst - 
+//          dstCapacity - 
+// Output : the compressed size, 0 on failure
+//-----------------------------------------------------------------------------
+int DataBlock_Compress(const DataBlockCodec_e codec, const bool useDictionary,
+	const uint8_t* const src, const int srcSize, uint8_t* const dst, const int dstCapacity)
+{
+	switch (codec)
+	{
+	case DataBlockCodec_e::LZ4:
+		return LZ4_compress_default((const char*)src, (char*)dst, srcSize, dstCapacity);
+	case DataBlockCodec_e::LZ4HC:
+		return LZ4_compress_HC((const char*)src, (char*)dst, srcSize, dstCapacity, DATABLOCK_LZ4HC_LEVEL);
+	case DataBlockCodec_e::ZSTD:
+	{
+		ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+
+		if (!cctx)
+			return 0;
+
+		const size_t encodedSize = (useDictionary && s_pZstdCDict)
+			? ZSTD_compress_usingCDict(cctx, dst, dstCapacity, src, srcSize, s_pZstdCDict)
+			: ZSTD_compressCCtx(cctx, dst, dstCapacity, src, srcSize, DATABLOCK_ZSTD_LEVEL);
+
+		ZSTD_freeCCtx(cctx);
+		return ZSTD_isError(encodedSize) ? 0 : int(encodedSize);
+	}
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: decompresses the data with given codec
+// Input  : codec - 
+//          *src - 
+//          srcSize - 
+//          *dst - 
+//          dstCapacity - 
+// Output : the decompressed size, -1 on failure
+//-----------------------------------------------------------------------------
+int DataBlock_Decompress(const DataBlockCodec_e codec,
+	const uint8_t* const src, const int srcSize, uint8_t* const dst, const int dstCapacity)
+{
+	switch (codec)
+	{
+	case DataBlockCodec_e::LZ4:
+	case DataBlockCodec_e::LZ4HC:
+		return LZ4_decompress_safe((const char*)src, (char*)dst, srcSize, dstCapacity);
+	case DataBlockCodec_e::ZSTD:
+	{
+		const uint32_t frameDictId = ZSTD_getDictID_fromFrame(src, srcSize);
+
+		// frame was compressed with a dictionary we don't have
+		if (frameDictId && frameDictId != s_nZstdDictId)
+			return -1;
+
+		ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+
+		if (!dctx)
+			return -1;
+
+		const size_t decodedSize = frameDictId
+			? ZSTD_decompress_usingDDict(dctx, dst, dstCapacity, src, srcSize, s_pZstdDDict)
+			: ZSTD_decompressDCtx(dctx, dst, dstCapacity, src, srcSize);
+
+		ZSTD_freeDCtx(dctx);
+		return ZSTD_isError(decodedSize) ? -1 : int(decodedSize);
+	}
+	}
+
+	return -1;
+}
@@ -18,6 +18,29 @@
 // the maximum size of a data block fragment packet (encoded header + actual data)
 #define DATABLOCK_FRAGMENT_PACKET_SIZE (MAX_DATABLOCK_FRAGMENT_SIZE + 176)
 
+// the shared pre-trained zstd dictionary, must be identical on both ends
+#define DATABLOCK_ZSTD_DICT_FILE "platform/datablock.zdict"
+
+//-----------------------------------------------------------------------------
+// Data block codecs, the codec id is stored in the first byte of the data
+// block header. The values for NONE and LZ4 match the retail 'isCompressed'
+// flag, so retail receivers can decode these
+//-----------------------------------------------------------------------------
+enum class DataBlockCodec_e : uint8_t
+{
+	NONE = 0,
+	LZ4,
+	LZ4HC, // decodes as LZ4
+	ZSTD,  // uses the shared dictionary if both ends have it loaded
+
+	COUNT
+};
+
+#define DATABLOCK_CODEC_BIT(codec) (1u << static_cast<uint8_t>(codec))
+
+// the codecs a receiver that doesn't advertise its codecs can decode
+#define DATABLOCK_CODECS_RETAIL (DATABLOCK_CODEC_BIT(DataBlockCodec_e::NONE) | DATABLOCK_CODEC_BIT(DataBlockCodec_e::LZ4))
+
 //-----------------------------------------------------------------------------
 // Forward decelerations
 //-----------------------------------------------------------------------------
@@ -143,6 +166,21 @@ protected:
 	char* m_pScratchBuffer;
 };
 
+//-----------------------------------------------------------------------------
+// Data block codecs
+//-----------------------------------------------------------------------------
+extern void DataBlock_InitCodecs(void);
+extern void DataBlock_ShutdownCodecs(void);
+
+extern uint32_t DataBlock_GetCodecMask(void);
+extern uint32_t DataBlock_GetDictionaryId(void);
+extern const char* DataBlock_GetCodecName(const DataBlockCodec_e codec);
+
+extern int DataBlock_Compress(const DataBlockCodec_e codec, const bool useDictionary,
+	const uint8_t* const src, const int srcSize, uint8_t* const dst, const int dstCapacity);
+extern int DataBlock_Decompress(const DataBlockCodec_e codec,
+	const uint8_t* const src, const int srcSize, uint8_t* const dst, const int dstCapacity);
+
 inline void* (*NetDataBlockSender__Destructor)(NetDataBlockSender* thisptr);
 inline void* (*NetDataBlockReceiver__Destructor)(NetDataBlockReceiver* thisptr);
 
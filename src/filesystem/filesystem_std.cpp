@@ -301,6 +301,18 @@ ssize_t CBaseFileSystem::ReadEx(void* pOutput, ssize_t /*destSize*/, ssize_t siz
 
 }
 
+void CBaseFileSystem::RemoveFile(char const* pRelativePath, const char* pathID)
+{
+	NOTE_UNUSED(pathID);
+	remove(pRelativePath);
+}
+
+bool CBaseFileSystem::RenameFile(char const* pOldPath, char const* pNewPath, const char* pathID)
+{
+	NOTE_UNUSED(pathID);
+	return rename(pOldPath, pNewPath) == 0;
+}
+
 int CBaseFileSystem::CreateDirHierarchy(const char* pPath, const char* pPathID)
 {
 	NOTE_UNUSED(pPathID);
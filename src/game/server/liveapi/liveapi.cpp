@@ -1959,7 +1959,7 @@ static void LiveAPI_SendEvent(const google::protobuf::Message* const msg)
 	s_liveAPIEvent.set_event_size(msg->ByteSize());
 	s_liveAPIEvent.mutable_gamemessage()->PackFrom(*msg);
 
-	LiveAPISystem()->LogEvent(&s_liveAPIEvent, &s_liveAPIEvent.gamemessage());
+	LiveAPISystem()->LogEvent(&s_liveAPIEvent);
 	s_liveAPIEvent.Clear();
 }
 
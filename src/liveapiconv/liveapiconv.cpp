@@ -0,0 +1,289 @@
+//=============================================================================//
+//
+// Purpose: Converts binary LiveAPI match recordings to JSON
+//
+//=============================================================================//
+#include "core/logdef.h"
+#include "core/logger.h"
+#include "tier0/cpu.h"
+#include "tier1/cmd.h"
+#include "windows/console.h"
+#include "rtech/liveapi/liverecord.h"
+#include "protobuf/any.pb.h"
+#include "protobuf/util/json_util.h"
+
+#include "vstdlib/keyvaluessystem.h"
+#include "filesystem/filesystem_std.h"
+
+static CKeyValuesSystem s_KeyValuesSystem;
+static CFileSystem_Stdio s_FullFileSystem;
+static bool s_bUseAnsiColors = true;
+
+//-----------------------------------------------------------------------------
+// Purpose: keyvalues singleton accessor
+//-----------------------------------------------------------------------------
+IKeyValuesSystem* KeyValuesSystem()
+{
+	return &s_KeyValuesSystem;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: filesystem singleton accessor
+//-----------------------------------------------------------------------------
+CFileSystem_Stdio* FileSystem()
+{
+	return &s_FullFileSystem;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: writes a line to the output; lines are terminated the same way the
+//			match logger terminates them, so the output is identical to it
+//-----------------------------------------------------------------------------
+static bool LiveAPIConv_WriteLine(FILE* const pOutFile, const string& line)
+{
+	const size_t nEolLen = strlen(spdlog::details::os::default_eol);
+
+	return fwrite(line.data(), 1, line.size(), pOutFile) == line.size() &&
+		fwrite(spdlog::details::os::default_eol, 1, nEolLen, pOutFile) == nEolLen;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: prints the block index of a recording
+//-----------------------------------------------------------------------------
+static void LiveAPIConv_PrintBlocks(const CLiveAPIRecordReader& reader)
+{
+	Msg(eDLL_T::RTECH, "Recording has '%d' block(s)%s\n", reader.GetBlockCount(),
+		reader.IsIndexed() ? "" : " (no index; recording wasn't closed)");
+
+	for (int i = 0; i < reader.GetBlockCount(); i++)
+	{
+		const LiveAPIRecordIndexEntry_s& block = reader.GetBlock(i);
+
+		Msg(eDLL_T::RTECH, " | block %5d: offset %12llu, events %6u - %6u, timestamps %llu - %llu\n",
+			i, block.offset, block.firstEvent, block.firstEvent + block.eventCount - 1,
+			block.minTimestamp, block.maxTimestamp);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: converts the events of a recording within the timestamp range to
+//			the JSON layout written by the match logger
+// Input  : *pInFile -
+//			*pOutFile -
+//			&options -
+//			nFrom -
+//			nTo -
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+static bool LiveAPIConv_Convert(const char* const pInFile, const char* const pOutFile,
+	const google::protobuf::util::JsonPrintOptions& options, const uint64_t nFrom, const uint64_t nTo)
+{
+	CLiveAPIRecordReader reader;
+
+	if (!reader.Open(pInFile))
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "Failed to open recording \"%s\"; not a valid LiveAPI recording\n", pInFile);
+		return false;
+	}
+
+	if (!reader.IsIndexed())
+		Warning(eDLL_T::RTECH, "Recording \"%s\" has no index; it wasn't closed properly\n", pInFile);
+
+	FILE* const pOut = fopen(pOutFile, "wb");
+
+	if (!pOut)
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "Failed to create output file \"%s\"\n", pOutFile);
+		return false;
+	}
+
+	bool bSuccess = LiveAPIConv_WriteLine(pOut, "[\n");
+
+	string blockData;
+	string jsonStr;
+
+	google::protobuf::Any event;
+	int nEventCount = 0;
+	int nBlockCount = 0;
+
+	// Blocks are only read if their timestamp range overlaps the requested
+	// range; the first block is looked up through the index.
+	for (int i = reader.FindBlock(nFrom); i >= 0 && i < reader.GetBlockCount() && bSuccess; i++)
+	{
+		const LiveAPIRecordIndexEntry_s& block = reader.GetBlock(i);
+
+		if (block.maxTimestamp < nFrom || block.minTimestamp > nTo)
+			continue;
+
+		if (!reader.ReadBlock(i, blockData))
+		{
+			Error(eDLL_T::RTECH, NO_ERROR, "Failed to read block '%d' of recording \"%s\"\n", i, pInFile);
+			bSuccess = false;
+
+			break;
+		}
+
+		nBlockCount++;
+
+		size_t nOffset = 0;
+		const char* pEventData;
+		uint32_t nEventSize;
+
+		while (CLiveAPIRecordReader::NextEvent(blockData, nOffset, pEventData, nEventSize))
+		{
+			if (!event.ParseFromArray(pEventData, int(nEventSize)))
+			{
+				Warning(eDLL_T::RTECH, "Skipped malformed event in block '%d'\n", i);
+				continue;
+			}
+
+			const uint64_t nTimestamp = LiveAPI_GetEventTimestamp(event);
+
+			if (nTimestamp < nFrom || nTimestamp > nTo)
+				continue;
+
+			jsonStr.assign(nEventCount ? ",\n" : "");
+			google::protobuf::util::MessageToJsonString(event, &jsonStr, options);
+
+			// Remove the trailing newline character
+			if (options.add_whitespace && !jsonStr.empty())
+				jsonStr.pop_back();
+
+			if (!LiveAPIConv_WriteLine(pOut, jsonStr))
+			{
+				bSuccess = false;
+				break;
+			}
+
+			nEventCount++;
+		}
+	}
+
+	bSuccess = LiveAPIConv_WriteLine(pOut, "\n]\n") && bSuccess;
+	fclose(pOut);
+
+	Msg(eDLL_T::RTECH, "Converted '%d' event(s) from '%d' of '%d' block(s) to \"%s\"\n",
+		nEventCount, nBlockCount, reader.GetBlockCount(), pOutFile);
+
+	return bSuccess;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: init
+//-----------------------------------------------------------------------------
+static void LiveAPIConv_Init()
+{
+	CheckSystemCPUForSSE2();
+
+	// Init time.
+	Plat_FloatTime();
+
+	g_CoreMsgVCallback = EngineLoggerSink;
+
+	if (s_bUseAnsiColors)
+		Console_ColorInit();
+
+	SpdLog_Init(s_bUseAnsiColors);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: shutdown
+//-----------------------------------------------------------------------------
+static void LiveAPIConv_Shutdown()
+{
+	// Must be done to flush all buffers.
+	SpdLog_Shutdown();
+	Console_Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: logs tool's usage
+//-----------------------------------------------------------------------------
+static void LiveAPIConv_Usage()
+{
+	Warning(eDLL_T::RTECH,
+		"LiveAPIConv instructions and options:\n"
+		"Run 'liveapiconv' with the following parameters:\n"
+		"\t<%s>\t- path and name of the recording\n"
+		"\t<%s>\t- ( optional ) path and name of the JSON file, defaults to the recording with a '.json' extension\n"
+		"\t<%s>\t- ( optional ) only convert events at or after this unix timestamp\n"
+		"\t<%s>\t- ( optional ) only convert events at or before this unix timestamp\n"
+		"\t<%s>\t- ( optional ) print events in a formatted manner\n"
+		"\t<%s>\t- ( optional ) print primitive event fields\n"
+		"\t<%s>\t- ( optional ) list the blocks of the recording instead of converting it\n",
+		"fileName", "-out <fileName>", "-from <timestamp>", "-to <timestamp>", "-pretty", "-primitive", "-blocks");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+// Output : EXIT_SUCCESS on success, EXIT_FAILURE otherwise
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	LiveAPIConv_Init();
+
+	CCommand args;
+	CUtlString str;
+
+	for (int i = 0; i < argc; i++)
+	{
+		str.Append(argv[i]);
+		str.Append(' ');
+	}
+
+	args.Tokenize(str.Get(), cmd_source_t::kCommandSrcCode);
+	int nResult = EXIT_FAILURE;
+
+	if (args.ArgC() < 2 || args.Arg(1)[0] == '-')
+	{
+		LiveAPIConv_Usage();
+	}
+	else if (args.FindArg("-blocks"))
+	{
+		CLiveAPIRecordReader reader;
+
+		if (reader.Open(args.Arg(1)))
+		{
+			LiveAPIConv_PrintBlocks(reader);
+			nResult = EXIT_SUCCESS;
+		}
+		else
+		{
+			Error(eDLL_T::RTECH, NO_ERROR, "Failed to open recording \"%s\"; not a valid LiveAPI recording\n", args.Arg(1));
+		}
+	}
+	else
+	{
+		char szOutFile[MAX_PATH];
+		const char* const pOutArg = args.FindArg("-out");
+
+		if (pOutArg && *pOutArg)
+		{
+			snprintf(szOutFile, sizeof(szOutFile), "%s", pOutArg);
+		}
+		else
+		{
+			char szBaseName[MAX_PATH];
+			V_StripExtension(args.Arg(1), szBaseName, sizeof(szBaseName));
+
+			snprintf(szOutFile, sizeof(szOutFile), "%s.json", szBaseName);
+		}
+
+		const char* const pFromArg = args.FindArg("-from");
+		const char* const pToArg = args.FindArg("-to");
+
+		const uint64_t nFrom = pFromArg ? strtoull(pFromArg, nullptr, 10) : 0;
+		const uint64_t nTo = pToArg ? strtoull(pToArg, nullptr, 10) : UINT64_MAX;
+
+		google::protobuf::util::JsonPrintOptions options;
+
+		options.add_whitespace = args.FindArg("-pretty") != nullptr;
+		options.always_print_primitive_fields = args.FindArg("-primitive") != nullptr;
+
+		if (LiveAPIConv_Convert(args.Arg(1), szOutFile, options, nFrom, nTo))
+			nResult = EXIT_SUCCESS;
+	}
+
+	LiveAPIConv_Shutdown();
+	return nResult;
+}
@@ -1,9 +1,41 @@
 #include <algorithm>
-#include <thread>
 #include <functional>
-#include <vector>
+#include <utility>
+#include "tier0/threadpool.h"
 #pragma once
 
+/// Ranges are split in halves until they hold at most this many grains per
+/// thread of the pool, which leaves spare pieces for idle threads to steal.
+#define PARALLEL_FOR_GRAINS_PER_THREAD 8
+
+/// @return the default grain size for a range of 'nb_elements'
+inline unsigned parallel_grain_size(unsigned nb_elements, CThreadPool& pool = g_ThreadPool)
+{
+    const unsigned nb_grains = unsigned(pool.GetNumThreads()) * PARALLEL_FOR_GRAINS_PER_THREAD;
+    return (std::max)(nb_elements / nb_grains, 1u);
+}
+
+/// Splits [start, end) in halves, queueing the upper halves on the group,
+/// until the range fits in a grain; idle threads steal the largest halves.
+template <typename Functor>
+void parallel_for_split(CTaskGroup& group, unsigned start, unsigned end,
+                        unsigned grain_size, const Functor& functor)
+{
+    while (end - start > grain_size)
+    {
+        const unsigned middle = start + (end - start) / 2;
+
+        group.Run([&group, middle, end, grain_size, &functor]()
+        {
+            parallel_for_split(group, middle, end, grain_size, functor);
+        });
+
+        end = middle;
+    }
+
+    functor(int(start), int(end));
+}
+
 /// @param[in] nb_elements : size of your for loop
 /// @param[in] functor(start, end) :
 /// your function processing a sub chunk of the for loop.
@@ -14,45 +46,106 @@
 ///         computation(i);
 /// @endcode
 /// @param use_threads : enable / disable threads.
+/// @param grain_size : smallest chunk passed to the functor, 0 picks one
+/// based on the number of threads.
 ///
+/// Chunks run on the shared thread pool, the calling thread helps until all
+/// chunks are done; the functor may itself call parallel_for.
 ///
-static
+template <typename Functor>
 void parallel_for(unsigned nb_elements,
-                  std::function<void (int start, int end)> functor,
-                  bool use_threads = true)
+                  const Functor& functor,
+                  bool use_threads = true,
+                  unsigned grain_size = 0)
 {
-    // -------
-    unsigned nb_threads_hint = std::thread::hardware_concurrency();
-    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
-
-    unsigned batch_size = nb_elements / nb_threads;
-    unsigned batch_remainder = nb_elements % nb_threads;
+    if( nb_elements == 0 )
+        return;
 
-    std::vector< std::thread > my_threads(nb_threads);
-
-    if( use_threads )
-    {
-        // Multithread execution
-        for(unsigned i = 0; i < nb_threads; ++i)
-        {
-            int start = i * batch_size;
-            my_threads[i] = std::thread(functor, start, start+batch_size);
-        }
-    }
-    else
+    if( !use_threads )
     {
         // Single thread execution (for easy debugging)
-        for(unsigned i = 0; i < nb_threads; ++i){
-            int start = i * batch_size;
-            functor( start, start+batch_size );
-        }
+        functor( 0, int(nb_elements) );
+        return;
     }
 
-    // Deform the elements left
-    int start = nb_threads * batch_size;
-    functor( start, start+batch_remainder);
+    if( grain_size == 0 )
+        grain_size = parallel_grain_size(nb_elements);
+
+    CTaskGroup group;
+    parallel_for_split(group, 0, nb_elements, grain_size, functor);
+    group.Wait();
+}
+
+/// Reduces [start, end) recursively, each split is combined as
+/// reduce(lower, upper); with a fixed grain size the order of the reductions
+/// doesn't depend on the thread timings.
+template <typename T, typename Map, typename Reduce>
+T parallel_reduce_split(CThreadPool& pool, unsigned start, unsigned end,
+                        unsigned grain_size, const Map& map, const Reduce& reduce)
+{
+    if( end - start <= grain_size )
+        return map(int(start), int(end));
+
+    const unsigned middle = start + (end - start) / 2;
+    T upper;
+
+    CTaskGroup group(pool);
+    group.Run([&]()
+    {
+        upper = parallel_reduce_split<T>(pool, middle, end, grain_size, map, reduce);
+    });
+
+    T lower = parallel_reduce_split<T>(pool, start, middle, grain_size, map, reduce);
+    group.Wait();
+
+    return reduce(std::move(lower), std::move(upper));
+}
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] identity : result of an empty range
+/// @param[in] map(start, end) : returns the result of a sub chunk
+/// @param[in] reduce(a, b) : combines the results of two adjacent chunks
+/// @param use_threads : enable / disable threads.
+/// @param grain_size : smallest chunk passed to map, 0 picks one based on
+/// the number of threads.
+/// @code
+///     float sum = parallel_reduce(count, 0.f,
+///         [&](int start, int end) { float s = 0.f; for(int i = start; i < end; ++i) s += values[i]; return s; },
+///         [](float a, float b) { return a + b; });
+/// @endcode
+///
+template <typename T, typename Map, typename Reduce>
+T parallel_reduce(unsigned nb_elements,
+                  const T& identity,
+                  const Map& map,
+                  const Reduce& reduce,
+                  bool use_threads = true,
+                  unsigned grain_size = 0)
+{
+    if( nb_elements == 0 )
+        return identity;
+
+    if( !use_threads )
+        return map( 0, int(nb_elements) );
+
+    if( grain_size == 0 )
+        grain_size = parallel_grain_size(nb_elements);
+
+    return parallel_reduce_split<T>(g_ThreadPool, 0, nb_elements, grain_size, map, reduce);
+}
+
+/// Runs all functors in parallel, the first one on the calling thread, and
+/// returns once all of them are done.
+/// @code
+///     parallel_invoke([&]() { BuildTiles(); }, [&]() { BuildLinks(); });
+/// @endcode
+///
+template <typename Functor, typename... Functors>
+void parallel_invoke(const Functor& functor, const Functors&... functors)
+{
+    CTaskGroup group;
+    (group.Run([&functors]() { functors(); }), ...);
 
-    // Wait for the other thread to finish their task
-    if( use_threads )
-        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+    functor();
+    group.Wait();
 }
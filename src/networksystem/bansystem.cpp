@@ -16,164 +16,400 @@
 #include "game/server/gameinterface.h"
 
 //-----------------------------------------------------------------------------
-// Purpose: loads and parses the banned list
+// Purpose: collects the ban records of a JSON stream without building a
+//          document; a record is any object with an address and nucleus id
 //-----------------------------------------------------------------------------
-void CBanSystem::LoadList(void)
+class CBanRecordReader : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, CBanRecordReader>
 {
-	if (IsBanListValid())
-		m_BannedList.Purge();
+public:
+	typedef std::function<void(const bool bRemove, const char* ipAddress, const NucleusID_t nucleusId)> Callback_t;
 
-	FileHandle_t pFile = FileSystem()->Open("banlist.json", "rt", "PLATFORM");
-	if (!pFile)
-		return;
+	CBanRecordReader(const Callback_t& callback)
+		: m_Callback(callback)
+	{
+		Reset();
+	}
 
-	const ssize_t nLen = FileSystem()->Size(pFile);
-	std::unique_ptr<char[]> pBuf(new char[nLen + 1]);
+	bool StartObject()
+	{
+		Reset();
+		return true;
+	}
 
-	const ssize_t nRead = FileSystem()->Read(pBuf.get(), nLen, pFile);
-	FileSystem()->Close(pFile);
+	bool EndObject(rapidjson::SizeType memberCount)
+	{
+		if (m_HasAddress && m_HasNucleusId)
+			m_Callback(m_Remove, m_Address.c_str(), m_NucleusId);
 
-	pBuf[nRead] = '\0'; // Null terminate the string buffer containing our banned list.
+		Reset();
+		return true;
+	}
 
-	rapidjson::Document document;
-	if (document.Parse(pBuf.get()).HasParseError())
+	bool Key(const char* str, rapidjson::SizeType length, bool copy)
 	{
-		Warning(eDLL_T::SERVER, "%s: JSON parse error at position %zu: %s\n",
-			__FUNCTION__, document.GetErrorOffset(), rapidjson::GetParseError_En(document.GetParseError()));
-		return;
+		m_Key.assign(str, length);
+		return true;
 	}
 
-	if (!document.IsObject())
+	bool String(const char* str, rapidjson::SizeType length, bool copy)
 	{
-		Warning(eDLL_T::SERVER, "%s: JSON root was not an object\n", __FUNCTION__);
-		return;
+		if (m_Key == "ipAddress")
+		{
+			m_Address.assign(str, length);
+			m_HasAddress = true;
+		}
+		else if (m_Key == "op")
+		{
+			m_Remove = length == 3 && strncmp(str, "del", 3) == 0;
+		}
+
+		return true;
 	}
 
-	int nTotalBans = 0;
+	bool Uint(unsigned value)   { return Uint64(value); }
+	bool Uint64(uint64_t value)
+	{
+		if (m_Key == "nucleusId")
+		{
+			m_NucleusId = value;
+			m_HasNucleusId = true;
+		}
+
+		return true;
+	}
 
-	if (!JSON_GetValue(document, "totalBans", JSONFieldType_e::kSint32, nTotalBans))
+	bool Default() { return true; }
+
+private:
+	void Reset()
 	{
-		return;
+		m_Address.clear();
+		m_NucleusId = NULL;
+		m_HasAddress = false;
+		m_HasNucleusId = false;
+		m_Remove = false;
 	}
 
-	for (int i = 0; i < nTotalBans; i++)
+	Callback_t m_Callback;
+
+	string m_Key;
+	string m_Address;
+	NucleusID_t m_NucleusId;
+	bool m_HasAddress;
+	bool m_HasNucleusId;
+	bool m_Remove;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: constructor
+//-----------------------------------------------------------------------------
+CBanSystem::CBanSystem()
+	: m_LogRecords(0)
+{
+	memset(m_PrefixCounts, 0, sizeof(m_PrefixCounts));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: loads and parses the banned list
+//-----------------------------------------------------------------------------
+void CBanSystem::LoadList(void)
+{
+	ClearList();
+	RecoverList();
+
+	FileHandle_t pFile = FileSystem()->Open(BANLIST_FILE, "rt", "PLATFORM");
+	if (!pFile)
 	{
-		char idx[12]; itoa(i, idx, 10);
+		if (LoadLegacyList())
+		{
+			// Move the bans over to the new format.
+			SaveList();
+			Msg(eDLL_T::SERVER, "Imported '%d' bans from '%s' into '%s'\n",
+				m_BannedList.Count(), BANLIST_LEGACY_FILE, BANLIST_FILE);
+		}
 
-		rapidjson::Value::ConstMemberIterator entryIt;
+		return;
+	}
 
-		if (JSON_GetIterator(document, idx, JSONFieldType_e::kObject, entryIt))
+	CBanRecordReader handler([this](const bool bRemove, const char* ipAddress, const NucleusID_t nucleusId)
 		{
-			const rapidjson::Value& entry = entryIt->value;
+			m_LogRecords++;
 
-			const char* ipAddress = nullptr;
-			NucleusID_t nucleusId = NULL;
+			if (!bRemove)
+			{
+				AddToList(ipAddress, nucleusId);
+				return;
+			}
 
-			if (JSON_GetValue(entry, "ipAddress", JSONFieldType_e::kString, ipAddress) && 
-				JSON_GetValue(entry, "nucleusId", JSONFieldType_e::kUint64, nucleusId))
+			FOR_EACH_VEC(m_BannedList, i)
 			{
-				Banned_t banned;
+				const Banned_t& banned = m_BannedList[i];
+
+				if (banned.m_NucleusID == nucleusId &&
+					banned.m_Address.IsEqual_CaseInsensitive(ipAddress))
+				{
+					RemoveFromList(i);
+					break;
+				}
+			}
+		});
 
-				banned.m_Address = ipAddress;
-				banned.m_NucleusID = nucleusId;
+	rapidjson::Reader reader;
 
-				m_BannedList.AddToTail(banned);
-			}
+	char szLine[1024];
+	int nLine = 0;
+
+	while (FileSystem()->ReadLine(szLine, sizeof(szLine) - 1, pFile))
+	{
+		nLine++;
+
+		// Skip blank lines, e.g. the end of a record that failed to write.
+		const char* pszRecord = szLine;
+
+		while (V_isspace(*pszRecord))
+			pszRecord++;
+
+		if (!*pszRecord)
+			continue;
+
+		rapidjson::StringStream stream(pszRecord);
+
+		if (reader.Parse(stream, handler).IsError())
+		{
+			Warning(eDLL_T::SERVER, "%s: JSON parse error in '%s' on line %d at position %zu: %s\n",
+				__FUNCTION__, BANLIST_FILE, nLine, reader.GetErrorOffset(), rapidjson::GetParseError_En(reader.GetParseErrorCode()));
 		}
 	}
+
+	FileSystem()->Close(pFile);
+	CompactList();
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: saves the banned list
+// Purpose: loads the banned list of the old format, which is an object of
+//          entries keyed by their index
+// Output : true if any bans were loaded, false otherwise
 //-----------------------------------------------------------------------------
-void CBanSystem::SaveList(void) const
+bool CBanSystem::LoadLegacyList(void)
 {
-	FileHandle_t pFile = FileSystem()->Open("banlist.json", "wt", "PLATFORM");
+	FileHandle_t pFile = FileSystem()->Open(BANLIST_LEGACY_FILE, "rt", "PLATFORM");
 	if (!pFile)
+		return false;
+
+	const ssize_t nLen = FileSystem()->Size(pFile);
+	std::unique_ptr<char[]> pBuf(new char[nLen + 1]);
+
+	const ssize_t nRead = FileSystem()->Read(pBuf.get(), nLen, pFile);
+	FileSystem()->Close(pFile);
+
+	pBuf[nRead] = '\0'; // Null terminate the string buffer containing our banned list.
+
+	CBanRecordReader handler([this](const bool bRemove, const char* ipAddress, const NucleusID_t nucleusId)
+		{
+			AddToList(ipAddress, nucleusId);
+		});
+
+	rapidjson::Reader reader;
+	rapidjson::StringStream stream(pBuf.get());
+
+	if (reader.Parse(stream, handler).IsError())
 	{
-		Error(eDLL_T::SERVER, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, "banlist.json");
-		return;
+		Warning(eDLL_T::SERVER, "%s: JSON parse error at position %zu: %s\n",
+			__FUNCTION__, reader.GetErrorOffset(), rapidjson::GetParseError_En(reader.GetParseErrorCode()));
+		return false;
 	}
 
-	rapidjson::Document document;
-	document.SetObject();
+	return IsBanListValid();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: saves the banned list, replacing the log with a single record per
+//          ban; the records are written to a temporary file first, so the
+//          log is left intact if writing fails
+//-----------------------------------------------------------------------------
+void CBanSystem::SaveList(void)
+{
+	FileHandle_t pFile = FileSystem()->Open(BANLIST_TEMP_FILE, "wt", "PLATFORM");
+	if (!pFile)
+	{
+		Error(eDLL_T::SERVER, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, BANLIST_TEMP_FILE);
+		return;
+	}
 
-	rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
+	rapidjson::StringBuffer buffer;
 
 	FOR_EACH_VEC(m_BannedList, i)
 	{
 		const Banned_t& banned = m_BannedList[i];
-		char idx[12]; itoa(i, idx, 10);
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+		writer.StartObject();
+		writer.Key("op");
+		writer.String("add");
+		writer.Key("ipAddress");
+		writer.String(banned.m_Address.String());
+		writer.Key("nucleusId");
+		writer.Uint64(banned.m_NucleusID);
+		writer.EndObject();
+
+		buffer.Put('\n');
+	}
+
+	const ssize_t nSize = ssize_t(buffer.GetSize());
+	const bool bWritten = FileSystem()->Write(buffer.GetString(), nSize, pFile) == nSize;
 
-		rapidjson::Value obj(rapidjson::kObjectType);
+	FileSystem()->Close(pFile);
 
-		obj.AddMember("ipAddress", rapidjson::Value(banned.m_Address.String(), allocator), allocator);
-		obj.AddMember("nucleusId", banned.m_NucleusID, allocator);
+	if (!bWritten)
+	{
+		Error(eDLL_T::SERVER, NO_ERROR, "%s - Unable to write to '%s' (disk full?)\n", __FUNCTION__, BANLIST_TEMP_FILE);
+		FileSystem()->RemoveFile(BANLIST_TEMP_FILE, "PLATFORM");
 
-		document.AddMember(rapidjson::Value(idx, allocator), obj, allocator);
+		return;
 	}
 
-	document.AddMember("totalBans", m_BannedList.Count(), allocator);
+	FileSystem()->RemoveFile(BANLIST_FILE, "PLATFORM");
+
+	if (!FileSystem()->RenameFile(BANLIST_TEMP_FILE, BANLIST_FILE, "PLATFORM"))
+	{
+		// Moved in on the next load or append.
+		Error(eDLL_T::SERVER, NO_ERROR, "%s - Unable to move '%s' to '%s'\n", __FUNCTION__, BANLIST_TEMP_FILE, BANLIST_FILE);
+		return;
+	}
+
+	m_LogRecords = m_BannedList.Count();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: moves the rewritten banned list in place if a rewrite got
+//          interrupted after the old log was removed; the rewritten list is
+//          complete at that point
+//-----------------------------------------------------------------------------
+void CBanSystem::RecoverList(void)
+{
+	if (!FileSystem()->FileExists(BANLIST_FILE, "PLATFORM") &&
+		FileSystem()->FileExists(BANLIST_TEMP_FILE, "PLATFORM"))
+	{
+		FileSystem()->RenameFile(BANLIST_TEMP_FILE, BANLIST_FILE, "PLATFORM");
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: appends a single record to the banned list log
+// Input  : *op     - "add" or "del"
+//			&banned - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CBanSystem::AppendRecord(const char* op, const Banned_t& banned)
+{
+	// Never start a new log while the complete one waits to be moved in.
+	RecoverList();
+
+	FileHandle_t pFile = FileSystem()->Open(BANLIST_FILE, "at", "PLATFORM");
+	if (!pFile)
+	{
+		Error(eDLL_T::SERVER, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, BANLIST_FILE);
+		return false;
+	}
 
 	rapidjson::StringBuffer buffer;
-	JSON_DocumentToBufferDeserialize(document, buffer);
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+	writer.Key("op");
+	writer.String(op);
+	writer.Key("ipAddress");
+	writer.String(banned.m_Address.String());
+	writer.Key("nucleusId");
+	writer.Uint64(banned.m_NucleusID);
+	writer.EndObject();
+
+	buffer.Put('\n');
 
 	FileSystem()->Write(buffer.GetString(), buffer.GetSize(), pFile);
 	FileSystem()->Close(pFile);
+
+	m_LogRecords++;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: rewrites the banned list log if it holds mostly removed bans
+//-----------------------------------------------------------------------------
+void CBanSystem::CompactList(void)
+{
+	if (m_LogRecords > BANLIST_COMPACT_MIN_RECORDS &&
+		m_LogRecords > m_BannedList.Count() * BANLIST_COMPACT_RATIO)
+	{
+		SaveList();
+	}
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: adds a banned player entry to the banned list
+// Purpose: adds a banned player entry to the banned list, the entry is
+//          appended to the banned list log
 // Input  : *ipAddress - 
 //			nucleusId - 
 //-----------------------------------------------------------------------------
 bool CBanSystem::AddEntry(const char* ipAddress, const NucleusID_t nucleusId)
 {
 	Assert(VALID_CHARSTAR(ipAddress));
-	const Banned_t banned(ipAddress, nucleusId);
 
-	if (IsBanListValid())
-	{
-		if (m_BannedList.Find(banned) == m_BannedList.InvalidIndex())
-		{
-			m_BannedList.AddToTail(banned);
-			return true;
-		}
-	}
-	else
-	{
-		m_BannedList.AddToTail(banned);
-		return true;
-	}
+	if (!AddToList(ipAddress, nucleusId))
+		return false;
 
-	return false;
+	AppendRecord("add", m_BannedList.Tail());
+	return true;
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: deletes an entry in the banned list
+// Purpose: deletes all entries in the banned list with given nucleus id or
+//          address, the removals are appended to the banned list log;
+//          addresses are compared the way they are checked, so an address
+//          lifts its ban in any notation, e.g. '1.2.3.4' and
+//          '[::ffff:1.2.3.4]:37015'
 // Input  : *ipAddress - 
 //			nucleusId - 
+// Output : true if any entry was deleted, false otherwise
 //-----------------------------------------------------------------------------
 bool CBanSystem::DeleteEntry(const char* ipAddress, const NucleusID_t nucleusId)
 {
 	Assert(VALID_CHARSTAR(ipAddress));
 
-	if (IsBanListValid())
+	BanRange_s range;
+	const bool bIsRange = ParseRange(ipAddress, range);
+
+	bool bDeleted = false;
+
+	FOR_EACH_VEC_BACK(m_BannedList, i)
 	{
-		FOR_EACH_VEC(m_BannedList, i)
+		const Banned_t& banned = m_BannedList[i];
+		bool bMatch = nucleusId != NULL && banned.m_NucleusID == nucleusId;
+
+		if (!bMatch)
 		{
-			const Banned_t& banned = m_BannedList[i];
+			BanRange_s bannedRange;
 
-			if (banned.m_NucleusID == nucleusId ||
-				banned.m_Address.IsEqual_CaseInsensitive(ipAddress))
-			{
-				m_BannedList.Remove(i);
-				return true;
-			}
+			if (bIsRange)
+				bMatch = ParseRange(banned.m_Address.String(), bannedRange) && bannedRange == range;
+			else
+				bMatch = banned.m_Address.IsEqual_CaseInsensitive(ipAddress);
+		}
+
+		if (bMatch)
+		{
+			const Banned_t removed = banned;
+			RemoveFromList(i);
+
+			AppendRecord("del", removed);
+			bDeleted = true;
 		}
 	}
 
-	return false;
+	if (bDeleted)
+		CompactList();
+
+	return bDeleted;
 }
 
 //-----------------------------------------------------------------------------
@@ -184,22 +420,26 @@ bool CBanSystem::DeleteEntry(const char* ipAddress, const NucleusID_t nucleusId)
 //-----------------------------------------------------------------------------
 bool CBanSystem::IsBanned(const char* ipAddress, const NucleusID_t nucleusId) const
 {
-	FOR_EACH_VEC(m_BannedList, i)
-	{
-		const Banned_t& banned = m_BannedList[i];
+	if (m_NucleusIndex.find(nucleusId) != m_NucleusIndex.end())
+		return true;
 
-		if (banned.m_NucleusID == NULL ||
-			banned.m_Address.IsEmpty())
-		{
-			// Cannot be NULL.
+	BanRange_s range;
+
+	if (!ParseRange(ipAddress, range))
+		return m_AddressIndex.find(GetEntryKey(ipAddress, NULL)) != m_AddressIndex.end();
+
+	// Look the address up in each range size that is banned, from single
+	// addresses to the widest range.
+	for (int prefix = range.prefix; prefix >= 0; prefix--)
+	{
+		if (!m_PrefixCounts[prefix])
 			continue;
-		}
 
-		if (banned.m_NucleusID == nucleusId ||
-			banned.m_Address.IsEqual_CaseInsensitive(ipAddress))
-		{
+		BanRange_s masked = range;
+		MaskRange(masked, prefix);
+
+		if (m_RangeIndex.find(masked) != m_RangeIndex.end())
 			return true;
-		}
 	}
 
 	return false;
@@ -213,6 +453,203 @@ bool CBanSystem::IsBanListValid(void) const
 	return !m_BannedList.IsEmpty();
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: parses an address, with an optional port or CIDR prefix length
+// Input  : *address  - e.g. '1.2.3.4', '[::ffff:1.2.3.4]:37015', '1.2.3.0/24'
+//			&outRange - 
+// Output : true if the address is an ip or range, false otherwise
+//-----------------------------------------------------------------------------
+bool CBanSystem::ParseRange(const char* address, BanRange_s& outRange)
+{
+	char szAddress[128];
+	V_strncpy(szAddress, address, sizeof(szAddress));
+
+	char* pszAddress = szAddress;
+	int prefix = -1;
+
+	if (char* pszPrefix = strchr(pszAddress, '/'))
+	{
+		*pszPrefix++ = '\0';
+
+		if (!*pszPrefix || !V_IsAllDigit(pszPrefix) || strlen(pszPrefix) > 3)
+			return false;
+
+		prefix = atoi(pszPrefix);
+	}
+
+	if (*pszAddress == '[') // Skip the brackets and port.
+	{
+		pszAddress++;
+
+		char* pszEnd = strchr(pszAddress, ']');
+		if (!pszEnd)
+			return false;
+
+		*pszEnd = '\0';
+	}
+	else if (char* pszPort = strchr(pszAddress, ':'))
+	{
+		// An IPv4 address with a port.
+		if (!strchr(pszPort + 1, ':') && strchr(pszAddress, '.'))
+			*pszPort = '\0';
+	}
+
+	uint8_t bytes[16];
+
+	if (inet_pton(AF_INET6, pszAddress, bytes) != 1)
+	{
+		if (inet_pton(AF_INET, pszAddress, &bytes[12]) != 1)
+			return false;
+
+		// Map it into IPv6, the way the engine renders IPv4 addresses.
+		memset(bytes, 0, 10);
+		bytes[10] = 0xFF;
+		bytes[11] = 0xFF;
+
+		if (prefix > 32)
+			return false;
+
+		if (prefix >= 0)
+			prefix += 96;
+	}
+
+	if (prefix > 128)
+		return false;
+
+	outRange.high = 0;
+	outRange.low = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		outRange.high = (outRange.high << 8) | bytes[i];
+		outRange.low = (outRange.low << 8) | bytes[i + 8];
+	}
+
+	MaskRange(outRange, prefix < 0 ? 128 : prefix);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: clears all bits of the range past the prefix length
+// Input  : &range - 
+//			prefix - 
+//-----------------------------------------------------------------------------
+void CBanSystem::MaskRange(BanRange_s& range, const int prefix)
+{
+	if (prefix <= 64)
+	{
+		range.high = prefix ? range.high & (~0ull << (64 - prefix)) : 0;
+		range.low = 0;
+	}
+	else
+	{
+		range.low = prefix < 128 ? range.low & (~0ull << (128 - prefix)) : range.low;
+	}
+
+	range.prefix = prefix;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the key of an entry for the duplicate check, addresses are
+//          compared case insensitively
+// Input  : *ipAddress - 
+//			nucleusId - 
+//-----------------------------------------------------------------------------
+string CBanSystem::GetEntryKey(const char* ipAddress, const NucleusID_t nucleusId)
+{
+	string key = Format("%llu@%s", nucleusId, ipAddress);
+	std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+	return key;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: adds an entry to the list and its indices, without persisting it
+// Input  : *ipAddress - 
+//			nucleusId - 
+// Output : true if added, false if already in the list
+//-----------------------------------------------------------------------------
+bool CBanSystem::AddToList(const char* ipAddress, const NucleusID_t nucleusId)
+{
+	if (!m_EntrySet.insert(GetEntryKey(ipAddress, nucleusId)).second)
+		return false;
+
+	const Banned_t banned(ipAddress, nucleusId);
+
+	m_BannedList.AddToTail(banned);
+	IndexEntry(banned, 1);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: removes an entry from the list and its indices
+// Input  : index - 
+//-----------------------------------------------------------------------------
+void CBanSystem::RemoveFromList(const int index)
+{
+	const Banned_t& banned = m_BannedList[index];
+
+	m_EntrySet.erase(GetEntryKey(banned.m_Address.String(), banned.m_NucleusID));
+	IndexEntry(banned, -1);
+
+	m_BannedList.Remove(index);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: adds or removes an entry from the lookup indices
+// Input  : &banned - 
+//			delta   - 1 to add, -1 to remove
+//-----------------------------------------------------------------------------
+void CBanSystem::IndexEntry(const Banned_t& banned, const int delta)
+{
+	if (banned.m_NucleusID == NULL ||
+		banned.m_Address.IsEmpty())
+	{
+		// Cannot be NULL.
+		return;
+	}
+
+	const auto update = [delta](auto& index, const auto& key)
+	{
+		auto it = index.emplace(key, 0).first;
+		it->second += delta;
+
+		if (it->second <= 0)
+			index.erase(it);
+	};
+
+	update(m_NucleusIndex, banned.m_NucleusID);
+
+	BanRange_s range;
+
+	if (ParseRange(banned.m_Address.String(), range))
+	{
+		update(m_RangeIndex, range);
+		m_PrefixCounts[range.prefix] += delta;
+	}
+	else
+	{
+		update(m_AddressIndex, GetEntryKey(banned.m_Address.String(), NULL));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: clears the list and its indices
+//-----------------------------------------------------------------------------
+void CBanSystem::ClearList(void)
+{
+	m_BannedList.Purge();
+
+	m_NucleusIndex.clear();
+	m_RangeIndex.clear();
+	m_AddressIndex.clear();
+	m_EntrySet.clear();
+
+	memset(m_PrefixCounts, 0, sizeof(m_PrefixCounts));
+	m_LogRecords = 0;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: kicks a player by given name
 // Input  : *playerName - 
@@ -292,7 +729,6 @@ void CBanSystem::UnbanPlayer(const char* criteria)
 
 	if (bSave)
 	{
-		SaveList(); // Save modified vector to file.
 		Msg(eDLL_T::SERVER, "Removed '%s' from banned list\n", criteria);
 	}
 }
@@ -337,7 +773,6 @@ void CBanSystem::AuthorPlayerByName(const char* playerName, const bool shouldBan
 
 	if (bSave)
 	{
-		SaveList();
 		Msg(eDLL_T::SERVER, "Added '%s' to banned list\n", playerName);
 	}
 	else if (bDisconnect)
@@ -414,7 +849,6 @@ void CBanSystem::AuthorPlayerById(const char* playerHandle, const bool shouldBan
 
 	if (bSave)
 	{
-		SaveList();
 		Msg(eDLL_T::SERVER, "Added '%s' to banned list\n", playerHandle);
 	}
 	else if (bDisconnect)
@@ -1,6 +1,15 @@
 #pragma once
 #include "ebisusdk/EbisuTypes.h"
 
+// Bans are stored as a log of JSON records, one per line; each ban or unban
+// appends a record, the log is rewritten once it holds this many times more
+// records than there are bans.
+#define BANLIST_FILE "banlist.jsonl"
+#define BANLIST_LEGACY_FILE "banlist.json" // Imported once if there is no log yet.
+#define BANLIST_TEMP_FILE "banlist.jsonl.tmp" // Rewrites go here first, then replace the log.
+#define BANLIST_COMPACT_RATIO 2
+#define BANLIST_COMPACT_MIN_RECORDS 256
+
 enum EKickType
 {
 	KICK_NAME = 0,
@@ -32,8 +41,10 @@ public:
 	typedef CUtlVector<Banned_t> BannedList_t;
 
 public:
+	CBanSystem();
+
 	void LoadList(void);
-	void SaveList(void) const;
+	void SaveList(void);
 
 	bool AddEntry(const char* ipAddress, const NucleusID_t nucleusId);
 	bool DeleteEntry(const char* ipAddress, const NucleusID_t nucleusId);
@@ -50,10 +61,56 @@ public:
 	void UnbanPlayer(const char* criteria);
 
 private:
+	// Binary form of a banned address or CIDR range, IPv4 is mapped into
+	// IPv6; only the first 'prefix' bits are set.
+	struct BanRange_s
+	{
+		uint64_t high;
+		uint64_t low;
+		int prefix;
+
+		inline bool operator==(const BanRange_s& other) const
+		{
+			return high == other.high && low == other.low && prefix == other.prefix;
+		}
+	};
+
+	struct BanRangeHash_s
+	{
+		inline size_t operator()(const BanRange_s& range) const
+		{
+			return std::hash<uint64_t>()(range.high ^ (range.low * 0x9E3779B97F4A7C15ull) ^ uint64_t(range.prefix));
+		}
+	};
+
+	static bool ParseRange(const char* address, BanRange_s& outRange);
+	static void MaskRange(BanRange_s& range, const int prefix);
+	static string GetEntryKey(const char* ipAddress, const NucleusID_t nucleusId);
+
+	bool AddToList(const char* ipAddress, const NucleusID_t nucleusId);
+	void RemoveFromList(const int index);
+	void IndexEntry(const Banned_t& banned, const int delta);
+	void ClearList(void);
+
+	bool LoadLegacyList(void);
+	void RecoverList(void);
+	bool AppendRecord(const char* op, const Banned_t& banned);
+	void CompactList(void);
+
 	void AuthorPlayerByName(const char* playerName, const bool bBan, const char* reason = nullptr);
 	void AuthorPlayerById(const char* playerHandle, const bool bBan, const char* reason = nullptr);
 
 	BannedList_t m_BannedList;
+
+	// Number of entries per key, entries without a nucleus id or address
+	// never match and aren't indexed, except for the duplicate check.
+	std::unordered_map<NucleusID_t, int> m_NucleusIndex;
+	std::unordered_map<BanRange_s, int, BanRangeHash_s> m_RangeIndex;
+	std::unordered_map<string, int> m_AddressIndex; // Lower case, for addresses that aren't an ip.
+	std::unordered_set<string> m_EntrySet;
+	int m_PrefixCounts[129]; // Number of indexed ranges per prefix length.
+
+	int m_LogRecords; // Number of records in the log.
 };
 
 extern CBanSystem g_BanSystem;
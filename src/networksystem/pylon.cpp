@@ -6,6 +6,7 @@
 //=============================================================================//
 
 #include <core/stdafx.h>
+#include <tier0/frametask.h>
 #include <tier1/cvar.h>
 #include <tier2/curlutils.h>
 #include <tier2/jsonutils.h>
@@ -140,15 +141,12 @@ bool CPylon::GetServerByToken(NetGameServer_t& outGameServer,
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Sends host server POST request.
-// Input  : &outMessage - 
-//			&outToken - 
-//			&netGameServer - 
-// Output : Returns true on success, false on failure.
+// Purpose: builds the host server request.
+// Input  : &requestJson   - 
+//          &netGameServer - 
 //-----------------------------------------------------------------------------
-bool CPylon::PostServerHost(string& outMessage, string& outToken, string& outHostIp, const NetGameServer_t& netGameServer) const
+static void BuildServerHostRequest(rapidjson::Document& requestJson, const NetGameServer_t& netGameServer)
 {
-    rapidjson::Document requestJson;
     requestJson.SetObject();
 
     rapidjson::Document::AllocatorType& allocator = requestJson.GetAllocator();
@@ -166,16 +164,22 @@ bool CPylon::PostServerHost(string& outMessage, string& outToken, string& outHos
     requestJson.AddMember("numPlayers",  netGameServer.numPlayers,                           allocator);
     requestJson.AddMember("maxPlayers",  netGameServer.maxPlayers,                           allocator);
     requestJson.AddMember("timeStamp",   netGameServer.timeStamp,                            allocator);
+}
 
-    rapidjson::Document responseJson;
-    CURLINFO status;
-
-    if (!SendRequest("/servers/add", requestJson, responseJson, outMessage, status, "server host error"))
-    {
-        return false;
-    }
-
-    if (netGameServer.hidden)
+//-----------------------------------------------------------------------------
+// Purpose: reads the token and address from the host server response.
+// Input  : &responseJson - 
+//          status        - 
+//          hidden        - 
+//          &outMessage   - 
+//          &outToken     - 
+//          &outHostIp    - 
+// Output : true on success, false on failure.
+//-----------------------------------------------------------------------------
+static bool GetServerHostFromJSON(const rapidjson::Document& responseJson, const CURLINFO status,
+    const bool hidden, string& outMessage, string& outToken, string& outHostIp)
+{
+    if (hidden)
     {
         const char* token = nullptr;
 
@@ -202,14 +206,61 @@ bool CPylon::PostServerHost(string& outMessage, string& outToken, string& outHos
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Checks a list of clients for their banned status.
-// Input  : &inBannedVec - 
-//			&outBannedVec  - 
-// Output : True on success, false otherwise.
+// Purpose: Sends host server POST request.
+// Input  : &outMessage - 
+//			&outToken - 
+//			&netGameServer - 
+// Output : Returns true on success, false on failure.
 //-----------------------------------------------------------------------------
-bool CPylon::GetBannedList(const CBanSystem::BannedList_t& inBannedVec, CBanSystem::BannedList_t& outBannedVec) const
+bool CPylon::PostServerHost(string& outMessage, string& outToken, string& outHostIp, const NetGameServer_t& netGameServer) const
+{
+    rapidjson::Document requestJson;
+    BuildServerHostRequest(requestJson, netGameServer);
+
+    rapidjson::Document responseJson;
+    CURLINFO status;
+
+    if (!SendRequest("/servers/add", requestJson, responseJson, outMessage, status, "server host error"))
+    {
+        return false;
+    }
+
+    return GetServerHostFromJSON(responseJson, status, netGameServer.hidden, outMessage, outToken, outHostIp);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends host server POST request without blocking.
+// Input  : &netGameServer - 
+//			&callback      - called on the main thread with the result.
+//-----------------------------------------------------------------------------
+void CPylon::PostServerHostAsync(const NetGameServer_t& netGameServer, const PylonHostCallback_t& callback) const
 {
     rapidjson::Document requestJson;
+    BuildServerHostRequest(requestJson, netGameServer);
+
+    const bool hidden = netGameServer.hidden;
+
+    SendRequestAsync("/servers/add", requestJson, [hidden, callback](const bool success,
+        const rapidjson::Document& responseJson, const string& message, const CURLINFO status)
+        {
+            string outMessage = message;
+            string outToken;
+            string outHostIp;
+
+            const bool result = success &&
+                GetServerHostFromJSON(responseJson, status, hidden, outMessage, outToken, outHostIp);
+
+            callback(result, outMessage, outToken, outHostIp);
+        }, "server host error");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: builds the bulk ban check request.
+// Input  : &requestJson - 
+//			&inBannedVec - 
+//-----------------------------------------------------------------------------
+static void BuildBannedListRequest(rapidjson::Document& requestJson, const CBanSystem::BannedList_t& inBannedVec)
+{
     requestJson.SetObject();
 
     rapidjson::Value playersArray(rapidjson::kArrayType);
@@ -228,22 +279,20 @@ bool CPylon::GetBannedList(const CBanSystem::BannedList_t& inBannedVec, CBanSyst
     }
 
     requestJson.AddMember("players", playersArray, allocator);
+}
 
-    rapidjson::Document responseJson;
-
-    string outMessage;
-    CURLINFO status;
-
-    if (!SendRequest("/banlist/bulkCheck", requestJson, responseJson, outMessage, status, "banned bulk check error"))
-    {
-        return false;
-    }
-
+//-----------------------------------------------------------------------------
+// Purpose: reads the banned clients from the bulk ban check response.
+// Input  : &responseJson - 
+//			&outBannedVec - 
+// Output : True on success, false otherwise.
+//-----------------------------------------------------------------------------
+static bool GetBannedListFromJSON(const rapidjson::Document& responseJson, CBanSystem::BannedList_t& outBannedVec)
+{
     rapidjson::Value::ConstMemberIterator bannedPlayersIt;
 
     if (!JSON_GetIterator(responseJson, "bannedPlayers", JSONFieldType_e::kArray, bannedPlayersIt))
     {
-        outMessage = Format("Invalid response with status: %d", int(status));
         return false;
     }
 
@@ -265,32 +314,76 @@ bool CPylon::GetBannedList(const CBanSystem::BannedList_t& inBannedVec, CBanSyst
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Checks if client is banned on the comp server.
-// Input  : &ipAddress - 
-//			nucleusId  - 
-//			&outReason - <- contains banned reason if any.
-// Output : True if banned, false if not banned.
+// Purpose: Checks a list of clients for their banned status.
+// Input  : &inBannedVec - 
+//			&outBannedVec  - 
+// Output : True on success, false otherwise.
 //-----------------------------------------------------------------------------
-bool CPylon::CheckForBan(const string& ipAddress, const uint64_t nucleusId, const string& personaName, string& outReason) const
+bool CPylon::GetBannedList(const CBanSystem::BannedList_t& inBannedVec, CBanSystem::BannedList_t& outBannedVec) const
 {
     rapidjson::Document requestJson;
-    requestJson.SetObject();
-
-    rapidjson::Document::AllocatorType& allocator = requestJson.GetAllocator();
-
-    requestJson.AddMember("name", rapidjson::Value(personaName.c_str(), allocator), allocator);
-    requestJson.AddMember("id", nucleusId, allocator);
-    requestJson.AddMember("ip", rapidjson::Value(ipAddress.c_str(), allocator), allocator);
+    BuildBannedListRequest(requestJson, inBannedVec);
 
     rapidjson::Document responseJson;
+
     string outMessage;
     CURLINFO status;
 
-    if (!SendRequest("/banlist/isBanned", requestJson, responseJson, outMessage, status, "banned check error"))
+    if (!SendRequest("/banlist/bulkCheck", requestJson, responseJson, outMessage, status, "banned bulk check error"))
     {
         return false;
     }
 
+    return GetBannedListFromJSON(responseJson, outBannedVec);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks a list of clients for their banned status without blocking.
+// Input  : &inBannedVec - 
+//			&callback    - called on the main thread with the banned clients.
+//-----------------------------------------------------------------------------
+void CPylon::GetBannedListAsync(const CBanSystem::BannedList_t& inBannedVec, const PylonBannedListCallback_t& callback) const
+{
+    rapidjson::Document requestJson;
+    BuildBannedListRequest(requestJson, inBannedVec);
+
+    SendRequestAsync("/banlist/bulkCheck", requestJson, [callback](const bool success,
+        const rapidjson::Document& responseJson, const string& message, const CURLINFO status)
+        {
+            CBanSystem::BannedList_t outBannedVec;
+            const bool result = success && GetBannedListFromJSON(responseJson, outBannedVec);
+
+            callback(result, outBannedVec);
+        }, "banned bulk check error");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: builds the ban check request.
+// Input  : &requestJson - 
+//			&ipAddress   - 
+//			nucleusId    - 
+//			&personaName - 
+//-----------------------------------------------------------------------------
+static void BuildBanCheckRequest(rapidjson::Document& requestJson, const string& ipAddress,
+    const uint64_t nucleusId, const string& personaName)
+{
+    requestJson.SetObject();
+
+    rapidjson::Document::AllocatorType& allocator = requestJson.GetAllocator();
+
+    requestJson.AddMember("name", rapidjson::Value(personaName.c_str(), allocator), allocator);
+    requestJson.AddMember("id", nucleusId, allocator);
+    requestJson.AddMember("ip", rapidjson::Value(ipAddress.c_str(), allocator), allocator);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads the banned status from the ban check response.
+// Input  : &responseJson - 
+//			&outReason    - <- contains banned reason if any.
+// Output : True if banned, false if not banned.
+//-----------------------------------------------------------------------------
+static bool GetBanStatusFromJSON(const rapidjson::Document& responseJson, string& outReason)
+{
     bool isBanned = false;
 
     if (JSON_GetValue(responseJson, "banned", JSONFieldType_e::kBool, isBanned))
@@ -310,6 +403,53 @@ bool CPylon::CheckForBan(const string& ipAddress, const uint64_t nucleusId, cons
     return false;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Checks if client is banned on the comp server.
+// Input  : &ipAddress - 
+//			nucleusId  - 
+//			&outReason - <- contains banned reason if any.
+// Output : True if banned, false if not banned.
+//-----------------------------------------------------------------------------
+bool CPylon::CheckForBan(const string& ipAddress, const uint64_t nucleusId, const string& personaName, string& outReason) const
+{
+    rapidjson::Document requestJson;
+    BuildBanCheckRequest(requestJson, ipAddress, nucleusId, personaName);
+
+    rapidjson::Document responseJson;
+    string outMessage;
+    CURLINFO status;
+
+    if (!SendRequest("/banlist/isBanned", requestJson, responseJson, outMessage, status, "banned check error"))
+    {
+        return false;
+    }
+
+    return GetBanStatusFromJSON(responseJson, outReason);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks if client is banned on the comp server without blocking.
+// Input  : &ipAddress  - 
+//			nucleusId   - 
+//			&personaName - 
+//			&callback   - called on the main thread with the banned status.
+//-----------------------------------------------------------------------------
+void CPylon::CheckForBanAsync(const string& ipAddress, const uint64_t nucleusId,
+    const string& personaName, const PylonBanCallback_t& callback) const
+{
+    rapidjson::Document requestJson;
+    BuildBanCheckRequest(requestJson, ipAddress, nucleusId, personaName);
+
+    SendRequestAsync("/banlist/isBanned", requestJson, [callback](const bool success,
+        const rapidjson::Document& responseJson, const string& message, const CURLINFO status)
+        {
+            string outReason;
+            const bool banned = success && GetBanStatusFromJSON(responseJson, outReason);
+
+            callback(success, banned, outReason);
+        }, "banned check error");
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: authenticate for 'this' particular connection.
 // Input  : nucleusId   - 
@@ -414,9 +554,8 @@ bool CPylon::SendRequest(const char* endpoint, const rapidjson::Document& reques
     rapidjson::Document& responseJson, string& outMessage, CURLINFO& status,
     const char* errorText, const bool checkEula) const
 {
-    if (!IsDedicated() && !IsEULAUpToDate() && checkEula)
+    if (!CanSendRequest(outMessage, checkEula))
     {
-        outMessage = "EULA not accepted";
         return false;
     }
 
@@ -429,47 +568,60 @@ bool CPylon::SendRequest(const char* endpoint, const rapidjson::Document& reques
         return false;
     }
 
-    if (status == 200) // STATUS_OK
+    return ParseResponse(responseBody, status, responseJson, outMessage, errorText);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends request to Pylon Master Server without blocking; the response
+//          is parsed on the worker and handed to the callback on the main
+//          thread.
+// Input  : *endpoint -
+//			&requestJson -
+//			&callback -
+//			*errorText -
+//			checkEula - 
+//-----------------------------------------------------------------------------
+void CPylon::SendRequestAsync(const char* endpoint, const rapidjson::Document& requestJson,
+    const PylonResponseCallback_t& callback, const char* errorText, const bool checkEula) const
+{
+    string message;
+
+    if (!CanSendRequest(message, checkEula))
     {
-        responseJson.Parse(responseBody.c_str());
+        g_TaskQueue.Dispatch([callback, message]
+            {
+                rapidjson::Document responseJson;
+                callback(false, responseJson, message, CURLINFO_NONE);
+            }, 0);
 
-        if (responseJson.HasParseError())
-        {
-            Warning(eDLL_T::ENGINE, "%s: JSON parse error at position %zu: %s\n", __FUNCTION__,
-                responseJson.GetErrorOffset(), rapidjson::GetParseError_En(responseJson.GetParseError()));
+        return;
+    }
 
-            return false;
-        }
+    rapidjson::StringBuffer stringBuffer;
+    JSON_DocumentToBufferDeserialize(requestJson, stringBuffer);
 
-        if (!responseJson.IsObject())
-        {
-            Warning(eDLL_T::ENGINE, "%s: JSON root was not an object\n", __FUNCTION__);
-            return false;
-        }
+    string finalUrl;
+    CURLParams params;
 
-        if (pylon_showdebuginfo.GetBool())
+    PrepareQuery(endpoint, stringBuffer.GetString(), finalUrl, params);
+
+    m_Worker.Submit(finalUrl.c_str(), stringBuffer.GetString(), params,
+        [this, callback, errorText](CURLWorkerResult_s& result)
         {
-            LogBody(responseJson);
-        }
+            std::shared_ptr<rapidjson::Document> responseJson = std::make_shared<rapidjson::Document>();
 
-        bool success = false;
+            string responseBody;
+            string outMessage;
+            CURLINFO status = CURLINFO_NONE;
 
-        if (JSON_GetValue(responseJson, "success", JSONFieldType_e::kBool, success)
-            && success)
-        {
-            return true;
-        }
-        else
-        {
-            ExtractError(responseJson, outMessage, status);
-            return false;
-        }
-    }
-    else
-    {
-        ExtractError(responseBody, outMessage, status, errorText);
-        return false;
-    }
+            const bool success = FinishQuery(result, responseBody, outMessage, status) &&
+                ParseResponse(responseBody, status, *responseJson, outMessage, errorText);
+
+            g_TaskQueue.Dispatch([callback, responseJson, success, outMessage, status]
+                {
+                    callback(success, *responseJson, outMessage, status);
+                }, 0);
+        });
 }
 
 //-----------------------------------------------------------------------------
@@ -484,51 +636,160 @@ bool CPylon::SendRequest(const char* endpoint, const rapidjson::Document& reques
 bool CPylon::QueryServer(const char* endpoint, const char* request,
     string& outResponse, string& outMessage, CURLINFO& outStatus) const
 {
-    const bool showDebug = pylon_showdebuginfo.GetBool();
+    string finalUrl;
+    CURLParams params;
+
+    PrepareQuery(endpoint, request, finalUrl, params);
+
+    // Blocks until the worker finished the request, the connection used for
+    // it is kept alive for the next one.
+    CURLWorkerResult_s result = m_Worker.Submit(finalUrl.c_str(), request, params).get();
+    return FinishQuery(result, outResponse, outMessage, outStatus);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the request worker, pending requests are failed.
+//-----------------------------------------------------------------------------
+void CPylon::Shutdown()
+{
+    m_Worker.Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks whether requests may be sent to the master server.
+// Input  : &outMessage - <- contains an error message on failure.
+//          checkEula   - 
+// Output : True if allowed, false otherwise.
+//-----------------------------------------------------------------------------
+bool CPylon::CanSendRequest(string& outMessage, const bool checkEula) const
+{
+    if (!IsDedicated() && !IsEULAUpToDate() && checkEula)
+    {
+        outMessage = "EULA not accepted";
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the url and parameters of a query.
+// Input  : *endpoint  - 
+//          *request   - 
+//          &outUrl    - 
+//          &outParams - 
+//-----------------------------------------------------------------------------
+void CPylon::PrepareQuery(const char* endpoint, const char* request,
+    string& outUrl, CURLParams& outParams) const
+{
     const char* hostName = pylon_matchmaking_hostname.GetString();
 
-    if (showDebug)
+    if (pylon_showdebuginfo.GetBool())
     {
         Msg(eDLL_T::ENGINE, "Sending request to '%s' with endpoint '%s':\n%s\n",
             hostName, endpoint, request);
     }
 
-    string finalUrl;
-    CURLFormatUrl(finalUrl, hostName, endpoint);
-    finalUrl += Format("?language=%s", this->GetLanguage().c_str());
+    CURLFormatUrl(outUrl, hostName, endpoint);
+    outUrl += Format("?language=%s", this->GetLanguage().c_str());
 
-    CURLParams params;
-
-    params.writeFunction = CURLWriteStringCallback;
-    params.timeout = curl_timeout.GetInt();
-    params.verifyPeer = ssl_verify_peer.GetBool();
-    params.verbose = curl_debug.GetBool();
+    outParams.writeFunction = CURLWriteStringCallback;
+    outParams.timeout = curl_timeout.GetInt();
+    outParams.verifyPeer = ssl_verify_peer.GetBool();
+    outParams.verbose = curl_debug.GetBool();
+}
 
-    curl_slist* sList = nullptr;
-    CURL* curl = CURLInitRequest(finalUrl.c_str(), request, outResponse, sList, params);
-    if (!curl)
+//-----------------------------------------------------------------------------
+// Purpose: Handles the result of a query.
+// Input  : &result      - 
+//          &outResponse - 
+//          &outMessage  - <- contains an error message on failure.
+//          &outStatus   - 
+// Output : True on success, false on failure.
+//-----------------------------------------------------------------------------
+bool CPylon::FinishQuery(CURLWorkerResult_s& result, string& outResponse,
+    string& outMessage, CURLINFO& outStatus) const
+{
+    if (result.code != CURLE_OK)
     {
-        return false;
-    }
+        const char* curlError = curl_easy_strerror(result.code);
 
-    CURLcode res = CURLSubmitRequest(curl, sList);
-    if (!CURLHandleError(curl, res, outMessage,
-        !IsDedicated(/* Errors are already shown for dedicated! */)))
-    {
+        if (!IsDedicated(/* Errors are already shown for dedicated! */))
+        {
+            Error(eDLL_T::COMMON, NO_ERROR, "CURL: %s\n", curlError);
+        }
+
+        outMessage = curlError;
         return false;
     }
 
-    outStatus = CURLRetrieveInfo(curl);
+    outStatus = CURLINFO(result.status);
 
-    if (showDebug)
+    if (pylon_showdebuginfo.GetBool())
     {
         Msg(eDLL_T::ENGINE, "Host '%s' replied with status: '%d'\n",
-            hostName, outStatus);
+            pylon_matchmaking_hostname.GetString(), outStatus);
     }
 
+    outResponse = std::move(result.response);
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Parses the response body of a query.
+// Input  : &responseBody -
+//          status        -
+//          &responseJson -
+//          &outMessage   -
+//          *errorText    -
+// Output : True on success, false on failure.
+//-----------------------------------------------------------------------------
+bool CPylon::ParseResponse(const string& responseBody, const CURLINFO status,
+    rapidjson::Document& responseJson, string& outMessage, const char* errorText) const
+{
+    if (status == 200) // STATUS_OK
+    {
+        responseJson.Parse(responseBody.c_str());
+
+        if (responseJson.HasParseError())
+        {
+            Warning(eDLL_T::ENGINE, "%s: JSON parse error at position %zu: %s\n", __FUNCTION__,
+                responseJson.GetErrorOffset(), rapidjson::GetParseError_En(responseJson.GetParseError()));
+
+            return false;
+        }
+
+        if (!responseJson.IsObject())
+        {
+            Warning(eDLL_T::ENGINE, "%s: JSON root was not an object\n", __FUNCTION__);
+            return false;
+        }
+
+        if (pylon_showdebuginfo.GetBool())
+        {
+            LogBody(responseJson);
+        }
+
+        bool success = false;
+
+        if (JSON_GetValue(responseJson, "success", JSONFieldType_e::kBool, success)
+            && success)
+        {
+            return true;
+        }
+        else
+        {
+            ExtractError(responseJson, outMessage, status);
+            return false;
+        }
+    }
+    else
+    {
+        ExtractError(responseBody, outMessage, status, errorText);
+        return false;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Extracts the error from the result json.
 // Input  : &resultJson - 
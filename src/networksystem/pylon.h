@@ -1,5 +1,6 @@
 #pragma once
 #include "thirdparty/curl/include/curl/curl.h"
+#include "tier2/curlworker.h"
 #include "bansystem.h"
 #include "serverlisting.h"
 #include "localize/ilocalize.h"
@@ -15,6 +16,12 @@ struct MSEulaData_t
 	string contents;
 };
 
+// Callbacks of the asynchronous requests, these are called on the main thread.
+typedef std::function<void(const bool success, const rapidjson::Document& responseJson, const string& message, const CURLINFO status)> PylonResponseCallback_t;
+typedef std::function<void(const bool result, const string& message, const string& token, const string& hostIp)> PylonHostCallback_t;
+typedef std::function<void(const bool success, const CBanSystem::BannedList_t& bannedVec)> PylonBannedListCallback_t;
+typedef std::function<void(const bool success, const bool banned, const string& reason)> PylonBanCallback_t;
+
 class CPylon
 {
 public:
@@ -27,6 +34,10 @@ public:
 	bool GetBannedList(const CBanSystem::BannedList_t& inBannedVec, CBanSystem::BannedList_t& outBannedVec) const;
 	bool CheckForBan(const string& ipAddress, const uint64_t nucleusId, const string& personaName, string& outReason) const;
 
+	void PostServerHostAsync(const NetGameServer_t& netGameServer, const PylonHostCallback_t& callback) const;
+	void GetBannedListAsync(const CBanSystem::BannedList_t& inBannedVec, const PylonBannedListCallback_t& callback) const;
+	void CheckForBanAsync(const string& ipAddress, const uint64_t nucleusId, const string& personaName, const PylonBanCallback_t& callback) const;
+
 	bool AuthForConnection(const uint64_t nucleusId, const char* ipAddress, const char* authCode, string& outToken, string& outMessage) const;
 
 	bool GetEULA(MSEulaData_t& outData, string& outMessage) const;
@@ -36,8 +47,11 @@ public:
 
 	void LogBody(const rapidjson::Document& responseJson) const;
 	bool SendRequest(const char* endpoint, const rapidjson::Document& requestJson, rapidjson::Document& responseJson, string& outMessage, CURLINFO& status, const char* errorText = nullptr, const bool checkEula = true) const;
+	void SendRequestAsync(const char* endpoint, const rapidjson::Document& requestJson, const PylonResponseCallback_t& callback, const char* errorText = nullptr, const bool checkEula = true) const;
 	bool QueryServer(const char* endpoint, const char* request, string& outResponse, string& outMessage, CURLINFO& outStatus) const;
 
+	void Shutdown();
+
 	inline void SetLanguage(const char* lang)
 	{
 		AUTO_LOCK(m_StringMutex);
@@ -50,7 +64,16 @@ public:
 	};
 
 private:
+	bool CanSendRequest(string& outMessage, const bool checkEula) const;
+	void PrepareQuery(const char* endpoint, const char* request, string& outUrl, CURLParams& outParams) const;
+	bool FinishQuery(CURLWorkerResult_s& result, string& outResponse, string& outMessage, CURLINFO& outStatus) const;
+	bool ParseResponse(const string& responseBody, const CURLINFO status, rapidjson::Document& responseJson, string& outMessage, const char* errorText) const;
+
 	string m_Language;
 	mutable CThreadFastMutex m_StringMutex;
+
+	// All requests go through this worker, which keeps the connections to
+	// the master server alive between requests.
+	mutable CCURLWorker m_Worker;
 };
 extern CPylon g_MasterServer;
@@ -0,0 +1,926 @@
+//=============================================================================//
+//
+// Purpose: Standalone pak inspection and validation tool
+//
+//=============================================================================//
+#include "core/logdef.h"
+#include "core/logger.h"
+#include "tier0/cpu.h"
+#include "tier0/binstream.h"
+#include "tier0/fasttimer.h"
+#include "tier1/cmd.h"
+#include "tier1/fmtstr.h"
+#include "windows/console.h"
+#include "rtech/ipakfile.h"
+#include "rtech/pak/pakdecode.h"
+#include "rtech/pak/paktools.h"
+
+#include "vstdlib/keyvaluessystem.h"
+#include "vstdlib/random.h"
+#include "filesystem/filesystem_std.h"
+
+// max number of errors and warnings printed, the remainder is only counted
+#define MAX_REPORTED_ISSUES 64
+
+static CKeyValuesSystem s_KeyValuesSystem;
+static CFileSystem_Stdio s_FullFileSystem;
+static bool s_bUseAnsiColors = true;
+
+//-----------------------------------------------------------------------------
+// Purpose: keyvalues singleton accessor
+//-----------------------------------------------------------------------------
+IKeyValuesSystem* KeyValuesSystem()
+{
+	return &s_KeyValuesSystem;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: filesystem singleton accessor
+//-----------------------------------------------------------------------------
+CFileSystem_Stdio* FileSystem()
+{
+	return &s_FullFileSystem;
+}
+
+//-----------------------------------------------------------------------------
+// Offsets to the tables in the decoded pak, these directly follow the file
+// header and are required before any page can be loaded
+//-----------------------------------------------------------------------------
+struct PakTableLayout_s
+{
+	size_t patchDataHeader;
+	size_t patchFileHeaders;
+	size_t patchNumbers;
+	size_t streamingFilePaths;
+	size_t segmentHeaders;
+	size_t pageHeaders;
+	size_t pointers;
+	size_t assets;
+	size_t guidDescriptors;
+	size_t fileRelations;
+
+	// end of the tables, the patch edit stream and page data follow
+	size_t totalSize;
+};
+
+//-----------------------------------------------------------------------------
+// Sizes of all assets of one type
+//-----------------------------------------------------------------------------
+struct PakAssetTypeStats_s
+{
+	uint32_t magic;
+	uint32_t assetCount;
+
+	// bytes of the asset headers and page data referenced by the assets
+	uint64_t headerBytes;
+	uint64_t pageBytes;
+
+	inline uint64_t GetTotalBytes() const { return headerBytes + pageBytes; }
+};
+
+//-----------------------------------------------------------------------------
+// Verifies the header, patch headers, page/segment layout, pointer and
+// dependency tables of a pak and reports the size of each asset type. The pak
+// is decoded in streaming fashion; only the tables are kept in memory
+//-----------------------------------------------------------------------------
+class CPakInspector
+{
+public:
+	CPakInspector(const char* const pPakFile);
+
+	bool Inspect(void);
+
+	inline int GetErrorCount(void) const { return m_nErrorCount; }
+	inline int GetWarningCount(void) const { return m_nWarningCount; }
+
+private:
+	bool OnHeader(const PakFileHeader_s& header);
+	bool OnData(const uint8_t* const pData, const size_t nDataLen);
+
+	void ComputeTableLayout(void);
+
+	void ValidatePatchHeaders(void);
+	void ValidateSegments(void);
+	void ValidatePages(void);
+	void ValidatePointers(void);
+	void ValidateAssets(void);
+
+	void ReportAssetTypes(void);
+
+	bool IsPagePtrValid(const PakPage_u& ptr, const size_t nSize) const;
+
+	void ReportError(const char* const pFormat, ...) FMTFUNCTION(2, 3);
+	void ReportWarning(const char* const pFormat, ...) FMTFUNCTION(2, 3);
+
+	inline PakFileHeader_s* GetHeader(void) const { return reinterpret_cast<PakFileHeader_s*>(m_pTables.get()); }
+
+	template <typename T>
+	inline T* GetTable(const size_t nOffset) const { return reinterpret_cast<T*>(&m_pTables[nOffset]); }
+
+	CUtlString m_PakFile;
+	PakFileHeader_s m_Header;
+	PakTableLayout_s m_Layout;
+
+	std::unique_ptr<uint8_t[]> m_pTables;
+	size_t m_nBytesDecoded;
+
+	int m_nErrorCount;
+	int m_nWarningCount;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: constructor
+//-----------------------------------------------------------------------------
+CPakInspector::CPakInspector(const char* const pPakFile)
+	: m_PakFile(pPakFile)
+	, m_Header{}
+	, m_Layout{}
+	, m_nBytesDecoded(0)
+	, m_nErrorCount(0)
+	, m_nWarningCount(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: decodes and validates the pak file
+// Output : true if the pak could be decoded, validation issues are counted
+//-----------------------------------------------------------------------------
+bool CPakInspector::Inspect(void)
+{
+	const bool bDecoded = Pak_StreamDecodePakFile(m_PakFile.String(),
+		[this](const PakFileHeader_s& header) { return OnHeader(header); },
+		[this](const uint8_t* const pData, const size_t nDataLen) { return OnData(pData, nDataLen); });
+
+	if (!bDecoded)
+	{
+		ReportError("Failed to decode pak file \"%s\"\n", m_PakFile.String());
+		return false;
+	}
+
+	if (m_nBytesDecoded != m_Header.decompressedSize)
+	{
+		ReportError("Decoded '%zu' bytes while the header specifies '%zu' bytes\n",
+			m_nBytesDecoded, m_Header.decompressedSize);
+
+		return false;
+	}
+
+	ValidatePatchHeaders();
+	ValidateSegments();
+	ValidatePages();
+	ValidatePointers();
+	ValidateAssets();
+
+	ReportAssetTypes();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: validates the file header and allocates room for the tables
+// Input  : &header -
+// Output : true to continue decoding
+//-----------------------------------------------------------------------------
+bool CPakInspector::OnHeader(const PakFileHeader_s& header)
+{
+	Pak_ShowHeaderDetails(&header);
+	m_Header = header;
+
+	if (header.virtualSegmentCount > PAK_MAX_SEGMENTS)
+	{
+		ReportError("Segment count '%hu' exceeds max '%d'\n", header.virtualSegmentCount, PAK_MAX_SEGMENTS);
+		return false;
+	}
+
+	if (header.decompressedSize < header.compressedSize && header.GetCompressionMode() != PakDecodeMode_e::MODE_DISABLED)
+		ReportWarning("Decompressed size '%zu' is smaller than compressed size '%zu'\n", header.decompressedSize, header.compressedSize);
+
+	ComputeTableLayout();
+
+	if (m_Layout.totalSize > header.decompressedSize)
+	{
+		ReportError("Tables ('%zu' bytes) exceed the decompressed size of '%zu' bytes\n",
+			m_Layout.totalSize, header.decompressedSize);
+
+		return false;
+	}
+
+	m_pTables.reset(new uint8_t[m_Layout.totalSize]);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: keeps the decoded tables, page data is only counted
+// Input  : *pData -
+//			nDataLen -
+// Output : true to continue decoding
+//-----------------------------------------------------------------------------
+bool CPakInspector::OnData(const uint8_t* const pData, const size_t nDataLen)
+{
+	if (m_nBytesDecoded < m_Layout.totalSize)
+	{
+		const size_t nCopyLen = (std::min)(nDataLen, m_Layout.totalSize - m_nBytesDecoded);
+		memcpy(&m_pTables[m_nBytesDecoded], pData, nCopyLen);
+	}
+
+	m_nBytesDecoded += nDataLen;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: computes the offsets to each table from the header counts
+//-----------------------------------------------------------------------------
+void CPakInspector::ComputeTableLayout(void)
+{
+	const PakFileHeader_s& header = m_Header;
+	size_t nOffset = sizeof(PakFileHeader_s);
+
+	m_Layout.patchDataHeader = nOffset;
+
+	if (header.patchIndex)
+		nOffset += sizeof(PakPatchDataHeader_s);
+
+	m_Layout.patchFileHeaders = nOffset;
+	nOffset += header.patchIndex * sizeof(PakPatchFileHeader_s);
+
+	m_Layout.patchNumbers = nOffset;
+	nOffset += header.patchIndex * sizeof(uint16_t);
+
+	m_Layout.streamingFilePaths = nOffset;
+	nOffset += header.GetTotalStreamingNamesBufferSize();
+
+	m_Layout.segmentHeaders = nOffset;
+	nOffset += header.virtualSegmentCount * sizeof(PakSegmentHeader_s);
+
+	m_Layout.pageHeaders = nOffset;
+	nOffset += header.memPageCount * sizeof(PakPageHeader_s);
+
+	m_Layout.pointers = nOffset;
+	nOffset += header.descriptorCount * sizeof(PakPage_u);
+
+	m_Layout.assets = nOffset;
+	nOffset += header.assetCount * sizeof(PakAsset_s);
+
+	m_Layout.guidDescriptors = nOffset;
+	nOffset += header.guidDescriptorCount * sizeof(PakPage_u);
+
+	m_Layout.fileRelations = nOffset;
+	nOffset += header.relationsCounts * sizeof(uint32_t);
+
+	// two more unknown buffers follow the relations, their sizes are stored
+	// in the first 2 dwords of 'unk2'
+	const uint32_t* const pUnknownSizes = reinterpret_cast<const uint32_t*>(header.unk2);
+	nOffset += size_t(pUnknownSizes[0]) + pUnknownSizes[1];
+
+	m_Layout.totalSize = nOffset;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: validates the patch headers against the patched pak files on disk
+//-----------------------------------------------------------------------------
+void CPakInspector::ValidatePatchHeaders(void)
+{
+	PakFileHeader_s* const pHeader = GetHeader();
+
+	if (!pHeader->patchIndex)
+		return;
+
+	const PakPatchDataHeader_s* const pPatchDataHeader = GetTable<PakPatchDataHeader_s>(m_Layout.patchDataHeader);
+
+	if (pPatchDataHeader->pageCount > pHeader->memPageCount)
+	{
+		ReportError("Patch data header patches '%u' pages, but the pak only has '%hu' pages\n",
+			pPatchDataHeader->pageCount, pHeader->memPageCount);
+	}
+
+	// file name without extension and patch number ID, same as the runtime
+	// uses to locate the patched paks
+	char baseFilePath[MAX_PATH];
+	snprintf(baseFilePath, sizeof(baseFilePath), "%s", m_PakFile.String());
+
+	const char* const pFileNameUnqualified = V_UnqualifiedFileName(baseFilePath);
+	V_StripExtension(baseFilePath, baseFilePath, sizeof(baseFilePath));
+
+	char* const pPatchIdentifier = strrchr(baseFilePath, '(');
+
+	if (pPatchIdentifier && pPatchIdentifier > pFileNameUnqualified)
+		*pPatchIdentifier = '\0';
+
+	for (uint16_t i = 0; i < pHeader->patchIndex; i++)
+	{
+		const PakPatchFileHeader_s* const pPatchHeader = Pak_GetPatchFileHeader(pHeader, i);
+		const short nPatchNumber = Pak_GetPatchNumberForIndex(pHeader, i);
+
+		if (pPatchHeader->compressedSize <= sizeof(PakFileHeader_s) || pPatchHeader->decompressedSize <= sizeof(PakFileHeader_s))
+		{
+			ReportError("Patch header '%hu' has invalid sizes (compressed: '%zu', decompressed: '%zu')\n",
+				i, pPatchHeader->compressedSize, pPatchHeader->decompressedSize);
+		}
+
+		char patchFile[MAX_PATH];
+
+		// the first patch number does not have an identifier in its name
+		if (nPatchNumber == 0)
+			snprintf(patchFile, sizeof(patchFile), "%s.rpak", baseFilePath);
+		else
+			snprintf(patchFile, sizeof(patchFile), "%s(%02u).rpak", baseFilePath, nPatchNumber);
+
+		CIOStream patchStream;
+
+		if (!patchStream.Open(patchFile, CIOStream::READ | CIOStream::BINARY))
+		{
+			ReportWarning("Patched pak \"%s\" not found; size not verified\n", patchFile);
+			continue;
+		}
+
+		const size_t nFileSize = patchStream.GetSize();
+
+		if (nFileSize != pPatchHeader->compressedSize)
+		{
+			ReportError("Patched pak \"%s\" is '%zu' bytes while patch header '%hu' specifies '%zu' bytes\n",
+				patchFile, nFileSize, i, pPatchHeader->compressedSize);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: validates the segment headers
+//-----------------------------------------------------------------------------
+void CPakInspector::ValidateSegments(void)
+{
+	const PakSegmentHeader_s* const pSegments = GetTable<PakSegmentHeader_s>(m_Layout.segmentHeaders);
+
+	for (uint16_t i = 0; i < m_Header.virtualSegmentCount; i++)
+	{
+		const PakSegmentHeader_s& segment = pSegments[i];
+
+		// header segments are aligned by the asset type bindings instead
+		if ((segment.typeFlags & (SF_TEMP | SF_CPU)) == SF_HEAD)
+			continue;
+
+		if (segment.dataAlignment <= 0 || !IsPowerOfTwo(segment.dataAlignment))
+			ReportError("Segment '%hu' has invalid alignment '%d'\n", i, segment.dataAlignment);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: validates the page headers, and the amount of page data
+//-----------------------------------------------------------------------------
+void CPakInspector::ValidatePages(void)
+{
+	const PakSegmentHeader_s* const pSegments = GetTable<PakSegmentHeader_s>(m_Layout.segmentHeaders);
+	const PakPageHeader_s* const pPages = GetTable<PakPageHeader_s>(m_Layout.pageHeaders);
+
+	// on patch paks, the first pages are patched through the edit stream
+	uint32_t nFirstPage = 0;
+	size_t nDataSize = 0;
+
+	if (m_Header.patchIndex)
+	{
+		const PakPatchDataHeader_s* const pPatchDataHeader = GetTable<PakPatchDataHeader_s>(m_Layout.patchDataHeader);
+
+		nFirstPage = (std::min)(pPatchDataHeader->pageCount, uint32_t(m_Header.memPageCount));
+		nDataSize += pPatchDataHeader->editStreamSize;
+	}
+
+	for (uint16_t i = 0; i < m_Header.memPageCount; i++)
+	{
+		const PakPageHeader_s& page = pPages[i];
+
+		if (page.segmentIdx >= m_Header.virtualSegmentCount)
+		{
+			ReportError("Page '%hu' references segment '%u' out of '%hu'\n",
+				i, page.segmentIdx, m_Header.virtualSegmentCount);
+
+			continue;
+		}
+
+		if (!page.pageAlignment || !IsPowerOfTwo(page.pageAlignment))
+			ReportError("Page '%hu' has invalid alignment '%u'\n", i, page.pageAlignment);
+
+		const PakSegmentHeader_s& segment = pSegments[page.segmentIdx];
+
+		// the runtime only aligns pages to their own alignment, this relies on
+		// the segment alignment being equal or greater
+		if ((segment.typeFlags & (SF_TEMP | SF_CPU)) != SF_HEAD && page.pageAlignment > uint32_t(segment.dataAlignment))
+		{
+			ReportWarning("Page '%hu' alignment '%u' exceeds alignment '%d' of segment '%u'\n",
+				i, page.pageAlignment, segment.dataAlignment, page.segmentIdx);
+		}
+
+		if (i >= nFirstPage)
+			nDataSize += page.dataSize;
+	}
+
+	const size_t nExpectedSize = m_Layout.totalSize + nDataSize;
+
+	if (nExpectedSize > m_Header.decompressedSize)
+	{
+		ReportError("Tables and page data ('%zu' bytes) exceed the decompressed size of '%zu' bytes\n",
+			nExpectedSize, m_Header.decompressedSize);
+	}
+	else if (nExpectedSize < m_Header.decompressedSize)
+	{
+		ReportWarning("'%zu' bytes of decoded data aren't covered by the tables or pages\n",
+			m_Header.decompressedSize - nExpectedSize);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: checks if the page pointer points to valid page data
+// Input  : &ptr -
+//			nSize - size of the data pointed to
+//-----------------------------------------------------------------------------
+bool CPakInspector::IsPagePtrValid(const PakPage_u& ptr, const size_t nSize) const
+{
+	if (ptr.index == UINT32_MAX || ptr.offset == UINT32_MAX || ptr.index >= m_Header.memPageCount)
+		return false;
+
+	const PakPageHeader_s* const pPages = GetTable<PakPageHeader_s>(m_Layout.pageHeaders);
+	return size_t(ptr.offset) + nSize <= pPages[ptr.index].dataSize;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: validates the pointer table
+//-----------------------------------------------------------------------------
+void CPakInspector::ValidatePointers(void)
+{
+	const PakPage_u* const pPointers = GetTable<PakPage_u>(m_Layout.pointers);
+
+	for (uint32_t i = 0; i < m_Header.descriptorCount; i++)
+	{
+		const PakPage_u& ptr = pPointers[i];
+
+		if (!IsPagePtrValid(ptr, sizeof(PakPage_u)))
+			ReportError("Pointer '%u' is invalid (page: '%u', offset: '%u')\n", i, ptr.index, ptr.offset);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: validates the asset entries and their dependency tables
+//-----------------------------------------------------------------------------
+void CPakInspector::ValidateAssets(void)
+{
+	const PakAsset_s* const pAssets = GetTable<PakAsset_s>(m_Layout.assets);
+	const PakPage_u* const pGuidDescriptors = GetTable<PakPage_u>(m_Layout.guidDescriptors);
+	const uint32_t* const pFileRelations = GetTable<uint32_t>(m_Layout.fileRelations);
+
+	std::unordered_map<PakGuid_t, uint32_t> guidMap;
+	guidMap.reserve(m_Header.assetCount);
+
+	for (uint32_t i = 0; i < m_Header.assetCount; i++)
+	{
+		const PakAsset_s& asset = pAssets[i];
+
+		const auto insert = guidMap.emplace(asset.guid, i);
+
+		if (!insert.second)
+			ReportError("Asset '%u' has the same GUID '0x%llX' as asset '%u'\n", i, asset.guid, insert.first->second);
+
+		if (!IsPagePtrValid(asset.headPtr, asset.headerSize))
+		{
+			ReportError("Asset '0x%llX' has an invalid header pointer (page: '%u', offset: '%u', size: '%u')\n",
+				asset.guid, asset.headPtr.index, asset.headPtr.offset, asset.headerSize);
+		}
+
+		// assets without page data have no data pointer
+		if (asset.dataPtr.index != UINT32_MAX && !IsPagePtrValid(asset.dataPtr, 0))
+		{
+			ReportError("Asset '0x%llX' has an invalid data pointer (page: '%u', offset: '%u')\n",
+				asset.guid, asset.dataPtr.index, asset.dataPtr.offset);
+		}
+
+		if (asset.pageEnd > m_Header.memPageCount)
+			ReportError("Asset '0x%llX' page end '%hu' exceeds page count '%hu'\n", asset.guid, asset.pageEnd, m_Header.memPageCount);
+
+		if (uint64_t(asset.dependenciesIndex) + asset.dependenciesCount > m_Header.guidDescriptorCount)
+		{
+			ReportError("Asset '0x%llX' dependencies ['%u', '%u') exceed descriptor count '%u'\n",
+				asset.guid, asset.dependenciesIndex, asset.dependenciesIndex + asset.dependenciesCount, m_Header.guidDescriptorCount);
+		}
+		else
+		{
+			for (uint32_t j = 0; j < asset.dependenciesCount; j++)
+			{
+				const PakPage_u& descriptor = pGuidDescriptors[asset.dependenciesIndex + j];
+
+				if (!IsPagePtrValid(descriptor, sizeof(PakGuid_t)))
+				{
+					ReportError("Asset '0x%llX' dependency '%u' has an invalid descriptor (page: '%u', offset: '%u')\n",
+						asset.guid, j, descriptor.index, descriptor.offset);
+				}
+			}
+		}
+
+		if (uint64_t(asset.dependentsIndex) + asset.dependentsCount > m_Header.relationsCounts)
+		{
+			ReportError("Asset '0x%llX' dependents ['%u', '%u') exceed relation count '%u'\n",
+				asset.guid, asset.dependentsIndex, asset.dependentsIndex + asset.dependentsCount, m_Header.relationsCounts);
+		}
+	}
+
+	for (uint32_t i = 0; i < m_Header.relationsCounts; i++)
+	{
+		if (pFileRelations[i] >= m_Header.assetCount)
+			ReportError("Relation '%u' references asset '%u' out of '%u'\n", i, pFileRelations[i], m_Header.assetCount);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reports the size of each asset type, the page data is divided up
+//          among the assets by the offsets at which they point into a page
+//-----------------------------------------------------------------------------
+void CPakInspector::ReportAssetTypes(void)
+{
+	struct PageRef_s
+	{
+		uint32_t pageIndex;
+		uint32_t offset;
+		uint32_t assetIndex;
+	};
+
+	const PakAsset_s* const pAssets = GetTable<PakAsset_s>(m_Layout.assets);
+	const PakPageHeader_s* const pPages = GetTable<PakPageHeader_s>(m_Layout.pageHeaders);
+
+	CUtlVector<PageRef_s> pageRefs;
+	pageRefs.EnsureCapacity(m_Header.assetCount * 2);
+
+	std::map<uint32_t, PakAssetTypeStats_s> typeMap;
+
+	for (uint32_t i = 0; i < m_Header.assetCount; i++)
+	{
+		const PakAsset_s& asset = pAssets[i];
+		PakAssetTypeStats_s& stats = typeMap[asset.magic];
+
+		stats.magic = asset.magic;
+		stats.assetCount++;
+		stats.headerBytes += asset.headerSize;
+
+		if (IsPagePtrValid(asset.dataPtr, 0))
+			pageRefs.AddToTail({ asset.dataPtr.index, asset.dataPtr.offset, i });
+	}
+
+	std::sort(pageRefs.begin(), pageRefs.end(), [](const PageRef_s& a, const PageRef_s& b)
+		{
+			return a.pageIndex != b.pageIndex ? a.pageIndex < b.pageIndex : a.offset < b.offset;
+		});
+
+	// each asset owns the data from its data pointer up to the next data
+	// pointer in the same page, or the end of the page
+	FOR_EACH_VEC(pageRefs, i)
+	{
+		const PageRef_s& ref = pageRefs[i];
+		const bool bLastInPage = i + 1 == pageRefs.Count() || pageRefs[i + 1].pageIndex != ref.pageIndex;
+
+		const uint32_t nEnd = bLastInPage ? pPages[ref.pageIndex].dataSize : pageRefs[i + 1].offset;
+		typeMap[pAssets[ref.assetIndex].magic].pageBytes += nEnd - ref.offset;
+	}
+
+	CUtlVector<PakAssetTypeStats_s> types;
+	uint64_t nTotalBytes = 0;
+
+	for (const auto& it : typeMap)
+	{
+		types.AddToTail(it.second);
+		nTotalBytes += it.second.GetTotalBytes();
+	}
+
+	std::sort(types.begin(), types.end(), [](const PakAssetTypeStats_s& a, const PakAssetTypeStats_s& b)
+		{
+			return a.GetTotalBytes() > b.GetTotalBytes();
+		});
+
+	Msg(eDLL_T::RTECH, "______________________________________________________________\n");
+	Msg(eDLL_T::RTECH, "-+ Asset types -----------------------------------------------\n");
+	Msg(eDLL_T::RTECH, " | %-6s %8s %14s %14s %14s %7s\n", "Type", "Count", "Header", "Page data", "Total", "Share");
+
+	FOR_EACH_VEC(types, i)
+	{
+		const PakAssetTypeStats_s& stats = types[i];
+
+		char typeName[sizeof(uint32_t) + 1];
+		memcpy(typeName, &stats.magic, sizeof(uint32_t));
+		typeName[sizeof(uint32_t)] = '\0';
+
+		Msg(eDLL_T::RTECH, " | %-6s %8u %14llu %14llu %14llu %6.2f%%\n",
+			typeName, stats.assetCount, stats.headerBytes, stats.pageBytes, stats.GetTotalBytes(),
+			nTotalBytes ? (stats.GetTotalBytes() * 100.0) / nTotalBytes : 0.0);
+	}
+
+	Msg(eDLL_T::RTECH, " |-- Embedded streaming data: '%llu' bytes\n", m_Header.GetTotalEmbeddedStreamingDataSize());
+	Msg(eDLL_T::RTECH, "--------------------------------------------------------------\n");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reports a validation error
+//-----------------------------------------------------------------------------
+void CPakInspector::ReportError(const char* const pFormat, ...)
+{
+	if (m_nErrorCount++ >= MAX_REPORTED_ISSUES)
+		return;
+
+	char buf[1024];
+
+	va_list args;
+	va_start(args, pFormat);
+	V_vsnprintf(buf, sizeof(buf), pFormat, args);
+	va_end(args);
+
+	Error(eDLL_T::RTECH, NO_ERROR, "%s", buf);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reports a validation warning
+//-----------------------------------------------------------------------------
+void CPakInspector::ReportWarning(const char* const pFormat, ...)
+{
+	if (m_nWarningCount++ >= MAX_REPORTED_ISSUES)
+		return;
+
+	char buf[1024];
+
+	va_list args;
+	va_start(args, pFormat);
+	V_vsnprintf(buf, sizeof(buf), pFormat, args);
+	va_end(args);
+
+	Warning(eDLL_T::RTECH, "%s", buf);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: decodes the pak with the wide kernel while the input is made
+//          available in randomly sized steps, which exercises the paths where
+//          the decoder runs out of streamed data and has to resume
+//-----------------------------------------------------------------------------
+static bool PakInspect_FuzzStreamDecode(uint8_t* const inBuf, uint8_t* const outBuf, const size_t pakSize, CUniformRandomStream& randomStream)
+{
+	PakDecoder_s decoder{};
+	const size_t decompressedSize = Pak_InitDecoder(&decoder, inBuf, outBuf, UINT64_MAX, UINT64_MAX,
+		pakSize, NULL, sizeof(PakFileHeader_s), PakDecodeMode_e::MODE_RTECH);
+
+	size_t inLen = 0;
+
+	for (;;)
+	{
+		const size_t lastOutPos = decoder.outBufBytePos;
+		inLen = Min(inLen + randomStream.RandomInt(1, 0x10000), pakSize);
+
+		if (Pak_StreamToBufferDecode(&decoder, inLen, decompressedSize, PakDecodeMode_e::MODE_RTECH, false))
+			return true;
+
+		// all data has been streamed, but the decoder is stuck
+		if (inLen == pakSize && decoder.outBufBytePos == lastOutPos)
+			return false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: decodes all RTech encoded paks in the directory with both the
+//          reference and the wide decoder kernel, verifies the decoded data is
+//          identical byte for byte and reports the throughput of each kernel
+// Input  : *pDirectory - 
+//          nIterations - decodes per kernel and pak
+//          nFuzzRounds - randomly streamed decodes per pak
+// Output : number of paks that failed to decode or differ between kernels
+//-----------------------------------------------------------------------------
+static int PakInspect_BenchDecoder(const char* const pDirectory, const int nIterations, const int nFuzzRounds)
+{
+	CUtlVector<CUtlString> pakFiles;
+	std::error_code ec;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(pDirectory, ec))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".rpak")
+			pakFiles.AddToTail(entry.path().string().c_str());
+	}
+
+	if (pakFiles.IsEmpty())
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "No pak files found in \"%s\"\n", pDirectory);
+		return 1;
+	}
+
+	// the decoders may read and write a few bytes past the end of the buffers
+	const size_t bufferPadding = 64;
+
+	CUniformRandomStream randomStream;
+	randomStream.SetSeed(0);
+
+	double totalReferenceSeconds = 0.0;
+	double totalWideSeconds = 0.0;
+
+	size_t totalDecodedBytes = 0;
+	int numMismatches = 0;
+
+	FOR_EACH_VEC(pakFiles, i)
+	{
+		const char* const pakFile = pakFiles[i].String();
+		CIOStream pakStream;
+
+		if (!pakStream.Open(pakFile, CIOStream::READ | CIOStream::BINARY))
+		{
+			Warning(eDLL_T::RTECH, "Failed to open pak file \"%s\" for read!\n", pakFile);
+			continue;
+		}
+
+		const size_t fileSize = pakStream.GetSize();
+
+		if (fileSize <= sizeof(PakFileHeader_s))
+			continue;
+
+		std::unique_ptr<uint8_t[]> inBufContainer(new uint8_t[fileSize + bufferPadding]);
+		uint8_t* const inBuf = inBufContainer.get();
+
+		pakStream.Read(inBuf, fileSize);
+		pakStream.Close();
+
+		const PakFileHeader_s* const header = reinterpret_cast<PakFileHeader_s*>(inBuf);
+
+		// only the RTech decoder has multiple kernels
+		if (header->magic != PAK_HEADER_MAGIC || header->version != PAK_HEADER_VERSION ||
+			header->GetCompressionMode() != PakDecodeMode_e::MODE_RTECH || header->compressedSize != fileSize)
+		{
+			continue;
+		}
+
+		const size_t decompressedSize = header->decompressedSize;
+
+		std::unique_ptr<uint8_t[]> referenceBufContainer(new uint8_t[decompressedSize + bufferPadding]);
+		std::unique_ptr<uint8_t[]> wideBufContainer(new uint8_t[decompressedSize + bufferPadding]);
+
+		uint8_t* const referenceBuf = referenceBufContainer.get();
+		uint8_t* const wideBuf = wideBufContainer.get();
+
+		double referenceSeconds = 0.0;
+		double wideSeconds = 0.0;
+
+		bool decoded = true;
+
+		for (int j = 0; j < nIterations && decoded; j++)
+		{
+			CFastTimer decodeTimer;
+
+			decodeTimer.Start();
+			decoded &= Pak_BufferToBufferDecode(inBuf, referenceBuf, fileSize, PakDecodeMode_e::MODE_RTECH, true);
+			decodeTimer.End();
+
+			referenceSeconds += decodeTimer.GetDuration().GetSeconds();
+
+			decodeTimer.Start();
+			decoded &= Pak_BufferToBufferDecode(inBuf, wideBuf, fileSize, PakDecodeMode_e::MODE_RTECH, false);
+			decodeTimer.End();
+
+			wideSeconds += decodeTimer.GetDuration().GetSeconds();
+		}
+
+		if (!decoded)
+		{
+			Error(eDLL_T::RTECH, NO_ERROR, "Failed to decode pak \"%s\"\n", pakFile);
+
+			numMismatches++;
+			continue;
+		}
+
+		bool identical = memcmp(referenceBuf, wideBuf, decompressedSize) == 0;
+
+		for (int j = 0; j < nFuzzRounds && identical; j++)
+		{
+			memset(wideBuf, 0, decompressedSize);
+
+			// the header isn't copied over on streamed decodes, only compare
+			// the decoded data
+			identical = PakInspect_FuzzStreamDecode(inBuf, wideBuf, fileSize, randomStream) &&
+				memcmp(&referenceBuf[sizeof(PakFileHeader_s)], &wideBuf[sizeof(PakFileHeader_s)],
+					decompressedSize - sizeof(PakFileHeader_s)) == 0;
+		}
+
+		if (!identical)
+		{
+			Error(eDLL_T::RTECH, NO_ERROR, "Decoded data of pak \"%s\" differs between kernels!\n", pakFile);
+
+			numMismatches++;
+			continue;
+		}
+
+		const double decodedMiB = static_cast<double>(decompressedSize) * nIterations / (1024.0 * 1024.0);
+
+		Msg(eDLL_T::RTECH, "%-48s: %8.2f MiB/s (reference) %8.2f MiB/s (wide) %5.2fx\n",
+			V_UnqualifiedFileName(pakFile), decodedMiB / referenceSeconds, decodedMiB / wideSeconds, referenceSeconds / wideSeconds);
+
+		totalReferenceSeconds += referenceSeconds;
+		totalWideSeconds += wideSeconds;
+		totalDecodedBytes += decompressedSize * nIterations;
+	}
+
+	if (totalDecodedBytes)
+	{
+		const double totalMiB = static_cast<double>(totalDecodedBytes) / (1024.0 * 1024.0);
+
+		Msg(eDLL_T::RTECH, "%-48s: %8.2f MiB/s (reference) %8.2f MiB/s (wide) %5.2fx\n",
+			"total", totalMiB / totalReferenceSeconds, totalMiB / totalWideSeconds, totalReferenceSeconds / totalWideSeconds);
+	}
+
+	Msg(eDLL_T::RTECH, "Benchmarked '%d' pak(s) with '%d' failing verification\n",
+		pakFiles.Count(), numMismatches);
+
+	return numMismatches;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: init
+//-----------------------------------------------------------------------------
+static void PakInspect_Init()
+{
+	CheckSystemCPUForSSE2();
+
+	// Init time.
+	Plat_FloatTime();
+
+	g_CoreMsgVCallback = EngineLoggerSink;
+
+	if (s_bUseAnsiColors)
+		Console_ColorInit();
+
+	SpdLog_Init(s_bUseAnsiColors);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: shutdown
+//-----------------------------------------------------------------------------
+static void PakInspect_Shutdown()
+{
+	// Must be done to flush all buffers.
+	SpdLog_Shutdown();
+	Console_Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: logs tool's usage
+//-----------------------------------------------------------------------------
+static void PakInspect_Usage()
+{
+	Warning(eDLL_T::RTECH,
+		"PakInspect instructions and options:\n"
+		"Run 'pakinspect' with the following parameters:\n"
+		"\t<%s>\t- path and name of the pak file\n"
+		"\t<%s>\t- ( optional ) treat warnings as errors\n"
+		"Or with the following parameters to benchmark the decoder:\n"
+		"\t<%s>\t- directory containing the pak files\n"
+		"\t<%s>\t- ( optional ) decodes per kernel, defaults to 3\n"
+		"\t<%s>\t- ( optional ) randomly streamed decodes per pak, defaults to 0\n",
+		"fileName", "-strict", "-bench <directory>", "-iterations <count>", "-fuzz <count>");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+// Output : EXIT_SUCCESS if the pak passed validation, EXIT_FAILURE otherwise
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	PakInspect_Init();
+
+	CCommand args;
+	CUtlString str;
+
+	for (int i = 0; i < argc; i++)
+	{
+		str.Append(argv[i]);
+		str.Append(' ');
+	}
+
+	args.Tokenize(str.Get(), cmd_source_t::kCommandSrcCode);
+	int nResult = EXIT_FAILURE;
+
+	const char* const pBenchDirectory = args.FindArg("-bench");
+
+	if (pBenchDirectory)
+	{
+		const int nIterations = Max(args.FindArgInt("-iterations", 3), 1);
+		const int nFuzzRounds = Max(args.FindArgInt("-fuzz", 0), 0);
+
+		if (!PakInspect_BenchDecoder(pBenchDirectory, nIterations, nFuzzRounds))
+			nResult = EXIT_SUCCESS;
+	}
+	else if (args.ArgC() < 2 || args.Arg(1)[0] == '-')
+	{
+		PakInspect_Usage();
+	}
+	else
+	{
+		const bool bStrict = args.FindArg("-strict") != nullptr;
+		CPakInspector inspector(args.Arg(1));
+
+		const bool bInspected = inspector.Inspect();
+
+		const int nErrors = inspector.GetErrorCount();
+		const int nWarnings = inspector.GetWarningCount();
+
+		Msg(eDLL_T::RTECH, "Inspected pak \"%s\" with '%d' error(s) and '%d' warning(s)\n",
+			args.Arg(1), nErrors, nWarnings);
+
+		if (bInspected && !nErrors && (!bStrict || !nWarnings))
+			nResult = EXIT_SUCCESS;
+	}
+
+	PakInspect_Shutdown();
+	return nResult;
+}
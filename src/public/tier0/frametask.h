@@ -3,6 +3,32 @@
 
 #include "public/iframetask.h"
 
+// Callables up to this size are stored in the task itself, larger ones are
+// allocated separately.
+#define FRAMETASK_INLINE_SIZE 96
+
+// The timer wheel has 2 levels of this many slots, tasks delayed beyond
+// 'FRAMETASK_WHEEL_SLOTS^2' frames are kept in an overflow list until the
+// second level wraps around.
+#define FRAMETASK_WHEEL_BITS 8
+#define FRAMETASK_WHEEL_SLOTS (1 << FRAMETASK_WHEEL_BITS)
+
+struct FrameTaskStats_s
+{
+    int64_t tasksRun;
+    int64_t tasksDeferred;  // Tasks pushed to the next frame by the budget.
+
+    int readyDepth;         // Due tasks not ran yet.
+    int peakReadyDepth;
+    int delayedDepth;       // Tasks waiting in the timer wheel.
+    int lastIntake;         // Tasks dispatched since the previous frame.
+    int peakIntake;
+
+    double lastFrameTime;   // Time spent running tasks in the last frame.
+    double avgLatency;      // Time from dispatch until ran, for undelayed tasks.
+    double peakLatency;
+};
+
 //=============================================================================//
 // This class is set up to run before each frame, committed tasks are scheduled
 // to execute after 'i' frames.
@@ -11,21 +37,138 @@
 // performing a web request in a separate thread, and apply the results (such as
 // server lists in the browser) onto the imgui panels which are created/drawn in
 // the main thread
+// ----------------------------------------------------------------------------
+// Dispatching never locks; tasks are pushed onto a lock-free stack that is
+// taken as a whole at the start of each frame, after which delayed tasks are
+// sorted into a timer wheel. Tasks are recycled through per-thread caches.
 //=============================================================================//
 class CFrameTask : public IFrameTask
 {
 public:
-    virtual ~CFrameTask() {}
+    CFrameTask();
+    virtual ~CFrameTask();
     virtual void RunFrame();
     virtual bool IsFinished() const;
 
-    void Dispatch(std::function<void()> functor, unsigned int frames);
+    template <typename Functor>
+    void Dispatch(Functor&& functor, unsigned int frames);
+
+    // Maximum time in seconds spent on running tasks each frame, 0 for no
+    // limit; at least one task runs each frame.
+    inline void SetFrameBudget(const double budget) { m_flFrameBudget = budget; }
+    void GetStats(FrameTaskStats_s& stats) const;
 
 private:
-    mutable CThreadMutex m_Mutex;
-    std::list<QueuedTasks_s> m_QueuedTasks;
+    struct Task_s
+    {
+        Task_s* next;
+        uint64_t dueFrame;
+        double dispatchTime;
+
+        // Runs the callable if 'invoke' is set, and destroys it.
+        void (*pfnRun)(void* const storage, const bool invoke);
+        alignas(16) uint8_t storage[FRAMETASK_INLINE_SIZE];
+    };
+
+    struct TaskList_s
+    {
+        TaskList_s() : head(nullptr), tail(nullptr), count(0) {}
+        inline bool IsEmpty() const { return !head; }
+
+        void AddToTail(Task_s* const task);
+        void AddToTail(TaskList_s& list);
+        Task_s* RemoveHead();
+
+        Task_s* head;
+        Task_s* tail;
+        int count;
+    };
+
+    template <typename Functor>
+    static void RunInline(void* const storage, const bool invoke);
+    template <typename Functor>
+    static void RunAllocated(void* const storage, const bool invoke);
+
+    static Task_s* AllocTask(CFrameTask* const owner);
+    void Submit(Task_s* const task, const unsigned int frames);
+
+    void Schedule(Task_s* const task);
+    void AdvanceWheel();
+    void ReleaseTasks(TaskList_s& list);
+
+    // Tasks dispatched since the last frame, newest first.
+    std::atomic<Task_s*> m_Intake;
+    std::atomic<int> m_IntakeCount;
+
+    // Finished tasks, taken as a whole by threads whose cache ran dry.
+    std::atomic<Task_s*> m_FreeTasks;
+
+    // Only accessed on the thread running the frames.
+    uint64_t m_nFrame;
+    TaskList_s m_Ready;
+    TaskList_s m_Wheel[2][FRAMETASK_WHEEL_SLOTS];
+    TaskList_s m_Overflow;
+    int m_nDelayed;
+
+    double m_flFrameBudget;
+
+    FrameTaskStats_s m_Stats;
+    int64_t m_nLatencySamples;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: runs and destroys a callable stored in the task
+//-----------------------------------------------------------------------------
+template <typename Functor>
+void CFrameTask::RunInline(void* const storage, const bool invoke)
+{
+    Functor* const functor = reinterpret_cast<Functor*>(storage);
+
+    if (invoke)
+        (*functor)();
+
+    functor->~Functor();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: runs and destroys a callable allocated for the task
+//-----------------------------------------------------------------------------
+template <typename Functor>
+void CFrameTask::RunAllocated(void* const storage, const bool invoke)
+{
+    Functor* const functor = *reinterpret_cast<Functor**>(storage);
+
+    if (invoke)
+        (*functor)();
+
+    delete functor;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: adds function to the queue, to be called after 'i' frames.
+// Input  : functor -
+//          frames - 0 to run on the next frame
+//-----------------------------------------------------------------------------
+template <typename Functor>
+void CFrameTask::Dispatch(Functor&& functor, unsigned int frames)
+{
+    typedef typename std::decay<Functor>::type Functor_t;
+    Task_s* const task = AllocTask(this);
+
+    if constexpr (sizeof(Functor_t) <= FRAMETASK_INLINE_SIZE && alignof(Functor_t) <= 16)
+    {
+        new (task->storage) Functor_t(std::forward<Functor>(functor));
+        task->pfnRun = &RunInline<Functor_t>;
+    }
+    else
+    {
+        *reinterpret_cast<Functor_t**>(task->storage) = new Functor_t(std::forward<Functor>(functor));
+        task->pfnRun = &RunAllocated<Functor_t>;
+    }
+
+    Submit(task, frames);
+}
+
 extern std::list<IFrameTask*> g_TaskQueueList;
 extern CFrameTask g_TaskQueue;
 
@@ -27,6 +27,9 @@ public:
 
 	void LoadSections();
 
+	void PrescanPatterns(const vector<string>& patterns);
+	void ClearPrescan();
+
 	CMemory FindPatternSIMD(const char* szPattern, const ModuleSections_t* moduleSection = nullptr) const;
 	CMemory FindString(const char* szString, const ptrdiff_t occurrence = 1, bool nullTerminator = false) const;
 	CMemory FindStringReadOnly(const char* szString, bool nullTerminator) const;
@@ -77,6 +80,9 @@ private:
 	DWORD                m_nModuleSize;
 	string               m_ModuleName;
 	ModuleSectionsMap_t  m_ModuleSections;
+
+	// Results of PrescanPatterns, by pattern; null if not found.
+	unordered_map<string, QWORD> m_PrescanResults;
 };
 
 #endif // MODULE_H
\ No newline at end of file
@@ -0,0 +1,76 @@
+//===========================================================================//
+//
+// Purpose: Byte pattern scanning
+//
+//===========================================================================//
+#ifndef TIER0_PATTERNSCAN_H
+#define TIER0_PATTERNSCAN_H
+
+// Patterns are compared in 16 byte chunks, this is the maximum length.
+#define PATTERNSCAN_MAX_LENGTH 2048
+
+// Bits of the hashed anchor; the filter and bucket tables have this many
+// entries.
+#define PATTERNSCAN_ANCHOR_HASH_BITS 16
+
+const uint8_t* PatternScan_FindSIMD(const uint8_t* const pData, const size_t nSize,
+	const uint8_t* const pPattern, const char* const szMask, const size_t nOccurrence = 0);
+
+//-----------------------------------------------------------------------------
+// Finds the first occurrence of many patterns in a single pass over memory.
+// Each pattern is anchored on 4 of its fixed bytes, picked to be the rarest
+// in the scanned memory; the scan looks up every 4 bytes of memory in a
+// filter of all anchors, and only compares the patterns whose anchor hashes
+// to the same bucket. Patterns without 4 consecutive fixed bytes are scanned
+// on their own.
+//-----------------------------------------------------------------------------
+class CPatternScanner
+{
+public:
+	CPatternScanner();
+
+	int AddPattern(const char* const szPattern);
+	void Scan(const uint8_t* const pData, const size_t nSize, int nThreads = 0);
+
+	inline int GetPatternCount() const { return static_cast<int>(m_Patterns.size()); }
+	inline const uint8_t* GetResult(const int i) const { return m_Patterns[i].pResult; }
+
+	// Number of patterns of the last scan that had no anchor.
+	inline int GetUnanchoredCount() const { return m_nUnanchored; }
+
+private:
+	struct Pattern_s
+	{
+		vector<uint8_t> bytes; // Padded to whole chunks.
+		vector<int> masks;     // Bit per fixed byte, per chunk.
+		string mask;
+
+		size_t length;
+		size_t anchorOffset;
+		uint32_t anchor;
+		bool anchored;
+
+		const uint8_t* pResult;
+	};
+
+	void ChooseAnchors(const uint8_t* const pData, const size_t nSize);
+	void BuildBuckets();
+
+	void ScanRange(const uint8_t* const pData, const size_t nSize,
+		const size_t nFrom, const size_t nTo, const uint8_t** const pResults) const;
+
+	bool Compare(const Pattern_s& pattern, const uint8_t* const pData, const size_t nAvail) const;
+
+	static inline uint32_t HashAnchor(const uint32_t nAnchor)
+	{ return (nAnchor * 0x9E3779B1u) >> (32 - PATTERNSCAN_ANCHOR_HASH_BITS); }
+
+	vector<Pattern_s> m_Patterns;
+
+	vector<uint64_t> m_Filter;       // Bit per anchor hash.
+	vector<uint32_t> m_BucketStart;  // Per anchor hash, into m_BucketItems.
+	vector<uint32_t> m_BucketItems;  // Pattern indices.
+
+	int m_nUnanchored;
+};
+
+#endif // TIER0_PATTERNSCAN_H
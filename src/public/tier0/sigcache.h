@@ -26,7 +26,10 @@ public:
 	bool ReadCache(const char* szCacheFile);
 	bool WriteCache(const char* szCacheFile) const;
 
+	bool ReadPatterns(const char* szCacheFile, vector<string>& patterns) const;
+
 private:
+	bool ReadBlob(const char* szCacheFile, SigMap_Pb& cache, const bool bAllowStale) const;
 	bool CompressBlob(const size_t nSrcLen, size_t& nDstLen, uint32_t& nAdler32, const uint8_t* pSrcBuf, uint8_t* pDstBuf) const;
 	bool DecompressBlob(const size_t nSrcLen, size_t& nDstLen, uint32_t& nAdler32, const uint8_t* pSrcBuf, uint8_t* pDstBuf) const;
 
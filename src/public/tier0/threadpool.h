@@ -0,0 +1,129 @@
+//===========================================================================//
+//
+// Purpose: Persistent work-stealing thread pool
+//
+//===========================================================================//
+#ifndef TIER0_THREADPOOL_H
+#define TIER0_THREADPOOL_H
+#include <condition_variable>
+#include <deque>
+
+// Number of times an idle worker looks for tasks to steal before it sleeps.
+#define THREADPOOL_SPIN_COUNT 64
+
+// Maximum number of workers, including the threads waiting on a task group.
+#define THREADPOOL_MAX_THREADS 64
+
+class CTaskGroup;
+
+//-----------------------------------------------------------------------------
+// Runs tasks on one worker per physical core, minus the core of the thread
+// that started the pool. Each worker has its own deque: it pushes and pops
+// its own tasks at the back, while idle workers steal from the front, where
+// the oldest and therefore largest pieces of split work are. Threads outside
+// the pool submit to a shared queue, and help running tasks while they wait
+// on a task group; every caller shares the same workers, so concurrent jobs
+// don't oversubscribe the cpu.
+//-----------------------------------------------------------------------------
+class CThreadPool
+{
+	friend class CTaskGroup;
+
+public:
+	CThreadPool();
+	~CThreadPool();
+
+	void Shutdown();
+
+	// Number of threads running tasks, including the waiting caller.
+	int GetNumThreads();
+
+	inline int64_t GetTaskCount() const { return m_nTaskCount; }
+	inline int64_t GetStealCount() const { return m_nStealCount; }
+
+private:
+	struct Task_s
+	{
+		std::function<void()> func;
+		CTaskGroup* group;
+	};
+
+	struct Worker_s
+	{
+		std::mutex mutex;
+		std::deque<Task_s> tasks;
+	};
+
+	void StartWorkers();
+	void WorkerRun(const int index);
+
+	void Submit(Task_s&& task);
+	bool RunTask();
+
+	bool PopTask(Task_s& outTask);
+	bool StealTask(Task_s& outTask, const unsigned int first);
+
+	std::unique_ptr<Worker_s[]> m_Workers;
+	vector<std::thread> m_Threads;
+	int m_nNumWorkers;
+
+	std::atomic<bool> m_bRunning;
+	std::mutex m_StartMutex;
+
+	// Tasks submitted by threads outside the pool.
+	std::mutex m_SharedMutex;
+	std::deque<Task_s> m_SharedTasks;
+
+	std::atomic<int> m_nQueued;   // Tasks in all queues.
+	std::atomic<int> m_nSleeping; // Workers waiting on the condition.
+
+	std::mutex m_SleepMutex;
+	std::condition_variable m_SleepCond;
+
+	std::atomic<int64_t> m_nTaskCount;
+	std::atomic<int64_t> m_nStealCount;
+};
+
+extern CThreadPool g_ThreadPool;
+
+//-----------------------------------------------------------------------------
+// A set of tasks that can be waited on together. Waiting runs queued tasks
+// until there are none left to take, so tasks may start and wait on nested
+// groups; the waiter then sleeps until the tasks running elsewhere finished.
+//-----------------------------------------------------------------------------
+class CTaskGroup
+{
+	friend class CThreadPool;
+
+public:
+	CTaskGroup(CThreadPool& pool = g_ThreadPool)
+		: m_Pool(pool)
+		, m_nPending(0)
+	{}
+
+	~CTaskGroup() { Wait(); }
+
+	template <typename Functor>
+	void Run(Functor&& functor)
+	{
+		m_nPending.fetch_add(1, std::memory_order_relaxed);
+		m_Pool.Submit(CThreadPool::Task_s{ std::forward<Functor>(functor), this });
+	}
+
+	void Wait();
+
+	inline CThreadPool& GetPool() const { return m_Pool; }
+
+private:
+	void Release();
+
+	CThreadPool& m_Pool;
+	std::atomic<int> m_nPending;
+
+	// The last task is released while holding the mutex, which the waiter
+	// takes before returning; the group can't be freed while it's notified.
+	std::mutex m_WaitMutex;
+	std::condition_variable m_WaitCond;
+};
+
+#endif // TIER0_THREADPOOL_H
@@ -38,6 +38,103 @@ inline CAlignedMemAlloc* AlignedMemAlloc()
 	return g_pAlignedMemAlloc;
 }
 
+//-----------------------------------------------------------------------------
+// Unbounded multi-producer, single-consumer queue. Any number of threads may
+// push items while only one thread at a time may pop them. A push that is in
+// progress may not yet be visible to the consumer; the queue then reports as
+// empty until the producer has finished linking the node in.
+//-----------------------------------------------------------------------------
+template <class T>
+class CTSQueue
+{
+public:
+	CTSQueue()
+		: m_pHead(&m_Stub)
+		, m_pTail(&m_Stub)
+		, m_nCount(0)
+	{
+		m_Stub.m_pNext.store(nullptr, std::memory_order_relaxed);
+	}
+
+	~CTSQueue()
+	{
+		Purge();
+
+		if (m_pTail != &m_Stub)
+			delete m_pTail;
+	}
+
+	// Thread safe; may be called from any thread.
+	void PushItem(const T& item)
+	{
+		Link(new Node_t(item));
+	}
+
+	void PushItem(T&& item)
+	{
+		Link(new Node_t(std::move(item)));
+	}
+
+	// Must only be called from the consumer thread.
+	bool PopItem(T* pResult)
+	{
+		Node_t* const pTail = m_pTail;
+		Node_t* const pNext = pTail->m_pNext.load(std::memory_order_acquire);
+
+		if (!pNext)
+			return false;
+
+		*pResult = std::move(pNext->m_Value);
+		m_pTail = pNext; // Next becomes the new stub.
+
+		if (pTail != &m_Stub)
+			delete pTail;
+
+		m_nCount.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Must only be called from the consumer thread.
+	void Purge()
+	{
+		T item;
+		while (PopItem(&item)) {}
+	}
+
+	// Approximate when called while other threads push items.
+	int Count() const { return m_nCount.load(std::memory_order_relaxed); }
+
+private:
+	struct Node_t
+	{
+		Node_t() = default;
+		explicit Node_t(const T& value) : m_Value(value), m_pNext(nullptr) {}
+		explicit Node_t(T&& value) : m_Value(std::move(value)), m_pNext(nullptr) {}
+
+		T m_Value;
+		std::atomic<Node_t*> m_pNext;
+	};
+
+	void Link(Node_t* const pNode)
+	{
+		m_nCount.fetch_add(1, std::memory_order_relaxed);
+
+		Node_t* const pPrev = m_pHead.exchange(pNode, std::memory_order_acq_rel);
+		pPrev->m_pNext.store(pNode, std::memory_order_release);
+	}
+
+	Node_t m_Stub;
+
+	std::atomic<Node_t*> m_pHead; // Producers push here.
+	Node_t*              m_pTail; // Consumer pops here.
+
+	std::atomic<int> m_nCount;
+
+	// Disallow copying
+	CTSQueue(const CTSQueue&);
+	CTSQueue& operator=(const CTSQueue&);
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 class VTSListBase : public IDetour
 {
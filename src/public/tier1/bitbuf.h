@@ -356,6 +356,10 @@ public:
 	FORCEINLINE bool IsOverflowed() const { return this->m_bOverflow; }
 
 private:
+	// Copies bits from an arbitrary bit offset in memory through a 64-bit
+	// accumulator; the caller must have done the bounds checking.
+	void            WriteBitsWordwise(const unsigned char* pIn, const int nInShift, const unsigned char* const pInEnd, int nBits);
+
 	// The current buffer.
 	unsigned char*          m_pData;
 	int                     m_nDataBytes;
@@ -497,6 +501,18 @@ FORCEINLINE unsigned int CBitRead::ReadUBitLong(int numbits)
 		}
 		return nRet;
 	}
+	else if (m_pDataIn < m_pBufferEnd)
+	{
+		// Refill through a 64-bit accumulator; the bits left in the current
+		// word are followed by the next word, so the field is extracted with
+		// a single mask and shift regardless of where it splits.
+		const uint64 nAccum = m_nInBufWord | (uint64(LittleDWord(*(m_pDataIn++))) << m_nBitsAvail);
+
+		m_nBitsAvail += 32 - numbits;
+		m_nInBufWord = uint32(nAccum >> numbits);
+
+		return uint32(nAccum) & s_nMaskTable[numbits];
+	}
 	else
 	{
 		uint32 nRet = m_nInBufWord;
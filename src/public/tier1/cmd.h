@@ -65,6 +65,8 @@ public:
 	const char* operator[](int nIndex) const;
 
 	bool HasOnlyDigits(int nIndex) const;
+	const char* FindArg(const char* pName) const;
+	int FindArgInt(const char* pName, int nDefaultVal) const;
 	void Reset();
 
 	static int MaxCommandLength(void);
@@ -17,6 +17,7 @@ class KeyValues;
 class CFileSystem_Stdio;
 class IBaseFileSystem;
 class CKeyValuesTokenReader;
+class CCommand;
 
 enum KeyValuesTypes_t : char
 {
@@ -155,10 +156,14 @@ public:
 	KeyValues* MakeCopy(void) const;
 
 	KeyValues* CreateKeyUsingKnownLastChild(const char* keyName, KeyValues* pLastChild);
+	KeyValues* CreateKeyUsingKnownLastChild(const int iKeyName, const int iKeyNameCaseSensitive, KeyValues* pLastChild);
 	void AddSubkeyUsingKnownLastChild(KeyValues* pSubKey, KeyValues* pLastChild);
 
 private:
+	KeyValues(const int iKeyName, const int iKeyNameCaseSensitive);
+
 	void RecursiveSaveToFile(IBaseFileSystem* pFileSystem, FileHandle_t pHandle, CUtlBuffer* pBuf, int nIndentLevel);
+	bool LoadFromTokenReader(char const* resourceName, CKeyValuesTokenReader& tokenReader, CUtlBuffer& buf, IBaseFileSystem* pFileSystem, const char* pPathID, GetSymbolProc_t pfnEvaluateSymbolProc);
 	void RecursiveLoadFromBuffer(char const* resourceName, CKeyValuesTokenReader& tokenReader, GetSymbolProc_t pfnEvaluateSymbolProc);
 
 	void RecursiveCopyKeyValues(KeyValues& src);
@@ -171,6 +176,8 @@ private:
 
 	bool EvaluateConditional(const char* pExpressionString, GetSymbolProc_t pfnEvaluateSymbolProc);
 
+	friend bool SDKBench_KVParser(const CCommand& args);
+
 public:
 	uint32_t         m_iKeyName               : 24;// 0x0000
 	uint32_t         m_iKeyNameCaseSensitive1 : 8; // 0x0003
@@ -46,6 +46,10 @@ size_t CURLWriteStringCallback(char* contents, const size_t size, const size_t n
 
 curl_slist* CURLSlistAppend(curl_slist* slist, const char* string);
 
+void CURLInitCommonOptions(CURL* curl, const char* remote,
+	const void* readData, const void* writeData,
+	const CURLParams& params, const CURLProgress* progressData);
+
 bool CURLUploadFile(const char* remote, const char* filePath, const char* options,
 	void* userData, const bool usePost, const curl_slist* slist, const CURLParams& params);
 bool CURLDownloadFile(const char* remote, const char* savePath, const char* fileName,
@@ -0,0 +1,106 @@
+//===========================================================================//
+//
+// Purpose: Asynchronous HTTP requests on a single curl multi worker
+//
+//===========================================================================//
+#ifndef TIER2_CURLWORKER_H
+#define TIER2_CURLWORKER_H
+#include <condition_variable>
+#include <future>
+#include "tier2/curlutils.h"
+
+// Maximum number of connections the worker keeps open to a single host,
+// requests beyond this are queued by curl until a connection frees up.
+#define CURLWORKER_MAX_HOST_CONNECTIONS 8
+
+// Number of idle easy handles kept around for reuse.
+#define CURLWORKER_MAX_FREE_HANDLES 16
+
+// Time in milliseconds the worker waits on socket activity before checking
+// for newly submitted requests.
+#define CURLWORKER_POLL_INTERVAL_MS 5
+
+struct CURLWorkerResult_s
+{
+	CURLWorkerResult_s()
+		: code(CURLE_OK)
+		, status(0)
+	{}
+
+	CURLcode code;
+	long status;
+	string response;
+};
+
+// Called on the worker thread once the request finished or failed, the
+// callback must not block; heavy work should be dispatched elsewhere.
+typedef std::function<void(CURLWorkerResult_s& result)> CURLWorkerCallback_t;
+
+//-----------------------------------------------------------------------------
+// Performs JSON POST requests on one thread driving a curl multi handle. The
+// multi handle owns the connection cache, so consecutive requests to the same
+// host reuse the kept alive connections instead of performing a new TCP and
+// TLS handshake for each one.
+//-----------------------------------------------------------------------------
+class CCURLWorker
+{
+public:
+	CCURLWorker();
+	~CCURLWorker();
+
+	void Shutdown();
+
+	void Submit(const char* remote, const char* request, const CURLParams& params, const CURLWorkerCallback_t& callback);
+	std::future<CURLWorkerResult_s> Submit(const char* remote, const char* request, const CURLParams& params);
+
+	inline int64_t GetRequestCount() const { return requestCount; }
+	inline int64_t GetFailedCount() const { return failedCount; }
+	inline int64_t GetConnectCount() const { return connectCount; }
+	inline int GetPeakInFlight() const { return peakInFlight; }
+
+private:
+	struct Request_s
+	{
+		string remote;
+		string request;
+		bool post;
+
+		CURLParams params;
+		CURLWorkerCallback_t callback;
+		CURLWorkerResult_s result;
+
+		CURL* curl; // Set while the transfer is in flight.
+	};
+
+	bool StartWorker();
+	void WorkerRun();
+
+	void StartTransfer(Request_s* const req);
+	void FinishTransfers();
+	void Complete(Request_s* const req, const CURLcode code);
+
+	CURL* AcquireHandle();
+	void ReleaseHandle(CURL* const curl);
+
+	CURLM* multiHandle;
+	curl_slist* headers;
+
+	// Only accessed on the worker thread.
+	vector<CURL*> freeHandles;
+	vector<Request_s*> activeRequests;
+
+	std::thread workerThread;
+	std::mutex workerMutex;
+	std::condition_variable workerCond; // Signaled on submit and shutdown.
+	bool workerRunning;
+	bool workerStopping; // Set while shutting down, requests are rejected meanwhile.
+
+	vector<Request_s*> pendingRequests; // Guarded by workerMutex.
+
+	std::atomic<int64_t> requestCount;
+	std::atomic<int64_t> failedCount;
+	std::atomic<int64_t> connectCount; // New connections, excluding reused ones.
+	std::atomic<int> peakInFlight;
+};
+
+#endif // TIER2_CURLWORKER_H
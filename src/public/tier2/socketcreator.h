@@ -1,4 +1,5 @@
 #pragma once
+#include "tier0/threadtools.h"
 #include "tier1/NetAdr.h"
 #include "common/igameserverdata.h"
 
@@ -38,6 +39,13 @@ public:
 	CConnectedNetConsoleData& GetAcceptedSocketData(int nIndex);
 	const CConnectedNetConsoleData& GetAcceptedSocketData(int nIndex) const;
 
+	SocketHandle_t GetListenSocketHandle(void) const { return m_hListenSocket; }
+	int FindAcceptedSocket(SocketHandle_t hSocket) const;
+
+	// Held while the listen and accepted sockets are being modified; lock it
+	// when sockets are also used from another thread.
+	CThreadFastMutex& GetMutex(void) const { return m_Mutex; }
+
 public:
 	struct AcceptedSocket_t
 	{
@@ -54,6 +62,8 @@ public:
 private:
 	CUtlVector<AcceptedSocket_t>  m_AcceptedSockets;
 	SocketHandle_t                m_hListenSocket; // Used to accept connections.
+	uint32_t                      m_nNextSerial;   // Serial of the next accepted connection.
+	mutable CThreadFastMutex      m_Mutex;
 
 	enum
 	{
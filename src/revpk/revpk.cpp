@@ -7,11 +7,13 @@
 #include "core/logger.h"
 #include "tier0/fasttimer.h"
 #include "tier0/cpu.h"
+#include "tier0/threadpool.h"
 #include "tier1/cmd.h"
 #include "tier1/fmtstr.h"
 #include "tier1/keyvalues.h"
 #include "windows/console.h"
 #include "vpklib/packedstore.h"
+#include "vpklib/packedstoreview.h"
 
 #include "public/const.h"
 #include "localize/ilocalize.h"
@@ -20,6 +22,7 @@
 
 #define PACK_COMMAND "pack"
 #define UNPACK_COMMAND "unpack"
+#define BENCH_COMMAND "bench"
 
 #define PACK_LOG_DIR "manifest/pack_logs/"
 #define UNPACK_LOG_DIR "manifest/unpack_logs/"
@@ -70,6 +73,9 @@ static void ReVPK_Init()
 //-----------------------------------------------------------------------------
 static void ReVPK_Shutdown()
 {
+    // Workers have to be joined before the statics are destroyed.
+    g_ThreadPool.Shutdown();
+
     // Must be done to flush all buffers.
     SpdLog_Shutdown();
     Console_Shutdown();
@@ -80,7 +86,7 @@ static void ReVPK_Shutdown()
 //-----------------------------------------------------------------------------
 static void ReVPK_Usage()
 {
-    CFmtStr1024 usage;
+    CFmtStrMax usage;
 
     usage.Format(
         "ReVPK instructions and options:\n"
@@ -91,12 +97,21 @@ static void ReVPK_Usage()
         "\t<%s>\t- ( optional ) path to the workspace containing the manifest file\n"
         "\t<%s>\t- ( optional ) path in which the VPK files will be built\n"
         "\t<%s>\t- ( optional ) max LZHAM helper threads [\"%d\", \"%d\"] \"%d\" ( default ) for max practical\n"
-        "\t<%s>\t- ( optional ) the level of compression [\"%s\", \"%s\", \"%s\", \"%s\", \"%s\"]\n\n"
+        "\t<%s>\t- ( optional ) the level of compression [\"%s\", \"%s\", \"%s\", \"%s\", \"%s\"]\n"
+        "\t<%s>\t- ( optional ) number of parallel compress workers, \"0\" for one per core, \"1\" ( default ) for serial\n"
+        "\t<%s>\t- ( optional ) pack file index to build, chunks already present in earlier pack files are shared\n"
+        "\t<%s>\t- ( optional ) only recompress entries that changed since the previous build\n\n"
 
         "For unpacking; run 'revpk %s' with the following parameters:\n"
         "\t<%s>\t- path and name of the target VPK files\n"
         "\t<%s>\t- ( optional ) path in which the VPK files will be unpacked\n"
-        "\t<%s>\t- ( optional ) whether to parse the directory file name from the pack file name\n",
+        "\t<%s>\t- ( optional ) whether to parse the directory file name from the pack file name\n"
+        "\t<%s>\t- ( optional ) number of parallel extract workers, \"0\" for one per core, \"1\" ( default ) for serial\n"
+        "\t<%s>\t- ( optional ) only extract entries matching the pattern, \"*\" matches any sequence of characters\n\n"
+
+        "For benchmarking the directory file loaders; run 'revpk %s' with the following parameters:\n"
+        "\t<%s>\t- path and name of the target VPK directory file\n"
+        "\t<%s>\t- ( optional ) number of iterations ( defaults to \"%d\" )\n",
 
         PACK_COMMAND, // Pack parameters:
         "locale", g_LanguageNames[0],
@@ -110,8 +125,17 @@ static void ReVPK_Usage()
         "compressLevel", // Compress level.
         "fastest", "faster", "default", "better", "uber",
 
+        "-threads <count>", // Num pack workers.
+        "-patch <index>", // Pack file index.
+        "-incremental", // Incremental build.
+
         UNPACK_COMMAND,// Unpack parameters:
-        "fileName", "outPath", "sanitize"
+        "fileName", "outPath", "sanitize",
+        "-threads <count>", // Num extract workers.
+        "-filter <pattern>", // Entry filter.
+
+        BENCH_COMMAND, // Bench parameters:
+        "fileName", "iterations", 10
     );
 
     Warning(eDLL_T::FS, "%s", usage.Get());
@@ -151,7 +175,20 @@ static void ReVPK_WriteEnableFile(const char* containingPath)
 //-----------------------------------------------------------------------------
 static void ReVPK_Pack(const CCommand& args)
 {
-    const int argCount = args.ArgC();
+    int argCount = args.ArgC();
+
+    // Named switches trail the positional parameters.
+    for (int i = 1; i < argCount; i++)
+    {
+        const char* arg = args.Arg(i);
+
+        if (V_stricmp(arg, "-threads") == NULL || V_stricmp(arg, "-patch") == NULL ||
+            V_stricmp(arg, "-incremental") == NULL)
+        {
+            argCount = i;
+            break;
+        }
+    }
 
     if (argCount < 5)
     {
@@ -187,7 +224,9 @@ static void ReVPK_Pack(const CCommand& args)
     CFmtStr1024 textFileName("%s%s%s%s_%s.log", buildPath.String(), PACK_LOG_DIR, localeName, contextName, levelName);
     SpdLog_InstallSupplementalLogger("supplemental_logger_mt", textFileName.String());
 
-    VPKPair_t pair(localeName, contextName, levelName, NULL);
+    const int patchIndex = std::clamp(args.FindArgInt("-patch", 0), 0, PACKFILEPATCH_MAX - 1);
+
+    VPKPair_t pair(localeName, contextName, levelName, patchIndex);
     Msg(eDLL_T::FS, "*** Starting VPK build command for: '%s'\n", pair.m_DirName.Get());
 
     CFastTimer timer;
@@ -199,6 +238,9 @@ static void ReVPK_Pack(const CCommand& args)
         argCount > 7 ? (std::min)(atoi(args.Arg(7)), LZHAM_MAX_HELPER_THREADS) : -1, // Num threads.
         argCount > 8 ? args.Arg(8) : "default"); // Compress level.
 
+    builder.SetNumPackWorkers(args.FindArgInt("-threads", 1));
+    builder.SetIncremental(args.FindArg("-incremental") != nullptr);
+
     builder.PackStore(pair, workspacePath.String(), buildPath.String());
 
     timer.End();
@@ -211,7 +253,19 @@ static void ReVPK_Pack(const CCommand& args)
 //-----------------------------------------------------------------------------
 static void ReVPK_Unpack(const CCommand& args)
 {
-    const int argCount = args.ArgC();
+    int argCount = args.ArgC();
+
+    // Named switches trail the positional parameters.
+    for (int i = 1; i < argCount; i++)
+    {
+        const char* arg = args.Arg(i);
+
+        if (V_stricmp(arg, "-threads") == NULL || V_stricmp(arg, "-filter") == NULL)
+        {
+            argCount = i;
+            break;
+        }
+    }
 
     if (argCount < 3)
     {
@@ -247,13 +301,132 @@ static void ReVPK_Unpack(const CCommand& args)
     CPackedStoreBuilder builder;
 
     builder.InitLzDecoder();
-    builder.UnpackStore(vpk, argCount > 3 ? args.Arg(3) : "ship/");
+    builder.SetNumPackWorkers(args.FindArgInt("-threads", 1));
+
+    builder.UnpackStore(vpk, outPath, args.FindArg("-filter"));
 
     timer.End();
     Msg(eDLL_T::FS, "*** Time elapsed: '%lf' seconds\n", timer.GetDuration().GetSeconds());
     Msg(eDLL_T::FS, "\n");
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: compares loading and querying a directory file through 'VPKDir_t'
+//          against the memory mapped 'CPackedStoreDirView'
+//-----------------------------------------------------------------------------
+static void ReVPK_Bench(const CCommand& args)
+{
+    const int argCount = args.ArgC();
+
+    if (argCount < 3)
+    {
+        ReVPK_Usage();
+        return;
+    }
+
+    const char* fileName = args.Arg(2);
+    const int iterations = argCount > 3 ? (std::max)(atoi(args.Arg(3)), 1) : 10;
+
+    CFastTimer timer;
+
+    // Current loader; parses every entry into its own entry block.
+    CCycleCount dirLoadTime;
+    std::unique_ptr<VPKDir_t> vpk;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        CTimeAdder loadTimer(&dirLoadTime);
+        vpk.reset(new VPKDir_t(fileName));
+    }
+
+    if (vpk->Failed())
+    {
+        Error(eDLL_T::FS, NO_ERROR, "Failed to parse directory tree file \"%s\"!\n", fileName);
+        return;
+    }
+
+    // Memory mapped view; only records where each entry lives.
+    CCycleCount viewLoadTime;
+    CPackedStoreDirView view;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        CTimeAdder loadTimer(&viewLoadTime);
+        view.Init(fileName);
+    }
+
+    if (!view.IsValid() || view.Count() != vpk->m_EntryBlocks.Count())
+    {
+        Error(eDLL_T::FS, NO_ERROR, "Directory view of \"%s\" doesn't match the directory tree!\n", fileName);
+        return;
+    }
+
+    // Linear lookups are quadratic over the whole
+    // directory, so only query an evenly spaced sample.
+    const int entryCount = vpk->m_EntryBlocks.Count();
+    const int sampleCount = (std::min)(entryCount, 1000);
+
+    CUtlVector<CUtlString> samplePaths;
+
+    for (int i = 0; i < sampleCount; i++)
+        samplePaths.AddToTail(vpk->m_EntryBlocks[int((int64_t(i) * entryCount) / sampleCount)].m_EntryPath);
+
+    int dirMisses = 0;
+    int viewMisses = 0;
+
+    timer.Start();
+
+    FOR_EACH_VEC(samplePaths, i)
+    {
+        const char* samplePath = samplePaths[i].Get();
+        int found = vpk->m_EntryBlocks.InvalidIndex();
+
+        FOR_EACH_VEC(vpk->m_EntryBlocks, j)
+        {
+            if (V_stricmp(vpk->m_EntryBlocks[j].m_EntryPath.Get(), samplePath) == NULL)
+            {
+                found = j;
+                break;
+            }
+        }
+
+        if (found == vpk->m_EntryBlocks.InvalidIndex())
+            dirMisses++;
+    }
+
+    timer.End();
+    const double dirLookupTime = timer.GetDuration().GetSeconds();
+
+    timer.Start();
+
+    FOR_EACH_VEC(samplePaths, i)
+    {
+        if (view.Find(samplePaths[i].Get()) == -1)
+            viewMisses++;
+    }
+
+    timer.End();
+    const double viewLookupTime = timer.GetDuration().GetSeconds();
+
+    // Rough heap use of the parsed tree; entry
+    // blocks, their paths and fragment lists.
+    size_t dirHeapSize = vpk->m_EntryBlocks.NumAllocated() * sizeof(VPKEntryBlock_t);
+
+    FOR_EACH_VEC(vpk->m_EntryBlocks, i)
+    {
+        const VPKEntryBlock_t& entryBlock = vpk->m_EntryBlocks[i];
+
+        dirHeapSize += entryBlock.m_EntryPath.Length() + 1;
+        dirHeapSize += entryBlock.m_Fragments.NumAllocated() * sizeof(VPKChunkDescriptor_t);
+    }
+
+    Msg(eDLL_T::FS, "*** Benchmarked '%i' entries over '%i' iterations and '%i' lookups\n", entryCount, iterations, sampleCount);
+    Msg(eDLL_T::FS, "*** 'VPKDir_t'           : load '%lf' ms, lookup '%lf' us, heap '%zu' bytes ('%i' misses)\n",
+        dirLoadTime.GetMillisecondsF() / iterations, (dirLookupTime * 1000000.0) / sampleCount, dirHeapSize, dirMisses);
+    Msg(eDLL_T::FS, "*** 'CPackedStoreDirView': load '%lf' ms, lookup '%lf' us, heap '%zu' bytes ('%i' misses)\n",
+        viewLoadTime.GetMillisecondsF() / iterations, (viewLookupTime * 1000000.0) / sampleCount, view.GetHeapSize(), viewMisses);
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -283,6 +456,9 @@ int main(int argc, char* argv[])
         else if (V_strcmp(args.Arg(1), UNPACK_COMMAND) == NULL) {
             ReVPK_Unpack(args);
         }
+        else if (V_strcmp(args.Arg(1), BENCH_COMMAND) == NULL) {
+            ReVPK_Bench(args);
+        }
         else {
             ReVPK_Usage();
         }
@@ -4,7 +4,9 @@
 // 
 //===========================================================================//
 #include "liveapi.h"
+#include "tier0/utility.h"
 #include "protobuf/util/json_util.h"
+#include "protoc/events.pb.h"
 
 #include "DirtySDK/dirtysock.h"
 #include "DirtySDK/dirtysock/netconn.h"
@@ -41,6 +43,10 @@ ConVar liveapi_truncate_hash_fields("liveapi_truncate_hash_fields", "1", FCVAR_R
 // WebSocket core
 static ConVar liveapi_websocket_enabled("liveapi_websocket_enabled", "0", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Whether to use WebSocket to transmit LiveAPI events", &LiveAPI_WebSocketEnabledChangedCallback);
 static ConVar liveapi_servers("liveapi_servers", "", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Comma separated list of addresses to connect to", &LiveAPI_AddressChangedCallback, "ws://domain.suffix:port");
+static ConVar liveapi_websocket_batch("liveapi_websocket_batch", "0", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Whether to batch the events of each server frame into one WebSocket message (events are length-delimited using a varint prefix)");
+
+// Event pipeline
+static ConVar liveapi_queue_size("liveapi_queue_size", "4096", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Max number of events queued for serialization before new events are dropped", true, 1.f, false, 0.f);
 
 // WebSocket connection base parameters
 static ConVar liveapi_retry_count("liveapi_retry_count", "5", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Amount of times to retry connecting before marking the connection as unavailable", &LiveAPI_ParamsChangedCallback);
@@ -57,6 +63,8 @@ static ConVar liveapi_print_enabled("liveapi_print_enabled", "0", FCVAR_RELEASE
 // Print parameters
 static ConVar liveapi_print_pretty("liveapi_print_pretty", "0", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Whether to print events in a formatted manner to the LiveAPI JSON file");
 static ConVar liveapi_print_primitive("liveapi_print_primitive", "0", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Whether to print primitive event fields to the LiveAPI JSON file");
+static ConVar liveapi_print_binary("liveapi_print_binary", "0", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Whether to record events in the compact binary format instead of JSON (convert recordings to JSON with 'liveapiconv')");
+static ConVar liveapi_print_compress_level("liveapi_print_compress_level", "3", FCVAR_RELEASE | FCVAR_SERVER_FRAME_THREAD, "Zstd compression level of binary LiveAPI recordings (0 = uncompressed)", true, 0.f, true, 22.f);
 
 //-----------------------------------------------------------------------------
 // constructors/destructors
@@ -66,6 +74,12 @@ LiveAPI::LiveAPI()
 	matchLogCount = 0;
 	initialLog = false;
 	initialized = false;
+
+	workerRunning = false;
+	queuedCount = 0;
+	processedCount = 0;
+
+	ResetStats();
 }
 LiveAPI::~LiveAPI()
 {
@@ -80,6 +94,8 @@ void LiveAPI::Init()
 		return;
 
 	InitWebSocket();
+	StartWorker();
+
 	initialized = true;
 }
 
@@ -88,6 +104,7 @@ void LiveAPI::Init()
 //-----------------------------------------------------------------------------
 void LiveAPI::Shutdown()
 {
+	StopWorker();
 	webSocketSystem.Shutdown();
 	DestroyLogger();
 	initialized = false;
@@ -197,6 +214,19 @@ void LiveAPI::CreateLogger()
 	if (!liveapi_print_enabled.GetBool())
 		return; // Logging is disabled
 
+	if (liveapi_print_binary.GetBool())
+	{
+		const string recordDir = Format("platform/liveapi/logs/%s/", g_LogSessionUUID.c_str());
+		CreateDirHierarchy(recordDir.c_str());
+
+		const string recordPath = Format("%smatch_%d" LIVE_API_RECORD_EXTENSION, recordDir.c_str(), matchLogCount++);
+
+		if (!matchRecorder.Open(recordPath.c_str(), liveapi_print_compress_level.GetInt()))
+			Error(eDLL_T::RTECH, 0, "LiveAPI: failed to create match recording \"%s\"\n", recordPath.c_str());
+
+		return;
+	}
+
 	matchLogger = spdlog::basic_logger_mt("match_logger",
 		Format("platform/liveapi/logs/%s/match_%d.json", g_LogSessionUUID.c_str(), matchLogCount++));
 
@@ -209,9 +239,17 @@ void LiveAPI::CreateLogger()
 //-----------------------------------------------------------------------------
 void LiveAPI::DestroyLogger()
 {
+	// The worker writes to the logger; finish the events queued so far.
+	WaitForWorker();
+
 	if (initialLog)
 		initialLog = false;
 
+	if (matchRecorder.IsOpen() && matchRecorder.HasFailed())
+		Error(eDLL_T::RTECH, 0, "LiveAPI: failed to write match recording; the recording is incomplete\n");
+
+	matchRecorder.Close();
+
 	if (!matchLogger)
 		return; // Nothing to drop
 
@@ -229,35 +267,125 @@ void LiveAPI::RunFrame()
 	if (!IsEnabled())
 		return;
 
+	if (workerThread.joinable())
+	{
+		// Close the batch of this frame, and send what the worker finished.
+		QueueFrameEnd();
+		SendPending();
+	}
+
 	if (WebSocketInitialized())
 		webSocketSystem.Update();
 }
 
 //-----------------------------------------------------------------------------
-// Send an event to all sockets
+// Send an event to all sockets and print its game message; the contents of
+// the event are moved into the queue of the worker, which serializes and
+// prints it, the event is left empty in that case
 //-----------------------------------------------------------------------------
-void LiveAPI::LogEvent(const google::protobuf::Message* const toTransmit, const google::protobuf::Message* toPrint)
+void LiveAPI::LogEvent(rtech::liveapi::LiveAPIEvent* const event)
 {
 	if (!IsEnabled())
 		return;
 
-	if (WebSocketInitialized())
-	{
-		const string data = toTransmit->SerializeAsString();
-		webSocketSystem.SendData(data.c_str(), (int)data.size());
-	}
-
 	// NOTE: we don't check on the cvar 'liveapi_print_enabled' here because if
 	// this cvar gets disabled on the fly and we check it here, the output will
 	// be truncated and thus invalid! Log for as long as the SpdLog instance is
 	// valid.
-	if (matchLogger)
+	const bool transmit = WebSocketInitialized();
+	const bool print = FileLoggerInitialized();
+
+	if (!transmit && !print)
+		return;
+
+	const bool printPretty = liveapi_print_pretty.GetBool();
+	const bool printPrimitive = liveapi_print_primitive.GetBool();
+
+	if (!workerThread.joinable())
+	{
+		// No worker, serialize and send on this thread.
+		string batch;
+		ProcessEvent(transmit ? event : nullptr, print ? &event->gamemessage() : nullptr, printPretty, printPrimitive, batch);
+
+		if (!batch.empty())
+			sendQueue.PushItem(std::move(batch));
+
+		eventCount++;
+		SendPending();
+
+		return;
+	}
+
+	if (eventQueue.Count() >= liveapi_queue_size.GetInt())
+	{
+		droppedCount++;
+		return;
+	}
+
+	LiveAPIQueuedEvent_s queued;
+
+	if (!eventPool.PopItem(&queued.event))
+		queued.event = new rtech::liveapi::LiveAPIEvent();
+
+	queued.event->Swap(event);
+
+	queued.queueTime = Plat_FloatTime();
+	queued.transmit = transmit;
+	queued.print = print;
+	queued.printPretty = printPretty;
+	queued.printPrimitive = printPrimitive;
+
+	eventQueue.PushItem(std::move(queued));
+	eventCount++;
+
+	// The worker is normally woken up at the end of each frame, but start
+	// early on large bursts so the queue doesn't fill up.
+	if ((++queuedCount % 256) == 0)
+	{
+		{ std::lock_guard<std::mutex> lock(workerMutex); }
+		workerCond.notify_all();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Serialize and print an event, runs on the worker
+//-----------------------------------------------------------------------------
+void LiveAPI::ProcessEvent(const google::protobuf::Message* const toTransmit, const google::protobuf::Message* const toPrint,
+	const bool printPretty, const bool printPrimitive, string& batch)
+{
+	if (toTransmit)
+	{
+		if (liveapi_websocket_batch.GetBool())
+		{
+			const size_t eventSize = toTransmit->ByteSizeLong();
+
+			// Don't exceed the WebSocket send buffer; 5 is the max varint size.
+			if (!batch.empty() && batch.size() + eventSize + 5 > LIVE_API_MAX_FRAME_BUFFER_SIZE)
+			{
+				sendQueue.PushItem(std::move(batch));
+				batch.clear();
+			}
+
+			LiveAPI_AppendVarint(batch, uint32_t(eventSize));
+			toTransmit->AppendToString(&batch);
+		}
+		else
+		{
+			sendQueue.PushItem(toTransmit->SerializeAsString());
+		}
+	}
+
+	if (toPrint && matchRecorder.IsOpen())
+	{
+		matchRecorder.WriteEvent(*toPrint, LiveAPI_GetEventTimestamp(*toPrint));
+	}
+	else if (toPrint && matchLogger)
 	{
 		std::string jsonStr(initialLog ? ",\n" : "");
 		google::protobuf::util::JsonPrintOptions options;
 
-		options.add_whitespace = liveapi_print_pretty.GetBool();
-		options.always_print_primitive_fields = liveapi_print_primitive.GetBool();
+		options.add_whitespace = printPretty;
+		options.always_print_primitive_fields = printPrimitive;
 
 		google::protobuf::util::MessageToJsonString(*toPrint, &jsonStr, options);
 
@@ -272,6 +400,188 @@ void LiveAPI::LogEvent(const google::protobuf::Message* const toTransmit, const
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Queue the end of the current frame, this completes the batch of the frame
+// and wakes up the worker
+//-----------------------------------------------------------------------------
+void LiveAPI::QueueFrameEnd()
+{
+	LiveAPIQueuedEvent_s marker;
+	marker.frameEnd = true;
+
+	eventQueue.PushItem(std::move(marker));
+	queuedCount++;
+
+	{ std::lock_guard<std::mutex> lock(workerMutex); }
+	workerCond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Send the messages finished by the worker to all sockets
+//-----------------------------------------------------------------------------
+void LiveAPI::SendPending()
+{
+	string message;
+
+	while (sendQueue.PopItem(&message))
+	{
+		if (message.empty() || !WebSocketInitialized())
+			continue;
+
+		webSocketSystem.SendData(message.c_str(), (int)message.size());
+		messageCount++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Free the events handed back by the worker
+//-----------------------------------------------------------------------------
+void LiveAPI::PurgeEventPool()
+{
+	rtech::liveapi::LiveAPIEvent* event;
+
+	while (eventPool.PopItem(&event))
+		delete event;
+}
+
+//-----------------------------------------------------------------------------
+// Start the worker
+//-----------------------------------------------------------------------------
+void LiveAPI::StartWorker()
+{
+	if (workerThread.joinable())
+		return;
+
+	queuedCount = 0;
+	processedCount = 0;
+
+	workerRunning = true;
+	workerThread = std::thread(&LiveAPI::WorkerRun, this);
+}
+
+//-----------------------------------------------------------------------------
+// Stop the worker, the queued events are processed and sent first
+//-----------------------------------------------------------------------------
+void LiveAPI::StopWorker()
+{
+	if (!workerThread.joinable())
+		return;
+
+	QueueFrameEnd();
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		workerRunning = false;
+	}
+
+	workerCond.notify_all();
+	workerThread.join();
+
+	SendPending();
+	PurgeEventPool();
+}
+
+//-----------------------------------------------------------------------------
+// Block until the worker processed all queued events
+//-----------------------------------------------------------------------------
+void LiveAPI::WaitForWorker()
+{
+	if (!workerThread.joinable())
+		return;
+
+	QueueFrameEnd();
+
+	std::unique_lock<std::mutex> lock(workerMutex);
+	workerCond.wait(lock, [this] { return processedCount == queuedCount; });
+}
+
+//-----------------------------------------------------------------------------
+// Worker main loop
+//-----------------------------------------------------------------------------
+void LiveAPI::WorkerRun()
+{
+	string batch;
+	LiveAPIQueuedEvent_s event;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(workerMutex);
+			workerCond.wait(lock, [this] { return !workerRunning || eventQueue.Count() > 0; });
+
+			if (!workerRunning && !eventQueue.Count())
+				break;
+		}
+
+		while (eventQueue.PopItem(&event))
+		{
+			if (event.frameEnd)
+			{
+				if (!batch.empty())
+				{
+					sendQueue.PushItem(std::move(batch));
+					batch.clear();
+				}
+			}
+			else
+			{
+				ProcessEvent(event.transmit ? event.event : nullptr, event.print ? &event.event->gamemessage() : nullptr,
+					event.printPretty, event.printPrimitive, batch);
+
+				event.event->Clear();
+				eventPool.PushItem(event.event);
+
+				const int64_t latencyUs = int64_t((Plat_FloatTime() - event.queueTime) * 1000000.0);
+				int bucket = 0;
+
+				while (bucket < LIVE_API_LATENCY_BUCKETS - 1 && (int64_t(2) << bucket) <= latencyUs)
+					bucket++;
+
+				latencyHistogram[bucket]++;
+			}
+
+			processedCount++;
+		}
+
+		// Wake up 'WaitForWorker()'.
+		{ std::lock_guard<std::mutex> lock(workerMutex); }
+		workerCond.notify_all();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Print the event pipeline counters and the latency histogram
+//-----------------------------------------------------------------------------
+void LiveAPI::PrintStats() const
+{
+	Msg(eDLL_T::RTECH, "LiveAPI: '%lld' events logged, '%lld' dropped, '%lld' queued, '%lld' messages sent\n",
+		eventCount.load(), droppedCount.load(), int64_t(eventQueue.Count()), messageCount.load());
+
+	for (int i = 0; i < LIVE_API_LATENCY_BUCKETS; i++)
+	{
+		const int64_t count = latencyHistogram[i];
+
+		if (!count)
+			continue;
+
+		Msg(eDLL_T::RTECH, "  %8lld - %8lld us: '%lld'\n",
+			i ? (int64_t(1) << i) : int64_t(0), (int64_t(2) << i) - 1, count);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Reset the event pipeline counters and the latency histogram
+//-----------------------------------------------------------------------------
+void LiveAPI::ResetStats()
+{
+	eventCount = 0;
+	droppedCount = 0;
+	messageCount = 0;
+
+	for (int i = 0; i < LIVE_API_LATENCY_BUCKETS; i++)
+		latencyHistogram[i] = 0;
+}
+
 //-----------------------------------------------------------------------------
 // Returns whether the system is enabled
 //-----------------------------------------------------------------------------
@@ -290,6 +600,27 @@ bool LiveAPI::IsValidToRun() const
 
 static LiveAPI s_liveApi;
 
+/*
+=====================
+LiveAPI_Stats_f
+
+  Prints the LiveAPI event pipeline
+  counters and latency histogram
+
+  Optional switches:
+  -reset ( resets the counters after printing )
+=====================
+*/
+static void LiveAPI_Stats_f(const CCommand& args)
+{
+	LiveAPISystem()->PrintStats();
+
+	if (args.FindArg("-reset"))
+		LiveAPISystem()->ResetStats();
+}
+
+static ConCommand liveapi_stats("liveapi_stats", LiveAPI_Stats_f, "Prints the LiveAPI event pipeline counters and latency histogram", FCVAR_RELEASE);
+
 //-----------------------------------------------------------------------------
 // Singleton accessor
 //-----------------------------------------------------------------------------
@@ -1,10 +1,46 @@
 #ifndef RTECH_LIVEAPI_H
 #define RTECH_LIVEAPI_H
+#include <condition_variable>
+#include "tier0/tslist.h"
 #include "tier2/websocket.h"
+#include "rtech/liveapi/liverecord.h"
 #include "thirdparty/protobuf/message.h"
 
 #define LIVE_API_MAX_FRAME_BUFFER_SIZE 0x8000
 
+// Bucket 'n' counts the events that took [2^n, 2^(n+1)) microseconds from
+// being logged until they were serialized and written by the worker
+#define LIVE_API_LATENCY_BUCKETS 20
+
+namespace rtech { namespace liveapi { class LiveAPIEvent; } }
+
+//-----------------------------------------------------------------------------
+// An event queued for the worker, or a marker for the end of a server frame
+//-----------------------------------------------------------------------------
+struct LiveAPIQueuedEvent_s
+{
+	LiveAPIQueuedEvent_s()
+	{
+		event = nullptr;
+		queueTime = 0.0;
+		frameEnd = false;
+		transmit = false;
+		print = false;
+		printPretty = false;
+		printPrimitive = false;
+	}
+
+	rtech::liveapi::LiveAPIEvent* event; // Taken from the event pool, null for frame markers.
+
+	double queueTime;
+	bool frameEnd;
+
+	bool transmit; // Send the event to all sockets.
+	bool print;    // Print the game message of the event.
+	bool printPretty;
+	bool printPrimitive;
+};
+
 extern ConVar liveapi_enabled;
 extern ConVar liveapi_session_name;
 extern ConVar liveapi_truncate_hash_fields;
@@ -37,21 +73,59 @@ public:
 	void DestroyLogger();
 
 	void RunFrame();
-	void LogEvent(const google::protobuf::Message* const toTransmit, const google::protobuf::Message* toPrint);
+	void LogEvent(rtech::liveapi::LiveAPIEvent* const event);
+
+	void StartWorker();
+	void StopWorker();
+	void WaitForWorker();
+
+	void PrintStats() const;
+	void ResetStats();
 
 	bool IsEnabled() const;
 	bool IsValidToRun() const;
 
 	inline bool WebSocketInitialized() const { return webSocketSystem.IsInitialized(); }
-	inline bool FileLoggerInitialized() const { return matchLogger != nullptr; }
+	inline bool FileLoggerInitialized() const { return matchLogger != nullptr || matchRecorder.IsOpen(); }
 
 private:
+	void WorkerRun();
+	void ProcessEvent(const google::protobuf::Message* const toTransmit, const google::protobuf::Message* const toPrint,
+		const bool printPretty, const bool printPrimitive, string& batch);
+	void QueueFrameEnd();
+	void SendPending();
+	void PurgeEventPool();
+
 	CWebSocket webSocketSystem;
 
 	std::shared_ptr<spdlog::logger> matchLogger;
+	CLiveAPIRecordWriter matchRecorder; // Used instead of the logger for binary recordings.
 	int matchLogCount;
 	bool initialLog;
 	bool initialized;
+
+	// Events are serialized, printed and batched on the worker, the frame
+	// thread only moves the events in and sends the finished messages out
+	std::thread workerThread;
+	std::mutex workerMutex;
+	std::condition_variable workerCond; // Signaled on frame end, shutdown and when the worker is idle.
+	bool workerRunning;
+
+	CTSQueue<LiveAPIQueuedEvent_s> eventQueue; // Frame thread -> worker.
+	CTSQueue<string> sendQueue;                // Worker -> frame thread.
+
+	// Processed events are cleared and handed back to the frame thread, which
+	// swaps the contents of new events into them; this recycles the memory of
+	// the messages instead of copying each event.
+	CTSQueue<rtech::liveapi::LiveAPIEvent*> eventPool; // Worker -> frame thread.
+
+	int64_t queuedCount; // Events and frame markers queued, only accessed on the frame thread.
+	std::atomic<int64_t> processedCount;
+
+	std::atomic<int64_t> eventCount;
+	std::atomic<int64_t> droppedCount;
+	std::atomic<int64_t> messageCount;
+	std::atomic<int64_t> latencyHistogram[LIVE_API_LATENCY_BUCKETS];
 };
 
 LiveAPI* LiveAPISystem();
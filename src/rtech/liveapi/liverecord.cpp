@@ -0,0 +1,473 @@
+//===========================================================================//
+//
+// Purpose: LiveAPI binary match recording
+//
+//===========================================================================//
+#include "liverecord.h"
+#include "protobuf/any.pb.h"
+#include "protobuf/io/coded_stream.h"
+#include "protobuf/wire_format_lite.h"
+
+//-----------------------------------------------------------------------------
+// Appends a varint to a string, used to length-delimit events
+//-----------------------------------------------------------------------------
+void LiveAPI_AppendVarint(string& out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(char(value | 0x80));
+		value >>= 7;
+	}
+
+	out.push_back(char(value));
+}
+
+//-----------------------------------------------------------------------------
+// Returns the timestamp of a game message packed in an Any, 0 if it has none
+//-----------------------------------------------------------------------------
+uint64_t LiveAPI_GetEventTimestamp(const google::protobuf::Message& gameMessage)
+{
+	if (gameMessage.GetDescriptor() != google::protobuf::Any::descriptor())
+		return 0;
+
+	using google::protobuf::internal::WireFormatLite;
+	const std::string& value = static_cast<const google::protobuf::Any&>(gameMessage).value();
+
+	google::protobuf::io::CodedInputStream stream(reinterpret_cast<const uint8_t*>(value.data()), int(value.size()));
+	uint32_t tag;
+
+	// All game messages carry their timestamp in field 1.
+	while ((tag = stream.ReadTag()) != 0)
+	{
+		if (tag == WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_VARINT))
+		{
+			uint64_t timestamp;
+			return stream.ReadVarint64(&timestamp) ? timestamp : 0;
+		}
+
+		if (!WireFormatLite::SkipField(&stream, tag))
+			break;
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// constructors/destructors
+//-----------------------------------------------------------------------------
+CLiveAPIRecordWriter::CLiveAPIRecordWriter()
+{
+	file = nullptr;
+	fileOffset = 0;
+	failed = false;
+
+	cctx = nullptr;
+	compressLevel = 0;
+
+	blockEventCount = 0;
+	blockMinTimestamp = 0;
+	blockMaxTimestamp = 0;
+
+	eventCount = 0;
+}
+CLiveAPIRecordWriter::~CLiveAPIRecordWriter()
+{
+	Close();
+}
+
+//-----------------------------------------------------------------------------
+// Create a recording, compressLevel 0 leaves the blocks uncompressed
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordWriter::Open(const char* const filePath, const int level)
+{
+	Close();
+
+	file = fopen(filePath, "wb");
+
+	if (!file)
+		return false;
+
+	fileOffset = 0;
+	failed = false;
+	eventCount = 0;
+
+	if (level > 0)
+	{
+		cctx = ZSTD_createCCtx();
+		compressLevel = level;
+	}
+
+	LiveAPIRecordHeader_s header;
+
+	header.magic = LIVE_API_RECORD_MAGIC;
+	header.version = LIVE_API_RECORD_VERSION;
+	header.reserved = 0;
+
+	return Write(&header, sizeof(header));
+}
+
+//-----------------------------------------------------------------------------
+// Write the remaining events and the index, and close the recording
+//-----------------------------------------------------------------------------
+void CLiveAPIRecordWriter::Close()
+{
+	if (!file)
+		return;
+
+	if (FlushBlock())
+	{
+		LiveAPIRecordFooter_s footer;
+
+		footer.indexOffset = fileOffset;
+		footer.blockCount = uint32_t(index.Count());
+		footer.magic = LIVE_API_RECORD_INDEX_MAGIC;
+
+		if (!index.IsEmpty())
+			Write(index.Base(), index.Count() * sizeof(LiveAPIRecordIndexEntry_s));
+
+		Write(&footer, sizeof(footer));
+	}
+
+	fclose(file);
+	file = nullptr;
+
+	if (cctx)
+	{
+		ZSTD_freeCCtx(cctx);
+		cctx = nullptr;
+	}
+
+	blockData.clear();
+	blockEventCount = 0;
+
+	index.Purge();
+}
+
+//-----------------------------------------------------------------------------
+// Append an event to the recording
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordWriter::WriteEvent(const google::protobuf::Message& gameMessage, const uint64_t timestamp)
+{
+	if (!file || failed)
+		return false;
+
+	LiveAPI_AppendVarint(blockData, uint32_t(gameMessage.ByteSizeLong()));
+	gameMessage.AppendToString(&blockData);
+
+	if (!blockEventCount)
+	{
+		blockMinTimestamp = timestamp;
+		blockMaxTimestamp = timestamp;
+	}
+	else
+	{
+		blockMinTimestamp = Min(blockMinTimestamp, timestamp);
+		blockMaxTimestamp = Max(blockMaxTimestamp, timestamp);
+	}
+
+	blockEventCount++;
+
+	if (blockData.size() >= LIVE_API_RECORD_BLOCK_SIZE)
+		return FlushBlock();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Write raw data to the recording
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordWriter::Write(const void* const data, const size_t size)
+{
+	if (failed)
+		return false;
+
+	if (fwrite(data, 1, size, file) != size)
+	{
+		failed = true;
+		return false;
+	}
+
+	fileOffset += size;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Compress and write the current block
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordWriter::FlushBlock()
+{
+	if (!blockEventCount)
+		return !failed;
+
+	LiveAPIRecordBlockHeader_s header;
+
+	header.magic = LIVE_API_RECORD_BLOCK_MAGIC;
+	header.flags = 0;
+	header.reserved = 0;
+	header.rawSize = uint32_t(blockData.size());
+	header.eventCount = blockEventCount;
+	header.minTimestamp = blockMinTimestamp;
+	header.maxTimestamp = blockMaxTimestamp;
+
+	const char* storedData = blockData.data();
+	size_t storedSize = blockData.size();
+
+	if (cctx)
+	{
+		compressBuf.resize(ZSTD_compressBound(blockData.size()));
+
+		const size_t compressedSize = ZSTD_compressCCtx(cctx, compressBuf.data(), compressBuf.size(),
+			blockData.data(), blockData.size(), compressLevel);
+
+		// Store the block raw if it doesn't compress.
+		if (!ZSTD_isError(compressedSize) && compressedSize < blockData.size())
+		{
+			storedData = compressBuf.data();
+			storedSize = compressedSize;
+
+			header.flags |= LIVE_API_RECORD_BLOCK_ZSTD;
+		}
+	}
+
+	header.storedSize = uint32_t(storedSize);
+
+	LiveAPIRecordIndexEntry_s& entry = index[index.AddToTail()];
+
+	entry.offset = fileOffset;
+	entry.minTimestamp = blockMinTimestamp;
+	entry.maxTimestamp = blockMaxTimestamp;
+	entry.firstEvent = eventCount;
+	entry.eventCount = blockEventCount;
+
+	eventCount += blockEventCount;
+
+	blockData.clear();
+	blockEventCount = 0;
+
+	return Write(&header, sizeof(header)) && Write(storedData, storedSize);
+}
+
+//-----------------------------------------------------------------------------
+// constructors/destructors
+//-----------------------------------------------------------------------------
+CLiveAPIRecordReader::CLiveAPIRecordReader()
+{
+	file = nullptr;
+	fileSize = 0;
+	indexed = false;
+
+	dctx = nullptr;
+}
+CLiveAPIRecordReader::~CLiveAPIRecordReader()
+{
+	Close();
+}
+
+//-----------------------------------------------------------------------------
+// Open a recording and load its block index, the blocks are scanned if the
+// recording has no index
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordReader::Open(const char* const filePath)
+{
+	Close();
+
+	file = fopen(filePath, "rb");
+
+	if (!file)
+		return false;
+
+	_fseeki64(file, 0, SEEK_END);
+	fileSize = uint64_t(_ftelli64(file));
+	_fseeki64(file, 0, SEEK_SET);
+
+	LiveAPIRecordHeader_s header;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+		header.magic != LIVE_API_RECORD_MAGIC ||
+		header.version != LIVE_API_RECORD_VERSION)
+	{
+		Close();
+		return false;
+	}
+
+	indexed = ReadIndex();
+
+	if (!indexed && !ScanBlocks())
+	{
+		Close();
+		return false;
+	}
+
+	dctx = ZSTD_createDCtx();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Close the recording
+//-----------------------------------------------------------------------------
+void CLiveAPIRecordReader::Close()
+{
+	if (file)
+	{
+		fclose(file);
+		file = nullptr;
+	}
+
+	if (dctx)
+	{
+		ZSTD_freeDCtx(dctx);
+		dctx = nullptr;
+	}
+
+	fileSize = 0;
+	indexed = false;
+
+	blocks.Purge();
+}
+
+//-----------------------------------------------------------------------------
+// Load the block index from the end of the recording
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordReader::ReadIndex()
+{
+	if (fileSize < sizeof(LiveAPIRecordHeader_s) + sizeof(LiveAPIRecordFooter_s))
+		return false;
+
+	LiveAPIRecordFooter_s footer;
+	_fseeki64(file, int64_t(fileSize - sizeof(footer)), SEEK_SET);
+
+	if (fread(&footer, sizeof(footer), 1, file) != 1 || footer.magic != LIVE_API_RECORD_INDEX_MAGIC)
+		return false;
+
+	const uint64_t indexSize = uint64_t(footer.blockCount) * sizeof(LiveAPIRecordIndexEntry_s);
+
+	if (footer.indexOffset < sizeof(LiveAPIRecordHeader_s) || footer.indexOffset + indexSize + sizeof(footer) != fileSize)
+		return false;
+
+	blocks.SetCount(int(footer.blockCount));
+	_fseeki64(file, int64_t(footer.indexOffset), SEEK_SET);
+
+	if (footer.blockCount && fread(blocks.Base(), sizeof(LiveAPIRecordIndexEntry_s), footer.blockCount, file) != footer.blockCount)
+	{
+		blocks.Purge();
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Rebuild the block index by walking the block headers, stops at the first
+// block that is incomplete (recording wasn't closed)
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordReader::ScanBlocks()
+{
+	blocks.Purge();
+
+	uint64_t offset = sizeof(LiveAPIRecordHeader_s);
+	uint32_t eventCount = 0;
+
+	while (offset + sizeof(LiveAPIRecordBlockHeader_s) <= fileSize)
+	{
+		LiveAPIRecordBlockHeader_s header;
+		_fseeki64(file, int64_t(offset), SEEK_SET);
+
+		if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LIVE_API_RECORD_BLOCK_MAGIC)
+			break;
+
+		const uint64_t blockEnd = offset + sizeof(header) + header.storedSize;
+
+		if (blockEnd > fileSize)
+			break;
+
+		LiveAPIRecordIndexEntry_s& entry = blocks[blocks.AddToTail()];
+
+		entry.offset = offset;
+		entry.minTimestamp = header.minTimestamp;
+		entry.maxTimestamp = header.maxTimestamp;
+		entry.firstEvent = eventCount;
+		entry.eventCount = header.eventCount;
+
+		eventCount += header.eventCount;
+		offset = blockEnd;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the first block containing events at or past the timestamp, -1 if
+// there are none
+//-----------------------------------------------------------------------------
+int CLiveAPIRecordReader::FindBlock(const uint64_t timestamp) const
+{
+	FOR_EACH_VEC(blocks, i)
+	{
+		if (blocks[i].maxTimestamp >= timestamp)
+			return i;
+	}
+
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+// Read and decompress a block
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordReader::ReadBlock(const int i, string& blockData)
+{
+	const LiveAPIRecordIndexEntry_s& entry = blocks[i];
+	LiveAPIRecordBlockHeader_s header;
+
+	_fseeki64(file, int64_t(entry.offset), SEEK_SET);
+
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LIVE_API_RECORD_BLOCK_MAGIC)
+		return false;
+
+	storedBuf.resize(header.storedSize);
+
+	if (header.storedSize && fread(storedBuf.data(), 1, header.storedSize, file) != header.storedSize)
+		return false;
+
+	if (!(header.flags & LIVE_API_RECORD_BLOCK_ZSTD))
+	{
+		blockData.assign(storedBuf.data(), storedBuf.size());
+		return header.storedSize == header.rawSize;
+	}
+
+	blockData.resize(header.rawSize);
+
+	const size_t decompressedSize = ZSTD_decompressDCtx(dctx, &blockData[0], blockData.size(),
+		storedBuf.data(), storedBuf.size());
+
+	return !ZSTD_isError(decompressedSize) && decompressedSize == header.rawSize;
+}
+
+//-----------------------------------------------------------------------------
+// Get the next event in a block, returns false at the end of the block or if
+// the block is malformed
+//-----------------------------------------------------------------------------
+bool CLiveAPIRecordReader::NextEvent(const string& blockData, size_t& offset, const char*& eventData, uint32_t& eventSize)
+{
+	uint32_t size = 0;
+
+	for (int shift = 0; ; shift += 7)
+	{
+		if (offset >= blockData.size() || shift > 28)
+			return false;
+
+		const uint8_t byte = uint8_t(blockData[offset++]);
+		size |= uint32_t(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80))
+			break;
+	}
+
+	if (size > blockData.size() - offset)
+		return false;
+
+	eventData = blockData.data() + offset;
+	eventSize = size;
+
+	offset += size;
+	return true;
+}
@@ -0,0 +1,152 @@
+//===========================================================================//
+//
+// Purpose: LiveAPI binary match recording
+//
+//===========================================================================//
+#ifndef RTECH_LIVERECORD_H
+#define RTECH_LIVERECORD_H
+#include "thirdparty/protobuf/message.h"
+
+#define LIVE_API_RECORD_MAGIC       (('C'<<24)+('R'<<16)+('A'<<8)+'L') // 'LARC'
+#define LIVE_API_RECORD_BLOCK_MAGIC (('K'<<24)+('B'<<16)+('A'<<8)+'L') // 'LABK'
+#define LIVE_API_RECORD_INDEX_MAGIC (('X'<<24)+('I'<<16)+('A'<<8)+'L') // 'LAIX'
+
+#define LIVE_API_RECORD_VERSION 1
+#define LIVE_API_RECORD_EXTENSION ".lar"
+
+// Events are collected into blocks of about this many bytes before they are
+// compressed and written; a block is the unit of seeking in a recording
+#define LIVE_API_RECORD_BLOCK_SIZE 0x10000
+
+//-----------------------------------------------------------------------------
+// Recording layout:
+//  - header
+//  - blocks; a block header followed by the (zstd compressed) events, each
+//    event is a varint length followed by the serialized game message (Any)
+//  - index of all blocks, followed by the footer pointing to it; these are
+//    missing if the recording wasn't closed, readers then scan the blocks
+//-----------------------------------------------------------------------------
+enum LiveAPIRecordBlockFlags_e : uint16_t
+{
+	LIVE_API_RECORD_BLOCK_ZSTD = (1 << 0)
+};
+
+#pragma pack(push, 1)
+struct LiveAPIRecordHeader_s
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+};
+
+struct LiveAPIRecordBlockHeader_s
+{
+	uint32_t magic;
+	uint16_t flags;
+	uint16_t reserved;
+
+	uint32_t storedSize; // Size of the block data in the file.
+	uint32_t rawSize;    // Size of the block data once decompressed.
+	uint32_t eventCount;
+
+	uint64_t minTimestamp;
+	uint64_t maxTimestamp;
+};
+
+struct LiveAPIRecordIndexEntry_s
+{
+	uint64_t offset; // Offset of the block header.
+
+	uint64_t minTimestamp;
+	uint64_t maxTimestamp;
+
+	uint32_t firstEvent;
+	uint32_t eventCount;
+};
+
+struct LiveAPIRecordFooter_s
+{
+	uint64_t indexOffset;
+	uint32_t blockCount;
+	uint32_t magic;
+};
+#pragma pack(pop)
+
+//-----------------------------------------------------------------------------
+// Writes events to a binary recording
+//-----------------------------------------------------------------------------
+class CLiveAPIRecordWriter
+{
+public:
+	CLiveAPIRecordWriter();
+	~CLiveAPIRecordWriter();
+
+	bool Open(const char* const filePath, const int level);
+	void Close();
+
+	inline bool IsOpen() const { return file != nullptr; }
+	inline bool HasFailed() const { return failed; }
+
+	bool WriteEvent(const google::protobuf::Message& gameMessage, const uint64_t timestamp);
+
+private:
+	bool Write(const void* const data, const size_t size);
+	bool FlushBlock();
+
+	FILE* file;
+	uint64_t fileOffset;
+	bool failed;
+
+	ZSTD_CCtx* cctx; // Null if the recording isn't compressed.
+	int compressLevel;
+	vector<char> compressBuf;
+
+	string blockData;
+	uint32_t blockEventCount;
+	uint64_t blockMinTimestamp;
+	uint64_t blockMaxTimestamp;
+
+	uint32_t eventCount;
+	CUtlVector<LiveAPIRecordIndexEntry_s> index;
+};
+
+//-----------------------------------------------------------------------------
+// Reads events from a binary recording
+//-----------------------------------------------------------------------------
+class CLiveAPIRecordReader
+{
+public:
+	CLiveAPIRecordReader();
+	~CLiveAPIRecordReader();
+
+	bool Open(const char* const filePath);
+	void Close();
+
+	inline bool IsIndexed() const { return indexed; }
+
+	inline int GetBlockCount() const { return blocks.Count(); }
+	inline const LiveAPIRecordIndexEntry_s& GetBlock(const int i) const { return blocks[i]; }
+
+	int FindBlock(const uint64_t timestamp) const;
+	bool ReadBlock(const int i, string& blockData);
+
+	static bool NextEvent(const string& blockData, size_t& offset, const char*& eventData, uint32_t& eventSize);
+
+private:
+	bool ReadIndex();
+	bool ScanBlocks();
+
+	FILE* file;
+	uint64_t fileSize;
+	bool indexed;
+
+	ZSTD_DCtx* dctx;
+	vector<char> storedBuf;
+
+	CUtlVector<LiveAPIRecordIndexEntry_s> blocks;
+};
+
+void LiveAPI_AppendVarint(string& out, uint32_t value);
+uint64_t LiveAPI_GetEventTimestamp(const google::protobuf::Message& gameMessage);
+
+#endif // RTECH_LIVERECORD_H
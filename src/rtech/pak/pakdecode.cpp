@@ -241,9 +241,24 @@ size_t Pak_RTechDecoderInit(PakDecoder_s* const decoder, const uint8_t* const fi
 }
 
 //-----------------------------------------------------------------------------
-// decodes the RTech data stream up to available buffer or data
+// checks if a copy into the output buffer can be done in 16 byte blocks; the
+// overshoot must stay within the current decode window and decompressed size
+// as data past the window may not have been flushed out of the ring buffer
 //-----------------------------------------------------------------------------
-bool Pak_RTechStreamDecode(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen)
+static FORCEINLINE bool Pak_RTechCanCopyWide(const PakDecoder_s* const decoder, const uint64_t outBufBytePos, const size_t copyLen)
+{
+	const size_t wideLen = ALIGN_VALUE(copyLen, 16ull);
+	return (decoder->outputInvMask & ~outBufBytePos) >= wideLen - 1 && decoder->decompSize - outBufBytePos >= wideLen;
+}
+
+//-----------------------------------------------------------------------------
+// decodes the RTech data stream up to available buffer or data; the wide
+// kernel copies literals and matches in 16 byte blocks using SSE2, but only
+// where this can't change the result: overlapping matches closer than 16
+// bytes are still copied in 8 byte blocks
+//-----------------------------------------------------------------------------
+template <bool UseWideCopy>
+static bool Pak_RTechStreamDecodeKernel(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen)
 {
 	bool result; // al
 	uint64_t outBufBytePos; // r15
@@ -379,12 +394,32 @@ bool Pak_RTechStreamDecode(PakDecoder_s* const decoder, const size_t inLen, cons
 				currentBit += v64 + 3;
 				v19 = v62 >> v64;
 				v66 = v63 + (v62 & ((1 << v64) - 1)) + v56;
-				for (j = v66 >> 3; j; --j)
+				if constexpr (UseWideCopy)
 				{
-					v68 = *(_QWORD*)v57;
-					v57 += 8;
-					*(_QWORD*)v58 = v68;
-					v58 += 8;
+					// literals come from the input buffer, which never overlaps
+					// with the output buffer
+					for (j = v66 >> 4; j; --j)
+					{
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(v58), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v57)));
+						v57 += 16;
+						v58 += 16;
+					}
+					if ((v66 & 8) != 0)
+					{
+						*(_QWORD*)v58 = *(_QWORD*)v57;
+						v58 += 8;
+						v57 += 8;
+					}
+				}
+				else
+				{
+					for (j = v66 >> 3; j; --j)
+					{
+						v68 = *(_QWORD*)v57;
+						v57 += 8;
+						*(_QWORD*)v58 = v68;
+						v58 += 8;
+					}
 				}
 				if ((v66 & 4) != 0)
 				{
@@ -405,8 +440,13 @@ bool Pak_RTechStreamDecode(PakDecoder_s* const decoder, const size_t inLen, cons
 			}
 			else
 			{
-				*(_QWORD*)v58 = *(_QWORD*)v57;
-				*((_QWORD*)v58 + 1) = *((_QWORD*)v57 + 1);
+				if constexpr (UseWideCopy)
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(v58), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v57)));
+				else
+				{
+					*(_QWORD*)v58 = *(_QWORD*)v57;
+					*((_QWORD*)v58 + 1) = *((_QWORD*)v57 + 1);
+				}
 				inBufBytePos += v56;
 				outBufBytePos += v56;
 			}
@@ -463,8 +503,17 @@ bool Pak_RTechStreamDecode(PakDecoder_s* const decoder, const size_t inLen, cons
 						v51 = *v29;
 						//++dword_14D40B2BC;
 						v52 = 0i64;
-						for (k = 0x101010101010101i64 * v51; (unsigned int)v52 < v50; v52 = (unsigned int)(v52 + 8))
-							*(_QWORD*)&v28[v52] = k;
+						if (UseWideCopy && Pak_RTechCanCopyWide(decoder, outBufBytePos - v50, v50))
+						{
+							const __m128i fill = _mm_set1_epi8(static_cast<char>(v51));
+							for (; (unsigned int)v52 < v50; v52 = (unsigned int)(v52 + 16))
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(&v28[v52]), fill);
+						}
+						else
+						{
+							for (k = 0x101010101010101i64 * v51; (unsigned int)v52 < v50; v52 = (unsigned int)(v52 + 8))
+								*(_QWORD*)&v28[v52] = k;
+						}
 					}
 					else
 					{
@@ -485,15 +534,30 @@ bool Pak_RTechStreamDecode(PakDecoder_s* const decoder, const size_t inLen, cons
 				else
 				{
 					//++dword_14D40B2AC;
-					for (m = 0i64; (unsigned int)m < (unsigned int)v48; m = (unsigned int)(m + 8))
-						*(_QWORD*)&v28[m] = *(_QWORD*)&v29[m];
+					// matches closer than 16 bytes overlap the data they copy,
+					// these must be copied in 8 byte blocks to get the same result
+					if (UseWideCopy && v26 >= 16 && Pak_RTechCanCopyWide(decoder, outBufBytePos - v48, v48))
+					{
+						for (m = 0i64; (unsigned int)m < (unsigned int)v48; m = (unsigned int)(m + 16))
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(&v28[m]), _mm_loadu_si128(reinterpret_cast<const __m128i*>(&v29[m])));
+					}
+					else
+					{
+						for (m = 0i64; (unsigned int)m < (unsigned int)v48; m = (unsigned int)(m + 8))
+							*(_QWORD*)&v28[m] = *(_QWORD*)&v29[m];
+					}
 				}
 			}
 			else
 			{
 				outBufBytePos += v20;
-				*(_QWORD*)v28 = *(_QWORD*)v29;
-				*((_QWORD*)v28 + 1) = *((_QWORD*)v29 + 1);
+				if (UseWideCopy && v26 >= 16)
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(v28), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v29)));
+				else
+				{
+					*(_QWORD*)v28 = *(_QWORD*)v29;
+					*((_QWORD*)v28 + 1) = *((_QWORD*)v29 + 1);
+				}
 			}
 			inputBuf = v74;
 		}
@@ -567,6 +631,23 @@ LABEL_69:
 	return result;
 }
 
+//-----------------------------------------------------------------------------
+// decodes the RTech data stream using the reference (scalar) kernel
+//-----------------------------------------------------------------------------
+bool Pak_RTechStreamDecode(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen)
+{
+	return Pak_RTechStreamDecodeKernel<false>(decoder, inLen, outLen);
+}
+
+//-----------------------------------------------------------------------------
+// decodes the RTech data stream using the wide (SSE2) kernel, the result is
+// identical to that of the reference kernel
+//-----------------------------------------------------------------------------
+bool Pak_RTechStreamDecodeWide(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen)
+{
+	return Pak_RTechStreamDecodeKernel<true>(decoder, inLen, outLen);
+}
+
 //-----------------------------------------------------------------------------
 // initializes the ZStd decoder
 //-----------------------------------------------------------------------------
@@ -722,7 +803,8 @@ size_t Pak_InitDecoder(PakDecoder_s* const decoder, const uint8_t* const inputBu
 // from where the base pak had ended as patch pak files are considered part of
 // the pak file that's currently getting loaded
 //-----------------------------------------------------------------------------
-bool Pak_StreamToBufferDecode(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen, const PakDecodeMode_e decodeMode)
+bool Pak_StreamToBufferDecode(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen,
+	const PakDecodeMode_e decodeMode, const bool useReferenceKernel)
 {
 	if (!Pak_HasEnoughStreamedDataForDecode(decoder, inLen))
 		return false;
@@ -731,7 +813,11 @@ bool Pak_StreamToBufferDecode(PakDecoder_s* const decoder, const size_t inLen, c
 		return false;
 
 	if (decodeMode == PakDecodeMode_e::MODE_RTECH)
-		return Pak_RTechStreamDecode(decoder, inLen, outLen);
+	{
+		return useReferenceKernel
+			? Pak_RTechStreamDecode(decoder, inLen, outLen)
+			: Pak_RTechStreamDecodeWide(decoder, inLen, outLen);
+	}
 
 	// must have a decoder at this point
 	//
@@ -749,7 +835,8 @@ bool Pak_StreamToBufferDecode(PakDecoder_s* const decoder, const size_t inLen, c
 //-----------------------------------------------------------------------------
 // decodes buffered input pak data
 //-----------------------------------------------------------------------------
-bool Pak_BufferToBufferDecode(uint8_t* const inBuf, uint8_t* const outBuf, const size_t pakSize, const PakDecodeMode_e decodeMode)
+bool Pak_BufferToBufferDecode(uint8_t* const inBuf, uint8_t* const outBuf, const size_t pakSize,
+	const PakDecodeMode_e decodeMode, const bool useReferenceKernel)
 {
 	assert(decodeMode != PakDecodeMode_e::MODE_DISABLED);
 
@@ -767,7 +854,7 @@ bool Pak_BufferToBufferDecode(uint8_t* const inBuf, uint8_t* const outBuf, const
 	}
 
 	// we should always have enough buffer room at this point
-	if (!Pak_StreamToBufferDecode(&decoder, inHeader->compressedSize, inHeader->decompressedSize, decodeMode))
+	if (!Pak_StreamToBufferDecode(&decoder, inHeader->compressedSize, inHeader->decompressedSize, decodeMode, useReferenceKernel))
 	{
 		Error(eDLL_T::RTECH, NO_ERROR, "%s: decompression failed!\n",
 			__FUNCTION__);
@@ -791,36 +878,87 @@ bool Pak_BufferToBufferDecode(uint8_t* const inBuf, uint8_t* const outBuf, const
 }
 
 //-----------------------------------------------------------------------------
-// decodes the pak file from file name
+// returns the ring buffer size needed to decode a stream with given window
+// mask; streams that aren't split into windows must fit as a whole
 //-----------------------------------------------------------------------------
-bool Pak_DecodePakFile(const char* const inPakFile, const char* const outPakFile)
+static size_t Pak_GetRingBufferSizeForWindow(const uint64_t windowMask, const size_t dataSize, const size_t defaultSize)
 {
-	// if this path doesn't exist, we must create it first before trying to
-	// open the out file
-	if (!Pak_CreateOverridePath())
+	const size_t windowSize = windowMask == UINT64_MAX
+		? dataSize
+		: Min(windowMask + 1, dataSize);
+
+	size_t ringSize = defaultSize;
+
+	while (ringSize < windowSize)
+		ringSize <<= 1;
+
+	return ringSize;
+}
+
+//-----------------------------------------------------------------------------
+// streams pak file data into the input ring buffer in chunks, never past the
+// stream limit as the data beyond it hasn't been consumed by the decoder yet
+//-----------------------------------------------------------------------------
+static bool Pak_StreamToRingBuffer(CIOStream& inStream, uint8_t* const ringBuf, const uint64_t ringMask,
+	size_t& bytesStreamed, const size_t streamLimit, const size_t fileSize)
+{
+	bool didStream = false;
+
+	while (bytesStreamed < fileSize)
 	{
-		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to create output path for pak file '%s'!\n",
-			__FUNCTION__, outPakFile);
+		const size_t readEnd = Min(bytesStreamed + PAK_READ_DATA_CHUNK_SIZE, fileSize);
 
-		return false;
+		if (readEnd > streamLimit)
+			break;
+
+		while (bytesStreamed < readEnd)
+		{
+			const PakRingBufferFrame_s frame = Pak_DetermineRingBufferFrame(ringMask, bytesStreamed, readEnd);
+			inStream.Read(&ringBuf[frame.bufIndex], frame.frameLen);
+
+			bytesStreamed += frame.frameLen;
+		}
+
+		didStream = true;
 	}
 
-	CIOStream inPakStream;
+	return didStream;
+}
 
-	if (!inPakStream.Open(inPakFile, CIOStream::READ | CIOStream::BINARY))
+//-----------------------------------------------------------------------------
+// passes decoded data out of the output ring buffer to the output function
+//-----------------------------------------------------------------------------
+static bool Pak_FlushRingBuffer(const PakDecodeOutputFunc_t& outputFunc, const uint8_t* const ringBuf,
+	const uint64_t ringMask, size_t& bytesFlushed, const size_t flushEnd)
+{
+	while (bytesFlushed < flushEnd)
 	{
-		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to open pak file '%s' for read!\n",
-			__FUNCTION__, inPakFile);
+		const PakRingBufferFrame_s frame = Pak_DetermineRingBufferFrame(ringMask, bytesFlushed, flushEnd);
 
-		return false;
+		if (!outputFunc(&ringBuf[frame.bufIndex], frame.frameLen))
+			return false;
+
+		bytesFlushed += frame.frameLen;
 	}
 
-	CIOStream outPakStream;
+	return true;
+}
 
-	if (!outPakStream.Open(outPakFile, CIOStream::WRITE | CIOStream::BINARY))
+//-----------------------------------------------------------------------------
+// decodes the pak file from file name and passes the decoded data, starting
+// with the decoded file header, to the output function in order; the input is
+// streamed in and the output flushed out through ring buffers, so only the
+// ring buffers are held in memory rather than the entire encoded and decoded
+// pak file. Paks that aren't encoded are passed through as-is
+//-----------------------------------------------------------------------------
+bool Pak_StreamDecodePakFile(const char* const inPakFile, const PakDecodeHeaderFunc_t& headerFunc, const PakDecodeOutputFunc_t& outputFunc)
+{
+	CIOStream inPakStream;
+
+	if (!inPakStream.Open(inPakFile, CIOStream::READ | CIOStream::BINARY))
 	{
-		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to open pak file '%s' for write!\n",
-			__FUNCTION__, outPakFile);
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to open pak file '%s' for read!\n",
+			__FUNCTION__, inPakFile);
 
 		return false;
 	}
@@ -835,15 +973,25 @@ bool Pak_DecodePakFile(const char* const inPakFile, const char* const outPakFile
 		return false;
 	}
 
-	std::unique_ptr<uint8_t[]> inPakBufContainer(new uint8_t[fileSize]);
-	uint8_t* const inPakBuf = inPakBufContainer.get();
+	// the decoders may read a few bytes past the end of the ring buffers, add
+	// some padding so this never runs off the allocation
+	const size_t ringBufferPadding = 64;
+
+	size_t inRingSize = PAK_DECODE_IN_RING_BUFFER_SIZE;
+	std::unique_ptr<uint8_t[]> inRingBufContainer(new uint8_t[inRingSize + ringBufferPadding]);
 
-	inPakStream.Read(inPakBuf, fileSize);
-	inPakStream.Close();
+	size_t bytesStreamed = 0;
 
-	PakFileHeader_s* const inHeader = reinterpret_cast<PakFileHeader_s*>(inPakBuf);
+	// the first chunk contains the file header and the frame header, both
+	// are required to initialize the decoder
+	Pak_StreamToRingBuffer(inPakStream, inRingBufContainer.get(), inRingSize - 1,
+		bytesStreamed, PAK_READ_DATA_CHUNK_SIZE, fileSize);
 
-	if (inHeader->magic != PAK_HEADER_MAGIC || inHeader->version != PAK_HEADER_VERSION)
+	// copy the header out as the ring buffer will be overwritten
+	PakFileHeader_s inHeader;
+	memcpy(&inHeader, inRingBufContainer.get(), sizeof(PakFileHeader_s));
+
+	if (inHeader.magic != PAK_HEADER_MAGIC || inHeader.version != PAK_HEADER_VERSION)
 	{
 		Error(eDLL_T::RTECH, NO_ERROR, "%s: pak '%s' has incompatible or invalid header!\n",
 			__FUNCTION__, inPakFile);
@@ -851,30 +999,194 @@ bool Pak_DecodePakFile(const char* const inPakFile, const char* const outPakFile
 		return false;
 	}
 
-	const PakDecodeMode_e decodeMode = inHeader->GetCompressionMode();
+	if (inHeader.compressedSize != fileSize)
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: pak '%s' appears truncated or corrupt; compressed size: '%zu' expected: '%zu'!\n",
+			__FUNCTION__, inPakFile, fileSize, inHeader.compressedSize);
+
+		return false;
+	}
+
+	if (!headerFunc(inHeader))
+		return false;
+
+	const PakDecodeMode_e decodeMode = inHeader.GetCompressionMode();
 
+	// not encoded, pass the file through in chunks
 	if (decodeMode == PakDecodeMode_e::MODE_DISABLED)
 	{
-		Error(eDLL_T::RTECH, NO_ERROR, "%s: pak '%s' is already decompressed!\n",
-			__FUNCTION__, inPakFile);
+		size_t bytesFlushed = 0;
+
+		for (;;)
+		{
+			if (!Pak_FlushRingBuffer(outputFunc, inRingBufContainer.get(), inRingSize - 1, bytesFlushed, bytesStreamed))
+				return false;
+
+			if (!Pak_StreamToRingBuffer(inPakStream, inRingBufContainer.get(), inRingSize - 1,
+				bytesStreamed, bytesFlushed + inRingSize, fileSize))
+				break;
+		}
+
+		return true;
+	}
+
+	// the output ring buffer is allocated once the decoder knows the size of
+	// the decode window, which is parsed from the frame header
+	PakDecoder_s decoder{};
+	const size_t decompressedSize = Pak_InitDecoder(&decoder, inRingBufContainer.get(), nullptr,
+		inRingSize - 1, PAK_DECODE_OUT_RING_BUFFER_MASK, fileSize, NULL, sizeof(PakFileHeader_s), decodeMode);
+
+	if (decompressedSize != inHeader.decompressedSize)
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: decompressed size: '%zu' expected: '%zu'!\n",
+			__FUNCTION__, decompressedSize, inHeader.decompressedSize);
+
+		if (decodeMode == PakDecodeMode_e::MODE_ZSTD && decoder.zstreamContext)
+			ZSTD_freeDStream(decoder.zstreamContext);
 
 		return false;
 	}
 
-	if (inHeader->compressedSize != fileSize)
+	// streams that use windows larger than our default ring buffers, or that
+	// aren't windowed at all, require larger ring buffers to be decoded
+	const size_t requiredInRingSize = Pak_GetRingBufferSizeForWindow(decoder.inputInvMask, fileSize, inRingSize);
+
+	if (requiredInRingSize != inRingSize)
 	{
-		Error(eDLL_T::RTECH, NO_ERROR, "%s: pak '%s' appears truncated or corrupt; compressed size: '%zu' expected: '%zu'!\n",
-			__FUNCTION__, inPakFile, fileSize, inHeader->compressedSize);
+		std::unique_ptr<uint8_t[]> newRingBuf(new uint8_t[requiredInRingSize + ringBufferPadding]);
+		memcpy(newRingBuf.get(), inRingBufContainer.get(), bytesStreamed);
+
+		inRingBufContainer = std::move(newRingBuf);
+		inRingSize = requiredInRingSize;
+
+		decoder.inputBuf = inRingBufContainer.get();
+		decoder.inputMask = inRingSize - 1;
+	}
+
+	const size_t outRingSize = Pak_GetRingBufferSizeForWindow(decoder.outputInvMask, decompressedSize, PAK_DECODE_OUT_RING_BUFFER_SIZE);
+	std::unique_ptr<uint8_t[]> outRingBufContainer(new uint8_t[outRingSize + ringBufferPadding]);
+
+	decoder.outputBuf = outRingBufContainer.get();
+	decoder.outputMask = outRingSize - 1;
+
+	DevMsg(eDLL_T::RTECH, "%s: decoding pak '%s' with ring buffers of %zu (in) and %zu (out) bytes\n",
+		__FUNCTION__, inPakFile, inRingSize, outRingSize);
+
+	// the decoded file header; compression flags removed and compressed size
+	// equal to decompressed size
+	PakFileHeader_s outHeader = inHeader;
+
+	outHeader.flags &= ~PAK_HEADER_FLAGS_COMPRESSED;
+	outHeader.flags &= ~PAK_HEADER_FLAGS_ZSTREAM_ENCODED;
+	outHeader.compressedSize = outHeader.decompressedSize;
+
+	size_t bytesFlushed = sizeof(PakFileHeader_s);
+	bool decoded = outputFunc(reinterpret_cast<const uint8_t*>(&outHeader), sizeof(PakFileHeader_s));
+
+	while (decoded)
+	{
+		const size_t lastInPos = decoder.inBufBytePos;
+		const size_t lastOutPos = decoder.outBufBytePos;
+
+		// anything before the current input position has been consumed by
+		// the decoder, and can therefore be overwritten with new data
+		const bool didStream = Pak_StreamToRingBuffer(inPakStream, inRingBufContainer.get(), inRingSize - 1,
+			bytesStreamed, (decoder.inBufBytePos & ~(PAK_READ_DATA_CHUNK_SIZE - 1)) + inRingSize, fileSize);
+
+		const bool finished = Pak_StreamToBufferDecode(&decoder, bytesStreamed, bytesFlushed + outRingSize, decodeMode);
+
+		if (!Pak_FlushRingBuffer(outputFunc, outRingBufContainer.get(), outRingSize - 1,
+			bytesFlushed, decoder.outBufBytePos))
+		{
+			decoded = false;
+			break;
+		}
+
+		if (finished)
+			return true;
+
+		if (!didStream && decoder.inBufBytePos == lastInPos && decoder.outBufBytePos == lastOutPos)
+		{
+			Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to decompress pak file '%s'; decoder stalled at %zu of %zu bytes!\n",
+				__FUNCTION__, inPakFile, decoder.outBufBytePos, decompressedSize);
+
+			decoded = false;
+		}
+	}
+
+	if (decodeMode == PakDecodeMode_e::MODE_ZSTD && decoder.zstreamContext)
+		ZSTD_freeDStream(decoder.zstreamContext);
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// decodes the pak file from file name and writes it to the output file
+//-----------------------------------------------------------------------------
+bool Pak_DecodePakFile(const char* const inPakFile, const char* const outPakFile)
+{
+	// if this path doesn't exist, we must create it first before trying to
+	// open the out file
+	if (!Pak_CreateOverridePath())
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to create output path for pak file '%s'!\n",
+			__FUNCTION__, outPakFile);
+
+		return false;
+	}
+
+	CIOStream outPakStream;
+
+	if (!outPakStream.Open(outPakFile, CIOStream::WRITE | CIOStream::BINARY))
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to open pak file '%s' for write!\n",
+			__FUNCTION__, outPakFile);
 
 		return false;
 	}
 
-	Pak_ShowHeaderDetails(inHeader);
+	// patch paks have their patch headers right after the file header, these
+	// belong to the decoded data but must be updated after decoding
+	std::unique_ptr<uint8_t[]> headerBufContainer;
+	size_t headerBufSize = 0;
 
-	std::unique_ptr<uint8_t[]> outPakBufContainer(new uint8_t[inHeader->decompressedSize]);
-	uint8_t* const outPakBuf = outPakBufContainer.get();
+	uint16_t patchIndex = 0;
+	size_t bytesWritten = 0;
 
-	if (!Pak_BufferToBufferDecode(inPakBuf, outPakBuf, fileSize, decodeMode))
+	const auto headerFunc = [&](const PakFileHeader_s& header) -> bool
+	{
+		if (header.GetCompressionMode() == PakDecodeMode_e::MODE_DISABLED)
+		{
+			Error(eDLL_T::RTECH, NO_ERROR, "%s: pak '%s' is already decompressed!\n",
+				__FUNCTION__, inPakFile);
+
+			return false;
+		}
+
+		Pak_ShowHeaderDetails(&header);
+
+		patchIndex = header.patchIndex;
+		headerBufSize = sizeof(PakFileHeader_s);
+
+		if (patchIndex)
+			headerBufSize += sizeof(PakPatchDataHeader_s) + patchIndex * (sizeof(PakPatchFileHeader_s) + sizeof(uint16_t));
+
+		headerBufContainer.reset(new uint8_t[headerBufSize]);
+		return true;
+	};
+
+	const auto outputFunc = [&](const uint8_t* const data, const size_t dataLen) -> bool
+	{
+		if (bytesWritten < headerBufSize)
+			memcpy(&headerBufContainer[bytesWritten], data, Min(dataLen, headerBufSize - bytesWritten));
+
+		outPakStream.Write(data, dataLen);
+		bytesWritten += dataLen;
+
+		return true;
+	};
+
+	if (!Pak_StreamDecodePakFile(inPakFile, headerFunc, outputFunc))
 	{
 		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to decompress pak file '%s'!\n",
 			__FUNCTION__, inPakFile);
@@ -882,18 +1194,22 @@ bool Pak_DecodePakFile(const char* const inPakFile, const char* const outPakFile
 		return false;
 	}
 
-	const PakFileHeader_s* const outHeader = reinterpret_cast<PakFileHeader_s*>(outPakBuf);
-
 	// NOTE: if the paks this particular pak patches have different sizes than
 	// current sizes in the patch header, the runtime will crash!
-	if (outHeader->patchIndex && !Pak_UpdatePatchHeaders(outPakBuf, outPakFile))
+	if (patchIndex)
 	{
-		Warning(eDLL_T::RTECH, "%s: pak '%s' is a patch pak, but the pak(s) it patches weren't found; patch headers not updated!\n",
-			__FUNCTION__, inPakFile);
+		if (Pak_UpdatePatchHeaders(headerBufContainer.get(), outPakFile))
+		{
+			outPakStream.SeekPut(0);
+			outPakStream.Write(headerBufContainer.get(), headerBufSize);
+		}
+		else
+		{
+			Warning(eDLL_T::RTECH, "%s: pak '%s' is a patch pak, but the pak(s) it patches weren't found; patch headers not updated!\n",
+				__FUNCTION__, inPakFile);
+		}
 	}
 
-	outPakStream.Write(outPakBuf, outHeader->decompressedSize);
-
 	Msg(eDLL_T::RTECH, "Decompressed pak file to: '%s'\n", outPakFile);
 	return true;
 }
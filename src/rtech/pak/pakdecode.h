@@ -6,9 +6,17 @@ extern size_t Pak_InitDecoder(PakDecoder_s* const decoder, const uint8_t* const
 	const uint64_t inputMask, const uint64_t outputMask, const size_t dataSize, const size_t dataOffset,
 	const size_t headerSize, const PakDecodeMode_e decodeMode);
 
-extern bool Pak_StreamToBufferDecode(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen, const PakDecodeMode_e decodeMode);
-extern bool Pak_BufferToBufferDecode(uint8_t* const inBuf, uint8_t* const outBuf, const size_t pakSize, const PakDecodeMode_e decodeMode);
+extern bool Pak_StreamToBufferDecode(PakDecoder_s* const decoder, const size_t inLen, const size_t outLen,
+	const PakDecodeMode_e decodeMode, const bool useReferenceKernel = false);
+extern bool Pak_BufferToBufferDecode(uint8_t* const inBuf, uint8_t* const outBuf, const size_t pakSize,
+	const PakDecodeMode_e decodeMode, const bool useReferenceKernel = false);
 
+// called with the header of the pak before decoding, return false to abort
+typedef std::function<bool(const PakFileHeader_s& header)> PakDecodeHeaderFunc_t;
+// called with each decoded range of the pak in order, return false to abort
+typedef std::function<bool(const uint8_t* const data, const size_t dataLen)> PakDecodeOutputFunc_t;
+
+extern bool Pak_StreamDecodePakFile(const char* const inPakFile, const PakDecodeHeaderFunc_t& headerFunc, const PakDecodeOutputFunc_t& outputFunc);
 extern bool Pak_DecodePakFile(const char* const inPakFile, const char* const outPakFile);
 
 #endif // RTECH_PAKDECODE_H
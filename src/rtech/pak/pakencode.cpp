@@ -4,6 +4,7 @@
 //
 //=============================================================================//
 #include "tier0/binstream.h"
+#include "tier0/fasttimer.h"
 #include "rtech/ipakfile.h"
 #include "paktools.h"
 #include "pakencode.h"
@@ -24,14 +25,51 @@ static const char* Pak_GetEncodeError(const size_t result)
 	return ZSTD_getErrorName(result);
 }
 
+//-----------------------------------------------------------------------------
+// sets an encoder parameter, returns false and logs the error on failure
+//-----------------------------------------------------------------------------
+static bool Pak_SetEncodeParameter(ZSTD_CCtx* const cctx, const ZSTD_cParameter param, const int value)
+{
+	const size_t result = ZSTD_CCtx_setParameter(cctx, param, value);
+
+	if (Pak_HasEncodeFailed(result))
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to set parameter '%d' to '%d'! [%s]\n",
+			__FUNCTION__, param, value, Pak_GetEncodeError(result));
+
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// clamps the requested worker count to what the encoder supports
+//-----------------------------------------------------------------------------
+static int Pak_GetEncodeWorkerCount(const int workerCount)
+{
+	const ZSTD_bounds workerBounds = ZSTD_cParam_getBounds(ZSTD_c_nbWorkers);
+	return Clamp(workerCount, workerBounds.lowerBound, workerBounds.upperBound);
+}
+
 //-----------------------------------------------------------------------------
 // encodes the pak file from buffer, we can't do streamed compression as we
 // need to know the actual decompress size ahead of time, else the runtime will
 // fail as we wouldn't be able to parse the decompressed size from the frame
 // header
+//
+// the runtime decoder stops after the first frame, so the data must be encoded
+// as a single frame; multiple workers are supported by letting zstd split the
+// input in jobs which are compressed in parallel and emitted as blocks of one
+// frame, rather than encoding independent frames. A worker count of 0 encodes
+// on the calling thread
+//
+// long distance matching finds matches far back in large paks, but raises the
+// window size to 128 MiB, which the runtime decoder has to allocate as well
 //-----------------------------------------------------------------------------
 bool Pak_BufferToBufferEncode(const uint8_t* const inBuf, const uint64_t inLen,
-	uint8_t* const outBuf, const uint64_t outLen, const int level)
+	uint8_t* const outBuf, const uint64_t outLen, const int level,
+	const int workerCount, const bool longDistanceMatching)
 {
 	// offset to the actual pak data, the main file header shouldn't be
 	// compressed
@@ -43,9 +81,30 @@ bool Pak_BufferToBufferEncode(const uint8_t* const inBuf, const uint64_t inLen,
 	const uint8_t* const srcBuf = inBuf + dataOffset;
 	const size_t srcLen = inLen - dataOffset;
 
-	size_t compressSize = NULL;
+	ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+
+	if (!cctx)
+	{
+		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to create encoder context!\n", __FUNCTION__);
+		return false;
+	}
+
+	const int numWorkers = Pak_GetEncodeWorkerCount(workerCount);
+
+	if (!Pak_SetEncodeParameter(cctx, ZSTD_c_compressionLevel, level) ||
+		!Pak_SetEncodeParameter(cctx, ZSTD_c_nbWorkers, numWorkers) ||
+		!Pak_SetEncodeParameter(cctx, ZSTD_c_enableLongDistanceMatching, longDistanceMatching ? ZSTD_ps_enable : ZSTD_ps_disable) ||
+		// the runtime obtains the decompressed size from the frame header
+		!Pak_SetEncodeParameter(cctx, ZSTD_c_contentSizeFlag, 1))
+	{
+		ZSTD_freeCCtx(cctx);
+		return false;
+	}
 
-	compressSize = ZSTD_compress(dstBuf, dstLen, srcBuf, srcLen, level);
+	// the size is known up front, this always produces a single frame with
+	// the content size in its header, regardless of the worker count
+	const size_t compressSize = ZSTD_compress2(cctx, dstBuf, dstLen, srcBuf, srcLen);
+	ZSTD_freeCCtx(cctx);
 
 	if (Pak_HasEncodeFailed(compressSize))
 	{
@@ -72,7 +131,8 @@ bool Pak_BufferToBufferEncode(const uint8_t* const inBuf, const uint64_t inLen,
 //-----------------------------------------------------------------------------
 // encodes the pak file from file name
 //-----------------------------------------------------------------------------
-bool Pak_EncodePakFile(const char* const inPakFile, const char* const outPakFile, const int level)
+bool Pak_EncodePakFile(const char* const inPakFile, const char* const outPakFile, const int level,
+	const int workerCount, const bool longDistanceMatching)
 {
 	if (!Pak_CreateBasePath())
 	{
@@ -163,8 +223,16 @@ bool Pak_EncodePakFile(const char* const inPakFile, const char* const outPakFile
 	// copy the header over
 	*outHeader = *inHeader;
 
+	CFastTimer encodeTimer;
+	encodeTimer.Start();
+
+	const bool encoded = Pak_BufferToBufferEncode(inPakBuf, fileSize, outPakBuf, outBufSize,
+		level, workerCount, longDistanceMatching);
+
+	encodeTimer.End();
+
 	// encoding failed
-	if (!Pak_BufferToBufferEncode(inPakBuf, fileSize, outPakBuf, outBufSize, level))
+	if (!encoded)
 	{
 		Error(eDLL_T::RTECH, NO_ERROR, "%s: failed to compress pak file '%s'!\n",
 			__FUNCTION__, inPakFile);
@@ -179,6 +247,12 @@ bool Pak_EncodePakFile(const char* const inPakFile, const char* const outPakFile
 	// this will be true if the entire buffer has been written
 	outPakStream.Write(outPakBuf, outPakHeader->compressedSize);
 
+	const double encodeSeconds = encodeTimer.GetDuration().GetSeconds();
+	const double encodeRate = encodeSeconds > 0.0 ? (double(fileSize) / (1024.0 * 1024.0)) / encodeSeconds : 0.0;
+
 	Msg(eDLL_T::RTECH, "Compressed pak file to: '%s'\n", outPakFile);
+	Msg(eDLL_T::RTECH, "Encoded '%zu' bytes to '%zu' bytes in '%lf' seconds ('%.2f' MiB/s, '%d' workers, long distance matching %s)\n",
+		fileSize, size_t(outPakHeader->compressedSize), encodeSeconds, encodeRate, Pak_GetEncodeWorkerCount(workerCount), longDistanceMatching ? "on" : "off");
+
 	return true;
 }
@@ -3,8 +3,10 @@
 #include "rtech/ipakfile.h"
 
 bool Pak_BufferToBufferEncode(const uint8_t* const inBuf, const uint64_t inLen,
-	uint8_t* const outBuf, const uint64_t outLen, const int level);
+	uint8_t* const outBuf, const uint64_t outLen, const int level,
+	const int workerCount, const bool longDistanceMatching);
 
-bool Pak_EncodePakFile(const char* const inPakFile, const char* const outPakFile, const int level);
+bool Pak_EncodePakFile(const char* const inPakFile, const char* const outPakFile, const int level,
+	const int workerCount, const bool longDistanceMatching);
 
 #endif // RTECH_PAKENCODE_H
@@ -15,6 +15,7 @@
 #include "pakstream.h"
 
 static ConVar pak_debugrelations("pak_debugrelations", "0", FCVAR_DEVELOPMENTONLY | FCVAR_ACCESSIBLE_FROM_THREADS, "Debug RPAK asset dependency resolving");
+static ConVar pak_referencedecoder("pak_referencedecoder", "0", FCVAR_DEVELOPMENTONLY | FCVAR_ACCESSIBLE_FROM_THREADS, "Decode RTech encoded RPAK files with the reference (scalar) kernel instead of the wide kernel");
 
 //-----------------------------------------------------------------------------
 // resolve the target guid from lookuo table
@@ -330,8 +331,10 @@ bool Pak_ProcessPakFile(PakFile_s* const pak)
 
             if (qword1D0 != pak->pakDecoder.decompSize)
             {
+                // both kernels share the decoder state, so toggling this
+                // while a pak is being decoded is safe
                 const bool didDecode = Pak_StreamToBufferDecode(&pak->pakDecoder, 
-                    fileStream->bytesStreamed, (memoryData->processedPatchedDataSize + PAK_DECODE_OUT_RING_BUFFER_SIZE), v22->compressionMode);
+                    fileStream->bytesStreamed, (memoryData->processedPatchedDataSize + PAK_DECODE_OUT_RING_BUFFER_SIZE), v22->compressionMode, pak_referencedecoder.GetBool());
 
                 qword1D0 = pak->pakDecoder.outBufBytePos;
                 pak->inputBytePos = pak->pakDecoder.inBufBytePos;
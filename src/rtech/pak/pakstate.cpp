@@ -224,6 +224,10 @@ RTech_Compress_f
 
   Compresses input RPak file and
   dumps results to base path
+
+  Optional switches:
+  -threads <count> ( encode workers, 0 = calling thread, defaults to one per core )
+  -ldm ( long distance matching )
 =====================
 */
 static void Pak_Compress_f(const CCommand& args)
@@ -237,9 +241,12 @@ static void Pak_Compress_f(const CCommand& args)
 	CFmtStr1024 outPakFile(PAK_PLATFORM_PATH "%s", args.Arg(1));
 
 	// NULL means default compress level
-	const int compressLevel = args.ArgC() > 2 ? atoi(args.Arg(2)) : NULL;
+	const int compressLevel = (args.ArgC() > 2 && args.Arg(2)[0] != '-') ? atoi(args.Arg(2)) : NULL;
+
+	const int workerCount = args.FindArgInt("-threads", static_cast<int>(std::thread::hardware_concurrency()));
+	const bool longDistanceMatching = args.FindArg("-ldm") != nullptr;
 
-	if (!Pak_EncodePakFile(inPakFile.String(), outPakFile.String(), compressLevel))
+	if (!Pak_EncodePakFile(inPakFile.String(), outPakFile.String(), compressLevel, workerCount, longDistanceMatching))
 	{
 		Error(eDLL_T::RTECH, NO_ERROR, "%s - compression failed for '%s'!\n",
 			__FUNCTION__, inPakFile.String());
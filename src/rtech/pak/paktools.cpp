@@ -6,7 +6,9 @@
 #include "tier0/binstream.h"
 #include "rtech/ipakfile.h"
 
+#ifndef _TOOLS
 #include "pakstate.h"
+#endif // !_TOOLS
 #include "paktools.h"
 
 //----------------------------------------------------------------------------------
@@ -250,6 +252,7 @@ PakGuid_t Pak_StringToGuid(const char* const string)
 		: Pak_StringToGuidAligned(string);
 }
 
+#ifndef _TOOLS
 //-----------------------------------------------------------------------------
 // gets information about loaded pak file via pak id
 //-----------------------------------------------------------------------------
@@ -281,6 +284,7 @@ const PakLoadedInfo_s* Pak_GetPakInfo(const char* const pakName)
 	Warning(eDLL_T::RTECH, "%s - Failed to retrieve pak info for name '%s'\n", __FUNCTION__, pakName);
 	return nullptr;
 }
+#endif // !_TOOLS
 
 //-----------------------------------------------------------------------------
 // returns a pointer to the patch data header
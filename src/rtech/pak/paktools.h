@@ -17,8 +17,10 @@ const char* Pak_DecoderToString(const PakDecodeMode_e mode);
 
 extern PakGuid_t Pak_StringToGuid(const char* const string);
 
+#ifndef _TOOLS
 extern PakLoadedInfo_s* Pak_GetPakInfo(const PakHandle_t pakId);
 extern const PakLoadedInfo_s* Pak_GetPakInfo(const char* const pakName);
+#endif // !_TOOLS
 
 extern PakPatchDataHeader_s* Pak_GetPatchDataHeader(PakFileHeader_s* const pakHeader);
 extern PakPatchFileHeader_s* Pak_GetPatchFileHeader(PakFileHeader_s* const pakHeader, const int index);
@@ -0,0 +1,487 @@
+//=============================================================================//
+//
+// Purpose: bit buffer bulk and coordinate routine fuzzer and benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "tier1/bitbuf.h"
+#include "public/coordsize.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: returns the mask of the low nBits bits, nBits must be below 32
+//-----------------------------------------------------------------------------
+static FORCEINLINE uint32 BitBuf_ExtraMask(const int nBits)
+{
+	return (uint32(1) << nBits) - 1;
+}
+
+//-----------------------------------------------------------------------------
+// Reference routines; these write and read the same bits one field at a time.
+//-----------------------------------------------------------------------------
+static void BitBuf_WriteBitsReference(CBitWrite& buf, const void* pInData, int nBits)
+{
+	const unsigned char* pIn = (const unsigned char*)pInData;
+
+	for (; nBits >= 8; nBits -= 8)
+		buf.WriteUBitLong(*pIn++, 8, false);
+
+	if (nBits)
+		buf.WriteUBitLong(*pIn & BitBuf_ExtraMask(nBits), nBits, false);
+}
+
+static void BitBuf_WriteBitsFromBufferReference(CBitWrite& buf, bf_read& in, int nBits)
+{
+	while (nBits > 32)
+	{
+		buf.WriteUBitLong(in.ReadUBitLong(32), 32);
+		nBits -= 32;
+	}
+
+	buf.WriteUBitLong(in.ReadUBitLong(nBits), nBits);
+}
+
+static void BitBuf_ReadBitsReference(CBitRead& buf, void* pOutData, int nBits)
+{
+	unsigned char* pOut = (unsigned char*)pOutData;
+
+	for (; nBits >= 8; nBits -= 8)
+		*pOut++ = (unsigned char)buf.ReadUBitLong(8);
+
+	if (nBits)
+		*pOut = (unsigned char)buf.ReadUBitLong(nBits);
+}
+
+static void BitBuf_WriteBitVec3CoordReference(CBitWrite& buf, const Vector3D& fa)
+{
+	const int xflag = (fa[0] >= COORD_RESOLUTION) || (fa[0] <= -COORD_RESOLUTION);
+	const int yflag = (fa[1] >= COORD_RESOLUTION) || (fa[1] <= -COORD_RESOLUTION);
+	const int zflag = (fa[2] >= COORD_RESOLUTION) || (fa[2] <= -COORD_RESOLUTION);
+
+	buf.WriteOneBit(xflag);
+	buf.WriteOneBit(yflag);
+	buf.WriteOneBit(zflag);
+
+	if (xflag)
+		buf.WriteBitCoord(fa[0]);
+	if (yflag)
+		buf.WriteBitCoord(fa[1]);
+	if (zflag)
+		buf.WriteBitCoord(fa[2]);
+}
+
+static void BitBuf_ReadBitVec3CoordReference(CBitRead& buf, Vector3D& fa)
+{
+	fa.Init(0, 0, 0);
+
+	const int xflag = buf.ReadOneBit();
+	const int yflag = buf.ReadOneBit();
+	const int zflag = buf.ReadOneBit();
+
+	if (xflag)
+		fa[0] = buf.ReadBitCoord();
+	if (yflag)
+		fa[1] = buf.ReadBitCoord();
+	if (zflag)
+		fa[2] = buf.ReadBitCoord();
+}
+
+//-----------------------------------------------------------------------------
+// Random number generation (xorshift64*)
+//-----------------------------------------------------------------------------
+static uint32 BitBuf_RandomInt(uint64& nState, const uint32 nMin, const uint32 nMax)
+{
+	nState ^= nState >> 12;
+	nState ^= nState << 25;
+	nState ^= nState >> 27;
+
+	const uint64 nRand = nState * 0x2545F4914F6CDD1DULL;
+	return nMin + uint32((nRand >> 32) % (uint64(nMax) - nMin + 1));
+}
+
+static float BitBuf_RandomCoord(uint64& nState)
+{
+	switch (BitBuf_RandomInt(nState, 0, 3))
+	{
+	case 0: // Zero and values below the resolution.
+		return (float(BitBuf_RandomInt(nState, 0, 64)) - 32.0f) / 1024.0f;
+	case 1: // Fractions only.
+		return (float(BitBuf_RandomInt(nState, 0, 64)) - 32.0f) / COORD_DENOMINATOR;
+	default: // Anything within the coordinate range.
+		return (float(BitBuf_RandomInt(nState, 0, 0xFFFFFF)) / float(0xFFFFFF) * 2.0f - 1.0f) * float(1 << COORD_INTEGER_BITS);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares the written bits of two buffers
+//-----------------------------------------------------------------------------
+static bool BitBuf_CompareWritten(const CBitWrite& a, const CBitWrite& b)
+{
+	const int nBits = a.GetNumBitsWritten();
+
+	if (nBits != b.GetNumBitsWritten() || a.IsOverflowed() != b.IsOverflowed())
+		return false;
+
+	if (memcmp(a.GetData(), b.GetData(), nBits >> 3) != 0)
+		return false;
+
+	return !(nBits & 7) || !((a.GetData()[nBits >> 3] ^ b.GetData()[nBits >> 3]) & BitBuf_ExtraMask(nBits & 7));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares the first nBits bits of two memory blocks
+//-----------------------------------------------------------------------------
+static bool BitBuf_CompareBits(const unsigned char* const a, const unsigned char* const b, const int nBits)
+{
+	if (memcmp(a, b, nBits >> 3) != 0)
+		return false;
+
+	return !(nBits & 7) || !((a[nBits >> 3] ^ b[nBits >> 3]) & BitBuf_ExtraMask(nBits & 7));
+}
+
+enum BitBufFuzzOp_e
+{
+	BITBUF_FUZZ_UBITLONG = 0,
+	BITBUF_FUZZ_BITS,
+	BITBUF_FUZZ_BITSFROMBUFFER,
+	BITBUF_FUZZ_VEC3COORD,
+
+	BITBUF_FUZZ_COUNT
+};
+
+struct BitBufFuzzOp_s
+{
+	BitBufFuzzOp_e type;
+	int numBits;
+	int srcBit;      // Bit offset into the source data for the bulk operations.
+	uint32 value;
+	Vector3D coord;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: writes a random sequence of fields through the fast and reference
+//			routines, compares the results and then reads the fields back the
+//			same way
+// Input  : nState - 
+//			&src - random source data
+// Output : true if both write and read back the same bits
+//-----------------------------------------------------------------------------
+static bool BitBuf_FuzzRound(uint64& nState, const vector<uint32>& src)
+{
+	const unsigned char* const pSrc = reinterpret_cast<const unsigned char*>(src.data());
+	const int nSrcBytes = int(src.size() * sizeof(uint32));
+
+	// Read buffers whose size isn't a multiple of 4 bytes keep the odd bytes at
+	// the head, which the bulk paths have to account for.
+	const int nReadBytes = nSrcBytes - int(BitBuf_RandomInt(nState, 0, 3));
+
+	vector<uint32> outFast(src.size() * 2 + 32, 0);
+	vector<uint32> outRef(outFast.size(), 0);
+
+	CBitWrite fast(outFast.data(), int(outFast.size() * sizeof(uint32)));
+	CBitWrite ref(outRef.data(), int(outRef.size() * sizeof(uint32)));
+
+	bf_read srcFast(src.data(), nReadBytes);
+	bf_read srcRef(src.data(), nReadBytes);
+
+	// Start at a random bit, so the bulk routines see every alignment.
+	const int nStartBit = int(BitBuf_RandomInt(nState, 0, 63));
+
+	fast.SeekToBit(nStartBit);
+	ref.SeekToBit(nStartBit);
+
+	CUtlVector<BitBufFuzzOp_s> ops;
+
+	while (fast.GetNumBitsLeft() > nReadBytes * 8 + 128)
+	{
+		BitBufFuzzOp_s op;
+
+		op.type = BitBufFuzzOp_e(BitBuf_RandomInt(nState, 0, BITBUF_FUZZ_COUNT - 1));
+		op.numBits = 0;
+		op.srcBit = 0;
+		op.value = 0;
+		op.coord.Init(0, 0, 0);
+
+		switch (op.type)
+		{
+		case BITBUF_FUZZ_UBITLONG:
+			op.numBits = int(BitBuf_RandomInt(nState, 1, 32));
+			op.value = BitBuf_RandomInt(nState, 0, UINT32_MAX) & (op.numBits < 32 ? BitBuf_ExtraMask(op.numBits) : UINT32_MAX);
+
+			fast.WriteUBitLong(op.value, op.numBits);
+			ref.WriteUBitLong(op.value, op.numBits);
+			break;
+		case BITBUF_FUZZ_BITS:
+			op.srcBit = int(BitBuf_RandomInt(nState, 0, nSrcBytes / 2)) * 8;
+			op.numBits = int(BitBuf_RandomInt(nState, 0, (nSrcBytes / 2) * 8));
+
+			fast.WriteBits(pSrc + (op.srcBit >> 3), op.numBits);
+			BitBuf_WriteBitsReference(ref, pSrc + (op.srcBit >> 3), op.numBits);
+			break;
+		case BITBUF_FUZZ_BITSFROMBUFFER:
+			op.numBits = int(BitBuf_RandomInt(nState, 0, nReadBytes * 8));
+			op.srcBit = int(BitBuf_RandomInt(nState, 0, nReadBytes * 8 - op.numBits));
+
+			srcFast.Seek(op.srcBit);
+			srcRef.Seek(op.srcBit);
+
+			fast.WriteBitsFromBuffer(&srcFast, op.numBits);
+			BitBuf_WriteBitsFromBufferReference(ref, srcRef, op.numBits);
+
+			if (srcFast.GetNumBitsRead() != srcRef.GetNumBitsRead())
+				return false;
+
+			break;
+		case BITBUF_FUZZ_VEC3COORD:
+			op.coord.Init(BitBuf_RandomCoord(nState), BitBuf_RandomCoord(nState), BitBuf_RandomCoord(nState));
+
+			fast.WriteBitVec3Coord(op.coord);
+			BitBuf_WriteBitVec3CoordReference(ref, op.coord);
+			break;
+		}
+
+		if (!BitBuf_CompareWritten(fast, ref))
+			return false;
+
+		ops.AddToTail(op);
+	}
+
+	// Read everything back through both readers.
+	CBitRead readFast(outFast.data(), outFast.size() * sizeof(uint32));
+	CBitRead readRef(outFast.data(), outFast.size() * sizeof(uint32));
+
+	readFast.Seek(nStartBit);
+	readRef.Seek(nStartBit);
+
+	vector<unsigned char> dataFast(nSrcBytes + 8);
+	vector<unsigned char> dataRef(nSrcBytes + 8);
+	vector<unsigned char> dataSrc(nSrcBytes + 8);
+
+	FOR_EACH_VEC(ops, i)
+	{
+		const BitBufFuzzOp_s& op = ops[i];
+
+		switch (op.type)
+		{
+		case BITBUF_FUZZ_UBITLONG:
+			if (readFast.ReadUBitLong(op.numBits) != op.value || readRef.ReadUBitLong(op.numBits) != op.value)
+				return false;
+
+			break;
+		case BITBUF_FUZZ_BITS:
+		case BITBUF_FUZZ_BITSFROMBUFFER:
+		{
+			// Read into a misaligned destination half of the time.
+			const int nOutOfs = int(BitBuf_RandomInt(nState, 0, 1) * BitBuf_RandomInt(nState, 1, 7));
+
+			readFast.ReadBits(&dataFast[nOutOfs], op.numBits);
+			BitBuf_ReadBitsReference(readRef, &dataRef[nOutOfs], op.numBits);
+
+			bf_read srcRead(src.data(), op.type == BITBUF_FUZZ_BITS ? nSrcBytes : nReadBytes);
+			srcRead.Seek(op.srcBit);
+
+			BitBuf_ReadBitsReference(srcRead, dataSrc.data(), op.numBits);
+
+			if (!BitBuf_CompareBits(&dataFast[nOutOfs], &dataRef[nOutOfs], op.numBits) ||
+				!BitBuf_CompareBits(&dataFast[nOutOfs], dataSrc.data(), op.numBits))
+				return false;
+
+			break;
+		}
+		case BITBUF_FUZZ_VEC3COORD:
+		{
+			Vector3D coordFast;
+			Vector3D coordRef;
+
+			readFast.ReadBitVec3Coord(coordFast);
+			BitBuf_ReadBitVec3CoordReference(readRef, coordRef);
+
+			if (memcmp(&coordFast, &coordRef, sizeof(Vector3D)) != 0)
+				return false;
+
+			break;
+		}
+		default:
+			break;
+		}
+
+		if (readFast.GetNumBitsRead() != readRef.GetNumBitsRead())
+			return false;
+	}
+
+	return !readFast.IsOverflowed() && !readRef.IsOverflowed();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: verifies the bulk and coordinate routines against the reference
+//			routines on random streams, then measures the throughput of both
+//
+//			Optional switches:
+//			-iterations <count> ( passes per routine, defaults to 8 )
+//			-fuzz <count> ( random streams to verify, defaults to 1000 )
+// Input  : &args - 
+// Output : true if the routines agree on all fuzzed streams
+//-----------------------------------------------------------------------------
+bool SDKBench_BitBuf(const CCommand& args)
+{
+	const int nIterations = Max(args.FindArgInt("-iterations", 8), 1);
+	const int nFuzzRounds = Max(args.FindArgInt("-fuzz", 1000), 0);
+
+	uint64 nState = 0x9E3779B97F4A7C15ULL;
+	int nMismatches = 0;
+
+	vector<uint32> src;
+
+	for (int i = 0; i < nFuzzRounds; i++)
+	{
+		src.resize(BitBuf_RandomInt(nState, 2, 512));
+
+		for (uint32& nWord : src)
+			nWord = BitBuf_RandomInt(nState, 0, UINT32_MAX);
+
+		if (!BitBuf_FuzzRound(nState, src))
+		{
+			Error(eDLL_T::COMMON, NO_ERROR, "Bit buffer mismatch in fuzz round '%d'\n", i);
+			nMismatches++;
+		}
+	}
+
+	if (nFuzzRounds)
+	{
+		Msg(eDLL_T::COMMON, "Bit buffer fuzzed '%d' rounds with '%d' mismatches\n", nFuzzRounds, nMismatches);
+	}
+
+	// Payloads the size of a datagram, written at an odd bit offset as they are
+	// when they follow message headers.
+	const int nChunkBytes = 1200;
+	const int nChunkCount = 1024;
+
+	src.resize((nChunkBytes * nChunkCount) / sizeof(uint32));
+
+	for (uint32& nWord : src)
+		nWord = BitBuf_RandomInt(nState, 0, UINT32_MAX);
+
+	vector<uint32> dst(src.size() + 16);
+	const unsigned char* const pSrc = reinterpret_cast<const unsigned char*>(src.data());
+
+	double flTimes[3][2] = {};
+
+	for (int i = 0; i < nIterations; i++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			CBitWrite writer(dst.data(), int(dst.size() * sizeof(uint32)));
+			writer.SeekToBit(3);
+
+			double flStart = Plat_FloatTime();
+
+			for (int j = 0; j < nChunkCount; j++)
+			{
+				if (k == 0)
+					writer.WriteBits(pSrc + j * nChunkBytes, nChunkBytes * 8);
+				else
+					BitBuf_WriteBitsReference(writer, pSrc + j * nChunkBytes, nChunkBytes * 8);
+			}
+
+			flTimes[0][k] += Plat_FloatTime() - flStart;
+
+			bf_read reader(src.data(), int(src.size() * sizeof(uint32)));
+			reader.Seek(5);
+
+			writer.SeekToBit(3);
+			flStart = Plat_FloatTime();
+
+			for (int j = 0; j < nChunkCount - 1; j++)
+			{
+				if (k == 0)
+					writer.WriteBitsFromBuffer(&reader, nChunkBytes * 8);
+				else
+					BitBuf_WriteBitsFromBufferReference(writer, reader, nChunkBytes * 8);
+			}
+
+			flTimes[1][k] += Plat_FloatTime() - flStart;
+
+			CBitRead dstReader(dst.data(), dst.size() * sizeof(uint32));
+			dstReader.Seek(3);
+
+			unsigned char chunk[nChunkBytes];
+			flStart = Plat_FloatTime();
+
+			for (int j = 0; j < nChunkCount - 1; j++)
+			{
+				if (k == 0)
+					dstReader.ReadBits(chunk, nChunkBytes * 8);
+				else
+					BitBuf_ReadBitsReference(dstReader, chunk, nChunkBytes * 8);
+			}
+
+			flTimes[2][k] += Plat_FloatTime() - flStart;
+		}
+	}
+
+	const char* const pszNames[] = { "WriteBits", "WriteBitsFromBuffer", "ReadBits" };
+	const double flMegaBytes = double(nChunkBytes) * nChunkCount * nIterations / (1024.0 * 1024.0);
+
+	for (int i = 0; i < int(SDK_ARRAYSIZE(pszNames)); i++)
+	{
+		Msg(eDLL_T::COMMON, "%s: '%.1f' MiB/s (reference: '%.1f' MiB/s)\n", pszNames[i],
+			flTimes[i][0] > 0.0 ? flMegaBytes / flTimes[i][0] : 0.0, flTimes[i][1] > 0.0 ? flMegaBytes / flTimes[i][1] : 0.0);
+	}
+
+	// Coordinates, as sent for entity origins.
+	const int nCoordCount = 16384;
+	CUtlVector<Vector3D> coords;
+
+	coords.SetCount(nCoordCount);
+
+	FOR_EACH_VEC(coords, i)
+	{
+		coords[i].Init(BitBuf_RandomCoord(nState), BitBuf_RandomCoord(nState), BitBuf_RandomCoord(nState));
+	}
+
+	vector<uint32> coordBuf(nCoordCount * 3 + 16);
+	double flCoordTimes[2][2] = {};
+
+	for (int i = 0; i < nIterations; i++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			CBitWrite writer(coordBuf.data(), int(coordBuf.size() * sizeof(uint32)));
+			double flStart = Plat_FloatTime();
+
+			FOR_EACH_VEC(coords, j)
+			{
+				if (k == 0)
+					writer.WriteBitVec3Coord(coords[j]);
+				else
+					BitBuf_WriteBitVec3CoordReference(writer, coords[j]);
+			}
+
+			flCoordTimes[0][k] += Plat_FloatTime() - flStart;
+
+			CBitRead reader(coordBuf.data(), coordBuf.size() * sizeof(uint32));
+			Vector3D coord;
+
+			flStart = Plat_FloatTime();
+
+			for (int j = 0; j < nCoordCount; j++)
+			{
+				if (k == 0)
+					reader.ReadBitVec3Coord(coord);
+				else
+					BitBuf_ReadBitVec3CoordReference(reader, coord);
+			}
+
+			flCoordTimes[1][k] += Plat_FloatTime() - flStart;
+		}
+	}
+
+	const double flMegaCoords = double(nCoordCount) * nIterations / 1000000.0;
+
+	Msg(eDLL_T::COMMON, "WriteBitVec3Coord: '%.2f' M/s (reference: '%.2f' M/s)\n",
+		flCoordTimes[0][0] > 0.0 ? flMegaCoords / flCoordTimes[0][0] : 0.0, flCoordTimes[0][1] > 0.0 ? flMegaCoords / flCoordTimes[0][1] : 0.0);
+	Msg(eDLL_T::COMMON, "ReadBitVec3Coord: '%.2f' M/s (reference: '%.2f' M/s)\n",
+		flCoordTimes[1][0] > 0.0 ? flMegaCoords / flCoordTimes[1][0] : 0.0, flCoordTimes[1][1] > 0.0 ? flMegaCoords / flCoordTimes[1][1] : 0.0);
+
+	return nMismatches == 0;
+}
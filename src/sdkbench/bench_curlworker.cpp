@@ -0,0 +1,109 @@
+//=============================================================================//
+//
+// Purpose: pooled HTTP request worker benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "tier2/curlworker.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: posts a number of requests to a server, once on a new handle each
+//			as done by blocking requests, and once through a worker, and
+//			reports the timings and connections opened; meant for a local
+//			mock server
+//
+//			Optional switches:
+//			-requests <count> ( requests per run, defaults to 200 )
+//			-timeout <seconds> ( transfer timeout, defaults to 15 )
+// Input  : &args - 
+// Output : true if all requests succeeded, false otherwise
+//-----------------------------------------------------------------------------
+bool SDKBench_CURLWorker(const CCommand& args)
+{
+	if (args.ArgC() < 3)
+	{
+		Error(eDLL_T::COMMON, NO_ERROR, "%s: no server address given\n", __FUNCTION__);
+		return false;
+	}
+
+	const char* const remote = args.Arg(2);
+	const int numRequests = Clamp(args.FindArgInt("-requests", 200), 1, 100000);
+
+	CURLParams params;
+
+	params.writeFunction = CURLWriteStringCallback;
+	params.timeout = Max(args.FindArgInt("-timeout", 15), 1);
+	params.verifyPeer = true;
+	params.failOnError = false;
+
+	curl_global_init(CURL_GLOBAL_ALL);
+
+	const char* const request = "{}";
+
+	// Blocking requests on a new handle each.
+	int numFailed = 0;
+	long numConnects = 0;
+
+	double startTime = Plat_FloatTime();
+
+	for (int i = 0; i < numRequests; i++)
+	{
+		string response;
+		curl_slist* slist = nullptr;
+
+		CURL* const curl = CURLInitRequest(remote, request, response, slist, params);
+
+		if (!curl)
+		{
+			curl_slist_free_all(slist);
+			numFailed++;
+
+			continue;
+		}
+
+		if (CURLSubmitRequest(curl, slist) != CURLE_OK)
+			numFailed++;
+
+		long connects = 0;
+		curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+		numConnects += connects;
+		curl_easy_cleanup(curl);
+	}
+
+	const double blockingTime = Plat_FloatTime() - startTime;
+
+	Msg(eDLL_T::COMMON, "Blocking: '%d' requests in '%.3f' seconds; '%d' failed, '%ld' connections opened\n",
+		numRequests, blockingTime, numFailed, numConnects);
+
+	// The same requests through the worker, all submitted at once.
+	CCURLWorker worker;
+
+	vector<std::future<CURLWorkerResult_s>> futures;
+	futures.reserve(numRequests);
+
+	startTime = Plat_FloatTime();
+
+	for (int i = 0; i < numRequests; i++)
+		futures.push_back(worker.Submit(remote, request, params));
+
+	int numWorkerFailed = 0;
+
+	for (std::future<CURLWorkerResult_s>& future : futures)
+	{
+		if (future.get().code != CURLE_OK)
+			numWorkerFailed++;
+	}
+
+	const double workerTime = Plat_FloatTime() - startTime;
+
+	Msg(eDLL_T::COMMON, "Worker: '%d' requests in '%.3f' seconds ('%.1fx'); '%d' failed, '%lld' connections opened, '%d' peak in flight\n",
+		numRequests, workerTime, workerTime > 0.0 ? blockingTime / workerTime : 0.0,
+		numWorkerFailed, worker.GetConnectCount(), worker.GetPeakInFlight());
+
+	worker.Shutdown();
+	curl_global_cleanup();
+
+	return numFailed == 0 && numWorkerFailed == 0;
+}
@@ -0,0 +1,287 @@
+//=============================================================================//
+//
+// Purpose: RCON length-prefix frame parser fuzzer and benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "engine/shared/base_rcon.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Records the frames parsed by either frame parser
+//-----------------------------------------------------------------------------
+class CNetConFrameRecorder : public CNetConBase
+{
+public:
+	CNetConFrameRecorder(void)
+		: m_nChecksum(0)
+		, m_nFrameCount(0)
+		, m_bDisconnected(false)
+	{}
+
+	virtual bool ProcessMessage(const char* pMsgBuf, int nMsgLen) override
+	{
+		// FNV-1a over the frame, folded into an order dependent checksum.
+		uint64_t nHash = 14695981039346656037ULL ^ uint64_t(nMsgLen);
+
+		for (int i = 0; i < nMsgLen; i++)
+		{
+			nHash = (nHash ^ uint8_t(pMsgBuf[i])) * 1099511628211ULL;
+		}
+
+		m_nChecksum = (m_nChecksum * 31) ^ nHash;
+		m_nFrameCount++;
+
+		return true;
+	}
+
+	virtual void Disconnect(const char* /*szReason*/) override
+	{
+		m_bDisconnected = true;
+	}
+
+	bool ProcessBufferReference(CConnectedNetConsoleData& data, const char* pRecvBuf, int nRecvLen, const int nMaxLen = SOCKET_ERROR);
+
+	uint64_t m_nChecksum;
+	int64_t  m_nFrameCount;
+	bool     m_bDisconnected;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: parses input response buffer using length-prefix framing, one
+//			byte at a time; this is the implementation 'ProcessBuffer()' replaced
+//			and is used as the reference it is verified against
+// Input  : &data - 
+//			*pRecvBuf - 
+//			nRecvLen - 
+//			nMaxLen - 
+// Output: true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CNetConFrameRecorder::ProcessBufferReference(CConnectedNetConsoleData& data, 
+	const char* pRecvBuf, int nRecvLen, const int nMaxLen)
+{
+	bool bSuccess = true;
+
+	while (nRecvLen > 0)
+	{
+		if (data.m_nPayloadLen)
+		{
+			if (data.m_nPayloadRead < data.m_nPayloadLen)
+			{
+				data.m_RecvBuffer[data.m_nPayloadRead++] = *pRecvBuf;
+
+				pRecvBuf++;
+				nRecvLen--;
+			}
+			if (data.m_nPayloadRead == data.m_nPayloadLen)
+			{
+				if (!ProcessMessage(
+					reinterpret_cast<const char*>(data.m_RecvBuffer.data()), data.m_nPayloadLen)
+					&& bSuccess)
+				{
+					bSuccess = false;
+				}
+
+				data.m_nPayloadLen = 0;
+				data.m_nPayloadRead = 0;
+			}
+		}
+		else if (data.m_nPayloadRead < sizeof(int)) // Read size field.
+		{
+			data.m_RecvBuffer[data.m_nPayloadRead++] = *pRecvBuf;
+
+			pRecvBuf++;
+			nRecvLen--;
+		}
+		else // Build prefix.
+		{
+			data.m_nPayloadLen = int(ntohl(*reinterpret_cast<u_long*>(&data.m_RecvBuffer[0])));
+			data.m_nPayloadRead = 0;
+
+			if (!data.m_bAuthorized && nMaxLen > -1)
+			{
+				if (data.m_nPayloadLen > nMaxLen)
+				{
+					Disconnect("overflow"); // Sending large messages while not authenticated.
+					return false;
+				}
+			}
+
+			if (data.m_nPayloadLen < 0 ||
+				data.m_nPayloadLen > data.m_RecvBuffer.max_size())
+			{
+				Error(eDLL_T::ENGINE, NO_ERROR, "RCON Cmd: sync error (%d)\n", data.m_nPayloadLen);
+				Disconnect("desync"); // Out of sync (irrecoverable).
+
+				return false;
+			}
+			else
+			{
+				data.m_RecvBuffer.resize(data.m_nPayloadLen);
+			}
+		}
+	}
+
+	return bSuccess;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: xorshift, the fuzzer must be reproducible across platforms
+//-----------------------------------------------------------------------------
+static uint32_t FrameParser_RandomInt(uint64_t& nState, const uint32_t nMin, const uint32_t nMax)
+{
+	nState ^= nState << 13;
+	nState ^= nState >> 7;
+	nState ^= nState << 17;
+
+	return nMin + uint32_t(nState % (uint64_t(nMax) - nMin + 1));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: builds a stream of length-prefixed frames
+// Input  : &vecStream - 
+//			&nState - 
+//			nFrames - 
+//			nMinFrameLen - 
+//			nMaxFrameLen - 
+//			bCorrupt - whether to corrupt a size field
+//-----------------------------------------------------------------------------
+static void FrameParser_BuildFrameStream(vector<char>& vecStream, uint64_t& nState, const int nFrames,
+	const int nMinFrameLen, const int nMaxFrameLen, const bool bCorrupt)
+{
+	vecStream.clear();
+	const int nCorruptFrame = bCorrupt ? int(FrameParser_RandomInt(nState, 0, nFrames - 1)) : -1;
+
+	for (int i = 0; i < nFrames; i++)
+	{
+		const int nFrameLen = int(FrameParser_RandomInt(nState, nMinFrameLen, nMaxFrameLen));
+		const u_long nNetLen = htonl(i == nCorruptFrame ? u_long(0x80000000 | nFrameLen) : u_long(nFrameLen));
+
+		const size_t nOffset = vecStream.size();
+		vecStream.resize(nOffset + sizeof(u_long) + nFrameLen);
+
+		memcpy(&vecStream[nOffset], &nNetLen, sizeof(u_long));
+
+		for (int j = 0; j < nFrameLen; j++)
+		{
+			vecStream[nOffset + sizeof(u_long) + j] = char(FrameParser_RandomInt(nState, 0, 255));
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: feeds a stream to a frame parser in chunks
+// Input  : &recorder - 
+//			&vecStream - 
+//			bReference - 
+//			*pChunkSizes - chunk sizes to cycle through
+//			nChunkSizes - 
+//			nMaxLen - 
+//-----------------------------------------------------------------------------
+static void FrameParser_FeedFrameStream(CNetConFrameRecorder& recorder, const vector<char>& vecStream,
+	const bool bReference, const int* pChunkSizes, const int nChunkSizes, const int nMaxLen)
+{
+	CConnectedNetConsoleData data;
+
+	int nOffset = 0;
+	int nChunk = 0;
+
+	while (nOffset < int(vecStream.size()) && !recorder.m_bDisconnected)
+	{
+		const int nChunkLen = Min(pChunkSizes[nChunk++ % nChunkSizes], int(vecStream.size()) - nOffset);
+
+		if (bReference)
+			recorder.ProcessBufferReference(data, &vecStream[nOffset], nChunkLen, nMaxLen);
+		else
+			recorder.ProcessBuffer(data, &vecStream[nOffset], nChunkLen, nMaxLen);
+
+		nOffset += nChunkLen;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: verifies the frame parser against the reference implementation on
+//			random streams and chunkings, then measures the throughput of both
+//
+//			Optional switches:
+//			-iterations <count> ( passes per parser, defaults to 8 )
+//			-fuzz <count> ( random streams to verify, defaults to 1000 )
+// Input  : &args - 
+// Output : true if the parsers agree on all fuzzed streams
+//-----------------------------------------------------------------------------
+bool SDKBench_FrameParser(const CCommand& args)
+{
+	const int nIterations = Max(args.FindArgInt("-iterations", 8), 1);
+	const int nFuzzRounds = Max(args.FindArgInt("-fuzz", 1000), 0);
+
+	uint64_t nState = 0x9E3779B97F4A7C15ULL;
+	vector<char> vecStream;
+
+	int nMismatches = 0;
+
+	for (int i = 0; i < nFuzzRounds; i++)
+	{
+		const bool bCorrupt = FrameParser_RandomInt(nState, 0, 15) == 0;
+		const int nMaxLen = FrameParser_RandomInt(nState, 0, 1) ? int(FrameParser_RandomInt(nState, 0, 4096)) : SOCKET_ERROR;
+
+		// Frames are at least as large as the size field, as the reference parser
+		// writes the next size field into the previous frame's buffer.
+		FrameParser_BuildFrameStream(vecStream, nState, int(FrameParser_RandomInt(nState, 1, 64)), sizeof(u_long), 4096, bCorrupt);
+
+		int chunkSizes[16];
+		for (int j = 0; j < int(SDK_ARRAYSIZE(chunkSizes)); j++)
+		{
+			chunkSizes[j] = int(FrameParser_RandomInt(nState, 1, j & 1 ? 8 : 8192));
+		}
+
+		CNetConFrameRecorder reference;
+		CNetConFrameRecorder recorder;
+
+		FrameParser_FeedFrameStream(reference, vecStream, true, chunkSizes, int(SDK_ARRAYSIZE(chunkSizes)), nMaxLen);
+		FrameParser_FeedFrameStream(recorder, vecStream, false, chunkSizes, int(SDK_ARRAYSIZE(chunkSizes)), nMaxLen);
+
+		if (reference.m_nChecksum != recorder.m_nChecksum ||
+			reference.m_nFrameCount != recorder.m_nFrameCount ||
+			reference.m_bDisconnected != recorder.m_bDisconnected)
+		{
+			Error(eDLL_T::ENGINE, NO_ERROR, "Frame parser mismatch in fuzz round '%d' ('%lld' vs '%lld' frames)\n",
+				i, recorder.m_nFrameCount, reference.m_nFrameCount);
+
+			nMismatches++;
+		}
+	}
+
+	if (nFuzzRounds)
+	{
+		Msg(eDLL_T::ENGINE, "Frame parser fuzzed '%d' rounds with '%d' mismatches\n", nFuzzRounds, nMismatches);
+	}
+
+	// Console log sized frames, received in chunks as small as the client's
+	// receive buffer and as large as the I/O thread's.
+	FrameParser_BuildFrameStream(vecStream, nState, 65536, 32, 512, false);
+	const int chunkSizes[] = { 1024, 65536 };
+
+	for (int i = 0; i < int(SDK_ARRAYSIZE(chunkSizes)); i++)
+	{
+		double flTimes[2] = { 0.0, 0.0 };
+
+		for (int j = 0; j < nIterations; j++)
+		{
+			for (int k = 0; k < 2; k++)
+			{
+				CNetConFrameRecorder recorder;
+				const double flStart = Plat_FloatTime();
+
+				FrameParser_FeedFrameStream(recorder, vecStream, k == 1, &chunkSizes[i], 1, SOCKET_ERROR);
+				flTimes[k] += Plat_FloatTime() - flStart;
+			}
+		}
+
+		const double flMegaBytes = double(vecStream.size()) * nIterations / (1024.0 * 1024.0);
+
+		Msg(eDLL_T::ENGINE, "Frame parser with '%d' byte chunks: '%.1f' MiB/s (reference: '%.1f' MiB/s)\n",
+			chunkSizes[i], flTimes[0] > 0.0 ? flMegaBytes / flTimes[0] : 0.0, flTimes[1] > 0.0 ? flMegaBytes / flTimes[1] : 0.0);
+	}
+
+	return nMismatches == 0;
+}
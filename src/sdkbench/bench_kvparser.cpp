@@ -0,0 +1,246 @@
+//=============================================================================//
+//
+// Purpose: KeyValues text parser verification and benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "tier0/threadtools.h"
+#include "tier1/keyvalues.h"
+#include "tier1/kvtokenreader.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: generates a KeyValues file laid out like the playlists file
+// Input  : &text - 
+//			nTargetSize - 
+//-----------------------------------------------------------------------------
+static void KeyValues_GenerateBenchmarkText(CUtlBuffer& text, const int nTargetSize)
+{
+	uint32 nState = 0x2545F491u;
+	const auto nextRandom = [&nState]() -> uint32
+	{
+		nState ^= nState << 13;
+		nState ^= nState >> 17;
+		nState ^= nState << 5;
+		return nState;
+	};
+
+	// Files reuse a limited set of key names; the vars are where most of
+	// the keys are, with a mix of integers, floats and (quoted) strings.
+	const auto writeVars = [&](const int nCount)
+	{
+		text.Printf("\t\t\tvars\n\t\t\t{\n");
+
+		for (int i = 0; i < nCount; i++)
+		{
+			const uint32 nRandom = nextRandom();
+			const int nVar = int(nRandom % 384);
+
+			if ((nRandom >> 12) % 16 == 0)
+				text.Printf("\t\t\t\t//// Setting group %d\n", nVar);
+
+			switch ((nRandom >> 16) % 5)
+			{
+			case 0:
+				text.Printf("\t\t\t\tgamemode_var_%d\t\t\t\t\t%d\n", nVar, int(nRandom >> 20));
+				break;
+			case 1:
+				text.Printf("\t\t\t\tgamemode_var_%d\t\t\t\t\t%.2f\n", nVar, float(nRandom >> 20) / 100.0f);
+				break;
+			case 2:
+				text.Printf("\t\t\t\tgamemode_var_%d\t\t\t\t\t\"#PL_desc_%d\"\n", nVar, int(nRandom >> 24));
+				break;
+			case 3:
+				text.Printf("\t\t\t\t\"gamemode_var_%d\"\t\t\t\t\t\"\"\n", nVar);
+				break;
+			default:
+				text.Printf("\t\t\t\tgamemode_var_%d\t\t\t\t\tmp_rr_map_%d\n", nVar, int(nRandom >> 28));
+				break;
+			}
+		}
+
+		text.Printf("\t\t\t}\n");
+	};
+
+	text.Printf("playlists\n{\n\tversion stable\n\tversionNum 229\n\tGamemodes\n\t{\n");
+
+	for (int i = 0; i < 4; i++)
+	{
+		text.Printf("\t\tgamemode_%d\n\t\t{\n\t\t\tinherit defaults\n", i);
+		writeVars(64);
+		text.Printf("\t\t}\n");
+	}
+
+	text.Printf("\t}\n\tPlaylists\n\t{\n");
+
+	for (int i = 0; text.TellPut() < nTargetSize; i++)
+	{
+		text.Printf("\t\tplaylist_%d\n\t\t{\n\t\t\tinherit gamemode_%d\n", i, i % 4);
+		writeVars(24);
+		text.Printf("\t\t\tgamemodes\n\t\t\t{\n\t\t\t\tgamemode_%d\n\t\t\t\t{\n\t\t\t\t\tmaps\n\t\t\t\t\t{\n"
+			"\t\t\t\t\t\tmp_rr_map_%d 1\n\t\t\t\t\t}\n\t\t\t\t}\n\t\t\t}\n\t\t}\n", i % 4, i % 16);
+	}
+
+	text.Printf("\t}\n}\n");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares two trees including their peers
+// Input  : *pA - 
+//			*pB - 
+// Output : true if both have the same keys, types and values
+//-----------------------------------------------------------------------------
+static bool KeyValues_IsSameTree(const KeyValues* pA, const KeyValues* pB)
+{
+	for (; pA && pB; pA = pA->m_pPeer, pB = pB->m_pPeer)
+	{
+		if (pA->GetNameSymbolCaseSensitive() != pB->GetNameSymbolCaseSensitive() ||
+			pA->GetNameSymbol() != pB->GetNameSymbol() ||
+			pA->m_iDataType != pB->m_iDataType)
+			return false;
+
+		switch (pA->m_iDataType)
+		{
+		case TYPE_STRING:
+			if (V_strcmp(pA->m_sValue, pB->m_sValue) != 0)
+				return false;
+			break;
+		case TYPE_INT:
+			if (pA->m_iValue != pB->m_iValue)
+				return false;
+			break;
+		case TYPE_FLOAT:
+			if (memcmp(&pA->m_flValue, &pB->m_flValue, sizeof(float)) != 0)
+				return false;
+			break;
+		case TYPE_UINT64:
+			if (*(uint64*)pA->m_sValue != *(uint64*)pB->m_sValue)
+				return false;
+			break;
+		default:
+			break;
+		}
+
+		if (!KeyValues_IsSameTree(pA->m_pSub, pB->m_pSub))
+			return false;
+	}
+
+	return pA == pB;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: verifies that the direct token reader builds the same trees as the
+//			buffered one, then measures how fast files of the playlists file's
+//			size are loaded on several threads; the reference loads them the
+//			way the loader used to: buffered, with a symbol table lookup per key
+//			and one load at a time
+//
+//			Optional switches:
+//			-threads <count> ( max loading threads, defaults to 8 )
+//			-files <count> ( files loaded per thread, defaults to 200 )
+// Input  : &args - 
+// Output : true if both readers built the same trees
+//-----------------------------------------------------------------------------
+bool SDKBench_KVParser(const CCommand& args)
+{
+	const int nThreads = Clamp(args.FindArgInt("-threads", 8), 1, 64);
+	const int nFiles = Max(args.FindArgInt("-files", 200), 1);
+
+	// Size of the stock playlists file.
+	const int nTargetSize = 52 * 1024;
+
+	CUtlBuffer text(0, nTargetSize + 4096, CUtlBuffer::TEXT_BUFFER);
+	KeyValues_GenerateBenchmarkText(text, nTargetSize);
+
+	const char* const pText = (const char*)text.Base();
+	const int nTextSize = int(text.TellPut());
+
+	CThreadFastMutex referenceMutex;
+
+	const auto loadFile = [&](const char* const pData, const int nDataSize, const bool bReference, bool& bLoaded) -> KeyValues*
+	{
+		CUtlBuffer buf(pData, nDataSize, CUtlBuffer::READ_ONLY | CUtlBuffer::TEXT_BUFFER);
+		KeyValues* const pKV = new KeyValues("playlists");
+
+		if (bReference)
+		{
+			AUTO_LOCK(referenceMutex);
+
+			CKeyValuesTokenReader tokenReader(pKV, buf, false);
+			bLoaded = pKV->LoadFromTokenReader("benchmark", tokenReader, buf, nullptr, nullptr, nullptr);
+		}
+		else
+		{
+			CKeyValuesTokenReader tokenReader(pKV, buf, true);
+			bLoaded = pKV->LoadFromTokenReader("benchmark", tokenReader, buf, nullptr, nullptr, nullptr);
+		}
+
+		return pKV;
+	};
+
+	// Compare the trees of the generated file, and of files cut off at
+	// random points so the end of input handling is covered as well; the
+	// latter report parse errors.
+	const int nRounds = 16;
+
+	int nMismatches = 0;
+	uint32 nState = 0x9E3779B9u;
+
+	for (int i = 0; i < nRounds; i++)
+	{
+		nState = nState * 1664525u + 1013904223u;
+		const int nSize = i ? int((nState >> 8) % uint32(nTextSize)) : nTextSize;
+
+		bool bReferenceLoaded;
+		bool bDirectLoaded;
+
+		KeyValues* const pReference = loadFile(pText, nSize, true, bReferenceLoaded);
+		KeyValues* const pDirect = loadFile(pText, nSize, false, bDirectLoaded);
+
+		if (bReferenceLoaded != bDirectLoaded || !KeyValues_IsSameTree(pReference, pDirect))
+			nMismatches++;
+
+		pReference->DeleteThis();
+		pDirect->DeleteThis();
+	}
+
+	Msg(eDLL_T::COMMON, "Token readers built '%d' trees with '%d' mismatches\n", nRounds, nMismatches);
+
+	const auto runLoads = [&](const int nThreadCount, const bool bReference) -> double
+	{
+		std::vector<std::thread> threads;
+		const double flStart = Plat_FloatTime();
+
+		for (int t = 0; t < nThreadCount; t++)
+		{
+			threads.emplace_back([&]()
+				{
+					bool bLoaded;
+
+					for (int i = 0; i < nFiles; i++)
+					{
+						loadFile(pText, nTextSize, bReference, bLoaded)->DeleteThis();
+					}
+				});
+		}
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		const double flElapsed = Plat_FloatTime() - flStart;
+		return flElapsed > 0.0 ? (double(nTextSize) * nFiles * nThreadCount) / flElapsed / (1024.0 * 1024.0) : 0.0;
+	};
+
+	for (int nCount = 1; nCount <= nThreads; nCount *= 2)
+	{
+		const double flDirect = runLoads(nCount, false);
+		const double flReference = runLoads(nCount, true);
+
+		Msg(eDLL_T::COMMON, "Loaded '%d' KiB files on '%d' thread(s): '%.1f' MiB/s (reference: '%.1f' MiB/s)\n",
+			nTextSize / 1024, nCount, flDirect, flReference);
+	}
+
+	return nMismatches == 0;
+}
@@ -0,0 +1,183 @@
+//=============================================================================//
+//
+// Purpose: KeyValues symbol table concurrency test and benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "tier0/threadtools.h"
+#include "vstdlib/keyvaluessystem.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: runs lookups of random names from multiple threads on a symbol
+//			table, optionally serializing them through a mutex the way every
+//			lookup used to be
+// Input  : &system - 
+//			&names - 
+//			nThreads - 
+//			nLookups - lookups per thread
+//			bLocked - 
+// Output : lookups per second
+//-----------------------------------------------------------------------------
+static double KVSymbols_RunLookups(CKeyValuesSystem& system, const CUtlVector<CUtlString>& names,
+	const int nThreads, const int nLookups, const bool bLocked)
+{
+	CThreadMutex mutex;
+	std::atomic<int> nMisses(0);
+
+	std::vector<std::thread> threads;
+	const double flStart = Plat_FloatTime();
+
+	for (int t = 0; t < nThreads; t++)
+	{
+		threads.emplace_back([&, t]()
+			{
+				uint32 nState = 0x9E3779B9u * uint32(t + 1);
+				int nThreadMisses = 0;
+
+				for (int i = 0; i < nLookups; i++)
+				{
+					nState = nState * 1664525u + 1013904223u;
+					const char* const pName = names[int((nState >> 8) % uint32(names.Count()))].String();
+
+					HKeySymbol symbol;
+
+					if (bLocked)
+					{
+						AUTO_LOCK(mutex);
+						symbol = system.GetSymbolForString(pName, false);
+					}
+					else
+					{
+						symbol = system.GetSymbolForString(pName, false);
+					}
+
+					if (symbol == INVALID_KEY_SYMBOL)
+						nThreadMisses++;
+				}
+
+				nMisses += nThreadMisses;
+			});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	const double flElapsed = Plat_FloatTime() - flStart;
+
+	if (nMisses)
+	{
+		Error(eDLL_T::COMMON, NO_ERROR, "Symbol table lost '%d' symbols during lookups\n", nMisses.load());
+	}
+
+	return flElapsed > 0.0 ? double(nThreads) * nLookups / flElapsed : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: verifies that symbols created concurrently are unique and stable
+//			while the table grows, then measures the lookup throughput with
+//			and without serializing the lookups through a mutex
+//
+//			Optional switches:
+//			-threads <count> ( max lookup threads, defaults to 8 )
+//			-lookups <count> ( lookups per thread, defaults to 1000000 )
+// Input  : &args - 
+// Output : true if all threads agreed on all symbols
+//-----------------------------------------------------------------------------
+bool SDKBench_KVSymbols(const CCommand& args)
+{
+	const int nThreads = Clamp(args.FindArgInt("-threads", 8), 1, 64);
+	const int nLookups = Max(args.FindArgInt("-lookups", 1000000), 1);
+
+	CKeyValuesSystem system;
+	CUtlVector<CUtlString> names;
+
+	// Names of the sizes found in typical KeyValues files, in various
+	// capitalizations; lookups are case insensitive.
+	for (int i = 0; i < 2048; i++)
+	{
+		CUtlString name;
+		name.Format("%s_%d", (i & 1) ? "BenchKeyName" : "benchkeyname", i);
+
+		system.GetSymbolForString(name.String(), true);
+		names.AddToTail(name);
+
+		name.ToUpper();
+		names.AddToTail(name);
+	}
+
+	// Every thread creates the same names concurrently, each with its own
+	// capitalization; enough to make the table grow while doing so.
+	const int nSharedNames = KEYVALUES_SYMBOL_TABLE_INITIAL_SIZE;
+
+	std::vector<std::vector<HKeySymbol>> results(nThreads);
+	std::vector<std::thread> threads;
+
+	std::atomic<int> nCaseErrors(0);
+
+	for (int t = 0; t < nThreads; t++)
+	{
+		threads.emplace_back([&, t]()
+			{
+				std::vector<HKeySymbol>& symbols = results[t];
+				symbols.resize(nSharedNames);
+
+				char szName[64];
+
+				for (int i = 0; i < nSharedNames; i++)
+				{
+					const int nLen = snprintf(szName, sizeof(szName), "benchshared_%d", i);
+
+					// Give each thread its own capitalization of the name.
+					if (t & 1)
+						szName[t % nLen] = char(toupper(szName[t % nLen]));
+
+					HKeySymbol hCaseInsensitive = INVALID_KEY_SYMBOL;
+					const HKeySymbol hCaseSensitive = system.GetSymbolForStringCaseSensitive(hCaseInsensitive, szName, true);
+
+					symbols[i] = system.GetSymbolForString(szName, true);
+
+					if (hCaseInsensitive != symbols[i] || strcmp(system.GetStringForSymbol(hCaseSensitive), szName) != 0)
+						nCaseErrors++;
+				}
+			});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	int nMismatches = nCaseErrors;
+	char szName[64];
+
+	for (int i = 0; i < nSharedNames; i++)
+	{
+		snprintf(szName, sizeof(szName), "benchshared_%d", i);
+
+		for (int t = 0; t < nThreads; t++)
+		{
+			if (results[t][i] != results[0][i] || stricmp(system.GetStringForSymbol(results[t][i]), szName) != 0)
+			{
+				nMismatches++;
+				break;
+			}
+		}
+	}
+
+	Msg(eDLL_T::COMMON, "Symbol table created '%d' names from '%d' threads with '%d' mismatches\n",
+		nSharedNames, nThreads, nMismatches);
+
+	for (int nCount = 1; nCount <= nThreads; nCount *= 2)
+	{
+		const double flLockFree = KVSymbols_RunLookups(system, names, nCount, nLookups, false);
+		const double flLocked = KVSymbols_RunLookups(system, names, nCount, nLookups, true);
+
+		Msg(eDLL_T::COMMON, "Symbol lookups with '%d' thread(s): '%.2f' M/s (locked: '%.2f' M/s)\n",
+			nCount, flLockFree / 1000000.0, flLocked / 1000000.0);
+	}
+
+	return nMismatches == 0;
+}
@@ -0,0 +1,221 @@
+//=============================================================================//
+//
+// Purpose: batched signature scanner verification and benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "tier0/utility.h"
+#include "tier0/patternscan.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: verifies the batched scanner against the single pattern scan on
+//			patterns sampled from the memory, and reports the scan times
+// Input  : *pData -
+//			nSize -
+//			nPatterns - number of patterns to scan for
+//			nThreads - max number of threads to scan on
+// Output : true if all results matched
+//-----------------------------------------------------------------------------
+static bool PatternScan_RunBenchmark(const uint8_t* const pData, const size_t nSize, const int nPatterns, const int nThreads)
+{
+	if (nSize < 64)
+	{
+		Error(eDLL_T::COMMON, NO_ERROR, "%s: need at least 64 bytes to scan\n", __FUNCTION__);
+		return false;
+	}
+
+	// Sample signature like patterns from the memory; instruction bytes with
+	// some wildcards in between for displacements. Every fourth pattern gets
+	// a byte changed so it's likely absent, which makes it scan everything.
+	vector<string> patterns;
+	patterns.reserve(nPatterns);
+
+	uint32_t nState = 0x9E3779B9u;
+	const auto nextRandom = [&nState]() -> uint32_t
+	{
+		nState = nState * 1664525u + 1013904223u;
+		return nState >> 8;
+	};
+
+	for (int i = 0; i < nPatterns; i++)
+	{
+		const size_t nLength = 12 + nextRandom() % 29;
+		const size_t nOffset = nextRandom() % (nSize - nLength);
+		const bool bAbsent = (i % 4) == 3;
+
+		string pattern;
+
+		for (size_t j = 0; j < nLength; j++)
+		{
+			uint8_t nByte = pData[nOffset + j];
+
+			if (bAbsent && j == nLength / 2)
+				nByte ^= 0x5A;
+
+			if (j && (nextRandom() % 5) == 0)
+				pattern += "?? ";
+			else
+				pattern += Format("%02X ", nByte);
+		}
+
+		pattern.pop_back();
+		patterns.push_back(std::move(pattern));
+	}
+
+	// Single pattern scans, as done for each signature on a cache miss.
+	vector<const uint8_t*> expected(nPatterns, nullptr);
+	double flStart = Plat_FloatTime();
+
+	for (int i = 0; i < nPatterns; i++)
+	{
+		const pair<vector<uint8_t>, string> patternInfo = PatternToMaskedBytes(patterns[i].c_str());
+
+		// Pad as the single scan compares whole chunks.
+		vector<uint8_t> bytes = patternInfo.first;
+		bytes.resize((bytes.size() + 15) / 16 * 16 + 16, 0);
+
+		expected[i] = PatternScan_FindSIMD(pData, nSize, bytes.data(), patternInfo.second.c_str());
+	}
+
+	const double flSingle = Plat_FloatTime() - flStart;
+
+	Msg(eDLL_T::COMMON, "Single pattern scans: '%d' patterns over '%zu' KiB in '%.3f' seconds\n",
+		nPatterns, nSize / 1024, flSingle);
+
+	int nMismatches = 0;
+
+	for (int nCount = 1; nCount <= nThreads; nCount *= 2)
+	{
+		CPatternScanner scanner;
+
+		for (const string& pattern : patterns)
+		{
+			scanner.AddPattern(pattern.c_str());
+		}
+
+		flStart = Plat_FloatTime();
+		scanner.Scan(pData, nSize, nCount);
+
+		const double flBatched = Plat_FloatTime() - flStart;
+
+		for (int i = 0; i < nPatterns; i++)
+		{
+			if (scanner.GetResult(i) != expected[i])
+				nMismatches++;
+		}
+
+		Msg(eDLL_T::COMMON, "Batched scan on '%d' thread(s): '%.3f' seconds ('%.1fx', '%d' unanchored)\n",
+			nCount, flBatched, flBatched > 0.0 ? flSingle / flBatched : 0.0, scanner.GetUnanchoredCount());
+	}
+
+	int nFound = 0;
+
+	for (const uint8_t* const pResult : expected)
+	{
+		if (pResult)
+			nFound++;
+	}
+
+	Msg(eDLL_T::COMMON, "Found '%d' of '%d' patterns; '%d' mismatches\n", nFound, nPatterns, nMismatches);
+	return nMismatches == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: runs the pattern scan benchmark on memory captured to a file
+// Input  : *pszBlobFile -
+//			nPatterns -
+//			nThreads -
+// Output : true if all results matched
+//-----------------------------------------------------------------------------
+static bool PatternScan_RunBenchmarkFile(const char* const pszBlobFile, const int nPatterns, const int nThreads)
+{
+	FILE* const pFile = fopen(pszBlobFile, "rb");
+
+	if (!pFile)
+	{
+		Error(eDLL_T::COMMON, NO_ERROR, "%s: failed to open \"%s\"\n", __FUNCTION__, pszBlobFile);
+		return false;
+	}
+
+	vector<uint8_t> blob;
+	uint8_t buf[0x10000];
+	size_t nRead;
+
+	while ((nRead = fread(buf, 1, sizeof(buf), pFile)) > 0)
+	{
+		blob.insert(blob.end(), buf, buf + nRead);
+	}
+
+	fclose(pFile);
+
+	// The single pattern scan reads whole chunks, which can run up to 15
+	// bytes past the end.
+	const size_t nSize = blob.size();
+	blob.resize(nSize + 16, 0);
+
+	return PatternScan_RunBenchmark(blob.data(), nSize, nPatterns, nThreads);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: verifies the batched scanner against single pattern scans on
+//			patterns sampled from a code section, and reports the scan times;
+//			scans the code of this tool unless told otherwise
+//
+//			Optional switches:
+//			-patterns <count> ( sampled patterns, defaults to 500 )
+//			-threads <count> ( max scan threads, defaults to 8 )
+//			-module <file> ( scan the code section of an executable image )
+//			-blob <file> ( scan the raw contents of a file )
+// Input  : &args - 
+// Output : true if all results matched
+//-----------------------------------------------------------------------------
+bool SDKBench_PatternScan(const CCommand& args)
+{
+	const int nPatterns = Clamp(args.FindArgInt("-patterns", 500), 1, 100000);
+	const int nThreads = Clamp(args.FindArgInt("-threads", 8), 1, 64);
+
+	const char* const pszBlobFile = args.FindArg("-blob");
+
+	if (pszBlobFile)
+		return PatternScan_RunBenchmarkFile(pszBlobFile, nPatterns, nThreads);
+
+	const char* const pszModuleFile = args.FindArg("-module");
+	HMODULE hModule = GetModuleHandleA(nullptr);
+
+	if (pszModuleFile)
+	{
+		// Mapped as an image, so the sections are laid out as they are in
+		// the game; no code of it is run, nor are its imports resolved.
+		hModule = LoadLibraryExA(pszModuleFile, nullptr, LOAD_LIBRARY_AS_IMAGE_RESOURCE);
+
+		if (!hModule)
+		{
+			Error(eDLL_T::COMMON, NO_ERROR, "%s: failed to map \"%s\" (error: '%lu')\n",
+				__FUNCTION__, pszModuleFile, GetLastError());
+			return false;
+		}
+	}
+
+	// Image resource mappings are tagged in the low bits of the handle.
+	const CModule module(reinterpret_cast<QWORD>(hModule) & ~QWORD(3));
+	const CModule::ModuleSectionsMap_t& sections = module.GetSections();
+
+	const auto it = sections.find(".text");
+	bool bResult = false;
+
+	if (it != sections.end() && it->second.IsSectionValid())
+	{
+		bResult = PatternScan_RunBenchmark(reinterpret_cast<const uint8_t*>(it->second.m_pSectionBase),
+			it->second.m_nSectionSize, nPatterns, nThreads);
+	}
+	else
+	{
+		Error(eDLL_T::COMMON, NO_ERROR, "%s: image has no code section\n", __FUNCTION__);
+	}
+
+	if (pszModuleFile)
+		FreeLibrary(hModule);
+
+	return bResult;
+}
@@ -0,0 +1,182 @@
+//=============================================================================//
+//
+// Purpose: work-stealing thread pool verification and benchmark
+//
+//=============================================================================//
+#include "core/stdafx.h"
+#include "tier0/threadpool.h"
+#include "mathlib/parallel_for.h"
+#include "sdkbench.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: the former parallel_for, which started a thread per logical
+//			processor on each call and split the range in equal parts
+// Input  : nElements -
+//			&functor  -
+//-----------------------------------------------------------------------------
+static void ThreadPool_SpawnFor(const unsigned nElements, const std::function<void(int, int)>& functor)
+{
+	const unsigned nThreadsHint = std::thread::hardware_concurrency();
+	const unsigned nThreads = nThreadsHint == 0 ? 8 : nThreadsHint;
+
+	const unsigned nBatchSize = nElements / nThreads;
+	const unsigned nBatchRemainder = nElements % nThreads;
+
+	vector<std::thread> threads(nThreads);
+
+	for (unsigned i = 0; i < nThreads; i++)
+	{
+		const int nStart = i * nBatchSize;
+		threads[i] = std::thread(functor, nStart, nStart + nBatchSize);
+	}
+
+	const int nStart = nThreads * nBatchSize;
+	functor(nStart, nStart + nBatchRemainder);
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: busy work for the benchmark, costs roughly 'nCost' multiplies
+// Input  : nIndex -
+//			nCost  -
+//-----------------------------------------------------------------------------
+static uint64_t ThreadPool_BenchWork(const unsigned nIndex, const unsigned nCost)
+{
+	uint64_t nValue = nIndex + 1;
+
+	for (unsigned i = 0; i < nCost; i++)
+		nValue = (nValue ^ (nValue >> 29)) * 0xBF58476D1CE4E5B9ull;
+
+	return nValue;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares the pool against spawning threads per call, on evenly
+//			and unevenly distributed work, and verifies the results
+//
+//			Optional switches:
+//			-elements <count> ( elements per loop, defaults to 1000000 )
+//			-iterations <count> ( runs per variant, defaults to 5 )
+// Input  : &args - 
+// Output : true if all variants computed the same results, false otherwise
+//-----------------------------------------------------------------------------
+bool SDKBench_ThreadPool(const CCommand& args)
+{
+	const int nElements = Clamp(args.FindArgInt("-elements", 1000000), 1, 100000000);
+	const int nIterations = Clamp(args.FindArgInt("-iterations", 5), 1, 1000);
+
+	struct Workload_s
+	{
+		const char* pszName;
+		unsigned (*pfnCost)(const unsigned nIndex, const unsigned nCount);
+	};
+
+	// All workloads average about 256 multiplies per element.
+	static const Workload_s s_Workloads[] =
+	{
+		{ "uniform", [](const unsigned nIndex, const unsigned nCount) { return 256u; } },
+		{ "ramp",    [](const unsigned nIndex, const unsigned nCount) { return unsigned(uint64_t(nIndex) * 512 / nCount); } },
+		{ "hotspot", [](const unsigned nIndex, const unsigned nCount) { return nIndex < nCount / 16 ? 3856u : 16u; } },
+	};
+
+	const unsigned nCount = unsigned(Max(nElements, 1));
+	const int nRuns = Max(nIterations, 1);
+
+	vector<uint64_t> expected(nCount);
+	vector<uint64_t> results(nCount);
+
+	const auto timeBest = [nRuns](const std::function<void()>& run)
+	{
+		double flBest = 0.0;
+
+		for (int i = 0; i < nRuns; i++)
+		{
+			const double flStart = Plat_FloatTime();
+			run();
+
+			const double flTime = Plat_FloatTime() - flStart;
+			flBest = i ? Min(flBest, flTime) : flTime;
+		}
+
+		return flBest;
+	};
+
+	Msg(eDLL_T::COMMON, "Thread pool: '%d' threads; '%u' elements; best of '%d' runs\n",
+		g_ThreadPool.GetNumThreads(), nCount, nRuns);
+
+	int nMismatches = 0;
+
+	for (const Workload_s& workload : s_Workloads)
+	{
+		const auto work = [&](vector<uint64_t>& out)
+		{
+			return [&workload, &out, nCount](const int nStart, const int nEnd)
+			{
+				for (int i = nStart; i < nEnd; i++)
+					out[i] = ThreadPool_BenchWork(unsigned(i), workload.pfnCost(unsigned(i), nCount));
+			};
+		};
+
+		const double flSerial = timeBest([&]() { work(expected)(0, int(nCount)); });
+
+		const double flSpawn = timeBest([&]() { ThreadPool_SpawnFor(nCount, work(results)); });
+		nMismatches += expected != results;
+
+		const double flPool = timeBest([&]() { parallel_for(nCount, work(results)); });
+		nMismatches += expected != results;
+
+		Msg(eDLL_T::COMMON, "%-8s serial: '%.3f' ms; spawned threads: '%.3f' ms ('%.1fx'); pool: '%.3f' ms ('%.1fx')\n",
+			workload.pszName, flSerial * 1000.0, flSpawn * 1000.0, flSerial / flSpawn, flPool * 1000.0, flSerial / flPool);
+	}
+
+	// The results of the last workload are summed, and recomputed in two
+	// nested loops at once.
+	uint64_t nExpectedSum = 0;
+
+	for (const uint64_t nValue : expected)
+		nExpectedSum += nValue;
+
+	const uint64_t nSum = parallel_reduce(nCount, uint64_t(0),
+		[&expected](const int nStart, const int nEnd)
+		{
+			uint64_t nPartial = 0;
+
+			for (int i = nStart; i < nEnd; i++)
+				nPartial += expected[i];
+
+			return nPartial;
+		},
+		[](const uint64_t a, const uint64_t b) { return a + b; });
+
+	nMismatches += nSum != nExpectedSum;
+
+	std::fill(results.begin(), results.end(), 0);
+	const unsigned nHalf = nCount / 2;
+
+	parallel_invoke(
+		[&]()
+		{
+			parallel_for(nHalf, [&](const int nStart, const int nEnd)
+				{
+					for (int i = nStart; i < nEnd; i++)
+						results[i] = ThreadPool_BenchWork(unsigned(i), s_Workloads[2].pfnCost(unsigned(i), nCount));
+				});
+		},
+		[&]()
+		{
+			parallel_for(nCount - nHalf, [&](const int nStart, const int nEnd)
+				{
+					for (int i = nStart; i < nEnd; i++)
+						results[nHalf + i] = ThreadPool_BenchWork(nHalf + unsigned(i), s_Workloads[2].pfnCost(nHalf + unsigned(i), nCount));
+				});
+		});
+
+	nMismatches += expected != results;
+
+	Msg(eDLL_T::COMMON, "Ran '%lld' tasks, '%lld' stolen; '%d' mismatches\n",
+		g_ThreadPool.GetTaskCount(), g_ThreadPool.GetStealCount(), nMismatches);
+
+	return nMismatches == 0;
+}
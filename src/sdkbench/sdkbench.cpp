@@ -0,0 +1,163 @@
+//=============================================================================//
+//
+// Purpose: Standalone benchmarks and fuzzers for SDK library routines
+//
+//=============================================================================//
+#include "core/logdef.h"
+#include "core/logger.h"
+#include "tier0/cpu.h"
+#include "tier0/threadpool.h"
+#include "tier1/cmd.h"
+#include "windows/console.h"
+#include "vstdlib/keyvaluessystem.h"
+#include "filesystem/filesystem_std.h"
+#include "sdkbench.h"
+
+static CKeyValuesSystem s_KeyValuesSystem;
+static CFileSystem_Stdio s_FullFileSystem;
+static bool s_bUseAnsiColors = true;
+
+//-----------------------------------------------------------------------------
+// Purpose: keyvalues singleton accessor
+//-----------------------------------------------------------------------------
+IKeyValuesSystem* KeyValuesSystem()
+{
+	return &s_KeyValuesSystem;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: filesystem singleton accessor
+//-----------------------------------------------------------------------------
+CFileSystem_Stdio* FileSystem()
+{
+	return &s_FullFileSystem;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark suites selectable from the command line
+//-----------------------------------------------------------------------------
+struct SDKBenchSuite_s
+{
+	const char* pName;
+	SDKBenchFunc_t pFunc;
+	const char* pSwitches;
+	const char* pDescription;
+};
+
+static const SDKBenchSuite_s s_BenchSuites[] =
+{
+	{ "frameparser", SDKBench_FrameParser, "[-iterations <count>] [-fuzz <count>]",
+		"verifies and benchmarks the RCON length-prefix frame parser" },
+	{ "bitbuf", SDKBench_BitBuf, "[-iterations <count>] [-fuzz <count>]",
+		"verifies and benchmarks the bit buffer bulk and coordinate routines" },
+	{ "kvsymbols", SDKBench_KVSymbols, "[-threads <count>] [-lookups <count>]",
+		"verifies and benchmarks the KeyValues symbol table under contention" },
+	{ "kvparser", SDKBench_KVParser, "[-threads <count>] [-files <count>]",
+		"verifies and benchmarks the KeyValues text parser on playlists sized files" },
+	{ "patternscan", SDKBench_PatternScan, "[-patterns <count>] [-threads <count>] [-module <file>] [-blob <file>]",
+		"verifies and benchmarks the batched signature scanner" },
+	{ "curlworker", SDKBench_CURLWorker, "<url> [-requests <count>] [-timeout <seconds>]",
+		"benchmarks the pooled HTTP request worker against a server" },
+	{ "threadpool", SDKBench_ThreadPool, "[-elements <count>] [-iterations <count>]",
+		"verifies and benchmarks the work-stealing thread pool against spawning threads per call" },
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: init
+//-----------------------------------------------------------------------------
+static void SDKBench_Init()
+{
+	CheckSystemCPUForSSE2();
+
+	// Init time.
+	Plat_FloatTime();
+
+	g_CoreMsgVCallback = EngineLoggerSink;
+
+	if (s_bUseAnsiColors)
+		Console_ColorInit();
+
+	SpdLog_Init(s_bUseAnsiColors);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: shutdown
+//-----------------------------------------------------------------------------
+static void SDKBench_Shutdown()
+{
+	// The pool's workers can't be stopped during static destruction.
+	g_ThreadPool.Shutdown();
+
+	// Must be done to flush all buffers.
+	SpdLog_Shutdown();
+	Console_Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: logs tool's usage
+//-----------------------------------------------------------------------------
+static void SDKBench_Usage()
+{
+	Warning(eDLL_T::COMMON,
+		"SDKBench instructions and options:\n"
+		"Run 'sdkbench' with one of the following suites:\n");
+
+	for (const SDKBenchSuite_s& suite : s_BenchSuites)
+	{
+		Warning(eDLL_T::COMMON, "\t<%s %s>\t- %s\n",
+			suite.pName, suite.pSwitches, suite.pDescription);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds a benchmark suite by name
+// Input  : *pName - 
+// Output : pointer to suite if found, NULL otherwise
+//-----------------------------------------------------------------------------
+static const SDKBenchSuite_s* SDKBench_FindSuite(const char* const pName)
+{
+	for (const SDKBenchSuite_s& suite : s_BenchSuites)
+	{
+		if (!V_stricmp(suite.pName, pName))
+			return &suite;
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+// Output : EXIT_SUCCESS if the suite passed verification, EXIT_FAILURE otherwise
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	SDKBench_Init();
+
+	CCommand args;
+	CUtlString str;
+
+	for (int i = 0; i < argc; i++)
+	{
+		str.Append(argv[i]);
+		str.Append(' ');
+	}
+
+	args.Tokenize(str.Get(), cmd_source_t::kCommandSrcCode);
+	int nResult = EXIT_FAILURE;
+
+	const SDKBenchSuite_s* const pSuite = args.ArgC() > 1
+		? SDKBench_FindSuite(args.Arg(1))
+		: nullptr;
+
+	if (!pSuite)
+	{
+		SDKBench_Usage();
+	}
+	else if (pSuite->pFunc(args))
+	{
+		nResult = EXIT_SUCCESS;
+	}
+
+	SDKBench_Shutdown();
+	return nResult;
+}
@@ -0,0 +1,20 @@
+#ifndef SDKBENCH_H
+#define SDKBENCH_H
+#include "tier1/cmd.h"
+
+//-----------------------------------------------------------------------------
+// Runs a benchmark suite with the switches passed on the command line,
+// returns false if the optimized routines failed verification against their
+// reference implementation
+//-----------------------------------------------------------------------------
+typedef bool (*SDKBenchFunc_t)(const CCommand& args);
+
+bool SDKBench_FrameParser(const CCommand& args);
+bool SDKBench_BitBuf(const CCommand& args);
+bool SDKBench_KVSymbols(const CCommand& args);
+bool SDKBench_KVParser(const CCommand& args);
+bool SDKBench_PatternScan(const CCommand& args);
+bool SDKBench_CURLWorker(const CCommand& args);
+bool SDKBench_ThreadPool(const CCommand& args);
+
+#endif // SDKBENCH_H
@@ -7,30 +7,146 @@
 //=============================================================================//
 #include "tier0/frametask.h"
 
+#define FRAMETASK_WHEEL_MASK (FRAMETASK_WHEEL_SLOTS - 1)
+
+//-----------------------------------------------------------------------------
+// Purpose: constructor
+//-----------------------------------------------------------------------------
+CFrameTask::CFrameTask()
+    : m_Intake(nullptr)
+    , m_IntakeCount(0)
+    , m_FreeTasks(nullptr)
+    , m_nFrame(0)
+    , m_nDelayed(0)
+    , m_flFrameBudget(0.0)
+    , m_nLatencySamples(0)
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: destructor, destroys all tasks that haven't ran yet
+//-----------------------------------------------------------------------------
+CFrameTask::~CFrameTask()
+{
+    const auto destroyTasks = [](Task_s* task, const bool pending)
+    {
+        while (task)
+        {
+            Task_s* const next = task->next;
+
+            if (pending)
+                task->pfnRun(task->storage, false);
+
+            delete task;
+            task = next;
+        }
+    };
+
+    destroyTasks(m_Intake.exchange(nullptr), true);
+    destroyTasks(m_Ready.head, true);
+    destroyTasks(m_Overflow.head, true);
+
+    for (TaskList_s (&level)[FRAMETASK_WHEEL_SLOTS] : m_Wheel)
+    {
+        for (TaskList_s& slot : level)
+            destroyTasks(slot.head, true);
+    }
+
+    destroyTasks(m_FreeTasks.exchange(nullptr), false);
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: run frame task and process queued calls
 //-----------------------------------------------------------------------------
 void CFrameTask::RunFrame()
 {
-    AUTO_LOCK(m_Mutex);
+    m_nFrame++;
+    AdvanceWheel();
+
+    // Take all dispatched tasks at once and put them back in dispatch order.
+    Task_s* intake = m_Intake.exchange(nullptr, std::memory_order_acquire);
+    Task_s* task = nullptr;
+
+    while (intake)
+    {
+        Task_s* const next = intake->next;
+        intake->next = task;
+
+        task = intake;
+        intake = next;
+    }
+
+    m_Stats.lastIntake = m_IntakeCount.exchange(0, std::memory_order_relaxed);
+    m_Stats.peakIntake = Max(m_Stats.peakIntake, m_Stats.lastIntake);
 
-    for (QueuedTasks_s& delay : m_QueuedTasks)
+    while (task)
     {
-        if (delay.m_nDelayedFrames == 0)
+        Task_s* const next = task->next;
+        const uint64_t delay = task->dueFrame;
+
+        if (delay == 0)
+        {
+            m_Ready.AddToTail(task);
+        }
+        else
         {
-            delay.m_rFunctor();
+            // The latency of delayed tasks isn't tracked, as it mostly
+            // consists of the delay itself.
+            task->dueFrame = m_nFrame + delay;
+            task->dispatchTime = 0.0;
+
+            Schedule(task);
+            m_nDelayed++;
         }
 
-        --delay.m_nDelayedFrames;
+        task = next;
     }
 
-    const auto newEnd = std::remove_if(m_QueuedTasks.begin(), m_QueuedTasks.end(),
-        [](const QueuedTasks_s& delay)
+    m_Stats.peakReadyDepth = Max(m_Stats.peakReadyDepth, m_Ready.count);
+
+    if (m_Ready.IsEmpty())
+    {
+        m_Stats.lastFrameTime = 0.0;
+        return;
+    }
+
+    const double startTime = Plat_FloatTime();
+    double curTime = startTime;
+
+    TaskList_s finished;
+
+    do
+    {
+        // Tasks over budget run first on the next frame.
+        if (!finished.IsEmpty() && m_flFrameBudget > 0.0 &&
+            curTime - startTime >= m_flFrameBudget)
+        {
+            m_Stats.tasksDeferred += m_Ready.count;
+            break;
+        }
+
+        task = m_Ready.RemoveHead();
+
+        if (task->dispatchTime > 0.0)
         {
-            return delay.m_nDelayedFrames == 0;
-        });
+            const double latency = curTime - task->dispatchTime;
+
+            m_nLatencySamples++;
+            m_Stats.avgLatency += (latency - m_Stats.avgLatency) / m_nLatencySamples;
+            m_Stats.peakLatency = Max(m_Stats.peakLatency, latency);
+        }
+
+        task->pfnRun(task->storage, true);
+        finished.AddToTail(task);
 
-    m_QueuedTasks.erase(newEnd, m_QueuedTasks.end());
+        curTime = Plat_FloatTime();
+    } while (!m_Ready.IsEmpty());
+
+    m_Stats.tasksRun += finished.count;
+    m_Stats.lastFrameTime = curTime - startTime;
+
+    ReleaseTasks(finished);
 }
 
 //-----------------------------------------------------------------------------
@@ -43,14 +159,203 @@ bool CFrameTask::IsFinished() const
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: adds function to list, to be called after 'i' frames.
-// Input  : functor - 
-//          frames - 
+// Purpose: gets the queue statistics
+// Input  : &stats -
+//-----------------------------------------------------------------------------
+void CFrameTask::GetStats(FrameTaskStats_s& stats) const
+{
+    stats = m_Stats;
+
+    stats.readyDepth = m_Ready.count;
+    stats.delayedDepth = m_nDelayed;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets a task to dispatch, from the cache of the calling thread
+// Input  : *owner - queue whose finished tasks refill the cache
+//-----------------------------------------------------------------------------
+CFrameTask::Task_s* CFrameTask::AllocTask(CFrameTask* const owner)
+{
+    struct TaskCache_s
+    {
+        ~TaskCache_s()
+        {
+            while (head)
+            {
+                Task_s* const next = head->next;
+
+                delete head;
+                head = next;
+            }
+        }
+
+        Task_s* head = nullptr;
+    };
+
+    static thread_local TaskCache_s s_Cache;
+
+    if (!s_Cache.head)
+        s_Cache.head = owner->m_FreeTasks.exchange(nullptr, std::memory_order_acquire);
+
+    Task_s* const task = s_Cache.head;
+
+    if (!task)
+        return new Task_s;
+
+    s_Cache.head = task->next;
+    return task;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: pushes a task onto the intake, this never locks
+// Input  : *task -
+//          frames -
 //-----------------------------------------------------------------------------
-void CFrameTask::Dispatch(std::function<void()> functor, unsigned int frames)
+void CFrameTask::Submit(Task_s* const task, const unsigned int frames)
 {
-    AUTO_LOCK(m_Mutex);
-    m_QueuedTasks.emplace_back(frames, functor);
+    task->dueFrame = frames; // Made absolute once taken from the intake.
+    task->dispatchTime = Plat_FloatTime();
+
+    Task_s* head = m_Intake.load(std::memory_order_relaxed);
+
+    do
+    {
+        task->next = head;
+    } while (!m_Intake.compare_exchange_weak(head, task,
+        std::memory_order_release, std::memory_order_relaxed));
+
+    m_IntakeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: puts a delayed task in the wheel slot of its due frame, or in the
+//          overflow list if it's due beyond the range of the wheel
+// Input  : *task -
+//-----------------------------------------------------------------------------
+void CFrameTask::Schedule(Task_s* const task)
+{
+    const uint64_t dueFrame = task->dueFrame;
+
+    if (dueFrame - m_nFrame < FRAMETASK_WHEEL_SLOTS)
+    {
+        m_Wheel[0][dueFrame & FRAMETASK_WHEEL_MASK].AddToTail(task);
+    }
+    else if ((dueFrame >> FRAMETASK_WHEEL_BITS) - (m_nFrame >> FRAMETASK_WHEEL_BITS) < FRAMETASK_WHEEL_SLOTS)
+    {
+        m_Wheel[1][(dueFrame >> FRAMETASK_WHEEL_BITS) & FRAMETASK_WHEEL_MASK].AddToTail(task);
+    }
+    else
+    {
+        m_Overflow.AddToTail(task);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: moves the tasks due this frame to the ready list, cascading the
+//          outer levels down as the wheel turns
+//-----------------------------------------------------------------------------
+void CFrameTask::AdvanceWheel()
+{
+    const auto reschedule = [this](TaskList_s& list)
+    {
+        TaskList_s tasks;
+        tasks.AddToTail(list);
+
+        while (!tasks.IsEmpty())
+            Schedule(tasks.RemoveHead());
+    };
+
+    if ((m_nFrame & FRAMETASK_WHEEL_MASK) == 0)
+    {
+        if (((m_nFrame >> FRAMETASK_WHEEL_BITS) & FRAMETASK_WHEEL_MASK) == 0)
+            reschedule(m_Overflow);
+
+        reschedule(m_Wheel[1][(m_nFrame >> FRAMETASK_WHEEL_BITS) & FRAMETASK_WHEEL_MASK]);
+    }
+
+    TaskList_s& slot = m_Wheel[0][m_nFrame & FRAMETASK_WHEEL_MASK];
+
+    m_nDelayed -= slot.count;
+    m_Ready.AddToTail(slot);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: hands finished tasks back for reuse by dispatching threads
+// Input  : &list -
+//-----------------------------------------------------------------------------
+void CFrameTask::ReleaseTasks(TaskList_s& list)
+{
+    if (list.IsEmpty())
+        return;
+
+    Task_s* const head = list.head;
+    Task_s* const tail = list.tail;
+
+    // The free list is only ever taken as a whole, pushing a chain onto it
+    // is therefore not subject to ABA.
+    tail->next = m_FreeTasks.load(std::memory_order_relaxed);
+
+    while (!m_FreeTasks.compare_exchange_weak(tail->next, head,
+        std::memory_order_release, std::memory_order_relaxed));
+
+    list = TaskList_s();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: appends a task to the list
+// Input  : *task -
+//-----------------------------------------------------------------------------
+void CFrameTask::TaskList_s::AddToTail(Task_s* const task)
+{
+    task->next = nullptr;
+
+    if (tail)
+        tail->next = task;
+    else
+        head = task;
+
+    tail = task;
+    count++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: moves all tasks of another list to the end of this list
+// Input  : &list -
+//-----------------------------------------------------------------------------
+void CFrameTask::TaskList_s::AddToTail(TaskList_s& list)
+{
+    if (list.IsEmpty())
+        return;
+
+    if (tail)
+        tail->next = list.head;
+    else
+        head = list.head;
+
+    tail = list.tail;
+    count += list.count;
+
+    list = TaskList_s();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: removes the first task of the list
+// Output : task, or nullptr if the list is empty
+//-----------------------------------------------------------------------------
+CFrameTask::Task_s* CFrameTask::TaskList_s::RemoveHead()
+{
+    Task_s* const task = head;
+
+    if (!task)
+        return nullptr;
+
+    head = task->next;
+
+    if (!head)
+        tail = nullptr;
+
+    count--;
+    return task;
 }
 
 //-----------------------------------------------------------------------------
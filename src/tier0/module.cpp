@@ -5,6 +5,7 @@
 //===========================================================================//
 #include "tier0/memaddr.h"
 #include "tier0/sigcache.h"
+#include "tier0/patternscan.h"
 
 //-----------------------------------------------------------------------------
 // Purpose: constructor
@@ -118,65 +119,44 @@ CMemory CModule::FindPatternSIMD(const uint8_t* pPattern, const char* szMask,
 	const QWORD nSize = bSectionValid ?
 		moduleSection->m_nSectionSize : executableCode.m_nSectionSize;
 
-	const size_t nMaskLen = strlen(szMask);
-	const uint8_t* pData = reinterpret_cast<uint8_t*>(nBase);
-	const uint8_t* pEnd = pData + nSize - nMaskLen;
+	return PatternScan_FindSIMD(reinterpret_cast<const uint8_t*>(nBase),
+		nSize, pPattern, szMask, nOccurrence);
+}
 
-	size_t nOccurrenceCount = 0;
-	int nMasks[128]; // 128*16 = enough masks for 2048 bytes.
-	const int iNumMasks = static_cast<int>(ceil(static_cast<float>(nMaskLen) / 16.f));
+//-----------------------------------------------------------------------------
+// Purpose: looks up many string patterns in the code section in a single pass;
+//			FindPatternSIMD takes the results from there until ClearPrescan
+// Input  : &patterns - 
+//-----------------------------------------------------------------------------
+void CModule::PrescanPatterns(const vector<string>& patterns)
+{
+	const ModuleSections_t& executableCode = GetSectionByName(".text");
 
-	memset(nMasks, '\0', iNumMasks * sizeof(int));
-	for (intptr_t i = 0; i < iNumMasks; ++i)
+	if (!executableCode.IsSectionValid() || patterns.empty())
+		return;
+
+	CPatternScanner scanner;
+
+	for (const string& pattern : patterns)
 	{
-		for (intptr_t j = strnlen(szMask + i * 16, 16) - 1; j >= 0; --j)
-		{
-			if (szMask[i * 16 + j] == 'x')
-			{
-				_bittestandset(reinterpret_cast<LONG*>(&nMasks[i]), static_cast<LONG>(j));
-			}
-		}
+		scanner.AddPattern(pattern.c_str());
 	}
-	const __m128i xmm1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPattern));
-	__m128i xmm2, xmm3, msks;
-	for (; pData != pEnd; _mm_prefetch(reinterpret_cast<const char*>(++pData + 64), _MM_HINT_NTA))
+
+	scanner.Scan(reinterpret_cast<const uint8_t*>(executableCode.m_pSectionBase),
+		executableCode.m_nSectionSize);
+
+	for (int i = 0; i < scanner.GetPatternCount(); i++)
 	{
-		if (pPattern[0] == pData[0])
-		{
-			xmm2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData));
-			msks = _mm_cmpeq_epi8(xmm1, xmm2);
-			if ((_mm_movemask_epi8(msks) & nMasks[0]) == nMasks[0])
-			{
-				for (uintptr_t i = 1; i < static_cast<uintptr_t>(iNumMasks); ++i)
-				{
-					xmm2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>((pData + i * 16)));
-					xmm3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>((pPattern + i * 16)));
-					msks = _mm_cmpeq_epi8(xmm2, xmm3);
-					if ((_mm_movemask_epi8(msks) & nMasks[i]) == nMasks[i])
-					{
-						if ((i + 1) == iNumMasks)
-						{
-							if (nOccurrenceCount == nOccurrence)
-							{
-								return static_cast<CMemory>(const_cast<uint8_t*>(pData));
-							}
-							nOccurrenceCount++;
-						}
-					}
-					else
-					{
-						goto cont;
-					}
-				}
-				if (nOccurrenceCount == nOccurrence)
-				{
-					return static_cast<CMemory>((&*(const_cast<uint8_t*>(pData))));
-				}
-				nOccurrenceCount++;
-			}
-		}cont:;
+		m_PrescanResults[patterns[i]] = reinterpret_cast<QWORD>(scanner.GetResult(i));
 	}
-	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: drops the results of PrescanPatterns
+//-----------------------------------------------------------------------------
+void CModule::ClearPrescan()
+{
+	m_PrescanResults.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -194,6 +174,20 @@ CMemory CModule::FindPatternSIMD(const char* szPattern,
 		return CMemory(nRVA + GetModuleBase());
 	}
 
+	// Prescanned patterns were looked up in the code section.
+	if (!moduleSection && !m_PrescanResults.empty())
+	{
+		const auto it = m_PrescanResults.find(szPattern);
+
+		if (it != m_PrescanResults.end())
+		{
+			const CMemory memory(it->second);
+
+			g_SigCache.AddEntry(szPattern, GetRVA(memory.GetPtr()));
+			return memory;
+		}
+	}
+
 	const pair<vector<uint8_t>, string>
 		patternInfo = PatternToMaskedBytes(szPattern);
 
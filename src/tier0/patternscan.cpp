@@ -0,0 +1,392 @@
+//===========================================================================//
+//
+// Purpose: Byte pattern scanning
+//
+//===========================================================================//
+#include "tier0/utility.h"
+#include "tier0/patternscan.h"
+#include "tier0/threadpool.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: find array of bytes in memory using SIMD instructions
+// Input  : *pData       -
+//          nSize        -
+//          *pPattern    -
+//          *szMask      -
+//          nOccurrence  -
+// Output : pointer to the occurrence, nullptr if not found
+//-----------------------------------------------------------------------------
+const uint8_t* PatternScan_FindSIMD(const uint8_t* const pData, const size_t nSize,
+	const uint8_t* const pPattern, const char* const szMask, const size_t nOccurrence)
+{
+	const size_t nMaskLen = strlen(szMask);
+
+	if (nMaskLen > nSize)
+		return nullptr;
+
+	const uint8_t* pCur = pData;
+	const uint8_t* const pEnd = pData + nSize - nMaskLen;
+
+	size_t nOccurrenceCount = 0;
+	int nMasks[PATTERNSCAN_MAX_LENGTH / 16]; // 128*16 = enough masks for 2048 bytes.
+	const int iNumMasks = static_cast<int>(ceil(static_cast<float>(nMaskLen) / 16.f));
+
+	memset(nMasks, '\0', iNumMasks * sizeof(int));
+	for (intptr_t i = 0; i < iNumMasks; ++i)
+	{
+		for (intptr_t j = strnlen(szMask + i * 16, 16) - 1; j >= 0; --j)
+		{
+			if (szMask[i * 16 + j] == 'x')
+			{
+				nMasks[i] |= (1 << j);
+			}
+		}
+	}
+	const __m128i xmm1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPattern));
+	__m128i xmm2, xmm3, msks;
+	for (; pCur != pEnd; _mm_prefetch(reinterpret_cast<const char*>(++pCur + 64), _MM_HINT_NTA))
+	{
+		if (pPattern[0] == pCur[0])
+		{
+			xmm2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCur));
+			msks = _mm_cmpeq_epi8(xmm1, xmm2);
+			if ((_mm_movemask_epi8(msks) & nMasks[0]) == nMasks[0])
+			{
+				for (uintptr_t i = 1; i < static_cast<uintptr_t>(iNumMasks); ++i)
+				{
+					xmm2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>((pCur + i * 16)));
+					xmm3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>((pPattern + i * 16)));
+					msks = _mm_cmpeq_epi8(xmm2, xmm3);
+					if ((_mm_movemask_epi8(msks) & nMasks[i]) == nMasks[i])
+					{
+						if ((i + 1) == iNumMasks)
+						{
+							if (nOccurrenceCount == nOccurrence)
+							{
+								return pCur;
+							}
+							nOccurrenceCount++;
+						}
+					}
+					else
+					{
+						goto cont;
+					}
+				}
+				if (nOccurrenceCount == nOccurrence)
+				{
+					return pCur;
+				}
+				nOccurrenceCount++;
+			}
+		}cont:;
+	}
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: constructor
+//-----------------------------------------------------------------------------
+CPatternScanner::CPatternScanner()
+	: m_nUnanchored(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: adds a pattern to scan for
+// Input  : *szPattern - pattern in the "48 8B ?? 05" form
+// Output : index of the pattern
+//-----------------------------------------------------------------------------
+int CPatternScanner::AddPattern(const char* const szPattern)
+{
+	const pair<vector<uint8_t>, string> patternInfo = PatternToMaskedBytes(szPattern);
+	Pattern_s pattern;
+
+	pattern.length = patternInfo.first.size();
+	Assert(pattern.length <= PATTERNSCAN_MAX_LENGTH);
+
+	pattern.mask = patternInfo.second;
+	pattern.bytes = patternInfo.first;
+
+	const size_t nChunks = (pattern.length + 15) / 16;
+	pattern.bytes.resize(Max<size_t>(nChunks, 1) * 16, 0);
+	pattern.masks.resize(Max<size_t>(nChunks, 1), 0);
+
+	for (size_t i = 0; i < pattern.length; i++)
+	{
+		if (pattern.mask[i] == 'x')
+			pattern.masks[i / 16] |= (1 << (i % 16));
+	}
+
+	// The single pattern scan only considers positions whose first byte
+	// equals the first pattern byte, even if that one is a wildcard (it
+	// then matches zero); do the same so the results are identical.
+	pattern.masks[0] |= 1;
+
+	pattern.anchorOffset = 0;
+	pattern.anchor = 0;
+	pattern.anchored = false;
+	pattern.pResult = nullptr;
+
+	m_Patterns.push_back(std::move(pattern));
+	return static_cast<int>(m_Patterns.size()) - 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: picks the anchor of each pattern; the window of 4 fixed bytes whose
+//			byte pairs are the least frequent in the memory to scan, so the
+//			anchors rarely hit on common instruction bytes
+// Input  : *pData -
+//			nSize -
+//-----------------------------------------------------------------------------
+void CPatternScanner::ChooseAnchors(const uint8_t* const pData, const size_t nSize)
+{
+	// Sampling every few positions is plenty to rank the pairs.
+	const size_t nSampleStride = 4;
+	vector<uint32_t> pairCounts(0x10000, 0);
+
+	for (size_t i = 0; i + 1 < nSize; i += nSampleStride)
+	{
+		pairCounts[pData[i] | (pData[i + 1] << 8)]++;
+	}
+
+	m_nUnanchored = 0;
+
+	for (Pattern_s& pattern : m_Patterns)
+	{
+		uint64_t nBestScore = UINT64_MAX;
+		pattern.anchored = false;
+
+		for (size_t i = 0; i + 4 <= pattern.length; i++)
+		{
+			if (pattern.mask[i] != 'x' || pattern.mask[i + 1] != 'x' ||
+				pattern.mask[i + 2] != 'x' || pattern.mask[i + 3] != 'x')
+			{
+				continue;
+			}
+
+			const uint8_t* const pBytes = &pattern.bytes[i];
+			const uint64_t nScore = uint64_t(pairCounts[pBytes[0] | (pBytes[1] << 8)] + 1) *
+				uint64_t(pairCounts[pBytes[2] | (pBytes[3] << 8)] + 1);
+
+			if (nScore < nBestScore)
+			{
+				nBestScore = nScore;
+
+				pattern.anchorOffset = i;
+				memcpy(&pattern.anchor, pBytes, sizeof(uint32_t));
+				pattern.anchored = true;
+			}
+		}
+
+		if (!pattern.anchored)
+			m_nUnanchored++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: builds the anchor filter and the per hash pattern buckets
+//-----------------------------------------------------------------------------
+void CPatternScanner::BuildBuckets()
+{
+	const size_t nHashes = size_t(1) << PATTERNSCAN_ANCHOR_HASH_BITS;
+
+	m_Filter.assign(nHashes / 64, 0);
+	m_BucketStart.assign(nHashes + 1, 0);
+
+	for (const Pattern_s& pattern : m_Patterns)
+	{
+		if (pattern.anchored)
+			m_BucketStart[HashAnchor(pattern.anchor) + 1]++;
+	}
+
+	for (size_t i = 0; i < nHashes; i++)
+	{
+		m_BucketStart[i + 1] += m_BucketStart[i];
+	}
+
+	m_BucketItems.resize(m_BucketStart[nHashes]);
+	vector<uint32_t> fill(m_BucketStart.begin(), m_BucketStart.end() - 1);
+
+	for (size_t i = 0; i < m_Patterns.size(); i++)
+	{
+		const Pattern_s& pattern = m_Patterns[i];
+
+		if (!pattern.anchored)
+			continue;
+
+		const uint32_t nHash = HashAnchor(pattern.anchor);
+
+		m_Filter[nHash / 64] |= (uint64_t(1) << (nHash % 64));
+		m_BucketItems[fill[nHash]++] = static_cast<uint32_t>(i);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares a pattern against memory
+// Input  : &pattern -
+//			*pData - start of the candidate
+//			nAvail - bytes readable from the candidate
+// Output : true if it matches
+//-----------------------------------------------------------------------------
+bool CPatternScanner::Compare(const Pattern_s& pattern, const uint8_t* const pData, const size_t nAvail) const
+{
+	const size_t nChunks = pattern.masks.size();
+
+	// Compare whole chunks while they are within the memory, the
+	// remainder byte by byte.
+	size_t i = 0;
+
+	for (; i < nChunks && (i + 1) * 16 <= nAvail; i++)
+	{
+		const __m128i xmm1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + i * 16));
+		const __m128i xmm2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pattern.bytes[i * 16]));
+
+		if ((_mm_movemask_epi8(_mm_cmpeq_epi8(xmm1, xmm2)) & pattern.masks[i]) != pattern.masks[i])
+			return false;
+	}
+
+	for (size_t j = i * 16; j < pattern.length; j++)
+	{
+		if ((pattern.masks[j / 16] & (1 << (j % 16))) && pData[j] != pattern.bytes[j])
+			return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: scans the anchor positions within a range of the memory
+// Input  : *pData -
+//			nSize -
+//			nFrom - first anchor position
+//			nTo - end of the anchor positions
+//			**pResults - first occurrence of each pattern in the range
+//-----------------------------------------------------------------------------
+void CPatternScanner::ScanRange(const uint8_t* const pData, const size_t nSize,
+	const size_t nFrom, const size_t nTo, const uint8_t** const pResults) const
+{
+	const uint64_t* const pFilter = m_Filter.data();
+	const uint32_t* const pBucketStart = m_BucketStart.data();
+	const uint32_t* const pBucketItems = m_BucketItems.data();
+
+	for (size_t i = nFrom; i < nTo; i++)
+	{
+		uint32_t nValue;
+		memcpy(&nValue, pData + i, sizeof(uint32_t));
+
+		const uint32_t nHash = HashAnchor(nValue);
+
+		if (!(pFilter[nHash / 64] & (uint64_t(1) << (nHash % 64))))
+			continue;
+
+		for (uint32_t b = pBucketStart[nHash]; b < pBucketStart[nHash + 1]; b++)
+		{
+			const uint32_t nPattern = pBucketItems[b];
+			const Pattern_s& pattern = m_Patterns[nPattern];
+
+			// Positions are visited in order, the first hit of a
+			// pattern is its first occurrence in this range.
+			if (pattern.anchor != nValue || pResults[nPattern] || i < pattern.anchorOffset)
+				continue;
+
+			const size_t nStart = i - pattern.anchorOffset;
+
+			// Same bounds as the single pattern scan.
+			if (nStart + pattern.length >= nSize)
+				continue;
+
+			if (Compare(pattern, pData + nStart, nSize - nStart))
+				pResults[nPattern] = pData + nStart;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds the first occurrence of all patterns
+// Input  : *pData -
+//			nSize -
+//			nThreads - number of threads to scan on, 0 to pick
+//-----------------------------------------------------------------------------
+void CPatternScanner::Scan(const uint8_t* const pData, const size_t nSize, int nThreads)
+{
+	ChooseAnchors(pData, nSize);
+	BuildBuckets();
+
+	const size_t nPatterns = m_Patterns.size();
+
+	for (Pattern_s& pattern : m_Patterns)
+	{
+		pattern.pResult = nullptr;
+	}
+
+	if (!nPatterns || nSize < sizeof(uint32_t))
+	{
+		for (Pattern_s& pattern : m_Patterns)
+		{
+			pattern.pResult = PatternScan_FindSIMD(pData, nSize, pattern.bytes.data(), pattern.mask.c_str());
+		}
+
+		return;
+	}
+
+	// Each thread gets at least a megabyte to scan.
+	const size_t nPositions = nSize - sizeof(uint32_t) + 1;
+	const size_t nMinPerThread = 1024 * 1024;
+	const size_t nMaxThreads = (nPositions + nMinPerThread - 1) / nMinPerThread;
+
+	// Don't start the thread pool for memory that is scanned on one thread.
+	if (nThreads <= 0)
+		nThreads = nMaxThreads > 1 ? Clamp(g_ThreadPool.GetNumThreads(), 1, 16) : 1;
+
+	nThreads = Clamp(static_cast<int>(Min<size_t>(size_t(nThreads), nMaxThreads)), 1, 64);
+
+	vector<const uint8_t*> results(nPatterns * nThreads, nullptr);
+
+	if (nThreads == 1)
+	{
+		// Scanned on the calling thread alone, this doesn't use the pool;
+		// it can run before the pool started or after it shut down.
+		ScanRange(pData, nSize, 0, nPositions, results.data());
+	}
+	else
+	{
+		const size_t nPerThread = (nPositions + nThreads - 1) / nThreads;
+
+		const auto scanSlice = [&](const int nThread)
+		{
+			const size_t nFrom = nThread * nPerThread;
+			const size_t nTo = Min(nFrom + nPerThread, nPositions);
+
+			ScanRange(pData, nSize, nFrom, nTo, &results[nThread * nPatterns]);
+		};
+
+		CTaskGroup group;
+
+		for (int t = 1; t < nThreads; t++)
+		{
+			group.Run([&scanSlice, t]() { scanSlice(t); });
+		}
+
+		scanSlice(0);
+		group.Wait();
+	}
+
+	// Slices are in memory order; the first slice with a hit has the
+	// first occurrence.
+	for (size_t i = 0; i < nPatterns; i++)
+	{
+		Pattern_s& pattern = m_Patterns[i];
+
+		if (!pattern.anchored)
+		{
+			pattern.pResult = PatternScan_FindSIMD(pData, nSize, pattern.bytes.data(), pattern.mask.c_str());
+			continue;
+		}
+
+		for (int t = 0; t < nThreads && !pattern.pResult; t++)
+		{
+			pattern.pResult = results[t * nPatterns + i];
+		}
+	}
+}
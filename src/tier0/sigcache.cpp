@@ -92,6 +92,57 @@ bool CSigCache::ReadCache(const char* szCacheFile)
 		return false;
 	}
 
+	if (!ReadBlob(szCacheFile, m_Cache, false))
+	{
+		return false;
+	}
+
+	m_bInitialized = true;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads the signatures of a cache on the disk, also if it is from an
+//			older SDK release; used to look them all up at once when the cache
+//			can't be used. Entries that aren't byte patterns are left out
+// Input  : *szCacheFile - 
+//			&patterns - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CSigCache::ReadPatterns(const char* szCacheFile, vector<string>& patterns) const
+{
+	SigMap_Pb cache;
+
+	if (!ReadBlob(szCacheFile, cache, true))
+	{
+		return false;
+	}
+
+	for (const auto& entry : cache.smap())
+	{
+		const string& svKey = entry.first;
+
+		// Strings and table names are cached under their name.
+		if (svKey.empty() || svKey.find_first_not_of("0123456789ABCDEFabcdef? ") != string::npos)
+		{
+			continue;
+		}
+
+		patterns.push_back(svKey);
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads and decompresses the cache map on the disk
+// Input  : *szCacheFile - 
+//			&cache - 
+//			bAllowStale - whether to accept caches from other SDK releases
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CSigCache::ReadBlob(const char* szCacheFile, SigMap_Pb& cache, const bool bAllowStale) const
+{
 	CIOStream reader;
 	if (!reader.Open(szCacheFile, CIOStream::READ | CIOStream::BINARY))
 	{
@@ -117,7 +168,7 @@ bool CSigCache::ReadCache(const char* szCacheFile)
 	}
 
 	header.m_nMinorVersion = reader.Read<uint16_t>();
-	if (header.m_nMinorVersion != SIGDB_MINOR_VERSION)
+	if (header.m_nMinorVersion != SIGDB_MINOR_VERSION && !bAllowStale)
 	{
 		return false;
 	}
@@ -145,13 +196,12 @@ bool CSigCache::ReadCache(const char* szCacheFile)
 
 #pragma warning(push)           // Disabled type conversion warning, as it is possible
 #pragma warning(disable : 4244) // for Protobuf to migrate this code to feature size_t.
-	if (!m_Cache.ParseFromArray(pDstBuf.get(), header.m_nBlobSizeMem))
+	if (!cache.ParseFromArray(pDstBuf.get(), header.m_nBlobSizeMem))
 #pragma warning(pop)
 	{
 		return false;
 	}
 
-	m_bInitialized = true;
 	return true;
 }
 
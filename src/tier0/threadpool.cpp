@@ -0,0 +1,345 @@
+//===========================================================================//
+//
+// Purpose: Persistent work-stealing thread pool
+//
+//===========================================================================//
+#include "tier0/cputopology.h"
+#include "tier0/threadpool.h"
+
+// The pool and worker index of the calling thread, if it's a worker.
+static thread_local CThreadPool* s_pWorkerPool = nullptr;
+static thread_local int s_nWorkerIndex = -1;
+
+//-----------------------------------------------------------------------------
+// constructors/destructors
+//-----------------------------------------------------------------------------
+CThreadPool::CThreadPool()
+	: m_nNumWorkers(0)
+	, m_bRunning(false)
+	, m_nQueued(0)
+	, m_nSleeping(0)
+	, m_nTaskCount(0)
+	, m_nStealCount(0)
+{
+}
+
+CThreadPool::~CThreadPool()
+{
+	// Shutdown() has to be called on every exit path, the workers can't be
+	// stopped safely during static destruction.
+	Assert(m_Threads.empty());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: starts the workers, one per physical core besides the core of
+//          the calling thread
+//-----------------------------------------------------------------------------
+void CThreadPool::StartWorkers()
+{
+	if (m_bRunning.load(std::memory_order_acquire))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_StartMutex);
+
+	if (m_bRunning.load(std::memory_order_relaxed))
+		return;
+
+	CpuTopology topology;
+	int nCores = static_cast<int>(topology.NumberOfProcessCores());
+
+	if (nCores <= 0)
+		nCores = static_cast<int>(std::thread::hardware_concurrency());
+
+	m_nNumWorkers = Clamp(nCores - 1, 1, THREADPOOL_MAX_THREADS - 1);
+	m_Workers.reset(new Worker_s[m_nNumWorkers]);
+
+	m_bRunning.store(true, std::memory_order_release);
+
+	for (int i = 0; i < m_nNumWorkers; i++)
+	{
+		m_Threads.emplace_back(&CThreadPool::WorkerRun, this, i);
+
+		if (topology.IsDefaultImpl())
+			continue;
+
+		// Only a hint, the scheduler may still move the worker elsewhere.
+		const DWORD_PTR coreMask = topology.CoreAffinityMask(DWORD(i + 1));
+		unsigned long processor;
+
+		if (coreMask && _BitScanForward64(&processor, coreMask))
+			SetThreadIdealProcessor(m_Threads.back().native_handle(), processor);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: stops and joins the workers, must not be called while tasks are
+//          running; the workers are started again on the next submit
+//-----------------------------------------------------------------------------
+void CThreadPool::Shutdown()
+{
+	std::lock_guard<std::mutex> startLock(m_StartMutex);
+
+	if (!m_bRunning.load(std::memory_order_relaxed))
+		return;
+
+	{
+		std::lock_guard<std::mutex> sleepLock(m_SleepMutex);
+		m_bRunning.store(false);
+	}
+
+	m_SleepCond.notify_all();
+
+	for (std::thread& thread : m_Threads)
+		thread.join();
+
+	m_Threads.clear();
+	m_Workers.reset();
+	m_nNumWorkers = 0;
+
+	m_SharedTasks.clear();
+	m_nQueued.store(0);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the number of threads running tasks, starting the pool
+// Output : number of workers plus the waiting caller
+//-----------------------------------------------------------------------------
+int CThreadPool::GetNumThreads()
+{
+	StartWorkers();
+	return m_nNumWorkers + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: worker loop, runs tasks and sleeps once there are none to steal
+// Input  : index -
+//-----------------------------------------------------------------------------
+void CThreadPool::WorkerRun(const int index)
+{
+	s_pWorkerPool = this;
+	s_nWorkerIndex = index;
+
+	while (m_bRunning.load(std::memory_order_relaxed))
+	{
+		if (RunTask())
+			continue;
+
+		bool bQueued = false;
+
+		for (int i = 0; i < THREADPOOL_SPIN_COUNT && !bQueued; i++)
+		{
+			std::this_thread::yield();
+			bQueued = m_nQueued.load() > 0;
+		}
+
+		if (bQueued)
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_nSleeping++;
+
+		m_SleepCond.wait(lock, [this]()
+			{
+				return m_nQueued.load() > 0 || !m_bRunning.load();
+			});
+
+		m_nSleeping--;
+	}
+
+	s_pWorkerPool = nullptr;
+	s_nWorkerIndex = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: queues a task on the calling worker, or on the shared queue if
+//          the caller isn't a worker of this pool
+// Input  : &&task -
+//-----------------------------------------------------------------------------
+void CThreadPool::Submit(Task_s&& task)
+{
+	StartWorkers();
+
+	// Counted before it's queued, so the count never drops below zero.
+	m_nQueued.fetch_add(1);
+
+	if (s_pWorkerPool == this)
+	{
+		Worker_s& worker = m_Workers[s_nWorkerIndex];
+
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_SharedMutex);
+		m_SharedTasks.push_back(std::move(task));
+	}
+
+	if (m_nSleeping.load() > 0)
+	{
+		// Taken so the notify can't slip in between a worker checking the
+		// queue count and waiting.
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+		}
+
+		m_SleepCond.notify_one();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: runs a single queued task
+// Output : true if a task ran, false if there was none
+//-----------------------------------------------------------------------------
+bool CThreadPool::RunTask()
+{
+	Task_s task;
+
+	if (!PopTask(task))
+	{
+		// Threads outside the pool spread their steals across the workers.
+		static thread_local unsigned int s_nNextVictim = 0;
+		const unsigned int first = s_pWorkerPool == this ? unsigned(s_nWorkerIndex + 1) : s_nNextVictim++;
+
+		if (!StealTask(task, first))
+			return false;
+	}
+
+	m_nQueued.fetch_sub(1);
+	task.func();
+
+	// Destroy the callable before the group is released, the waiting thread
+	// may free whatever it captured as soon as it returns.
+	task.func = nullptr;
+	task.group->Release();
+
+	m_nTaskCount.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: takes the newest task of the calling worker, or the oldest task
+//          of the shared queue
+// Input  : &outTask -
+// Output : true if a task was taken, false otherwise
+//-----------------------------------------------------------------------------
+bool CThreadPool::PopTask(Task_s& outTask)
+{
+	if (s_pWorkerPool == this)
+	{
+		Worker_s& worker = m_Workers[s_nWorkerIndex];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+
+		if (!worker.tasks.empty())
+		{
+			outTask = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+
+			return true;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_SharedMutex);
+
+	if (m_SharedTasks.empty())
+		return false;
+
+	outTask = std::move(m_SharedTasks.front());
+	m_SharedTasks.pop_front();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: takes the oldest task of another worker
+// Input  : &outTask -
+//          first    - worker to try first
+// Output : true if a task was stolen, false otherwise
+//-----------------------------------------------------------------------------
+bool CThreadPool::StealTask(Task_s& outTask, const unsigned int first)
+{
+	for (int i = 0; i < m_nNumWorkers; i++)
+	{
+		const int victim = int((first + i) % unsigned(m_nNumWorkers));
+
+		if (s_pWorkerPool == this && victim == s_nWorkerIndex)
+			continue;
+
+		Worker_s& worker = m_Workers[victim];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+
+		if (worker.tasks.empty())
+			continue;
+
+		outTask = std::move(worker.tasks.front());
+		worker.tasks.pop_front();
+
+		m_nStealCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: waits until all tasks of the group finished, running queued tasks
+//          in the mean time; sleeps once there are none left to take
+//-----------------------------------------------------------------------------
+void CTaskGroup::Wait()
+{
+	while (m_nPending.load(std::memory_order_acquire) > 0)
+	{
+		if (m_Pool.RunTask())
+			continue;
+
+		// The remaining tasks run on other threads, and are often about to
+		// finish; spin a little before sleeping, as idle workers do.
+		bool bReady = false;
+
+		for (int i = 0; i < THREADPOOL_SPIN_COUNT && !bReady; i++)
+		{
+			std::this_thread::yield();
+			bReady = m_nPending.load(std::memory_order_acquire) == 0 || m_Pool.m_nQueued.load() > 0;
+		}
+
+		if (bReady)
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_WaitMutex);
+
+		m_WaitCond.wait(lock, [this]()
+			{
+				return m_nPending.load(std::memory_order_acquire) == 0;
+			});
+	}
+
+	// The last task may still be notifying us, hold off until it's done.
+	std::lock_guard<std::mutex> lock(m_WaitMutex);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: marks a task of the group as finished; the last one is released
+//          while holding the wait mutex and wakes up the waiter
+//-----------------------------------------------------------------------------
+void CTaskGroup::Release()
+{
+	int nPending = m_nPending.load(std::memory_order_relaxed);
+
+	// Not the last one, the group can't be waited on until the count is 0.
+	while (nPending > 1)
+	{
+		if (m_nPending.compare_exchange_weak(nPending, nPending - 1,
+			std::memory_order_release, std::memory_order_relaxed))
+		{
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_WaitMutex);
+
+	if (m_nPending.fetch_sub(1, std::memory_order_release) == 1)
+		m_WaitCond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+CThreadPool g_ThreadPool;
@@ -91,6 +91,32 @@ void SetBitBufErrorHandler(BitBufErrorHandler fn)
 	g_BitBufErrorHandler = fn;
 }
 
+//-----------------------------------------------------------------------------
+// Loads 32 bits starting at bit nShift (0-7) of pIn; the bytes past pInEnd are
+// never touched and read as zero. Away from the end this is a single unaligned
+// 64-bit load.
+//-----------------------------------------------------------------------------
+static FORCEINLINE uint32 BitBuf_LoadBits32(const unsigned char* const pIn, const int nShift, const unsigned char* const pInEnd)
+{
+	uint64 nWord;
+
+	if (pIn + sizeof(uint64) <= pInEnd)
+	{
+		memcpy(&nWord, pIn, sizeof(uint64));
+		nWord = LittleQWord(nWord);
+	}
+	else
+	{
+		nWord = 0;
+		const ptrdiff_t nAvail = MIN(pInEnd - pIn, ptrdiff_t(sizeof(uint32) + 1));
+
+		for (ptrdiff_t i = 0; i < nAvail; i++)
+			nWord |= uint64(pIn[i]) << (i * 8);
+	}
+
+	return uint32(nWord >> nShift);
+}
+
 // ---------------------------------------------------------------------------------------- //
 // CBitBuffer
 // ---------------------------------------------------------------------------------------- //
@@ -367,22 +393,44 @@ float CBitRead::ReadBitNormal(void)
 //-----------------------------------------------------------------------------
 void CBitRead::ReadBitVec3Coord(Vector3D& fa)
 {
-	int		xflag, yflag, zflag;
+	// The fields of all three components are read first, after which they are
+	// converted to floats at once. The bit layout is the same as three calls
+	// to ReadBitCoord, components that aren't sent are zero.
+	int intvals[4] = { 0, 0, 0, 0 };
+	int fractvals[4] = { 0, 0, 0, 0 };
+	uint32 signs[4] = { 0, 0, 0, 0 };
 
-	// This vector must be initialized! Otherwise, If any of the flags aren't set, 
-	// the corresponding component will not be read and will be stack garbage.
-	fa.Init(0, 0, 0);
+	const unsigned int nFlags = ReadUBitLong(3);
 
-	xflag = ReadOneBit();
-	yflag = ReadOneBit();
-	zflag = ReadOneBit();
+	for (int i = 0; i < 3; i++)
+	{
+		if (!(nFlags & (1 << i)))
+			continue;
 
-	if (xflag)
-		fa[0] = ReadBitCoord();
-	if (yflag)
-		fa[1] = ReadBitCoord();
-	if (zflag)
-		fa[2] = ReadBitCoord();
+		// Integer and fraction flags.
+		const unsigned int nParts = ReadUBitLong(2);
+
+		if (!nParts)
+			continue;
+
+		if (ReadOneBit())
+			signs[i] = 0x80000000;
+
+		// Adjust the integers from [0..MAX_COORD_VALUE-1] to [1..MAX_COORD_VALUE]
+		if (nParts & 1)
+			intvals[i] = ReadUBitLong(COORD_INTEGER_BITS) + 1;
+
+		if (nParts & 2)
+			fractvals[i] = ReadUBitLong(COORD_FRACTIONAL_BITS);
+	}
+
+	const __m128 vFract = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)fractvals)), _mm_set1_ps(COORD_RESOLUTION));
+	const __m128 vValue = _mm_add_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)intvals)), vFract);
+
+	float values[4];
+	_mm_storeu_ps(values, _mm_xor_ps(vValue, _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)signs))));
+
+	fa.Init(values[0], values[1], values[2]);
 }
 
 //-----------------------------------------------------------------------------
@@ -517,6 +565,39 @@ void CBitRead::ReadBits(void* pOutData, int nBits)
 	unsigned char* pOut = (unsigned char*)pOutData;
 	int nBitsLeft = nBits;
 
+	// Copy whole dwords straight out of the buffer when the read stays within
+	// it, the bit reader is then moved past them and reads the remainder.
+	if (nBitsLeft >= 64 && m_pData && !IsOverflowed() && GetNumBitsLeft() >= nBitsLeft)
+	{
+		const ssize_t nReadPos = GetNumBitsRead();
+		const unsigned char* const pBase = GetBasePointer();
+		const unsigned char* const pEnd = pBase + m_nDataBytes;
+
+		const unsigned char* pIn = pBase + (nReadPos >> 3);
+		const int nShift = int(nReadPos & 7);
+		const int nBulkBits = nBitsLeft & ~31;
+
+		if (nShift == 0)
+		{
+			memcpy(pOut, pIn, nBulkBits >> 3);
+			pOut += nBulkBits >> 3;
+		}
+		else
+		{
+			for (int i = 0; i < nBulkBits; i += 32)
+			{
+				const uint32 nWord = BitBuf_LoadBits32(pIn, nShift, pEnd);
+				memcpy(pOut, &nWord, sizeof(uint32));
+
+				pIn += sizeof(uint32);
+				pOut += sizeof(uint32);
+			}
+		}
+
+		nBitsLeft -= nBulkBits;
+		Seek(nReadPos + nBulkBits);
+	}
+
 	// align output to dword boundary
 	while (((uintp)pOut & 3) != 0 && nBitsLeft >= 8)
 	{
@@ -778,6 +859,28 @@ void CBitWrite::WriteUBitLong(unsigned int curData, int numbits, bool bCheckRang
 
 	uint32 iCurBitMasked = iCurBit & 31;
 
+	// Mask in both dwords at once through a 64-bit accumulator when they are
+	// in the buffer. Bits of 'curData' above 'numbits' are only kept in the
+	// second dword if the field spans it, like below, so the output is the
+	// same bit for bit.
+	if ((iDWord * 4 + sizeof(uint64)) <= (unsigned int)m_nDataBytes)
+	{
+		const uint64 nFieldMask = ((uint64(1) << numbits) - 1) << iCurBitMasked;
+		const uint64 nKeepMask = ~uint64(0) >> ((iCurBitMasked + numbits <= 32) << 5);
+
+		uint64 qword;
+		memcpy(&qword, &m_pData[iDWord * 4], sizeof(uint64));
+
+		qword = LittleQWord(qword);
+		qword = (qword & ~nFieldMask) | ((uint64(curData) << iCurBitMasked) & nKeepMask);
+		qword = LittleQWord(qword);
+
+		memcpy(&m_pData[iDWord * 4], &qword, sizeof(uint64));
+
+		m_iCurBit += numbits;
+		return;
+	}
+
 	uint32 dword = LoadLittleDWord((uint32*)m_pData, iDWord);
 
 	dword &= g_BitWriteMasks[iCurBitMasked][nBitsLeft];
@@ -852,92 +955,75 @@ void CBitWrite::WriteBitLong(unsigned int data, int numbits, bool bSigned)
 }
 
 //-----------------------------------------------------------------------------
-bool CBitWrite::WriteBits(const void* pInData, int nBits)
+void CBitWrite::WriteBitsWordwise(const unsigned char* pIn, const int nInShift, const unsigned char* const pInEnd, int nBits)
 {
-	unsigned char* pIn = (unsigned char*)pInData;
-	int nBitsLeft = nBits;
+	Assert(m_iCurBit + nBits <= m_nDataBits);
 
-	// Bounds checking..
-	if ((m_iCurBit + nBits) > m_nDataBits)
+	const uint32 nAccumBits = m_iCurBit & 31;
+	unsigned int iDWord = m_iCurBit >> 5;
+
+	// The bits before the write position in the first dword are kept; after
+	// that every step stores one whole dword and carries the rest over.
+	uint64 nAccum = nAccumBits ? (LoadLittleDWord((uint32*)m_pData, iDWord) & g_ExtraMasks[nAccumBits]) : 0;
+
+	while (nBits >= 32)
 	{
-		SetOverflowFlag();
-		CallErrorHandler(BITBUFERROR_BUFFER_OVERRUN, GetDebugName());
-		return false;
+		nAccum |= uint64(BitBuf_LoadBits32(pIn, nInShift, pInEnd)) << nAccumBits;
+		StoreLittleDWord((uint32*)m_pData, iDWord++, uint32(nAccum));
+
+		nAccum >>= 32;
+		pIn += sizeof(uint32);
+		nBits -= 32;
 	}
 
-	// Align input to dword boundary
-	while (((uintp)pIn & 3) != 0 && nBitsLeft >= 8)
+	m_iCurBit = (iDWord << 5) + nAccumBits;
+
+	// Store the bits that were carried over, keeping the ones after them.
+	if (nAccumBits)
 	{
-		WriteUBitLong(*pIn, 8, false);
-		++pIn;
-		nBitsLeft -= 8;
+		const uint32 dword = LoadLittleDWord((uint32*)m_pData, iDWord) & ~g_ExtraMasks[nAccumBits];
+		StoreLittleDWord((uint32*)m_pData, iDWord, dword | uint32(nAccum));
 	}
 
-	if (nBitsLeft >= 32)
+	if (nBits)
 	{
-		if ((m_iCurBit & 7) == 0)
-		{
-			// current bit is byte aligned, do block copy
-			int numbytes = nBitsLeft >> 3;
-			int numbits = numbytes << 3;
-
-			memcpy(m_pData + (m_iCurBit >> 3), pIn, numbytes);
-			pIn += numbytes;
-			nBitsLeft -= numbits;
-			m_iCurBit += numbits;
-		}
-		else
-		{
-			const uint32 iBitsRight = (m_iCurBit & 31);
-			Assert(iBitsRight > 0); // should not be aligned, otherwise it would have been handled before
-			const uint32 iBitsLeft = 32 - iBitsRight;
-			const int iBitsChanging = 32 + iBitsLeft; // how many bits are changed during one step (not necessary written meaningful)
-			unsigned int iDWord = m_iCurBit >> 5;
-
-			uint32 outWord = LoadLittleDWord((uint32*)m_pData, iDWord);
-			outWord &= g_BitWriteMasks[iBitsRight][32]; // clear rest of beginning DWORD 
+		WriteUBitLong(BitBuf_LoadBits32(pIn, nInShift, pInEnd) & g_ExtraMasks[nBits], nBits, false);
+	}
+}
 
-			// copy in DWORD blocks
-			while (nBitsLeft >= iBitsChanging)
-			{
-				uint32 curData = LittleDWord(*(uint32*)pIn);
-				pIn += sizeof(uint32);
+//-----------------------------------------------------------------------------
+bool CBitWrite::WriteBits(const void* pInData, int nBits)
+{
+	const unsigned char* pIn = (const unsigned char*)pInData;
 
-				outWord |= curData << iBitsRight;
-				StoreLittleDWord((uint32*)m_pData, iDWord, outWord);
+	// Bounds checking..
+	if ((m_iCurBit + nBits) > m_nDataBits)
+	{
+		SetOverflowFlag();
+		CallErrorHandler(BITBUFERROR_BUFFER_OVERRUN, GetDebugName());
+		return false;
+	}
 
-				++iDWord;
-				outWord = curData >> iBitsLeft;
+	if ((m_iCurBit & 7) == 0)
+	{
+		// current bit is byte aligned, do block copy
+		const int numbytes = nBits >> 3;
 
-				nBitsLeft -= 32;
-				m_iCurBit += 32;
-			}
+		memcpy(m_pData + (m_iCurBit >> 3), pIn, numbytes);
+		pIn += numbytes;
+		m_iCurBit += numbytes << 3;
 
-			// store last word
-			StoreLittleDWord((uint32*)m_pData, iDWord, outWord);
+		// write remaining bits
+		const int nBitsLeft = nBits & 7;
 
-			// write remaining DWORD 
-			if (nBitsLeft >= 32)
-			{
-				WriteUBitLong(LittleDWord(*((uint32*)pIn)), 32, false);
-				pIn += sizeof(uint32);
-				nBitsLeft -= 32;
-			}
+		if (nBitsLeft)
+		{
+			WriteUBitLong(*pIn & g_ExtraMasks[nBitsLeft], nBitsLeft, false);
 		}
 	}
-
-	// write remaining bytes
-	while (nBitsLeft >= 8)
+	else if (nBits > 0)
 	{
-		WriteUBitLong(*pIn, 8, false);
-		++pIn;
-		nBitsLeft -= 8;
-	}
-
-	// write remaining bits
-	if (nBitsLeft)
-	{
-		WriteUBitLong(*pIn, nBitsLeft, false);
+		WriteBitsWordwise(pIn, 0, pIn + BitByte(nBits), nBits);
 	}
 
 	return !IsOverflowed();
@@ -946,7 +1032,20 @@ bool CBitWrite::WriteBits(const void* pInData, int nBits)
 //-----------------------------------------------------------------------------
 bool CBitWrite::WriteBitsFromBuffer(bf_read* pIn, int nBits)
 {
-	// This could be optimized a little by
+	// Copy straight out of the read buffer when both buffers have room for all
+	// bits, the read buffer is then moved past them.
+	if (nBits > 0 && (m_iCurBit + nBits) <= m_nDataBits &&
+		pIn->m_pData && !pIn->IsOverflowed() && pIn->GetNumBitsLeft() >= nBits)
+	{
+		const ssize_t nReadPos = pIn->GetNumBitsRead();
+		const unsigned char* const pBase = pIn->GetBasePointer();
+
+		WriteBitsWordwise(pBase + (nReadPos >> 3), int(nReadPos & 7), pBase + pIn->TotalBytesAvailable(), nBits);
+		pIn->Seek(nReadPos + nBits);
+
+		return !IsOverflowed();
+	}
+
 	while (nBits > 32)
 	{
 		WriteUBitLong(pIn->ReadUBitLong(32), 32);
@@ -1330,22 +1429,60 @@ void CBitWrite::WriteBitCellCoord(const float f, int bits, EBitCoordType coordTy
 //-----------------------------------------------------------------------------
 void CBitWrite::WriteBitVec3Coord(const Vector3D& fa)
 {
-	int		xflag, yflag, zflag;
+	// All three components are classified and split into their integer and
+	// fractional parts at once, every sent component is then written with a
+	// single call. The bit layout is the same as three calls to WriteBitCoord.
+	const __m128 vCoord = _mm_setr_ps(fa[0], fa[1], fa[2], 0.0f);
+	const __m128 vAbs = _mm_andnot_ps(_mm_set1_ps(-0.0f), vCoord);
 
-	xflag = (fa[0] >= COORD_RESOLUTION) || (fa[0] <= -COORD_RESOLUTION);
-	yflag = (fa[1] >= COORD_RESOLUTION) || (fa[1] <= -COORD_RESOLUTION);
-	zflag = (fa[2] >= COORD_RESOLUTION) || (fa[2] <= -COORD_RESOLUTION);
+	const int nFlags = _mm_movemask_ps(_mm_cmpge_ps(vAbs, _mm_set1_ps(COORD_RESOLUTION)));
+	const int nSigns = _mm_movemask_ps(_mm_cmple_ps(vCoord, _mm_set1_ps(-COORD_RESOLUTION)));
 
-	WriteOneBit(xflag);
-	WriteOneBit(yflag);
-	WriteOneBit(zflag);
+	// abs((int)(f * COORD_DENOMINATOR)) & (COORD_DENOMINATOR - 1)
+	const __m128i vFract = _mm_cvttps_epi32(_mm_mul_ps(vCoord, _mm_set1_ps(float(COORD_DENOMINATOR))));
+	const __m128i vFractSign = _mm_srai_epi32(vFract, 31);
 
-	if (xflag)
-		WriteBitCoord(fa[0]);
-	if (yflag)
-		WriteBitCoord(fa[1]);
-	if (zflag)
-		WriteBitCoord(fa[2]);
+	int intvals[4];
+	int fractvals[4];
+
+	_mm_storeu_si128((__m128i*)intvals, _mm_cvttps_epi32(vAbs));
+	_mm_storeu_si128((__m128i*)fractvals, _mm_and_si128(_mm_sub_epi32(_mm_xor_si128(vFract, vFractSign), vFractSign),
+		_mm_set1_epi32(COORD_DENOMINATOR - 1)));
+
+	WriteUBitLong(nFlags, 3, false);
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (!(nFlags & (1 << i)))
+			continue;
+
+		const int intval = intvals[i];
+		const int fractval = fractvals[i];
+
+		// Integer and fraction flags.
+		uint32 nData = (intval ? 1 : 0) | (fractval ? 2 : 0);
+		int nNumBits = 2;
+
+		if (nData)
+		{
+			nData |= ((nSigns >> i) & 1) << nNumBits++;
+
+			// Adjust the integers from [1..MAX_COORD_VALUE] to [0..MAX_COORD_VALUE-1]
+			if (intval)
+			{
+				nData |= (uint32(intval - 1) & g_ExtraMasks[COORD_INTEGER_BITS]) << nNumBits;
+				nNumBits += COORD_INTEGER_BITS;
+			}
+
+			if (fractval)
+			{
+				nData |= uint32(fractval) << nNumBits;
+				nNumBits += COORD_FRACTIONAL_BITS;
+			}
+		}
+
+		WriteUBitLong(nData, nNumBits, false);
+	}
 }
 
 //-----------------------------------------------------------------------------
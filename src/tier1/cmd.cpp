@@ -204,6 +204,44 @@ bool CCommand::HasOnlyDigits(int nIndex) const
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: returns the argument following the named switch (e.g. '-threads')
+// Input  : *pName - 
+// Output : value string if found, empty string if the switch has no value,
+//          NULL if the switch is not present
+//-----------------------------------------------------------------------------
+const char* CCommand::FindArg(const char* pName) const
+{
+	const int nArgC = ArgC();
+
+	for (int i = 1; i < nArgC; i++)
+	{
+		if (!V_stricmp(Arg(i), pName))
+		{
+			return (i + 1) < nArgC ? Arg(i + 1) : "";
+		}
+	}
+
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: returns the integer value following the named switch
+// Input  : *pName       - 
+//          nDefaultVal - returned if the switch is not present
+//-----------------------------------------------------------------------------
+int CCommand::FindArgInt(const char* pName, int nDefaultVal) const
+{
+	const char* pVal = FindArg(pName);
+
+	if (pVal)
+	{
+		return atoi(pVal);
+	}
+
+	return nDefaultVal;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: reset
 //-----------------------------------------------------------------------------
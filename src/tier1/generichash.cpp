@@ -427,3 +427,96 @@ uint64 MurmurHash64(const void* key, int len, uint32 seed)
 
 	return h;
 }
+
+
+//-----------------------------------------------------------------------------
+// Murmur hash 3, 128 bit (x64 variant)
+//-----------------------------------------------------------------------------
+static FORCEINLINE uint64 MurmurRotl64(const uint64 x, const int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static FORCEINLINE uint64 MurmurFmix64(uint64 k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return k;
+}
+
+void MurmurHash3_128(const void* key, const size_t len, const uint32 seed, uint64 out[2])
+{
+	const uint8* data = (const uint8*)key;
+	const size_t nblocks = len / 16;
+
+	uint64 h1 = seed;
+	uint64 h2 = seed;
+
+	const uint64 c1 = 0x87c37b91114253d5ULL;
+	const uint64 c2 = 0x4cf5ad432745937fULL;
+
+	// Mix 16 bytes at a time into the hash
+
+	const uint64* blocks = (const uint64*)data;
+
+	for (size_t i = 0; i < nblocks; i++)
+	{
+		uint64 k1 = LittleQWord(blocks[i * 2 + 0]);
+		uint64 k2 = LittleQWord(blocks[i * 2 + 1]);
+
+		k1 *= c1; k1 = MurmurRotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = MurmurRotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+		k2 *= c2; k2 = MurmurRotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = MurmurRotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	// Handle the last few bytes of the input array
+
+	const uint8* tail = data + nblocks * 16;
+
+	uint64 k1 = 0;
+	uint64 k2 = 0;
+
+	switch (len & 15)
+	{
+	case 15: k2 ^= ((uint64)tail[14]) << 48;
+	case 14: k2 ^= ((uint64)tail[13]) << 40;
+	case 13: k2 ^= ((uint64)tail[12]) << 32;
+	case 12: k2 ^= ((uint64)tail[11]) << 24;
+	case 11: k2 ^= ((uint64)tail[10]) << 16;
+	case 10: k2 ^= ((uint64)tail[9]) << 8;
+	case  9: k2 ^= ((uint64)tail[8]);
+		k2 *= c2; k2 = MurmurRotl64(k2, 33); k2 *= c1; h2 ^= k2;
+	case  8: k1 ^= ((uint64)tail[7]) << 56;
+	case  7: k1 ^= ((uint64)tail[6]) << 48;
+	case  6: k1 ^= ((uint64)tail[5]) << 40;
+	case  5: k1 ^= ((uint64)tail[4]) << 32;
+	case  4: k1 ^= ((uint64)tail[3]) << 24;
+	case  3: k1 ^= ((uint64)tail[2]) << 16;
+	case  2: k1 ^= ((uint64)tail[1]) << 8;
+	case  1: k1 ^= ((uint64)tail[0]);
+		k1 *= c1; k1 = MurmurRotl64(k1, 31); k1 *= c2; h1 ^= k1;
+	};
+
+	// Do a few final mixes of the hash to ensure the last few
+	// bytes are well-incorporated.
+
+	h1 ^= (uint64)len; h2 ^= (uint64)len;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = MurmurFmix64(h1);
+	h2 = MurmurFmix64(h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	out[0] = h1;
+	out[1] = h2;
+}
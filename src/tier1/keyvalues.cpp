@@ -20,8 +20,8 @@
 #include "engine/sys_dll2.h"
 #include "engine/cmodel_bsp.h"
 
-static const char* s_LastFileLoadingFrom = "unknown"; // just needed for error messages
-CExpressionEvaluator g_ExpressionEvaluator;
+static thread_local const char* s_LastFileLoadingFrom = "unknown"; // just needed for error messages
+static thread_local CExpressionEvaluator s_ExpressionEvaluator;
 
 #define INTERNALWRITE( pData, nLen ) InternalWrite( pFileSystem, pHandle, pBuf, pData, nLen )
 
@@ -121,6 +121,21 @@ KeyValues::KeyValues(const char* pszSetName, const char* pszFirstKey, int iFirst
 	SetInt(pszSecondKey, iSecondValue);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Constructor for keys whose name symbols are already known
+// Input  : iKeyName - 
+//			iKeyNameCaseSensitive - 
+//-----------------------------------------------------------------------------
+KeyValues::KeyValues(const int iKeyName, const int iKeyNameCaseSensitive)
+{
+	Init();
+
+	m_iKeyName = iKeyName;
+	SPLIT_3_BYTES_INTO_1_AND_2(m_iKeyNameCaseSensitive1, m_iKeyNameCaseSensitive2, iKeyNameCaseSensitive);
+
+	TRACK_KV_ADD(this, GetName());
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Destructor
 //-----------------------------------------------------------------------------
@@ -1488,7 +1503,10 @@ void KeyValues::RecursiveLoadFromBuffer(char const* resourceName, CKeyValuesToke
 
 		// Always create the key; note that this could potentially
 		// cause some duplication, but that's what we want sometimes
-		KeyValues* dat = CreateKeyUsingKnownLastChild(name, pLastChild);
+		HKeySymbol hCaseInsensitiveName;
+		const HKeySymbol hCaseSensitiveName = tokenReader.GetSymbolForKeyName(hCaseInsensitiveName, name);
+
+		KeyValues* dat = CreateKeyUsingKnownLastChild(hCaseInsensitiveName, hCaseSensitiveName, pLastChild);
 
 		errorKey.Reset(dat->GetNameSymbolCaseSensitive());
 
@@ -1671,15 +1689,22 @@ void KeyValues::RecursiveLoadFromBuffer(char const* resourceName, CKeyValuesToke
 	}
 }
 
-// prevent two threads from entering this at the same time and trying to share the global error reporting and parse buffers
-static CThreadFastMutex g_KVMutex;
 //-----------------------------------------------------------------------------
 // Read from a buffer...
+// NOTE: the parse state is owned by the token reader and the error stack is
+// per thread, so several buffers can be loaded at the same time
 //-----------------------------------------------------------------------------
 bool KeyValues::LoadFromBuffer(char const* resourceName, CUtlBuffer& buf, IBaseFileSystem* pFileSystem, const char* pPathID, GetSymbolProc_t pfnEvaluateSymbolProc)
 {
-	AUTO_LOCK(g_KVMutex);
+	CKeyValuesTokenReader tokenReader(this, buf);
+	return LoadFromTokenReader(resourceName, tokenReader, buf, pFileSystem, pPathID, pfnEvaluateSymbolProc);
+}
 
+//-----------------------------------------------------------------------------
+// Read from a buffer through the given token reader...
+//-----------------------------------------------------------------------------
+bool KeyValues::LoadFromTokenReader(char const* resourceName, CKeyValuesTokenReader& tokenReader, CUtlBuffer& buf, IBaseFileSystem* pFileSystem, const char* pPathID, GetSymbolProc_t pfnEvaluateSymbolProc)
+{
 	//if (IsGameConsole())
 	//{
 	//	// Let's not crash if the buffer is empty
@@ -1704,7 +1729,6 @@ bool KeyValues::LoadFromBuffer(char const* resourceName, CUtlBuffer& buf, IBaseF
 	CUtlVector< KeyValues* > baseKeys;
 	bool wasQuoted;
 	bool wasConditional;
-	CKeyValuesTokenReader tokenReader(this, buf);
 
 	g_KeyValuesErrorStack.SetFilename(resourceName);
 	do
@@ -2043,7 +2067,7 @@ bool KeyValues::EvaluateConditional(const char* pExpressionString, GetSymbolProc
 {
 	// evaluate the infix expression, calling the symbol proc to resolve each symbol's value
 	bool bResult = false;
-	const bool bValid = g_ExpressionEvaluator.Evaluate(bResult, pExpressionString, pfnEvaluateSymbolProc);
+	const bool bValid = s_ExpressionEvaluator.Evaluate(bResult, pExpressionString, pfnEvaluateSymbolProc);
 	if (!bValid)
 	{
 		g_KeyValuesErrorStack.ReportError("KV Conditional Evaluation Error");
@@ -2068,6 +2092,22 @@ KeyValues* KeyValues::CreateKeyUsingKnownLastChild(const char* keyName, KeyValue
 	return dat;
 }
 
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+KeyValues* KeyValues::CreateKeyUsingKnownLastChild(const int iKeyName, const int iKeyNameCaseSensitive, KeyValues* pLastChild)
+{
+	// Create a new key
+	KeyValues* dat = new KeyValues(iKeyName, iKeyNameCaseSensitive);
+
+	dat->UsesEscapeSequences(m_bHasEscapeSequences != 0); // use same format as parent does
+
+	// add into subkey list
+	AddSubkeyUsingKnownLastChild(dat, pLastChild);
+
+	return dat;
+}
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
@@ -83,6 +83,7 @@ private:
 	bool	m_bEncounteredErrors;
 };
 
-inline CKeyValuesErrorStack g_KeyValuesErrorStack;
+// Per thread, so files can be parsed on several threads at once
+inline thread_local CKeyValuesErrorStack g_KeyValuesErrorStack;
 
 #endif // KVERRORSTACK_H
@@ -3,18 +3,43 @@
 #include "kverrorstack.h"
 #include "tier1/keyvalues.h"
 
+// Number of slots in the per-parse key name symbol cache, must be a power of 2.
+#define KEYVALUES_SYMBOL_CACHE_SIZE 512
+// Key names longer than this aren't cached.
+#define KEYVALUES_SYMBOL_CACHE_MAX_NAME 128
+// Cap on the memory used to hold the cached key names.
+#define KEYVALUES_SYMBOL_CACHE_MAX_POOL (1024 * 64)
+
 // This class gets the tokens out of a CUtlBuffer for KeyValues.
-// Since KeyValues likes to seek backwards and seeking won't work with a text-mode CUtlStreamBuffer 
+// Since KeyValues likes to seek backwards and seeking won't work with a text-mode CUtlStreamBuffer
 // (which is what dmserializers uses), this class allows you to seek back one token.
+// All parse state lives in the reader, so several files can be parsed at the
+// same time. When the buffer holds the rest of the input in memory, tokens are
+// scanned from it in place rather than a char at a time through the buffer.
 class CKeyValuesTokenReader
 {
 public:
-	CKeyValuesTokenReader(KeyValues* pKeyValues, CUtlBuffer& buf);
+	CKeyValuesTokenReader(KeyValues* pKeyValues, CUtlBuffer& buf, const bool bFastPath = true);
 
 	const char* ReadToken(bool& wasQuoted, bool& wasConditional);
 	void SeekBackOneToken();
 
+	HKeySymbol GetSymbolForKeyName(HKeySymbol& hCaseInsensitiveSymbol, const char* const pszName);
+
 private:
+	const char* ReadTokenDirect(bool& wasQuoted, bool& wasConditional);
+	const char* ReadTokenBuffered(bool& wasQuoted, bool& wasConditional);
+
+	struct SymbolCacheEntry_s
+	{
+		uint32 nHash;
+		int nNameOffset; // Offset of the name in m_SymbolNames.
+		int nNameLength;
+
+		HKeySymbol hCaseInsensitive;
+		HKeySymbol hCaseSensitive;
+	};
+
 	KeyValues* m_pKeyValues;
 	CUtlBuffer& m_Buffer;
 
@@ -22,17 +47,43 @@ private:
 	bool m_bUsePriorToken;
 	bool m_bPriorTokenWasQuoted;
 	bool m_bPriorTokenWasConditional;
-	static char s_pTokenBuf[KEYVALUES_TOKEN_SIZE];
+	bool m_bFastPath;
+
+	CUtlMemory<char> m_TokenBuf;
+
+	// Files repeat the same few key names over and over; caching their
+	// symbols here saves a trip through the (shared) symbol table per key.
+	SymbolCacheEntry_s m_SymbolCache[KEYVALUES_SYMBOL_CACHE_SIZE];
+	CUtlVector<char> m_SymbolNames;
 };
 
-char CKeyValuesTokenReader::s_pTokenBuf[KEYVALUES_TOKEN_SIZE];
+//-----------------------------------------------------------------------------
+// Purpose: same set of characters as V_isspace()
+//-----------------------------------------------------------------------------
+static inline bool KeyValues_IsSpace(const char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
 
-CKeyValuesTokenReader::CKeyValuesTokenReader(KeyValues* pKeyValues, CUtlBuffer& buf) :
-	m_Buffer(buf)
+CKeyValuesTokenReader::CKeyValuesTokenReader(KeyValues* pKeyValues, CUtlBuffer& buf, const bool bFastPath) :
+	m_Buffer(buf),
+	m_TokenBuf(0, KEYVALUES_TOKEN_SIZE)
 {
 	m_pKeyValues = pKeyValues;
 	m_nTokensRead = 0;
 	m_bUsePriorToken = false;
+	m_bPriorTokenWasQuoted = false;
+	m_bPriorTokenWasConditional = false;
+	m_bFastPath = bFastPath;
+
+	for (SymbolCacheEntry_s& entry : m_SymbolCache)
+	{
+		entry.nHash = 0;
+		entry.nNameOffset = 0;
+		entry.nNameLength = -1;
+		entry.hCaseInsensitive = INVALID_KEY_SYMBOL;
+		entry.hCaseSensitive = INVALID_KEY_SYMBOL;
+	}
 }
 
 const char* CKeyValuesTokenReader::ReadToken(bool& wasQuoted, bool& wasConditional)
@@ -42,7 +93,7 @@ const char* CKeyValuesTokenReader::ReadToken(bool& wasQuoted, bool& wasCondition
 		m_bUsePriorToken = false;
 		wasQuoted = m_bPriorTokenWasQuoted;
 		wasConditional = m_bPriorTokenWasConditional;
-		return s_pTokenBuf;
+		return m_TokenBuf.Base();
 	}
 
 	m_bPriorTokenWasQuoted = wasQuoted = false;
@@ -51,6 +102,171 @@ const char* CKeyValuesTokenReader::ReadToken(bool& wasQuoted, bool& wasCondition
 	if (!m_Buffer.IsValid())
 		return NULL;
 
+	if (m_bFastPath && m_Buffer.IsText())
+		return ReadTokenDirect(wasQuoted, wasConditional);
+
+	return ReadTokenBuffered(wasQuoted, wasConditional);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads the next token straight from the buffer's memory; produces
+//			the same tokens as ReadTokenBuffered(), which it hands over to at
+//			the end of the input so the buffer is flagged the same way
+//-----------------------------------------------------------------------------
+const char* CKeyValuesTokenReader::ReadTokenDirect(bool& wasQuoted, bool& wasConditional)
+{
+	const ssize_t nRemaining = m_Buffer.GetBytesRemaining();
+	const char* const pStart = nRemaining > 0 ? (const char*)m_Buffer.PeekGet(nRemaining, 0) : nullptr;
+
+	if (!pStart)
+		return ReadTokenBuffered(wasQuoted, wasConditional);
+
+	const char* const pEnd = pStart + nRemaining;
+	const char* p = pStart;
+
+	// eating white spaces and remarks loop
+	while (true)
+	{
+		while (p < pEnd && KeyValues_IsSpace(*p))
+			p++;
+
+		if (p + 1 >= pEnd || p[0] != '/' || p[1] != '/')
+			break;
+
+		const char* const pEol = (const char*)memchr(p + 2, '\n', pEnd - (p + 2));
+
+		if (!pEol)
+			break; // comment runs up to the end of the file
+
+		p = pEol + 1;
+	}
+
+	if (p == pEnd || (p + 1 < pEnd && p[0] == '/' && p[1] == '/'))
+	{
+		m_Buffer.SeekGet(CUtlBuffer::SEEK_CURRENT, p - pStart);
+		return ReadTokenBuffered(wasQuoted, wasConditional);
+	}
+
+	char* const pTokenBuf = m_TokenBuf.Base();
+	int nCount = 0;
+
+	// read quoted strings specially
+	if (*p == '\"')
+	{
+		CUtlCharConversion* const pConv = m_pKeyValues->m_bHasEscapeSequences ? GetCStringCharConversion() : GetNoEscCharConversion();
+		const char cEscapeChar = pConv->GetEscapeChar();
+
+		const char* const pQuote = p++;
+		bool bTerminated = false;
+
+		while (p < pEnd)
+		{
+			char c = *p++;
+
+			if (c == '\"')
+			{
+				bTerminated = true;
+				break;
+			}
+
+			if (c == cEscapeChar)
+			{
+				ssize_t nLength = Min(pConv->MaxConversionLength(), ssize_t(pEnd - p));
+
+				if (nLength)
+				{
+					c = pConv->FindConversion(p, &nLength);
+					p += nLength;
+				}
+				else
+				{
+					c = '\0';
+				}
+			}
+
+			if (nCount < (KEYVALUES_TOKEN_SIZE - 1))
+				pTokenBuf[nCount++] = c;
+		}
+
+		// unterminated string; let the buffered path run into the end of
+		// the buffer so it gets flagged as overflowed
+		if (!bTerminated)
+		{
+			m_Buffer.SeekGet(CUtlBuffer::SEEK_CURRENT, pQuote - pStart);
+			return ReadTokenBuffered(wasQuoted, wasConditional);
+		}
+
+		m_bPriorTokenWasQuoted = wasQuoted = true;
+		pTokenBuf[nCount] = 0;
+
+		m_Buffer.SeekGet(CUtlBuffer::SEEK_CURRENT, p - pStart);
+		++m_nTokensRead;
+		return pTokenBuf;
+	}
+
+	if (*p == '{' || *p == '}' || *p == '=')
+	{
+		// it's a control char, just add this one char and stop reading
+		pTokenBuf[0] = *p;
+		pTokenBuf[1] = 0;
+		m_Buffer.SeekGet(CUtlBuffer::SEEK_CURRENT, (p + 1) - pStart);
+		++m_nTokensRead;
+		return pTokenBuf;
+	}
+
+	// read in the token until we hit a whitespace or a control character
+	bool bReportedError = false;
+	bool bConditionalStart = false;
+
+	for (; p < pEnd; p++)
+	{
+		const char c = *p;
+
+		if (c == 0)
+			break;
+
+		// break if any control character appears in non quoted tokens
+		if (c == '"' || c == '{' || c == '}' || c == '=')
+			break;
+
+		if (c == '[')
+			bConditionalStart = true;
+
+		if (c == ']' && bConditionalStart)
+		{
+			m_bPriorTokenWasConditional = wasConditional = true;
+			bConditionalStart = false;
+		}
+
+		// break on whitespace
+		if (KeyValues_IsSpace(c) && !bConditionalStart)
+			break;
+
+		if (nCount < (KEYVALUES_TOKEN_SIZE - 1))
+		{
+			pTokenBuf[nCount++] = c;	// add char to buffer
+		}
+		else if (!bReportedError)
+		{
+			bReportedError = true;
+			g_KeyValuesErrorStack.ReportError(" ReadToken overflow");
+		}
+	}
+
+	pTokenBuf[nCount] = 0;
+	m_Buffer.SeekGet(CUtlBuffer::SEEK_CURRENT, p - pStart);
+	++m_nTokensRead;
+
+	return pTokenBuf;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads the next token through the buffer's accessors
+//-----------------------------------------------------------------------------
+const char* CKeyValuesTokenReader::ReadTokenBuffered(bool& wasQuoted, bool& wasConditional)
+{
+	char* const pTokenBuf = m_TokenBuf.Base();
+
 	// eating white spaces and remarks loop
 	while (true)
 	{
@@ -76,20 +292,20 @@ const char* CKeyValuesTokenReader::ReadToken(bool& wasQuoted, bool& wasCondition
 	{
 		m_bPriorTokenWasQuoted = wasQuoted = true;
 		m_Buffer.GetDelimitedString(m_pKeyValues->m_bHasEscapeSequences ? GetCStringCharConversion() : GetNoEscCharConversion(),
-			s_pTokenBuf, KEYVALUES_TOKEN_SIZE);
+			pTokenBuf, KEYVALUES_TOKEN_SIZE);
 
 		++m_nTokensRead;
-		return s_pTokenBuf;
+		return pTokenBuf;
 	}
 
 	if (*c == '{' || *c == '}' || *c == '=')
 	{
 		// it's a control char, just add this one char and stop reading
-		s_pTokenBuf[0] = *c;
-		s_pTokenBuf[1] = 0;
+		pTokenBuf[0] = *c;
+		pTokenBuf[1] = 0;
 		m_Buffer.GetChar();
 		++m_nTokensRead;
-		return s_pTokenBuf;
+		return pTokenBuf;
 	}
 
 	// read in the token until we hit a whitespace or a control character
@@ -123,7 +339,7 @@ const char* CKeyValuesTokenReader::ReadToken(bool& wasQuoted, bool& wasCondition
 
 		if (nCount < (KEYVALUES_TOKEN_SIZE - 1))
 		{
-			s_pTokenBuf[nCount++] = *c;	// add char to buffer
+			pTokenBuf[nCount++] = *c;	// add char to buffer
 		}
 		else if (!bReportedError)
 		{
@@ -133,10 +349,10 @@ const char* CKeyValuesTokenReader::ReadToken(bool& wasQuoted, bool& wasCondition
 
 		m_Buffer.GetChar();
 	}
-	s_pTokenBuf[nCount] = 0;
+	pTokenBuf[nCount] = 0;
 	++m_nTokensRead;
 
-	return s_pTokenBuf;
+	return pTokenBuf;
 }
 
 void CKeyValuesTokenReader::SeekBackOneToken()
@@ -150,4 +366,52 @@ void CKeyValuesTokenReader::SeekBackOneToken()
 	m_bUsePriorToken = true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: gets the symbols for a key name, through the cache of this parse
+// Input  : &hCaseInsensitiveSymbol -
+//			*pszName -
+// Output : case sensitive symbol
+//-----------------------------------------------------------------------------
+HKeySymbol CKeyValuesTokenReader::GetSymbolForKeyName(HKeySymbol& hCaseInsensitiveSymbol, const char* const pszName)
+{
+	if (!m_bFastPath)
+		return KeyValuesSystem()->GetSymbolForStringCaseSensitive(hCaseInsensitiveSymbol, pszName);
+
+	// FNV-1a
+	uint32 nHash = 2166136261u;
+	int nLength = 0;
+
+	for (; pszName[nLength] && nLength <= KEYVALUES_SYMBOL_CACHE_MAX_NAME; nLength++)
+	{
+		nHash = (nHash ^ uint8(pszName[nLength])) * 16777619u;
+	}
+
+	if (nLength > KEYVALUES_SYMBOL_CACHE_MAX_NAME)
+		return KeyValuesSystem()->GetSymbolForStringCaseSensitive(hCaseInsensitiveSymbol, pszName);
+
+	SymbolCacheEntry_s& entry = m_SymbolCache[nHash & (KEYVALUES_SYMBOL_CACHE_SIZE - 1)];
+
+	if (entry.nHash == nHash && entry.nNameLength == nLength &&
+		memcmp(m_SymbolNames.Base() + entry.nNameOffset, pszName, nLength) == 0)
+	{
+		hCaseInsensitiveSymbol = entry.hCaseInsensitive;
+		return entry.hCaseSensitive;
+	}
+
+	const HKeySymbol hCaseSensitiveSymbol = KeyValuesSystem()->GetSymbolForStringCaseSensitive(hCaseInsensitiveSymbol, pszName);
+
+	// Entries whose slot is taken over keep their name in the pool; stop
+	// caching once it's full rather than compacting it.
+	if (m_SymbolNames.Count() + nLength <= KEYVALUES_SYMBOL_CACHE_MAX_POOL)
+	{
+		entry.nHash = nHash;
+		entry.nNameOffset = m_SymbolNames.AddMultipleToTail(nLength, pszName);
+		entry.nNameLength = nLength;
+		entry.hCaseInsensitive = hCaseInsensitiveSymbol;
+		entry.hCaseSensitive = hCaseSensitiveSymbol;
+	}
+
+	return hCaseSensitiveSymbol;
+}
+
 #endif // KVTOKENREADER_H
@@ -0,0 +1,420 @@
+//===========================================================================//
+//
+// Purpose: Asynchronous HTTP requests on a single curl multi worker
+//
+// The bundled curl has no curl_multi_wakeup, so the worker waits on socket
+// activity with a short timeout while transfers are in flight, and sleeps on
+// a condition variable while it has nothing to do.
+//
+//===========================================================================//
+#include "tier1/cvar.h"
+#include "tier2/curlworker.h"
+
+//-----------------------------------------------------------------------------
+// constructors/destructors
+//-----------------------------------------------------------------------------
+CCURLWorker::CCURLWorker()
+	: multiHandle(nullptr)
+	, headers(nullptr)
+	, workerRunning(false)
+	, workerStopping(false)
+	, requestCount(0)
+	, failedCount(0)
+	, connectCount(0)
+	, peakInFlight(0)
+{
+}
+
+CCURLWorker::~CCURLWorker()
+{
+	// Shutdown() has to be called before the process exits, the thread is
+	// only detached here to avoid terminating if it wasn't; curl may already
+	// be torn down at this point so nothing else is cleaned up.
+	if (workerThread.joinable())
+		workerThread.detach();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: starts the worker and creates the multi handle, must be called
+//          with the worker mutex held
+// Output : true if the worker is running, false otherwise
+//-----------------------------------------------------------------------------
+bool CCURLWorker::StartWorker()
+{
+	if (workerThread.joinable())
+		return true;
+
+	multiHandle = curl_multi_init();
+
+	if (!multiHandle)
+	{
+		Error(eDLL_T::COMMON, NO_ERROR, "CURL: %s\n", "Multi init failed");
+		return false;
+	}
+
+	curl_multi_setopt(multiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, long(CURLWORKER_MAX_HOST_CONNECTIONS));
+	curl_multi_setopt(multiHandle, CURLMOPT_MAXCONNECTS, long(CURLWORKER_MAX_HOST_CONNECTIONS));
+
+	headers = CURLSlistAppend(nullptr, "Content-Type: application/json");
+
+	if (!headers)
+	{
+		curl_multi_cleanup(multiHandle);
+		multiHandle = nullptr;
+
+		return false;
+	}
+
+	workerRunning = true;
+	workerThread = std::thread(&CCURLWorker::WorkerRun, this);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: stops the worker, requests that haven't finished yet are failed;
+//          the worker is started again on the next request submitted after
+//          the shutdown completed
+//-----------------------------------------------------------------------------
+void CCURLWorker::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+
+		if (!workerThread.joinable() || workerStopping)
+			return;
+
+		workerRunning = false;
+		workerStopping = true;
+	}
+
+	workerCond.notify_all();
+	workerThread.join();
+
+	// Requests submitted after the worker took its last batch.
+	vector<Request_s*> abandoned;
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		abandoned.swap(pendingRequests);
+	}
+
+	for (Request_s* const req : abandoned)
+		Complete(req, CURLE_ABORTED_BY_CALLBACK);
+
+	for (CURL* const curl : freeHandles)
+		curl_easy_cleanup(curl);
+
+	freeHandles.clear();
+
+	curl_multi_cleanup(multiHandle);
+	multiHandle = nullptr;
+
+	curl_slist_free_all(headers);
+	headers = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		workerStopping = false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: queues a request, the callback is called on the worker thread
+// Input  : *remote   -
+//          *request  - the body to post, or nullptr for a GET request
+//          &params   -
+//          &callback -
+//-----------------------------------------------------------------------------
+void CCURLWorker::Submit(const char* remote, const char* request,
+	const CURLParams& params, const CURLWorkerCallback_t& callback)
+{
+	Request_s* req = new Request_s;
+
+	req->remote = remote;
+	req->post = request != nullptr;
+
+	if (request)
+		req->request = request;
+
+	req->params = params;
+	req->params.writeFunction = CURLWriteStringCallback;
+	req->callback = callback;
+	req->curl = nullptr;
+
+	CURLcode failCode = CURLE_FAILED_INIT;
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+
+		if (workerStopping)
+		{
+			// The worker might not pick it up anymore.
+			failCode = CURLE_ABORTED_BY_CALLBACK;
+		}
+		else if (StartWorker())
+		{
+			pendingRequests.push_back(req);
+			req = nullptr;
+		}
+	}
+
+	if (req)
+	{
+		Complete(req, failCode);
+		return;
+	}
+
+	workerCond.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: queues a request
+// Input  : *remote  -
+//          *request - the body to post, or nullptr for a GET request
+//          &params  -
+// Output : future that is set once the request finished or failed
+//-----------------------------------------------------------------------------
+std::future<CURLWorkerResult_s> CCURLWorker::Submit(const char* remote,
+	const char* request, const CURLParams& params)
+{
+	std::shared_ptr<std::promise<CURLWorkerResult_s>> promise =
+		std::make_shared<std::promise<CURLWorkerResult_s>>();
+
+	std::future<CURLWorkerResult_s> future = promise->get_future();
+
+	Submit(remote, request, params, [promise](CURLWorkerResult_s& result)
+		{
+			promise->set_value(std::move(result));
+		});
+
+	return future;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: the worker loop, drives all transfers until shutdown
+//-----------------------------------------------------------------------------
+void CCURLWorker::WorkerRun()
+{
+	vector<Request_s*> submitted;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(workerMutex);
+
+			// Only sleep when there are no transfers to drive.
+			if (activeRequests.empty())
+				workerCond.wait(lock, [this] { return !workerRunning || !pendingRequests.empty(); });
+
+			submitted.swap(pendingRequests);
+
+			if (!workerRunning)
+				break;
+		}
+
+		for (Request_s* const req : submitted)
+			StartTransfer(req);
+
+		submitted.clear();
+
+		int running = 0;
+		curl_multi_perform(multiHandle, &running);
+
+		FinishTransfers();
+
+		if (activeRequests.empty())
+			continue;
+
+		// Transfers that were waiting on a free connection get picked up on
+		// the next perform; curl reports them as an expired timer.
+		long timeoutMs = -1;
+		curl_multi_timeout(multiHandle, &timeoutMs);
+
+		if (timeoutMs == 0)
+			continue;
+
+		const int waitMs = timeoutMs > 0 && timeoutMs < CURLWORKER_POLL_INTERVAL_MS
+			? static_cast<int>(timeoutMs)
+			: CURLWORKER_POLL_INTERVAL_MS;
+
+		fd_set readSet;
+		fd_set writeSet;
+		fd_set exceptSet;
+
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		FD_ZERO(&exceptSet);
+
+		int maxFd = -1;
+		curl_multi_fdset(multiHandle, &readSet, &writeSet, &exceptSet, &maxFd);
+
+		// curl_multi_wait returns right away if curl has no sockets to wait
+		// on yet, e.g. while the name is being resolved; don't spin on it.
+		if (maxFd == -1)
+			std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+		else
+			curl_multi_wait(multiHandle, nullptr, 0, waitMs, nullptr);
+	}
+
+	// Fail everything that didn't finish, so each callback and future still
+	// gets a result.
+	for (Request_s* const req : submitted)
+		Complete(req, CURLE_ABORTED_BY_CALLBACK);
+
+	for (Request_s* const req : activeRequests)
+	{
+		curl_multi_remove_handle(multiHandle, req->curl);
+		ReleaseHandle(req->curl);
+
+		Complete(req, CURLE_ABORTED_BY_CALLBACK);
+	}
+
+	activeRequests.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: sets up the transfer of a request and adds it to the multi handle
+// Input  : *req -
+//-----------------------------------------------------------------------------
+void CCURLWorker::StartTransfer(Request_s* const req)
+{
+	CURL* const curl = AcquireHandle();
+
+	if (!curl)
+	{
+		Complete(req, CURLE_FAILED_INIT);
+		return;
+	}
+
+	CURLInitCommonOptions(curl, req->remote.c_str(), nullptr, &req->result.response, req->params, nullptr);
+
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
+
+	if (req->post)
+	{
+		curl_easy_setopt(curl, CURLOPT_POST, 1L);
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->request.c_str());
+	}
+
+	if (curl_multi_add_handle(multiHandle, curl) != CURLM_OK)
+	{
+		ReleaseHandle(curl);
+		Complete(req, CURLE_FAILED_INIT);
+
+		return;
+	}
+
+	req->curl = curl;
+	activeRequests.push_back(req);
+
+	const int numInFlight = static_cast<int>(activeRequests.size());
+
+	if (numInFlight > peakInFlight)
+		peakInFlight = numInFlight;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: completes all transfers the multi handle reported as done
+//-----------------------------------------------------------------------------
+void CCURLWorker::FinishTransfers()
+{
+	CURLMsg* msg;
+	int msgsLeft;
+
+	while ((msg = curl_multi_info_read(multiHandle, &msgsLeft)) != nullptr)
+	{
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+
+		// The message is freed once the handle is removed.
+		CURL* const curl = msg->easy_handle;
+		const CURLcode code = msg->data.result;
+
+		char* privateData = nullptr;
+		curl_easy_getinfo(curl, CURLINFO_PRIVATE, &privateData);
+
+		Request_s* const req = reinterpret_cast<Request_s*>(privateData);
+
+		long numConnects = 0;
+		curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &numConnects);
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &req->result.status);
+
+		connectCount += numConnects;
+
+		for (size_t i = 0; i < activeRequests.size(); i++)
+		{
+			if (activeRequests[i] == req)
+			{
+				activeRequests[i] = activeRequests.back();
+				activeRequests.pop_back();
+
+				break;
+			}
+		}
+
+		curl_multi_remove_handle(multiHandle, curl);
+		ReleaseHandle(curl);
+
+		Complete(req, code);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: runs the callback of a request and frees it
+// Input  : *req -
+//          code -
+//-----------------------------------------------------------------------------
+void CCURLWorker::Complete(Request_s* const req, const CURLcode code)
+{
+	req->result.code = code;
+
+	requestCount++;
+
+	if (code != CURLE_OK)
+		failedCount++;
+
+	if (req->callback)
+		req->callback(req->result);
+
+	delete req;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets an easy handle from the free list, or creates a new one
+//-----------------------------------------------------------------------------
+CURL* CCURLWorker::AcquireHandle()
+{
+	if (!freeHandles.empty())
+	{
+		CURL* const curl = freeHandles.back();
+		freeHandles.pop_back();
+
+		return curl;
+	}
+
+	CURL* const curl = curl_easy_init();
+
+	if (!curl)
+		Error(eDLL_T::COMMON, NO_ERROR, "CURL: %s\n", "Easy init failed");
+
+	return curl;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: returns an easy handle to the free list; its options are reset,
+//          the connections stay cached in the multi handle
+//-----------------------------------------------------------------------------
+void CCURLWorker::ReleaseHandle(CURL* const curl)
+{
+	if (freeHandles.size() >= CURLWORKER_MAX_FREE_HANDLES)
+	{
+		curl_easy_cleanup(curl);
+		return;
+	}
+
+	curl_easy_reset(curl);
+	freeHandles.push_back(curl);
+}
@@ -17,6 +17,7 @@
 CSocketCreator::CSocketCreator(void)
 {
 	m_hListenSocket = SOCKET_ERROR;
+	m_nNextSerial = 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -75,6 +76,8 @@ void CSocketCreator::ProcessAccept(void)
 //-----------------------------------------------------------------------------
 bool CSocketCreator::CreateListenSocket(const netadr_t& netAdr, bool bDualStack)
 {
+	AUTO_LOCK(m_Mutex);
+
 	CloseListenSocket();
 	m_hListenSocket = SocketHandle_t(::socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP));
 
@@ -115,6 +118,8 @@ bool CSocketCreator::CreateListenSocket(const netadr_t& netAdr, bool bDualStack)
 //-----------------------------------------------------------------------------
 void CSocketCreator::CloseListenSocket(void)
 {
+	AUTO_LOCK(m_Mutex);
+
 	if (m_hListenSocket != SOCKET_ERROR)
 	{
 		DisconnectSocket(m_hListenSocket);
@@ -266,8 +271,11 @@ bool CSocketCreator::ConfigureSocket(SocketHandle_t hSocket, bool bDualStack /*=
 //-----------------------------------------------------------------------------
 int CSocketCreator::OnSocketAccepted(SocketHandle_t hSocket, const netadr_t& netAdr)
 {
+	AUTO_LOCK(m_Mutex);
+
 	AcceptedSocket_t newEntry(hSocket);
 	newEntry.m_Address = netAdr;
+	newEntry.m_Data.m_nSerial = m_nNextSerial++;
 
 	m_AcceptedSockets.AddToTail(newEntry);
 
@@ -281,6 +289,8 @@ int CSocketCreator::OnSocketAccepted(SocketHandle_t hSocket, const netadr_t& net
 //-----------------------------------------------------------------------------
 void CSocketCreator::CloseAcceptedSocket(int nIndex)
 {
+	AUTO_LOCK(m_Mutex);
+
 	if (nIndex >= m_AcceptedSockets.Count())
 	{
 		Assert(0);
@@ -298,6 +308,8 @@ void CSocketCreator::CloseAcceptedSocket(int nIndex)
 //-----------------------------------------------------------------------------
 void CSocketCreator::CloseAllAcceptedSockets(void)
 {
+	AUTO_LOCK(m_Mutex);
+
 	for (int i = 0; i < m_AcceptedSockets.Count(); ++i)
 	{
 		AcceptedSocket_t& connected = m_AcceptedSockets[i];
@@ -395,3 +407,21 @@ const CConnectedNetConsoleData& CSocketCreator::GetAcceptedSocketData(int nIndex
 	Assert(nIndex >= 0 && nIndex < m_AcceptedSockets.Count());
 	return m_AcceptedSockets[nIndex].m_Data;
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: finds the index of an accepted socket by its handle
+// Input  : hSocket - 
+// Output : accepted socket index, -1 if not found
+//-----------------------------------------------------------------------------
+int CSocketCreator::FindAcceptedSocket(SocketHandle_t hSocket) const
+{
+	for (int i = 0; i < m_AcceptedSockets.Count(); ++i)
+	{
+		if (m_AcceptedSockets[i].m_hSocket == hSocket)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
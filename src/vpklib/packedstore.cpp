@@ -25,11 +25,17 @@
 // 
 /////////////////////////////////////////////////////////////////////////////////
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+#include "tier0/fasttimer.h"
+#include "tier0/threadpool.h"
 #include "tier1/keyvalues.h"
+#include "tier1/generichash.h"
 #include "tier2/fileutils.h"
 #include "mathlib/adler32.h"
 #include "mathlib/crc32.h"
-#include "mathlib/sha1.h"
 #include "localize/ilocalize.h"
 #include "vpklib/packedstore.h"
 
@@ -55,6 +61,22 @@ static lzham_compress_level DetermineCompressionLevel(const char* compressionLev
 		return lzham_compress_level::LZHAM_COMP_LEVEL_DEFAULT;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: constructor
+//-----------------------------------------------------------------------------
+CPackedStoreBuilder::CPackedStoreBuilder()
+{
+	memset(&m_Encoder, 0, sizeof(m_Encoder));
+	memset(&m_Decoder, 0, sizeof(m_Decoder));
+
+	m_nNumPackWorkers = 1;
+	m_iPackFileIndex = 0;
+
+	m_bIncremental = false;
+	m_nUnchangedCount = 0;
+	m_hPrevPackFile = FILESYSTEM_INVALID_HANDLE;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: initialize parameters for compression algorithm
 //-----------------------------------------------------------------------------
@@ -85,6 +107,34 @@ void CPackedStoreBuilder::InitLzDecoder(void)
 	m_Decoder.m_pSeed_bytes      = NULL;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: sets the number of hash/compress workers used for packing
+// Input  : numWorkers - (1 = serial, 0 = one per logical processor)
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::SetNumPackWorkers(const int numWorkers)
+{
+	int nWorkers = numWorkers;
+
+	if (nWorkers <= 0)
+	{
+		nWorkers = static_cast<int>(std::thread::hardware_concurrency());
+
+		if (nWorkers <= 0)
+			nWorkers = 1;
+	}
+
+	m_nNumPackWorkers = (std::min)(nWorkers, PACKSTORE_MAX_WORKERS);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: enables or disables incremental builds
+// Input  : bIncremental - 
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::SetIncremental(const bool bIncremental)
+{
+	m_bIncremental = bIncremental;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: gets the level name from the directory file name
 // Input  : &dirFileName - 
@@ -119,6 +169,53 @@ CUtlString PackedStore_GetDirNameParts(const CUtlString& dirFileName, const int
 	return regexMatches[nCaptureGroup].str().c_str();
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: gets the deduplication index file name for the pack file
+// Input  : &packFileName - 
+// Output : index file name as string (e.g. "server_mp_rr_box.bsp.pak000_000.dedup")
+//-----------------------------------------------------------------------------
+CUtlString PackedStore_GetDedupIndexFileName(const CUtlString& packFileName)
+{
+	CUtlString result = packFileName.StripExtension();
+	result.Append('.');
+	result.Append(VPK_DEDUP_INDEX_EXT);
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the build cache file name for the directory file
+// Input  : &dirFileName - 
+// Output : cache file name as string (e.g. "englishserver_mp_rr_box.bsp.pak000_dir.buildcache")
+//-----------------------------------------------------------------------------
+CUtlString PackedStore_GetBuildCacheFileName(const CUtlString& dirFileName)
+{
+	CUtlString result = dirFileName.StripExtension();
+	result.Append('.');
+	result.Append(VPK_BUILD_CACHE_EXT);
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: computes the 128-bit content hash of an uncompressed chunk
+// Input  : *pData - 
+//          nLen   - 
+// Output : chunk hash
+//-----------------------------------------------------------------------------
+VPKChunkHash_t PackedStore_HashChunk(const uint8_t* pData, const size_t nLen)
+{
+	uint64 hash[2];
+	MurmurHash3_128(pData, nLen, 0, hash);
+
+	VPKChunkHash_t result;
+
+	result.m_nLow = hash[0];
+	result.m_nHigh = hash[1];
+
+	return result;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: formats the file entry path
 // Input  : &filePath - 
@@ -383,297 +480,1385 @@ static void BuildManifest(const CUtlVector<VPKEntryBlock_t>& entryBlocks, const
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: validates extraction result with precomputed CRC32 hash
-// Input  : &assetPath - 
-//        : nFileCRC   - 
+// Purpose: attempts to deduplicate a chunk of data by comparing it to existing chunks
+// Input  : *pEntryBuffer   - 
+//          &chunkHash      - 
+//          &descriptor     - 
+//          &iPackFileIndex - index of the pack file containing the existing chunk
+//          chunkIndex      - 
+// Output : true if the chunk was deduplicated, false otherwise
 //-----------------------------------------------------------------------------
-static void ValidateCRC32PostDecomp(const CUtlString& assetPath, const uint32_t nFileCRC)
+bool CPackedStoreBuilder::Deduplicate(const uint8_t* pEntryBuffer, const VPKChunkHash_t& chunkHash, VPKChunkDescriptor_t& descriptor,
+	uint16_t& iPackFileIndex, const size_t chunkIndex)
 {
-	const char* pAssetPath = assetPath.Get();
+	VPKDedupEntry_t existing;
 
-	FileHandle_t hAsset = FileSystem()->Open(pAssetPath, "rb", "PLATFORM");
-	if (!hAsset)
+	if (!m_DedupIndex.Find(chunkHash, pEntryBuffer, descriptor.m_nUncompressedSize, existing))
 	{
-		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, pAssetPath);
-		return;
+		return false;
 	}
 
-	const ssize_t nLen = FileSystem()->Size(hAsset);
-	std::unique_ptr<uint8_t[]> pBuf(new uint8_t[nLen]);
+	// Map to existing chunk to avoid having copies of the same data.
+	Msg(eDLL_T::FS, "Mapping chunk '%zu' ('%016llx%016llx') to existing chunk at '0x%llx' in block '%hu'\n",
+		chunkIndex, chunkHash.m_nHigh, chunkHash.m_nLow, existing.m_nPackFileOffset, existing.m_iPackFileIndex);
 
-	FileSystem()->Read(pBuf.get(), nLen, hAsset);
-	FileSystem()->Close(hAsset);
+	descriptor.m_nLoadFlags = existing.m_nLoadFlags;
+	descriptor.m_nTextureFlags = existing.m_nTextureFlags;
+	descriptor.m_nPackFileOffset = existing.m_nPackFileOffset;
+	descriptor.m_nCompressedSize = existing.m_nCompressedSize;
+	descriptor.m_nUncompressedSize = existing.m_nUncompressedSize;
+
+	iPackFileIndex = existing.m_iPackFileIndex;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: assigns the pack file to the entry block once all of its chunks
+//          have been written or deduplicated. An entry block can only point
+//          into a single pack file, so if its chunks got mapped onto chunks
+//          in different pack files, the ones living in an earlier pack file
+//          are copied over into the pack file that is being built.
+// Input  : &entryBlock           - 
+//          &chunkPackFileIndices - pack file index of each chunk
+//          hPackFile             - 
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::FinalizeEntryBlock(VPKEntryBlock_t& entryBlock, const CUtlVector<uint16_t>& chunkPackFileIndices, FileHandle_t hPackFile)
+{
+	const uint16_t iFirstPackFileIndex = chunkPackFileIndices[0];
+	bool bSinglePackFile = true;
+
+	FOR_EACH_VEC(chunkPackFileIndices, i)
+	{
+		if (chunkPackFileIndices[i] != iFirstPackFileIndex)
+		{
+			bSinglePackFile = false;
+			break;
+		}
+	}
+
+	if (bSinglePackFile)
+	{
+		entryBlock.m_iPackFileIndex = iFirstPackFileIndex;
+		return;
+	}
 
-	uint32_t nCrc32 = crc32::update(NULL, pBuf.get(), nLen);
-	if (nCrc32 != nFileCRC)
+	entryBlock.m_iPackFileIndex = m_iPackFileIndex;
+
+	FOR_EACH_VEC(entryBlock.m_Fragments, i)
 	{
-		Warning(eDLL_T::FS, "Computed checksum '0x%lX' doesn't match expected checksum '0x%lX'. File may be corrupt!\n", nCrc32, nFileCRC);
+		if (chunkPackFileIndices[i] == m_iPackFileIndex)
+		{
+			continue;
+		}
+
+		VPKChunkDescriptor_t& descriptor = entryBlock.m_Fragments[i];
+		const uint8_t* pRawChunk = m_DedupIndex.ReadRawChunk(chunkPackFileIndices[i], descriptor);
+
+		if (!pRawChunk)
+		{
+			Error(eDLL_T::FS, NO_ERROR, "%s - Unable to copy chunk '%i' of '%s' from block '%hu'; entry will be corrupt!\n",
+				__FUNCTION__, i, entryBlock.m_EntryPath.Get(), chunkPackFileIndices[i]);
+			continue;
+		}
+
+		descriptor.m_nPackFileOffset = FileSystem()->Tell(hPackFile);
+		FileSystem()->Write(pRawChunk, descriptor.m_nCompressedSize, hPackFile);
 	}
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: attempts to deduplicate a chunk of data by comparing it to existing chunks
-// Input  : *pEntryBuffer - 
-//          &descriptor   - 
-//          chunkIndex    - 
-// Output : true if the chunk was deduplicated, false otherwise
+// Purpose: prepares an incremental build against the previous build of the
+//          pack file. The previous pack file is moved aside, so unchanged
+//          chunks can be copied from it while the new one is being written.
+// Input  : &dirFilePath  - 
+//          &packFilePath - 
+// Output : true if the previous build can be reused, false otherwise
 //-----------------------------------------------------------------------------
-bool CPackedStoreBuilder::Deduplicate(const uint8_t* pEntryBuffer, VPKChunkDescriptor_t& descriptor, const size_t chunkIndex)
+bool CPackedStoreBuilder::InitIncrementalBuild(const CUtlString& dirFilePath, const CUtlString& packFilePath)
 {
-	string entryHash(reinterpret_cast<const char*>(pEntryBuffer), descriptor.m_nUncompressedSize);
-	entryHash = sha1(entryHash);
+	if (!FileSystem()->FileExists(dirFilePath.Get(), "GAME"))
+	{
+		Warning(eDLL_T::FS, "No previous directory file '%s'; performing full build\n", dirFilePath.Get());
+		return false;
+	}
 
-	auto p = m_ChunkHashMap.insert({ entryHash.c_str(), descriptor });
-	if (!p.second) // Map to existing chunk to avoid having copies of the same data.
+	m_pPrevDir.reset(new VPKDir_t(dirFilePath));
+
+	if (m_pPrevDir->Failed())
 	{
-		Msg(eDLL_T::FS, "Mapping chunk '%zu' ('%s') to existing chunk at '0x%llx'\n",
-			chunkIndex, entryHash.c_str(), p.first->second.m_nPackFileOffset);
-		descriptor = p.first->second;
+		Warning(eDLL_T::FS, "Unable to load previous directory file '%s'; performing full build\n", dirFilePath.Get());
+		m_pPrevDir.reset();
 
-		return true;
+		return false;
 	}
 
-	return false;
+	if (FileSystem()->FileExists(packFilePath.Get(), "GAME"))
+	{
+		CUtlString prevPackFilePath;
+		prevPackFilePath.Format("%s.%s", packFilePath.Get(), VPK_PREV_PACK_FILE_EXT);
+
+		// Left over from an interrupted build.
+		FileSystem()->RemoveFile(prevPackFilePath.Get(), "GAME");
+
+		if (!FileSystem()->RenameFile(packFilePath.Get(), prevPackFilePath.Get(), "GAME"))
+		{
+			Warning(eDLL_T::FS, "Unable to move '%s' aside; performing full build\n", packFilePath.Get());
+			m_pPrevDir.reset();
+
+			return false;
+		}
+
+		m_hPrevPackFile = FileSystem()->Open(prevPackFilePath.Get(), "rb", "GAME");
+
+		if (!m_hPrevPackFile)
+		{
+			Warning(eDLL_T::FS, "Unable to open '%s'; performing full build\n", prevPackFilePath.Get());
+
+			FileSystem()->RenameFile(prevPackFilePath.Get(), packFilePath.Get(), "GAME");
+			m_pPrevDir.reset();
+
+			return false;
+		}
+
+		if (!m_pCopyBuffer)
+		{
+			m_pCopyBuffer.reset(new uint8_t[VPK_ENTRY_MAX_LEN]);
+		}
+
+		LoadPrevChunkHashes(packFilePath);
+	}
+
+	FOR_EACH_VEC(m_pPrevDir->m_EntryBlocks, i)
+	{
+		m_PrevEntryMap[m_pPrevDir->m_EntryBlocks[i].m_EntryPath.Get()] = i;
+	}
+
+	LoadBuildCache(dirFilePath);
+
+	Msg(eDLL_T::FS, "Incremental build against '%s' ('%i' entries)\n", dirFilePath.Get(), m_pPrevDir->m_EntryBlocks.Count());
+	return true;
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: packs all files from workspace path into VPK file
-// Input  : &vpkPair       - 
-//          *workspaceName - 
-//          *buildPath     - 
+// Purpose: releases the previous build of the pack file
+// Input  : &packFilePath     - 
+//          bRestorePackFile - move the previous pack file back in place
 //-----------------------------------------------------------------------------
-void CPackedStoreBuilder::PackStore(const VPKPair_t& vpkPair, const char* workspaceName, const char* buildPath)
+void CPackedStoreBuilder::ShutdownIncrementalBuild(const CUtlString& packFilePath, const bool bRestorePackFile)
 {
-	CUtlString workspacePath(workspaceName);
-	workspacePath.AppendSlash();
-	workspacePath.FixSlashes('/');
+	if (m_hPrevPackFile)
+	{
+		FileSystem()->Close(m_hPrevPackFile);
+		m_hPrevPackFile = FILESYSTEM_INVALID_HANDLE;
 
-	CUtlVector<VPKKeyValues_t> entryValues;
-	CUtlVector<VPKEntryBlock_t> entryBlocks;
+		CUtlString prevPackFilePath;
+		prevPackFilePath.Format("%s.%s", packFilePath.Get(), VPK_PREV_PACK_FILE_EXT);
 
-	// NOTE: we get the entry values prior to opening the file, because if we
-	// don't have a valid manifest file, we won't be able to build the store.
-	// If we had already opened the pack file, and a one already existed, it
-	// would be emptied out ("wb" flag) which we want to avoid here.
-	if (!GetEntryValues(entryValues, workspacePath, vpkPair.m_DirName))
+		if (bRestorePackFile)
+			FileSystem()->RenameFile(prevPackFilePath.Get(), packFilePath.Get(), "GAME");
+		else
+			FileSystem()->RemoveFile(prevPackFilePath.Get(), "GAME");
+	}
+
+	m_pPrevDir.reset();
+
+	m_PrevEntryMap.clear();
+	m_PrevChunkHashes.clear();
+	m_CopiedChunkMap.clear();
+	m_PrevBuildCache.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: loads the chunk hashes of the previous build of the pack file, so
+//          copied chunks can still be deduplicated against
+// Input  : &packFilePath - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreBuilder::LoadPrevChunkHashes(const CUtlString& packFilePath)
+{
+	const CUtlString indexFilePath = PackedStore_GetDedupIndexFileName(packFilePath);
+	const char* pIndexFilePath = indexFilePath.Get();
+
+	FileHandle_t hIndexFile = FileSystem()->Open(pIndexFilePath, "rb", "GAME");
+	if (!hIndexFile)
 	{
-		return;
+		return false;
 	}
 
-	std::unique_ptr<uint8_t[]> pEntryBuffer(new uint8_t[VPK_ENTRY_MAX_LEN]);
+	VPKDedupHeader_t header;
+	const ssize_t nIndexSize = FileSystem()->Size(hIndexFile);
 
-	if (!pEntryBuffer)
+	if (FileSystem()->Read(&header, sizeof(header), hIndexFile) != static_cast<ssize_t>(sizeof(header)) ||
+		header.m_nHeaderMarker != VPK_DEDUP_INDEX_MARKER ||
+		header.m_nVersion != VPK_DEDUP_INDEX_VERSION ||
+		header.m_iPackFileIndex != m_iPackFileIndex ||
+		header.m_nPackFileSize != uint64_t(FileSystem()->Size(m_hPrevPackFile)) ||
+		header.m_nEntryCount > (static_cast<size_t>(nIndexSize) - sizeof(header)) / sizeof(VPKDedupEntry_t))
 	{
-		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to allocate chunk buffer!\n", __FUNCTION__);
-		return;
+		Warning(eDLL_T::FS, "Deduplication index '%s' is stale; reused chunks won't be shared\n", pIndexFilePath);
+		FileSystem()->Close(hIndexFile);
+
+		return false;
 	}
 
-	CUtlString packFilePath;
-	CUtlString dirFilePath;
+	for (uint64_t i = 0; i < header.m_nEntryCount; i++)
+	{
+		VPKDedupEntry_t entry;
+		FileSystem()->Read(&entry, sizeof(entry), hIndexFile);
 
-	packFilePath.Format("%s%s", buildPath, vpkPair.m_PackName.Get());
-	dirFilePath.Format("%s%s", buildPath, vpkPair.m_DirName.Get());
+		m_PrevChunkHashes[entry.m_nPackFileOffset] = entry.m_Hash;
+	}
 
-	FileSystem()->CreateDirHierarchy(packFilePath.DirName().Get(), "GAME");
-	FileHandle_t hPackFile = FileSystem()->Open(packFilePath.Get(), "wb", "GAME");
-	if (!hPackFile)
+	FileSystem()->Close(hIndexFile);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds the entry block of the previous build if the file did not
+//          change since. Without data, the file is only compared against
+//          the build cache; with data, the contents are compared against
+//          the size and crc of the previous entry block
+// Input  : &entryValue - 
+//          *pEntryPath - 
+//          &fileInfo   - 
+//          *pData      - (optional)
+// Output : pointer to previous entry block, nullptr if changed
+//-----------------------------------------------------------------------------
+const VPKEntryBlock_t* CPackedStoreBuilder::FindUnchangedEntry(const VPKKeyValues_t& entryValue, const char* pEntryPath,
+	const VPKBuildCacheEntry_t& fileInfo, const uint8_t* pData) const
+{
+	const auto it = m_PrevEntryMap.find(pEntryPath);
+
+	if (it == m_PrevEntryMap.end())
 	{
-		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, packFilePath.Get());
-		return;
+		return nullptr;
 	}
 
-	size_t nSharedTotal = NULL;
-	size_t nSharedCount = NULL;
+	const VPKEntryBlock_t& prevEntry = m_pPrevDir->m_EntryBlocks[it->second];
 
-	FOR_EACH_VEC(entryValues, i)
+	// Entries in earlier pack files are referenced as is, entries in this
+	// pack file can only be reused if its previous build is available.
+	if (prevEntry.m_iPackFileIndex > m_iPackFileIndex ||
+		(prevEntry.m_iPackFileIndex == m_iPackFileIndex && !m_hPrevPackFile))
 	{
-		const VPKKeyValues_t& entryValue = entryValues[i];
-		const char* pEntryPath = entryValue.m_EntryPath.Get();
+		return nullptr;
+	}
 
-		FileHandle_t hAsset = FileSystem()->Open(pEntryPath, "rb", "PLATFORM");
+	if (prevEntry.m_iPreloadSize != entryValue.m_iPreloadSize)
+	{
+		return nullptr;
+	}
 
-		if (!hAsset)
+	uint64_t nPrevFileSize = 0;
+
+	FOR_EACH_VEC(prevEntry.m_Fragments, i)
+	{
+		const VPKChunkDescriptor_t& fragment = prevEntry.m_Fragments[i];
+
+		// Compression got disabled for this entry since.
+		if (!entryValue.m_bUseCompression && fragment.m_nCompressedSize != fragment.m_nUncompressedSize)
 		{
-			Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, pEntryPath);
-			continue;
+			return nullptr;
 		}
 
-		const char* szDestPath = (pEntryPath + workspacePath.Length());
-		if (PATHSEPARATOR(szDestPath[0]))
+		nPrevFileSize += fragment.m_nUncompressedSize;
+	}
+
+	if (nPrevFileSize != fileInfo.m_nFileSize)
+	{
+		return nullptr;
+	}
+
+	if (!pData)
+	{
+		const auto ct = m_PrevBuildCache.find(pEntryPath);
+
+		if (ct == m_PrevBuildCache.end() ||
+			ct->second.m_nFileTime != fileInfo.m_nFileTime ||
+			ct->second.m_nFileSize != fileInfo.m_nFileSize)
 		{
-			szDestPath++;
+			return nullptr;
 		}
 
-		const ssize_t nLen = FileSystem()->Size(hAsset);
-		std::unique_ptr<uint8_t[]> pBuf(new uint8_t[nLen]);
+		return &prevEntry;
+	}
 
-		FileSystem()->Read(pBuf.get(), nLen, hAsset);
-		FileSystem()->Seek(hAsset, 0, FileSystemSeek_t::FILESYSTEM_SEEK_HEAD);
+	if (crc32::update(NULL, pData, fileInfo.m_nFileSize) != prevEntry.m_nFileCRC)
+	{
+		return nullptr;
+	}
 
-		Msg(eDLL_T::FS, "Packing entry '%i' ('%s')\n", i, szDestPath);
-		int index = entryBlocks.AddToTail(VPKEntryBlock_t(
-			pBuf.get(),
-			nLen,
-			FileSystem()->Tell(hPackFile),
-			entryValue.m_iPreloadSize,
-			0,
-			entryValue.m_nLoadFlags,
-			entryValue.m_nTextureFlags,
-			CUtlString(szDestPath)));
+	return &prevEntry;
+}
 
-		VPKEntryBlock_t& entryBlock = entryBlocks[index];
+//-----------------------------------------------------------------------------
+// Purpose: copies the compressed chunks of an unchanged entry from the
+//          previous build of the pack file into the pack file
+// Input  : &entryBlock - (copy of the previous entry block)
+//          &entryValue - 
+//          hPackFile   - 
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::CopyUnchangedEntry(VPKEntryBlock_t& entryBlock, const VPKKeyValues_t& entryValue, FileHandle_t hPackFile)
+{
+	// Flags aren't part of the chunk data, take them from the manifest.
+	FOR_EACH_VEC(entryBlock.m_Fragments, i)
+	{
+		entryBlock.m_Fragments[i].m_nLoadFlags = entryValue.m_nLoadFlags;
+		entryBlock.m_Fragments[i].m_nTextureFlags = entryValue.m_nTextureFlags;
+	}
 
-		FOR_EACH_VEC(entryBlock.m_Fragments, j)
+	if (entryBlock.m_iPackFileIndex != m_iPackFileIndex)
+	{
+		// Still lives in an earlier pack file.
+		return;
+	}
+
+	FOR_EACH_VEC(entryBlock.m_Fragments, i)
+	{
+		VPKChunkDescriptor_t& descriptor = entryBlock.m_Fragments[i];
+		const uint64_t nPrevOffset = descriptor.m_nPackFileOffset;
+
+		// Chunk is shared with an entry that has already been copied.
+		const auto it = m_CopiedChunkMap.find(nPrevOffset);
+
+		if (it != m_CopiedChunkMap.end())
 		{
-			VPKChunkDescriptor_t& descriptor = entryBlock.m_Fragments[j];
+			descriptor.m_nPackFileOffset = it->second;
+			continue;
+		}
 
-			FileSystem()->Read(pEntryBuffer.get(), descriptor.m_nCompressedSize, hAsset);
-			descriptor.m_nPackFileOffset = FileSystem()->Tell(hPackFile);
+		if (descriptor.m_nCompressedSize > VPK_ENTRY_MAX_LEN)
+		{
+			Error(eDLL_T::FS, NO_ERROR, "%s - Chunk '%i' of '%s' exceeds '%u' bytes; entry will be corrupt!\n",
+				__FUNCTION__, i, entryBlock.m_EntryPath.Get(), VPK_ENTRY_MAX_LEN);
+			continue;
+		}
 
-			if (entryValue.m_bDeduplicate && Deduplicate(pEntryBuffer.get(), descriptor, j))
-			{
-				nSharedTotal += descriptor.m_nCompressedSize;
-				nSharedCount++;
+		FileSystem()->Seek(m_hPrevPackFile, nPrevOffset, FileSystemSeek_t::FILESYSTEM_SEEK_HEAD);
 
-				// Data was deduplicated.
-				continue;
-			}
+		if (FileSystem()->Read(m_pCopyBuffer.get(), descriptor.m_nCompressedSize, m_hPrevPackFile) != static_cast<ssize_t>(descriptor.m_nCompressedSize))
+		{
+			Error(eDLL_T::FS, NO_ERROR, "%s - Unable to copy chunk '%i' of '%s'; entry will be corrupt!\n",
+				__FUNCTION__, i, entryBlock.m_EntryPath.Get());
+			continue;
+		}
 
-			if (entryValue.m_bUseCompression)
-			{
-				lzham_compress_status_t lzCompStatus = lzham_compress_memory(&m_Encoder, pEntryBuffer.get(), &descriptor.m_nCompressedSize, pEntryBuffer.get(),
-					descriptor.m_nUncompressedSize, nullptr);
+		descriptor.m_nPackFileOffset = FileSystem()->Tell(hPackFile);
+		FileSystem()->Write(m_pCopyBuffer.get(), descriptor.m_nCompressedSize, hPackFile);
 
-				if (lzCompStatus != lzham_compress_status_t::LZHAM_COMP_STATUS_SUCCESS)
-				{
-					Warning(eDLL_T::FS, "Status '%d' for chunk '%i' within entry '%i' in block '%hu' (chunk packed without compression)\n",
-						lzCompStatus, j, i, entryBlock.m_iPackFileIndex);
+		m_CopiedChunkMap[nPrevOffset] = descriptor.m_nPackFileOffset;
 
-					descriptor.m_nCompressedSize = descriptor.m_nUncompressedSize;
-				}
-			}
-			else // Write data uncompressed.
-			{
-				descriptor.m_nCompressedSize = descriptor.m_nUncompressedSize;
-			}
+		if (entryValue.m_bDeduplicate)
+		{
+			const auto ht = m_PrevChunkHashes.find(nPrevOffset);
 
-			FileSystem()->Write(pEntryBuffer.get(), descriptor.m_nCompressedSize, hPackFile);
+			if (ht != m_PrevChunkHashes.end())
+				m_DedupIndex.Insert(ht->second, descriptor);
 		}
-
-		FileSystem()->Close(hAsset);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: loads the build cache of the previous build
+// Input  : &dirFilePath - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreBuilder::LoadBuildCache(const CUtlString& dirFilePath)
+{
+	const CUtlString cacheFilePath = PackedStore_GetBuildCacheFileName(dirFilePath);
+	const char* pCacheFilePath = cacheFilePath.Get();
+
+	FileHandle_t hCacheFile = FileSystem()->Open(pCacheFilePath, "rb", "GAME");
+	if (!hCacheFile)
+	{
+		Warning(eDLL_T::FS, "No build cache '%s'; every entry will be read\n", pCacheFilePath);
+		return false;
+	}
+
+	uint32_t nMarker = 0;
+	uint16_t nVersion = 0;
+	uint32_t nEntryCount = 0;
+
+	FileSystem()->Read(&nMarker, sizeof(uint32_t), hCacheFile);
+	FileSystem()->Read(&nVersion, sizeof(uint16_t), hCacheFile);
+	FileSystem()->Read(&nEntryCount, sizeof(uint32_t), hCacheFile);
+
+	if (nMarker != VPK_BUILD_CACHE_MARKER || nVersion != VPK_BUILD_CACHE_VERSION)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "Unsupported build cache '%s' (invalid header criteria)\n", pCacheFilePath);
+		FileSystem()->Close(hCacheFile);
+
+		return false;
+	}
+
+	for (uint32_t i = 0; i < nEntryCount; i++)
+	{
+		const CUtlString entryPath = FileSystem()->ReadString(hCacheFile);
+		VPKBuildCacheEntry_t& entry = m_PrevBuildCache[entryPath.Get()];
+
+		FileSystem()->Read(&entry.m_nFileTime, sizeof(int64_t), hCacheFile);
+		FileSystem()->Read(&entry.m_nFileSize, sizeof(uint64_t), hCacheFile);
+	}
+
+	FileSystem()->Close(hCacheFile);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: saves the build cache of the current build
+// Input  : &dirFilePath - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreBuilder::SaveBuildCache(const CUtlString& dirFilePath) const
+{
+	const CUtlString cacheFilePath = PackedStore_GetBuildCacheFileName(dirFilePath);
+	const char* pCacheFilePath = cacheFilePath.Get();
+
+	FileHandle_t hCacheFile = FileSystem()->Open(pCacheFilePath, "wb", "GAME");
+	if (!hCacheFile)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, pCacheFilePath);
+		return false;
+	}
+
+	const uint32_t nMarker = VPK_BUILD_CACHE_MARKER;
+	const uint16_t nVersion = VPK_BUILD_CACHE_VERSION;
+	const uint32_t nEntryCount = static_cast<uint32_t>(m_BuildCache.size());
+
+	FileSystem()->Write(&nMarker, sizeof(uint32_t), hCacheFile);
+	FileSystem()->Write(&nVersion, sizeof(uint16_t), hCacheFile);
+	FileSystem()->Write(&nEntryCount, sizeof(uint32_t), hCacheFile);
+
+	for (const auto& it : m_BuildCache)
+	{
+		FileSystem()->Write(it.first.c_str(), it.first.length() + 1, hCacheFile);
+		FileSystem()->Write(&it.second.m_nFileTime, sizeof(int64_t), hCacheFile);
+		FileSystem()->Write(&it.second.m_nFileSize, sizeof(uint64_t), hCacheFile);
+	}
+
+	FileSystem()->Close(hCacheFile);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: packs all entries into the pack file on the calling thread
+// Input  : &entryValues   - 
+//          &entryBlocks   - 
+//          &workspacePath - 
+//          hPackFile      - 
+//          &nSharedTotal  - 
+//          &nSharedCount  - 
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::PackEntriesSerial(const CUtlVector<VPKKeyValues_t>& entryValues, CUtlVector<VPKEntryBlock_t>& entryBlocks,
+	const CUtlString& workspacePath, FileHandle_t hPackFile, size_t& nSharedTotal, size_t& nSharedCount)
+{
+	std::unique_ptr<uint8_t[]> pEntryBuffer(new uint8_t[VPK_ENTRY_MAX_LEN]);
+
+	if (!pEntryBuffer)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to allocate chunk buffer!\n", __FUNCTION__);
+		return;
+	}
+
+	FOR_EACH_VEC(entryValues, i)
+	{
+		const VPKKeyValues_t& entryValue = entryValues[i];
+		const char* pEntryPath = entryValue.m_EntryPath.Get();
+
+		FileHandle_t hAsset = FileSystem()->Open(pEntryPath, "rb", "PLATFORM");
+
+		if (!hAsset)
+		{
+			Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, pEntryPath);
+			continue;
+		}
+
+		const char* szDestPath = (pEntryPath + workspacePath.Length());
+		if (PATHSEPARATOR(szDestPath[0]))
+		{
+			szDestPath++;
+		}
+
+		const ssize_t nLen = FileSystem()->Size(hAsset);
+
+		VPKBuildCacheEntry_t fileInfo;
+		fileInfo.m_nFileTime = FileSystem()->GetFileTime(pEntryPath, "PLATFORM");
+		fileInfo.m_nFileSize = nLen;
+
+		m_BuildCache[szDestPath] = fileInfo;
+
+		const VPKEntryBlock_t* pUnchangedEntry = FindUnchangedEntry(entryValue, szDestPath, fileInfo, nullptr);
+		std::unique_ptr<uint8_t[]> pBuf;
+
+		if (!pUnchangedEntry)
+		{
+			pBuf.reset(new uint8_t[nLen]);
+
+			FileSystem()->Read(pBuf.get(), nLen, hAsset);
+			FileSystem()->Seek(hAsset, 0, FileSystemSeek_t::FILESYSTEM_SEEK_HEAD);
+
+			pUnchangedEntry = FindUnchangedEntry(entryValue, szDestPath, fileInfo, pBuf.get());
+		}
+
+		if (pUnchangedEntry)
+		{
+			Msg(eDLL_T::FS, "Reusing entry '%i' ('%s')\n", i, szDestPath);
+
+			const int index = entryBlocks.AddToTail(*pUnchangedEntry);
+			CopyUnchangedEntry(entryBlocks[index], entryValue, hPackFile);
+
+			m_nUnchangedCount++;
+			FileSystem()->Close(hAsset);
+
+			continue;
+		}
+
+		Msg(eDLL_T::FS, "Packing entry '%i' ('%s')\n", i, szDestPath);
+		int index = entryBlocks.AddToTail(VPKEntryBlock_t(
+			pBuf.get(),
+			nLen,
+			FileSystem()->Tell(hPackFile),
+			entryValue.m_iPreloadSize,
+			m_iPackFileIndex,
+			entryValue.m_nLoadFlags,
+			entryValue.m_nTextureFlags,
+			CUtlString(szDestPath)));
+
+		VPKEntryBlock_t& entryBlock = entryBlocks[index];
+		CUtlVector<uint16_t> chunkPackFileIndices;
+
+		FOR_EACH_VEC(entryBlock.m_Fragments, j)
+		{
+			VPKChunkDescriptor_t& descriptor = entryBlock.m_Fragments[j];
+
+			FileSystem()->Read(pEntryBuffer.get(), descriptor.m_nCompressedSize, hAsset);
+			descriptor.m_nPackFileOffset = FileSystem()->Tell(hPackFile);
+
+			uint16_t iChunkPackFileIndex = m_iPackFileIndex;
+			VPKChunkHash_t chunkHash = {};
+
+			if (entryValue.m_bDeduplicate)
+			{
+				chunkHash = PackedStore_HashChunk(pEntryBuffer.get(), descriptor.m_nUncompressedSize);
+
+				if (Deduplicate(pEntryBuffer.get(), chunkHash, descriptor, iChunkPackFileIndex, j))
+				{
+					chunkPackFileIndices.AddToTail(iChunkPackFileIndex);
+
+					nSharedTotal += descriptor.m_nCompressedSize;
+					nSharedCount++;
+
+					// Data was deduplicated.
+					continue;
+				}
+			}
+
+			if (entryValue.m_bUseCompression)
+			{
+				lzham_compress_status_t lzCompStatus = lzham_compress_memory(&m_Encoder, pEntryBuffer.get(), &descriptor.m_nCompressedSize, pEntryBuffer.get(),
+					descriptor.m_nUncompressedSize, nullptr);
+
+				if (lzCompStatus != lzham_compress_status_t::LZHAM_COMP_STATUS_SUCCESS)
+				{
+					Warning(eDLL_T::FS, "Status '%d' for chunk '%i' within entry '%i' in block '%hu' (chunk packed without compression)\n",
+						lzCompStatus, j, i, entryBlock.m_iPackFileIndex);
+
+					descriptor.m_nCompressedSize = descriptor.m_nUncompressedSize;
+				}
+			}
+			else // Write data uncompressed.
+			{
+				descriptor.m_nCompressedSize = descriptor.m_nUncompressedSize;
+			}
+
+			FileSystem()->Write(pEntryBuffer.get(), descriptor.m_nCompressedSize, hPackFile);
+			chunkPackFileIndices.AddToTail(iChunkPackFileIndex);
+
+			if (entryValue.m_bDeduplicate)
+			{
+				m_DedupIndex.Insert(chunkHash, descriptor);
+			}
+		}
+
+		FinalizeEntryBlock(entryBlock, chunkPackFileIndices, hPackFile);
+		FileSystem()->Close(hAsset);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// A single chunk travelling through the parallel pack pipeline. Jobs are
+// recycled through a fixed pool, so the amount of chunk memory in flight
+// is bounded by the pool size rather than the size of the workspace.
+//-----------------------------------------------------------------------------
+struct VPKPackJob_t
+{
+	std::unique_ptr<uint8_t[]> m_pSourceBuffer;
+	std::unique_ptr<uint8_t[]> m_pCompressBuffer;
+
+	// Only set on the first chunk of an entry, ownership
+	// is transferred to the writer which adds it to the
+	// directory tree in manifest order.
+	VPKEntryBlock_t* m_pEntryBlock;
+
+	int     m_iEntryIndex;
+	int     m_iChunkIndex;
+	size_t  m_nUncompressedSize;
+	size_t  m_nCompressedSize;
+
+	lzham_compress_status_t m_CompStatus;
+	VPKChunkHash_t m_ChunkHash;
+
+	bool    m_bUseCompression;
+	bool    m_bDeduplicate;
+	bool    m_bUnchanged; // Entry is copied from the previous build.
+	bool    m_bFinished;
+
+	VPKPackJob_t()
+		: m_pSourceBuffer(new uint8_t[VPK_ENTRY_MAX_LEN])
+		, m_pCompressBuffer(new uint8_t[VPK_ENTRY_MAX_LEN])
+		, m_pEntryBlock(nullptr)
+		, m_iEntryIndex(0)
+		, m_iChunkIndex(0)
+		, m_nUncompressedSize(0)
+		, m_nCompressedSize(0)
+		, m_CompStatus(lzham_compress_status_t::LZHAM_COMP_STATUS_NOT_FINISHED)
+		, m_ChunkHash()
+		, m_bUseCompression(false)
+		, m_bDeduplicate(false)
+		, m_bUnchanged(false)
+		, m_bFinished(false)
+	{
+	}
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: packs all entries into the pack file using a reader thread, a pool
+//          of hash/compress workers and an ordered writer on the calling
+//          thread. Chunks are written and deduplicated in manifest order, so
+//          the resulting pack is byte-identical to 'PackEntriesSerial'.
+// Input  : &entryValues   - 
+//          &entryBlocks   - 
+//          &workspacePath - 
+//          hPackFile      - 
+//          &nSharedTotal  - 
+//          &nSharedCount  - 
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::PackEntriesParallel(const CUtlVector<VPKKeyValues_t>& entryValues, CUtlVector<VPKEntryBlock_t>& entryBlocks,
+	const CUtlString& workspacePath, FileHandle_t hPackFile, size_t& nSharedTotal, size_t& nSharedCount)
+{
+	const int numWorkers = m_nNumPackWorkers;
+
+	// Each worker runs its own compressor, don't let LZHAM spawn additional
+	// helper threads on top of that. Deterministic parsing guarantees the
+	// output is identical regardless of the helper thread count.
+	lzham_compress_params workerEncoder = m_Encoder;
+	workerEncoder.m_max_helper_threads = 0;
+
+	// Enough jobs to keep every worker busy while the
+	// reader fills and the writer drains the pipeline.
+	std::vector<VPKPackJob_t> jobPool(numWorkers * 2 + 2);
+
+	std::mutex mutex;
+	std::condition_variable freeCond;
+	std::condition_variable workCond;
+	std::condition_variable doneCond;
+
+	std::deque<VPKPackJob_t*> freeQueue;
+	std::deque<VPKPackJob_t*> workQueue;
+	std::deque<VPKPackJob_t*> writeQueue; // In manifest order.
+
+	bool readerDone = false;
+
+	for (VPKPackJob_t& job : jobPool)
+		freeQueue.push_back(&job);
+
+	CCycleCount readTime, readStallTime;
+	CCycleCount hashTime, compressTime;
+	CCycleCount writeTime, writeStallTime;
+
+	std::thread readerThread([&]()
+	{
+		const auto acquireJob = [&]() -> VPKPackJob_t*
+		{
+			CTimeAdder stallTimer(&readStallTime);
+			std::unique_lock<std::mutex> lock(mutex);
+
+			freeCond.wait(lock, [&]() { return !freeQueue.empty(); });
+
+			VPKPackJob_t* pJob = freeQueue.front();
+			freeQueue.pop_front();
+
+			return pJob;
+		};
+
+		FOR_EACH_VEC(entryValues, i)
+		{
+			const VPKKeyValues_t& entryValue = entryValues[i];
+			const char* pEntryPath = entryValue.m_EntryPath.Get();
+
+			CTimeAdder readTimer(&readTime);
+			FileHandle_t hAsset = FileSystem()->Open(pEntryPath, "rb", "PLATFORM");
+
+			if (!hAsset)
+			{
+				Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, pEntryPath);
+				continue;
+			}
+
+			const char* szDestPath = (pEntryPath + workspacePath.Length());
+			if (PATHSEPARATOR(szDestPath[0]))
+			{
+				szDestPath++;
+			}
+
+			const ssize_t nLen = FileSystem()->Size(hAsset);
+
+			VPKBuildCacheEntry_t fileInfo;
+			fileInfo.m_nFileTime = FileSystem()->GetFileTime(pEntryPath, "PLATFORM");
+			fileInfo.m_nFileSize = nLen;
+
+			m_BuildCache[szDestPath] = fileInfo;
+
+			const VPKEntryBlock_t* pUnchangedEntry = FindUnchangedEntry(entryValue, szDestPath, fileInfo, nullptr);
+			std::unique_ptr<uint8_t[]> pBuf;
+
+			if (!pUnchangedEntry)
+			{
+				pBuf.reset(new uint8_t[nLen]);
+				FileSystem()->Read(pBuf.get(), nLen, hAsset);
+
+				pUnchangedEntry = FindUnchangedEntry(entryValue, szDestPath, fileInfo, pBuf.get());
+			}
+
+			FileSystem()->Close(hAsset);
+
+			if (pUnchangedEntry)
+			{
+				m_nUnchangedCount++;
+				readTimer.End();
+
+				// Nothing to hash or compress, the writer copies
+				// the chunks from the previous build in order.
+				VPKPackJob_t* pJob = acquireJob();
+
+				pJob->m_pEntryBlock = new VPKEntryBlock_t(*pUnchangedEntry);
+				pJob->m_iEntryIndex = i;
+				pJob->m_iChunkIndex = 0;
+				pJob->m_bUseCompression = false;
+				pJob->m_bDeduplicate = entryValue.m_bDeduplicate;
+				pJob->m_bUnchanged = true;
+				pJob->m_bFinished = true;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					writeQueue.push_back(pJob);
+				}
+
+				doneCond.notify_one();
+				continue;
+			}
+
+			// Pack file offsets are assigned by the writer.
+			VPKEntryBlock_t* pEntryBlock = new VPKEntryBlock_t(
+				pBuf.get(),
+				nLen,
+				0,
+				entryValue.m_iPreloadSize,
+				m_iPackFileIndex,
+				entryValue.m_nLoadFlags,
+				entryValue.m_nTextureFlags,
+				CUtlString(szDestPath));
+
+			// Cache the count, the writer takes ownership of the
+			// entry block as soon as the first chunk is queued.
+			const int nFragmentCount = pEntryBlock->m_Fragments.Count();
+			size_t nRemaining = static_cast<size_t>(nLen);
+
+			readTimer.End();
+
+			for (int j = 0; j < nFragmentCount; j++)
+			{
+				VPKPackJob_t* pJob = acquireJob();
+
+				CTimeAdder copyTimer(&readTime);
+				const size_t nChunkLen = (std::min)(size_t(VPK_ENTRY_MAX_LEN), nRemaining);
+
+				memcpy(pJob->m_pSourceBuffer.get(), pBuf.get() + (nLen - nRemaining), nChunkLen);
+				nRemaining -= nChunkLen;
+
+				pJob->m_pEntryBlock = (j == 0) ? pEntryBlock : nullptr;
+				pJob->m_iEntryIndex = i;
+				pJob->m_iChunkIndex = j;
+				pJob->m_nUncompressedSize = nChunkLen;
+				pJob->m_nCompressedSize = nChunkLen;
+				pJob->m_CompStatus = lzham_compress_status_t::LZHAM_COMP_STATUS_NOT_FINISHED;
+				pJob->m_ChunkHash = VPKChunkHash_t();
+				pJob->m_bUseCompression = entryValue.m_bUseCompression;
+				pJob->m_bDeduplicate = entryValue.m_bDeduplicate;
+				pJob->m_bUnchanged = false;
+				pJob->m_bFinished = false;
+
+				copyTimer.End();
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+
+					workQueue.push_back(pJob);
+					writeQueue.push_back(pJob);
+				}
+
+				workCond.notify_one();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			readerDone = true;
+		}
+
+		workCond.notify_all();
+		doneCond.notify_one();
+	});
+
+	std::vector<std::thread> workerThreads;
+	workerThreads.reserve(numWorkers);
+
+	for (int w = 0; w < numWorkers; w++)
+	{
+		workerThreads.emplace_back([&]()
+		{
+			CCycleCount localHashTime, localCompressTime;
+
+			for (;;)
+			{
+				VPKPackJob_t* pJob;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					workCond.wait(lock, [&]() { return !workQueue.empty() || readerDone; });
+
+					if (workQueue.empty())
+						break;
+
+					pJob = workQueue.front();
+					workQueue.pop_front();
+				}
+
+				if (pJob->m_bDeduplicate)
+				{
+					CTimeAdder hashTimer(&localHashTime);
+					pJob->m_ChunkHash = PackedStore_HashChunk(pJob->m_pSourceBuffer.get(), pJob->m_nUncompressedSize);
+				}
+
+				// NOTE: chunks that end up being deduplicated by the writer
+				// are compressed for nothing, but this keeps the decision
+				// in manifest order without serializing the workers.
+				if (pJob->m_bUseCompression)
+				{
+					CTimeAdder compressTimer(&localCompressTime);
+					pJob->m_CompStatus = lzham_compress_memory(&workerEncoder, pJob->m_pCompressBuffer.get(), &pJob->m_nCompressedSize,
+						pJob->m_pSourceBuffer.get(), pJob->m_nUncompressedSize, nullptr);
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					pJob->m_bFinished = true;
+				}
+
+				doneCond.notify_one();
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			hashTime += localHashTime;
+			compressTime += localCompressTime;
+		});
+	}
+
+	int iCurrentBlock = entryBlocks.InvalidIndex();
+	CUtlVector<uint16_t> chunkPackFileIndices;
+
+	for (;;)
+	{
+		VPKPackJob_t* pJob;
+		{
+			CTimeAdder stallTimer(&writeStallTime);
+			std::unique_lock<std::mutex> lock(mutex);
+
+			doneCond.wait(lock, [&]() { return (!writeQueue.empty() && writeQueue.front()->m_bFinished)
+				|| (writeQueue.empty() && readerDone); });
+
+			if (writeQueue.empty())
+				break;
+
+			pJob = writeQueue.front();
+			writeQueue.pop_front();
+		}
+
+		CTimeAdder writeTimer(&writeTime);
+
+		if (pJob->m_bUnchanged)
+		{
+			Msg(eDLL_T::FS, "Reusing entry '%i' ('%s')\n", pJob->m_iEntryIndex, pJob->m_pEntryBlock->m_EntryPath.Get());
+
+			const int index = entryBlocks.AddToTail(*pJob->m_pEntryBlock);
+			delete pJob->m_pEntryBlock;
+
+			pJob->m_pEntryBlock = nullptr;
+			CopyUnchangedEntry(entryBlocks[index], entryValues[pJob->m_iEntryIndex], hPackFile);
+
+			writeTimer.End();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				freeQueue.push_back(pJob);
+			}
+
+			freeCond.notify_one();
+			continue;
+		}
+
+		if (pJob->m_pEntryBlock)
+		{
+			Msg(eDLL_T::FS, "Packing entry '%i' ('%s')\n", pJob->m_iEntryIndex, pJob->m_pEntryBlock->m_EntryPath.Get());
+
+			iCurrentBlock = entryBlocks.AddToTail(*pJob->m_pEntryBlock);
+			delete pJob->m_pEntryBlock;
+
+			pJob->m_pEntryBlock = nullptr;
+			chunkPackFileIndices.RemoveAll();
+		}
+
+		VPKEntryBlock_t& entryBlock = entryBlocks[iCurrentBlock];
+		VPKChunkDescriptor_t& descriptor = entryBlock.m_Fragments[pJob->m_iChunkIndex];
+
+		descriptor.m_nPackFileOffset = FileSystem()->Tell(hPackFile);
+		uint16_t iChunkPackFileIndex = m_iPackFileIndex;
+
+		if (pJob->m_bDeduplicate && Deduplicate(pJob->m_pSourceBuffer.get(), pJob->m_ChunkHash,
+			descriptor, iChunkPackFileIndex, pJob->m_iChunkIndex))
+		{
+			nSharedTotal += descriptor.m_nCompressedSize;
+			nSharedCount++;
+		}
+		else
+		{
+			const uint8_t* pWriteBuffer = pJob->m_pSourceBuffer.get();
+
+			if (pJob->m_bUseCompression)
+			{
+				if (pJob->m_CompStatus != lzham_compress_status_t::LZHAM_COMP_STATUS_SUCCESS)
+				{
+					Warning(eDLL_T::FS, "Status '%d' for chunk '%i' within entry '%i' in block '%hu' (chunk packed without compression)\n",
+						pJob->m_CompStatus, pJob->m_iChunkIndex, pJob->m_iEntryIndex, entryBlock.m_iPackFileIndex);
+
+					descriptor.m_nCompressedSize = descriptor.m_nUncompressedSize;
+				}
+				else
+				{
+					descriptor.m_nCompressedSize = pJob->m_nCompressedSize;
+					pWriteBuffer = pJob->m_pCompressBuffer.get();
+				}
+			}
+			else // Write data uncompressed.
+			{
+				descriptor.m_nCompressedSize = descriptor.m_nUncompressedSize;
+			}
+
+			FileSystem()->Write(pWriteBuffer, descriptor.m_nCompressedSize, hPackFile);
+
+			if (pJob->m_bDeduplicate)
+			{
+				m_DedupIndex.Insert(pJob->m_ChunkHash, descriptor);
+			}
+		}
+
+		chunkPackFileIndices.AddToTail(iChunkPackFileIndex);
+
+		if (pJob->m_iChunkIndex == entryBlock.m_Fragments.Count() - 1)
+		{
+			FinalizeEntryBlock(entryBlock, chunkPackFileIndices, hPackFile);
+		}
+
+		writeTimer.End();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeQueue.push_back(pJob);
+		}
+
+		freeCond.notify_one();
+	}
+
+	readerThread.join();
+
+	for (std::thread& workerThread : workerThreads)
+		workerThread.join();
+
+	Msg(eDLL_T::FS, "*** Stage 'read'    : '%lf' seconds busy, '%lf' seconds stalled\n", readTime.GetSeconds(), readStallTime.GetSeconds());
+	Msg(eDLL_T::FS, "*** Stage 'hash'    : '%lf' seconds summed over '%i' workers\n", hashTime.GetSeconds(), numWorkers);
+	Msg(eDLL_T::FS, "*** Stage 'compress': '%lf' seconds summed over '%i' workers\n", compressTime.GetSeconds(), numWorkers);
+	Msg(eDLL_T::FS, "*** Stage 'write'   : '%lf' seconds busy, '%lf' seconds stalled\n", writeTime.GetSeconds(), writeStallTime.GetSeconds());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: packs all files from workspace path into VPK file
+// Input  : &vpkPair       - 
+//          *workspaceName - 
+//          *buildPath     - 
+//-----------------------------------------------------------------------------
+void CPackedStoreBuilder::PackStore(const VPKPair_t& vpkPair, const char* workspaceName, const char* buildPath)
+{
+	CUtlString workspacePath(workspaceName);
+	workspacePath.AppendSlash();
+	workspacePath.FixSlashes('/');
+
+	CUtlVector<VPKKeyValues_t> entryValues;
+	CUtlVector<VPKEntryBlock_t> entryBlocks;
+
+	// NOTE: we get the entry values prior to opening the file, because if we
+	// don't have a valid manifest file, we won't be able to build the store.
+	// If we had already opened the pack file, and a one already existed, it
+	// would be emptied out ("wb" flag) which we want to avoid here.
+	if (!GetEntryValues(entryValues, workspacePath, vpkPair.m_DirName))
+	{
+		return;
+	}
+
+	CUtlString packFilePath;
+	CUtlString dirFilePath;
+
+	packFilePath.Format("%s%s", buildPath, vpkPair.m_PackName.Get());
+	dirFilePath.Format("%s%s", buildPath, vpkPair.m_DirName.Get());
+
+	FileSystem()->CreateDirHierarchy(packFilePath.DirName().Get(), "GAME");
+
+	m_iPackFileIndex = vpkPair.m_iPackFileIndex;
+	m_nUnchangedCount = 0;
+	m_BuildCache.clear();
+
+	// Must be done before the pack file gets emptied out.
+	const bool bIncremental = m_bIncremental && InitIncrementalBuild(dirFilePath, packFilePath);
+
+	// Opened for reading as well, the deduplication index
+	// compares new chunks against the ones already written.
+	FileHandle_t hPackFile = FileSystem()->Open(packFilePath.Get(), "w+b", "GAME");
+	if (!hPackFile)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, packFilePath.Get());
+		ShutdownIncrementalBuild(packFilePath, true);
+
+		return;
+	}
+
+	m_DedupIndex.Init(hPackFile, m_iPackFileIndex);
+
+	// When building a patch, chunks that are already
+	// present in earlier pack files are mapped onto them.
+	for (uint16_t i = 0; i < m_iPackFileIndex; i++)
+	{
+		CUtlString prevPackFilePath;
+		prevPackFilePath.Format("%s%s", buildPath, vpkPair.GetPackFileNameForIndex(i).Get());
+
+		m_DedupIndex.LoadIndexFile(prevPackFilePath, i);
+	}
+
+	size_t nSharedTotal = NULL;
+	size_t nSharedCount = NULL;
+
+	if (m_nNumPackWorkers > 1)
+		PackEntriesParallel(entryValues, entryBlocks, workspacePath, hPackFile, nSharedTotal, nSharedCount);
+	else
+		PackEntriesSerial(entryValues, entryBlocks, workspacePath, hPackFile, nSharedTotal, nSharedCount);
 
 	Msg(eDLL_T::FS, "*** Build block totaling '%zd' bytes with '%zu' shared bytes among '%zu' chunks\n", FileSystem()->Tell(hPackFile), nSharedTotal, nSharedCount);
+
+	if (bIncremental)
+	{
+		Msg(eDLL_T::FS, "*** Reused '%i' unchanged entries out of '%i'\n", m_nUnchangedCount, entryValues.Count());
+	}
+
+	// Must be saved before closing the pack file,
+	// as the index records the size of the pack.
+	m_DedupIndex.SaveIndexFile(packFilePath);
+	m_DedupIndex.Shutdown();
+
+	ShutdownIncrementalBuild(packFilePath, false);
 	FileSystem()->Close(hPackFile);
 
-	m_ChunkHashMap.clear();
+	SaveBuildCache(dirFilePath);
+
+	VPKDir_t vDirectory;
+	vDirectory.BuildDirectoryFile(dirFilePath, entryBlocks);
+}
+
+//-----------------------------------------------------------------------------
+// Extracts entries from the pack files of a VPK. Each worker owns its own
+// LZHAM decoder, chunk buffers and pack file handles, so workers never share
+// file positions or decoder state, and memory use doesn't grow with the size
+// of the entries being extracted.
+//-----------------------------------------------------------------------------
+class CPackedStoreUnpackWorker
+{
+public:
+	CPackedStoreUnpackWorker(const VPKDir_t& vpkDir, const lzham_decompress_params& decoderParams);
+	~CPackedStoreUnpackWorker();
+
+	bool UnpackEntry(const int iEntryIndex, const CUtlString& workspacePath);
+
+private:
+	FileHandle_t GetPackFile(const uint16_t iPackFileIndex);
+
+	const VPKDir_t&            m_VpkDir;
+	lzham_decompress_params    m_DecoderParams;
+	lzham_decompress_state_ptr m_pDecoder;
+
+	std::unique_ptr<uint8_t[]> m_pSourceBuffer;
+	std::unique_ptr<uint8_t[]> m_pDestBuffer;
+
+	std::map<uint16_t, FileHandle_t> m_PackFiles;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: 'CPackedStoreUnpackWorker' constructor
+// Input  : &vpkDir        - 
+//          &decoderParams - 
+//-----------------------------------------------------------------------------
+CPackedStoreUnpackWorker::CPackedStoreUnpackWorker(const VPKDir_t& vpkDir, const lzham_decompress_params& decoderParams)
+	: m_VpkDir(vpkDir)
+	, m_DecoderParams(decoderParams)
+	, m_pSourceBuffer(new uint8_t[VPK_ENTRY_MAX_LEN])
+	, m_pDestBuffer(new uint8_t[VPK_ENTRY_MAX_LEN])
+{
+	m_pDecoder = lzham_decompress_init(&m_DecoderParams);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 'CPackedStoreUnpackWorker' destructor
+//-----------------------------------------------------------------------------
+CPackedStoreUnpackWorker::~CPackedStoreUnpackWorker()
+{
+	for (auto& it : m_PackFiles)
+	{
+		if (it.second)
+			FileSystem()->Close(it.second);
+	}
+
+	if (m_pDecoder)
+		lzham_decompress_deinit(m_pDecoder);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: opens the pack file on first use
+// Input  : iPackFileIndex - 
+// Output : handle to the pack file, nullptr on failure
+//-----------------------------------------------------------------------------
+FileHandle_t CPackedStoreUnpackWorker::GetPackFile(const uint16_t iPackFileIndex)
+{
+	const auto it = m_PackFiles.find(iPackFileIndex);
+
+	if (it != m_PackFiles.end())
+		return it->second;
+
+	const CUtlString packFile = m_VpkDir.m_DirFilePath.StripFilename(false) + m_VpkDir.GetPackFileNameForIndex(iPackFileIndex);
+	const char* pPackFile = packFile.Get();
+
+	// Failures are cached as well, so it only gets reported once.
+	FileHandle_t hPackFile = FileSystem()->Open(pPackFile, "rb", "GAME");
+	m_PackFiles[iPackFileIndex] = hPackFile;
+
+	if (!hPackFile)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, pPackFile);
+	}
+
+	return hPackFile;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: extracts an entry, computing its crc while it's being written
+// Input  : iEntryIndex    - 
+//          &workspacePath - 
+// Output : true on success, false if the entry is missing or corrupt
+//-----------------------------------------------------------------------------
+bool CPackedStoreUnpackWorker::UnpackEntry(const int iEntryIndex, const CUtlString& workspacePath)
+{
+	const VPKEntryBlock_t& entryBlock = m_VpkDir.m_EntryBlocks[iEntryIndex];
+	const uint16_t packFileIndex = entryBlock.m_iPackFileIndex;
+
+	FileHandle_t hPackFile = GetPackFile(packFileIndex);
+
+	if (!hPackFile)
+	{
+		return false;
+	}
+
+	const char* pEntryPath = entryBlock.m_EntryPath.Get();
+
+	CUtlString filePath;
+	filePath.Format("%s%s", workspacePath.Get(), pEntryPath);
+
+	FileSystem()->CreateDirHierarchy(filePath.DirName().Get(), "PLATFORM");
+	FileHandle_t hAsset = FileSystem()->Open(filePath.Get(), "wb", "PLATFORM");
+
+	if (!hAsset)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, filePath.Get());
+		return false;
+	}
+
+	Msg(eDLL_T::FS, "Unpacking entry '%i' from block '%hu' ('%s')\n",
+		iEntryIndex, packFileIndex, pEntryPath);
+
+	uint32_t nCrc32 = 0;
+	bool bSuccess = true;
+
+	FOR_EACH_VEC(entryBlock.m_Fragments, k)
+	{
+		const VPKChunkDescriptor_t& fragment = entryBlock.m_Fragments[k];
+
+		if (fragment.m_nCompressedSize > VPK_ENTRY_MAX_LEN ||
+			fragment.m_nUncompressedSize > VPK_ENTRY_MAX_LEN)
+		{
+			// Corrupt or invalid chunk descriptor.
+			Error(eDLL_T::FS, NO_ERROR, "Chunk '%i' within entry '%i' in block '%hu' exceeds '%u' bytes (chunk not extracted)\n",
+				k, iEntryIndex, packFileIndex, VPK_ENTRY_MAX_LEN);
+
+			bSuccess = false;
+			break;
+		}
+
+		FileSystem()->Seek(hPackFile, fragment.m_nPackFileOffset, FileSystemSeek_t::FILESYSTEM_SEEK_HEAD);
+		FileSystem()->Read(m_pSourceBuffer.get(), fragment.m_nCompressedSize, hPackFile);
+
+		const uint8_t* pData = m_pSourceBuffer.get();
+		size_t nDataLen = fragment.m_nUncompressedSize;
+
+		if (fragment.m_nCompressedSize != fragment.m_nUncompressedSize) // Data is compressed.
+		{
+			size_t nSrcLen = fragment.m_nCompressedSize;
+			size_t nDstLen = VPK_ENTRY_MAX_LEN;
+
+			// Reinitializing reuses the allocations of the decoder.
+			m_pDecoder = lzham_decompress_reinit(m_pDecoder, &m_DecoderParams);
+
+			lzham_decompress_status_t lzDecompStatus = m_pDecoder
+				? lzham_decompress(m_pDecoder, m_pSourceBuffer.get(), &nSrcLen, m_pDestBuffer.get(), &nDstLen, true)
+				: lzham_decompress_status_t::LZHAM_DECOMP_STATUS_FAILED_INITIALIZING;
+
+			if (lzDecompStatus != lzham_decompress_status_t::LZHAM_DECOMP_STATUS_SUCCESS)
+			{
+				Error(eDLL_T::FS, NO_ERROR, "Status '%d' for chunk '%i' within entry '%i' in block '%hu' (chunk not decompressed)\n",
+					lzDecompStatus, k, iEntryIndex, packFileIndex);
+
+				bSuccess = false;
+				continue;
+			}
+
+			pData = m_pDestBuffer.get();
+			nDataLen = nDstLen;
+		}
+
+		nCrc32 = crc32::update(nCrc32, pData, nDataLen);
+		FileSystem()->Write(pData, nDataLen, hAsset);
+	}
+
+	FileSystem()->Close(hAsset);
+
+	if (bSuccess && nCrc32 != entryBlock.m_nFileCRC)
+	{
+		Warning(eDLL_T::FS, "Computed checksum '0x%lX' doesn't match expected checksum '0x%lX' for '%s'. File may be corrupt!\n",
+			nCrc32, entryBlock.m_nFileCRC, pEntryPath);
+
+		bSuccess = false;
+	}
 
-	VPKDir_t vDirectory;
-	vDirectory.BuildDirectoryFile(dirFilePath, entryBlocks);
+	return bSuccess;
 }
 
 //-----------------------------------------------------------------------------
 // Purpose: rebuilds manifest and extracts all files from specified VPK file
 // Input  : &vpkDirectory  - 
 //          &workspaceName - 
+//          *pEntryFilter  - only extract entries matching this pattern
+//                           ('*' is a wildcard), nullptr or empty extracts all
 //-----------------------------------------------------------------------------
-void CPackedStoreBuilder::UnpackStore(const VPKDir_t& vpkDir, const char* workspaceName)
+void CPackedStoreBuilder::UnpackStore(const VPKDir_t& vpkDir, const char* workspaceName, const char* pEntryFilter)
 {
 	CUtlString workspacePath(workspaceName);
 
 	workspacePath.AppendSlash();
 	workspacePath.FixSlashes('/');
 
-	std::unique_ptr<uint8_t[]> pDestBuffer(new uint8_t[VPK_ENTRY_MAX_LEN]);
-	std::unique_ptr<uint8_t[]> pSourceBuffer(new uint8_t[VPK_ENTRY_MAX_LEN]);
-
-	if (!pDestBuffer || !pSourceBuffer)
-	{
-		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to allocate chunk buffer!\n", __FUNCTION__);
-		return;
-	}
-
-	BuildManifest(vpkDir.m_EntryBlocks, workspacePath, PackedStore_GetDirBaseName(vpkDir.m_DirFilePath));
-	const CUtlString basePath = vpkDir.m_DirFilePath.StripFilename(false);
+	const bool bFiltered = pEntryFilter && *pEntryFilter;
+	CUtlVector<int> entryIndices;
 
-	for (uint16_t packFileIndex : vpkDir.m_PakFileIndices)
+	FOR_EACH_VEC(vpkDir.m_EntryBlocks, i)
 	{
-		const CUtlString packFile = basePath + vpkDir.GetPackFileNameForIndex(packFileIndex);
-		const char* pPackFile = packFile.Get();
-
-		// Read from each pack file.
-		FileHandle_t hPackFile = FileSystem()->Open(pPackFile, "rb", "GAME");
-		if (!hPackFile)
+		if (bFiltered && !V_StringMatchesPattern(vpkDir.m_EntryBlocks[i].m_EntryPath.Get(), pEntryFilter))
 		{
-			Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, pPackFile);
 			continue;
 		}
 
-		FOR_EACH_VEC(vpkDir.m_EntryBlocks, j)
-		{
-			const VPKEntryBlock_t& entryBlock = vpkDir.m_EntryBlocks[j];
-
-			if (entryBlock.m_iPackFileIndex != packFileIndex)
-			{
-				// Chunk doesn't belongs to this block.
-				continue;
-			}
-
-			const char* pEntryPath = entryBlock.m_EntryPath.Get();
+		entryIndices.AddToTail(i);
+	}
 
-			CUtlString filePath;
-			filePath.Format("%s%s", workspacePath.Get(), pEntryPath);
+	if (entryIndices.IsEmpty())
+	{
+		Warning(eDLL_T::FS, "No entries matching '%s' in '%s'\n", bFiltered ? pEntryFilter : "*", vpkDir.m_DirFilePath.Get());
+		return;
+	}
 
-			FileSystem()->CreateDirHierarchy(filePath.DirName().Get(), "PLATFORM");
-			FileHandle_t hAsset = FileSystem()->Open(filePath.Get(), "wb", "PLATFORM");
+	// The manifest describes the entire VPK, don't
+	// overwrite it when only extracting a subset.
+	if (!bFiltered)
+	{
+		BuildManifest(vpkDir.m_EntryBlocks, workspacePath, PackedStore_GetDirBaseName(vpkDir.m_DirFilePath));
+	}
 
-			if (!hAsset)
-			{
-				Error(eDLL_T::FS, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, filePath.Get());
-				continue;
-			}
+	// Extract in pack file and offset order, so
+	// each worker mostly reads its packs forward.
+	std::sort(entryIndices.begin(), entryIndices.end(), [&vpkDir](const int a, const int b)
+	{
+		const VPKEntryBlock_t& blockA = vpkDir.m_EntryBlocks[a];
+		const VPKEntryBlock_t& blockB = vpkDir.m_EntryBlocks[b];
 
-			Msg(eDLL_T::FS, "Unpacking entry '%i' from block '%hu' ('%s')\n",
-				j, packFileIndex, pEntryPath);
+		if (blockA.m_iPackFileIndex != blockB.m_iPackFileIndex)
+			return blockA.m_iPackFileIndex < blockB.m_iPackFileIndex;
 
-			FOR_EACH_VEC(entryBlock.m_Fragments, k)
-			{
-				const VPKChunkDescriptor_t& fragment = entryBlock.m_Fragments[k];
+		return blockA.m_Fragments[0].m_nPackFileOffset < blockB.m_Fragments[0].m_nPackFileOffset;
+	});
 
-				FileSystem()->Seek(hPackFile, fragment.m_nPackFileOffset, FileSystemSeek_t::FILESYSTEM_SEEK_HEAD);
-				FileSystem()->Read(pSourceBuffer.get(), fragment.m_nCompressedSize, hPackFile);
+	const int numWorkers = (std::min)(m_nNumPackWorkers, entryIndices.Count());
 
-				if (fragment.m_nCompressedSize == fragment.m_nUncompressedSize) // Data is not compressed.
-				{
-					FileSystem()->Write(pSourceBuffer.get(), fragment.m_nUncompressedSize, hAsset);
-					continue;
-				}
+	std::atomic<int> nextEntry(0);
+	std::atomic<int> numFailed(0);
 
-				size_t nDstLen = VPK_ENTRY_MAX_LEN;
-				assert(fragment.m_nCompressedSize <= nDstLen);
+	const auto unpackEntries = [&]()
+	{
+		CPackedStoreUnpackWorker worker(vpkDir, m_Decoder);
 
-				if (fragment.m_nCompressedSize > nDstLen)
-					break; // Corrupt or invalid chunk descriptor.
+		for (int i = nextEntry++; i < entryIndices.Count(); i = nextEntry++)
+		{
+			if (!worker.UnpackEntry(entryIndices[i], workspacePath))
+				numFailed++;
+		}
+	};
 
-				lzham_decompress_status_t lzDecompStatus = lzham_decompress_memory(&m_Decoder, pDestBuffer.get(),
-					&nDstLen, pSourceBuffer.get(), fragment.m_nCompressedSize, nullptr);
+	if (numWorkers > 1)
+	{
+		// Workers pull entries until none are left, so this runs on as many
+		// pool threads as are free, without spawning threads of its own.
+		CTaskGroup group;
 
-				if (lzDecompStatus != lzham_decompress_status_t::LZHAM_DECOMP_STATUS_SUCCESS)
-				{
-					Error(eDLL_T::FS, NO_ERROR, "Status '%d' for chunk '%i' within entry '%i' in block '%hu' (chunk not decompressed)\n",
-						lzDecompStatus, k, j, packFileIndex);
-				}
-				else // If successfully decompressed, write to file.
-				{
-					FileSystem()->Write(pDestBuffer.get(), nDstLen, hAsset);
-				}
-			}
+		for (int w = 1; w < numWorkers; w++)
+			group.Run(unpackEntries);
 
-			FileSystem()->Close(hAsset);
-			ValidateCRC32PostDecomp(filePath, entryBlock.m_nFileCRC);
-		}
-		FileSystem()->Close(hPackFile);
+		unpackEntries();
+		group.Wait();
 	}
+	else
+	{
+		unpackEntries();
+	}
+
+	Msg(eDLL_T::FS, "*** Unpacked '%i' entries using '%i' workers ('%i' failed)\n",
+		entryIndices.Count(), numWorkers, numFailed.load());
 }
 
 //-----------------------------------------------------------------------------
@@ -817,6 +2002,24 @@ VPKPair_t::VPKPair_t(const char* pLocale, const char* pTarget, const char* pLeve
 
 	m_PackName.Format("%s_%s.bsp.pak000_%03d.vpk", pTarget, pLevel, nPatch);
 	m_DirName.Format("%s%s_%s.bsp.pak000_dir.vpk", pLocale, pTarget, pLevel);
+
+	m_iPackFileIndex = static_cast<uint16_t>(nPatch);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: formats pack file name for specified patch
+// Input  : iPackFileIndex - (patch)
+// output : string
+//-----------------------------------------------------------------------------
+CUtlString VPKPair_t::GetPackFileNameForIndex(uint16_t iPackFileIndex) const
+{
+	CUtlString currentIndex;
+	CUtlString packChunkIndex;
+
+	currentIndex.Format("pak000_%03hu", m_iPackFileIndex);
+	packChunkIndex.Format("pak000_%03hu", iPackFileIndex);
+
+	return m_PackName.Replace(currentIndex.Get(), packChunkIndex.Get());
 }
 
 //-----------------------------------------------------------------------------
@@ -1176,3 +2379,375 @@ void VPKDir_t::BuildDirectoryFile(const CUtlString& directoryPath, const CUtlVec
 	Msg(eDLL_T::FS, "*** Build directory totaling '%zu' bytes with '%i' entries and '%i' descriptors\n",
 		size_t(sizeof(VPKDirHeader_t) + m_Header.m_nDirectorySize), entryBlocks.Count(), nDescriptors);
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: 'CPackedStoreDedupIndex' constructor
+//-----------------------------------------------------------------------------
+CPackedStoreDedupIndex::CPackedStoreDedupIndex()
+	: m_hPackFile(FILESYSTEM_INVALID_HANDLE)
+	, m_iPackFileIndex(0)
+{
+	m_Decoder.m_struct_size      = sizeof(lzham_decompress_params);
+	m_Decoder.m_dict_size_log2   = VPK_DICT_SIZE;
+	m_Decoder.m_decompress_flags = lzham_decompress_flags::LZHAM_DECOMP_FLAG_OUTPUT_UNBUFFERED;
+	m_Decoder.m_num_seed_bytes   = NULL;
+	m_Decoder.m_pSeed_bytes      = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 'CPackedStoreDedupIndex' destructor
+//-----------------------------------------------------------------------------
+CPackedStoreDedupIndex::~CPackedStoreDedupIndex()
+{
+	Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: initializes the index for the pack file that is being built
+// Input  : hPackFile      - (must be opened for reading and writing)
+//          iPackFileIndex - 
+//-----------------------------------------------------------------------------
+void CPackedStoreDedupIndex::Init(FileHandle_t hPackFile, const uint16_t iPackFileIndex)
+{
+	m_hPackFile = hPackFile;
+	m_iPackFileIndex = iPackFileIndex;
+
+	if (!m_pReadBuffer)
+	{
+		m_pReadBuffer.reset(new uint8_t[VPK_ENTRY_MAX_LEN]);
+		m_pDecodeBuffer.reset(new uint8_t[VPK_ENTRY_MAX_LEN]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: clears the index and closes all earlier pack files
+//-----------------------------------------------------------------------------
+void CPackedStoreDedupIndex::Shutdown(void)
+{
+	for (auto& it : m_ExternalPackFiles)
+	{
+		FileSystem()->Close(it.second);
+	}
+
+	m_ExternalPackFiles.clear();
+
+	m_Entries.Purge();
+	m_Buckets.Purge();
+
+	m_hPackFile = FILESYSTEM_INVALID_HANDLE;
+	m_iPackFileIndex = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: loads the index of an earlier pack file
+// Input  : &packFilePath  - 
+//          iPackFileIndex - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreDedupIndex::LoadIndexFile(const CUtlString& packFilePath, const uint16_t iPackFileIndex)
+{
+	const CUtlString indexFilePath = PackedStore_GetDedupIndexFileName(packFilePath);
+	const char* pIndexFilePath = indexFilePath.Get();
+
+	FileHandle_t hIndexFile = FileSystem()->Open(pIndexFilePath, "rb", "GAME");
+	if (!hIndexFile)
+	{
+		Warning(eDLL_T::FS, "No deduplication index '%s' for block '%hu'; its chunks won't be shared\n", pIndexFilePath, iPackFileIndex);
+		return false;
+	}
+
+	VPKDedupHeader_t header;
+	const ssize_t nIndexSize = FileSystem()->Size(hIndexFile);
+
+	if (FileSystem()->Read(&header, sizeof(header), hIndexFile) != static_cast<ssize_t>(sizeof(header)) ||
+		header.m_nHeaderMarker != VPK_DEDUP_INDEX_MARKER ||
+		header.m_nVersion != VPK_DEDUP_INDEX_VERSION ||
+		header.m_iPackFileIndex != iPackFileIndex ||
+		header.m_nEntryCount > (static_cast<size_t>(nIndexSize) - sizeof(header)) / sizeof(VPKDedupEntry_t))
+	{
+		Error(eDLL_T::FS, NO_ERROR, "Unsupported deduplication index '%s' (invalid header criteria)\n", pIndexFilePath);
+		FileSystem()->Close(hIndexFile);
+
+		return false;
+	}
+
+	FileHandle_t hPackFile = FileSystem()->Open(packFilePath.Get(), "rb", "GAME");
+	if (!hPackFile)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to open '%s' (insufficient rights?)\n", __FUNCTION__, packFilePath.Get());
+		FileSystem()->Close(hIndexFile);
+
+		return false;
+	}
+
+	// The pack file has been rebuilt since the index was written.
+	if (uint64_t(FileSystem()->Size(hPackFile)) != header.m_nPackFileSize)
+	{
+		Warning(eDLL_T::FS, "Deduplication index '%s' is stale; its chunks won't be shared\n", pIndexFilePath);
+
+		FileSystem()->Close(hPackFile);
+		FileSystem()->Close(hIndexFile);
+
+		return false;
+	}
+
+	m_Entries.EnsureCapacity(m_Entries.Count() + static_cast<int>(header.m_nEntryCount));
+
+	for (uint64_t i = 0; i < header.m_nEntryCount; i++)
+	{
+		VPKDedupEntry_t entry;
+		FileSystem()->Read(&entry, sizeof(entry), hIndexFile);
+
+		entry.m_iPackFileIndex = iPackFileIndex;
+		InsertEntry(entry);
+	}
+
+	FileSystem()->Close(hIndexFile);
+	m_ExternalPackFiles[iPackFileIndex] = hPackFile;
+
+	Msg(eDLL_T::FS, "Loaded '%llu' chunks from deduplication index '%s'\n", header.m_nEntryCount, pIndexFilePath);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: saves the index of the pack file that is being built
+// Input  : &packFilePath - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreDedupIndex::SaveIndexFile(const CUtlString& packFilePath) const
+{
+	const CUtlString indexFilePath = PackedStore_GetDedupIndexFileName(packFilePath);
+	const char* pIndexFilePath = indexFilePath.Get();
+
+	FileHandle_t hIndexFile = FileSystem()->Open(pIndexFilePath, "wb", "GAME");
+	if (!hIndexFile)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "%s - Unable to write to '%s' (read-only?)\n", __FUNCTION__, pIndexFilePath);
+		return false;
+	}
+
+	VPKDedupHeader_t header;
+
+	header.m_nHeaderMarker = VPK_DEDUP_INDEX_MARKER;
+	header.m_nVersion = VPK_DEDUP_INDEX_VERSION;
+	header.m_iPackFileIndex = m_iPackFileIndex;
+	header.m_nPackFileSize = FileSystem()->Size(m_hPackFile);
+	header.m_nEntryCount = 0;
+
+	// Only chunks stored in this pack file are written,
+	// the others are owned by the index of earlier packs.
+	FOR_EACH_VEC(m_Entries, i)
+	{
+		if (m_Entries[i].m_iPackFileIndex == m_iPackFileIndex)
+			header.m_nEntryCount++;
+	}
+
+	FileSystem()->Write(&header, sizeof(header), hIndexFile);
+
+	FOR_EACH_VEC(m_Entries, i)
+	{
+		const VPKDedupEntry_t& entry = m_Entries[i];
+
+		if (entry.m_iPackFileIndex == m_iPackFileIndex)
+			FileSystem()->Write(&entry, sizeof(entry), hIndexFile);
+	}
+
+	FileSystem()->Close(hIndexFile);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds an existing chunk with the same contents
+// Input  : &chunkHash - 
+//          *pData     - uncompressed chunk data
+//          nLen       - 
+//          &outEntry  - 
+// Output : true if found, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreDedupIndex::Find(const VPKChunkHash_t& chunkHash, const uint8_t* pData, const size_t nLen, VPKDedupEntry_t& outEntry)
+{
+	if (!m_Buckets.Count())
+	{
+		return false;
+	}
+
+	const int nMask = m_Buckets.Count() - 1;
+
+	for (int i = static_cast<int>(chunkHash.m_nLow & nMask);; i = (i + 1) & nMask)
+	{
+		const int iEntry = m_Buckets[i];
+
+		if (iEntry == -1)
+		{
+			return false;
+		}
+
+		const VPKDedupEntry_t& entry = m_Entries[iEntry];
+
+		// A matching hash is confirmed with a byte compare, so
+		// a collision can never map a chunk onto other data.
+		if (entry.m_Hash == chunkHash && CompareChunk(entry, pData, nLen))
+		{
+			outEntry = entry;
+			return true;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: adds a chunk written to the current pack file to the index
+// Input  : &chunkHash  - 
+//          &descriptor - 
+//-----------------------------------------------------------------------------
+void CPackedStoreDedupIndex::Insert(const VPKChunkHash_t& chunkHash, const VPKChunkDescriptor_t& descriptor)
+{
+	VPKDedupEntry_t entry;
+
+	entry.m_Hash = chunkHash;
+	entry.m_nPackFileOffset = descriptor.m_nPackFileOffset;
+	entry.m_nCompressedSize = descriptor.m_nCompressedSize;
+	entry.m_nUncompressedSize = descriptor.m_nUncompressedSize;
+	entry.m_nLoadFlags = descriptor.m_nLoadFlags;
+	entry.m_nTextureFlags = descriptor.m_nTextureFlags;
+	entry.m_iPackFileIndex = m_iPackFileIndex;
+
+	InsertEntry(entry);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads the chunk as stored in the pack file (possibly compressed)
+// Input  : iPackFileIndex - 
+//          &descriptor    - 
+// Output : pointer to the chunk data, valid until the next read; NULL on failure
+//-----------------------------------------------------------------------------
+const uint8_t* CPackedStoreDedupIndex::ReadRawChunk(const uint16_t iPackFileIndex, const VPKChunkDescriptor_t& descriptor)
+{
+	if (descriptor.m_nCompressedSize > VPK_ENTRY_MAX_LEN)
+	{
+		return nullptr; // Corrupt or invalid chunk descriptor.
+	}
+
+	const bool bCurrentPackFile = (iPackFileIndex == m_iPackFileIndex);
+	FileHandle_t hPackFile = m_hPackFile;
+
+	if (!bCurrentPackFile)
+	{
+		auto it = m_ExternalPackFiles.find(iPackFileIndex);
+
+		if (it == m_ExternalPackFiles.end())
+		{
+			return nullptr;
+		}
+
+		hPackFile = it->second;
+	}
+
+	FileSystem()->Seek(hPackFile, descriptor.m_nPackFileOffset, FileSystemSeek_t::FILESYSTEM_SEEK_HEAD);
+	const ssize_t nRead = FileSystem()->Read(m_pReadBuffer.get(), descriptor.m_nCompressedSize, hPackFile);
+
+	// The builder appends at the current file position.
+	if (bCurrentPackFile)
+	{
+		FileSystem()->Seek(hPackFile, 0, FileSystemSeek_t::FILESYSTEM_SEEK_TAIL);
+	}
+
+	if (nRead != static_cast<ssize_t>(descriptor.m_nCompressedSize))
+	{
+		return nullptr;
+	}
+
+	return m_pReadBuffer.get();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: adds an entry to the hash table, growing it if needed
+// Input  : &entry - 
+//-----------------------------------------------------------------------------
+void CPackedStoreDedupIndex::InsertEntry(const VPKDedupEntry_t& entry)
+{
+	// Keep the load factor at or below 50%.
+	if ((m_Entries.Count() + 1) * 2 > m_Buckets.Count())
+	{
+		Rehash((std::max)(1024, m_Buckets.Count() * 2));
+	}
+
+	const int iEntry = m_Entries.AddToTail(entry);
+	const int nMask = m_Buckets.Count() - 1;
+
+	int i = static_cast<int>(entry.m_Hash.m_nLow & nMask);
+
+	while (m_Buckets[i] != -1)
+	{
+		i = (i + 1) & nMask;
+	}
+
+	m_Buckets[i] = iEntry;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: rebuilds the hash table with the given number of buckets
+// Input  : nBucketCount - (must be a power of 2)
+//-----------------------------------------------------------------------------
+void CPackedStoreDedupIndex::Rehash(const int nBucketCount)
+{
+	Assert(IsPowerOfTwo(nBucketCount));
+
+	m_Buckets.SetCount(nBucketCount);
+	m_Buckets.FillWithValue(-1);
+
+	const int nMask = nBucketCount - 1;
+
+	FOR_EACH_VEC(m_Entries, iEntry)
+	{
+		int i = static_cast<int>(m_Entries[iEntry].m_Hash.m_nLow & nMask);
+
+		while (m_Buckets[i] != -1)
+		{
+			i = (i + 1) & nMask;
+		}
+
+		m_Buckets[i] = iEntry;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares the chunk stored in the pack file against the given data
+// Input  : &entry - 
+//          *pData - uncompressed chunk data
+//          nLen   - 
+// Output : true if identical, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreDedupIndex::CompareChunk(const VPKDedupEntry_t& entry, const uint8_t* pData, const size_t nLen)
+{
+	if (entry.m_nUncompressedSize != nLen)
+	{
+		return false;
+	}
+
+	const VPKChunkDescriptor_t descriptor(entry.m_nLoadFlags, entry.m_nTextureFlags,
+		entry.m_nPackFileOffset, entry.m_nCompressedSize, entry.m_nUncompressedSize);
+
+	const uint8_t* pRawChunk = ReadRawChunk(entry.m_iPackFileIndex, descriptor);
+
+	if (!pRawChunk)
+	{
+		return false;
+	}
+
+	if (entry.m_nCompressedSize == entry.m_nUncompressedSize) // Data is not compressed.
+	{
+		return memcmp(pRawChunk, pData, nLen) == 0;
+	}
+
+	size_t nDstLen = VPK_ENTRY_MAX_LEN;
+
+	lzham_decompress_status_t lzDecompStatus = lzham_decompress_memory(&m_Decoder, m_pDecodeBuffer.get(),
+		&nDstLen, pRawChunk, entry.m_nCompressedSize, nullptr);
+
+	if (lzDecompStatus != lzham_decompress_status_t::LZHAM_DECOMP_STATUS_SUCCESS || nDstLen != nLen)
+	{
+		return false;
+	}
+
+	return memcmp(m_pDecodeBuffer.get(), pData, nLen) == 0;
+}
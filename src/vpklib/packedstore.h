@@ -23,10 +23,20 @@ constexpr unsigned int VPK_MINOR_VERSION = 3;
 constexpr unsigned int VPK_DICT_SIZE = 20;
 constexpr unsigned int VPK_ENTRY_MAX_LEN = 1024 * 1024;
 constexpr int PACKFILEPATCH_MAX = 512;
+constexpr int PACKSTORE_MAX_WORKERS = 64;
 constexpr int PACKFILEINDEX_SEP = 0x0;
 constexpr int PACKFILEINDEX_END = 0xffff;
 constexpr const char VPK_IGNORE_FILE[] = ".vpkignore";
 
+constexpr unsigned int VPK_DEDUP_INDEX_MARKER = 0x49444B56; // 'VKDI'
+constexpr unsigned short VPK_DEDUP_INDEX_VERSION = 1;
+constexpr const char VPK_DEDUP_INDEX_EXT[] = "dedup";
+
+constexpr unsigned int VPK_BUILD_CACHE_MARKER = 0x43424B56; // 'VKBC'
+constexpr unsigned short VPK_BUILD_CACHE_VERSION = 1;
+constexpr const char VPK_BUILD_CACHE_EXT[] = "buildcache";
+constexpr const char VPK_PREV_PACK_FILE_EXT[] = "prev";
+
 static const std::regex g_VpkDirFileRegex{ R"((?:.*\/)?([^_]*)(?:_)(.*)(.bsp.pak000_dir).*)" };
 static const std::regex g_VpkPackFileRegex{ R"(pak000_([0-9]{3}))" };
 
@@ -196,8 +206,112 @@ struct VPKPair_t
 {
 	CUtlString m_PackName;
 	CUtlString m_DirName;
+	uint16_t   m_iPackFileIndex;
 
 	VPKPair_t(const char* svLocale, const char* svTarget, const char* svLevel, int nPatch);
+	CUtlString GetPackFileNameForIndex(uint16_t iPackFileIndex) const;
+};
+
+//-----------------------------------------------------------------------------
+// 128-bit content hash of an uncompressed chunk.
+//-----------------------------------------------------------------------------
+struct VPKChunkHash_t
+{
+	uint64_t m_nLow;
+	uint64_t m_nHigh;
+
+	inline bool operator==(const VPKChunkHash_t& other) const
+	{
+		return m_nLow == other.m_nLow && m_nHigh == other.m_nHigh;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// A chunk in the deduplication index. This is also the on-disk layout of the
+// index file that gets written next to each pack file.
+//-----------------------------------------------------------------------------
+struct VPKDedupEntry_t
+{
+	VPKChunkHash_t m_Hash;
+
+	uint64_t m_nPackFileOffset;
+	uint64_t m_nCompressedSize;
+	uint64_t m_nUncompressedSize;
+	uint32_t m_nLoadFlags;
+	uint16_t m_nTextureFlags;
+
+	// Index of the pack file that contains this chunk.
+	uint16_t m_iPackFileIndex;
+};
+
+//-----------------------------------------------------------------------------
+// The deduplication index file header.
+//-----------------------------------------------------------------------------
+struct VPKDedupHeader_t
+{
+	uint32_t m_nHeaderMarker;  // File magic.
+	uint16_t m_nVersion;       // Index version.
+	uint16_t m_iPackFileIndex; // Pack file this index describes.
+	uint64_t m_nPackFileSize;  // Size of the pack file, used to detect stale indices.
+	uint64_t m_nEntryCount;    // Number of 'VPKDedupEntry_t' following the header.
+};
+
+//-----------------------------------------------------------------------------
+// State of a workspace file at the time it was packed. The build cache is
+// stored next to the directory file, so incremental builds can skip reading
+// files that haven't been modified since the previous build.
+//-----------------------------------------------------------------------------
+struct VPKBuildCacheEntry_t
+{
+	int64_t  m_nFileTime; // Last modification time.
+	uint64_t m_nFileSize;
+};
+
+//-----------------------------------------------------------------------------
+// Index of all unique chunks written to the pack files of a VPK. Chunks are
+// keyed by a 128-bit hash of their uncompressed data, and a hit is confirmed
+// by comparing the chunk against the data stored in the pack file before the
+// descriptor is committed. The index is stored next to each pack file, so
+// patch builds can map unchanged chunks onto the data already present in
+// earlier pack files.
+//-----------------------------------------------------------------------------
+class CPackedStoreDedupIndex
+{
+public:
+	CPackedStoreDedupIndex();
+	~CPackedStoreDedupIndex();
+
+	void Init(FileHandle_t hPackFile, const uint16_t iPackFileIndex);
+	void Shutdown(void);
+
+	bool LoadIndexFile(const CUtlString& packFilePath, const uint16_t iPackFileIndex);
+	bool SaveIndexFile(const CUtlString& packFilePath) const;
+
+	bool Find(const VPKChunkHash_t& chunkHash, const uint8_t* pData, const size_t nLen, VPKDedupEntry_t& outEntry);
+	void Insert(const VPKChunkHash_t& chunkHash, const VPKChunkDescriptor_t& descriptor);
+
+	const uint8_t* ReadRawChunk(const uint16_t iPackFileIndex, const VPKChunkDescriptor_t& descriptor);
+
+	inline int Count(void) const { return m_Entries.Count(); }
+
+private:
+	void InsertEntry(const VPKDedupEntry_t& entry);
+	void Rehash(const int nBucketCount);
+
+	bool CompareChunk(const VPKDedupEntry_t& entry, const uint8_t* pData, const size_t nLen);
+
+	CUtlVector<VPKDedupEntry_t> m_Entries;
+	CUtlVector<int>             m_Buckets; // Open addressing into 'm_Entries', -1 if empty.
+
+	FileHandle_t m_hPackFile; // Pack file that is currently being built.
+	uint16_t     m_iPackFileIndex;
+
+	// Earlier pack files, only opened when building a patch.
+	std::map<uint16_t, FileHandle_t> m_ExternalPackFiles;
+
+	std::unique_ptr<uint8_t[]> m_pReadBuffer;
+	std::unique_ptr<uint8_t[]> m_pDecodeBuffer;
+	lzham_decompress_params    m_Decoder;
 };
 
 //-----------------------------------------------------------------------------
@@ -206,22 +320,72 @@ struct VPKPair_t
 class CPackedStoreBuilder
 {
 public:
+	CPackedStoreBuilder();
+
 	void InitLzEncoder(const lzham_int32 maxHelperThreads = -1, const char* compressionLevel = "default");
 	void InitLzDecoder(void);
 
-	bool Deduplicate(const uint8_t* pEntryBuffer, VPKChunkDescriptor_t& descriptor, const size_t chunkIndex);
+	// Number of workers used by PackStore and UnpackStore, 1 runs serially
+	// on the calling thread and 0 uses one worker per logical processor.
+	void SetNumPackWorkers(const int numWorkers);
+
+	// Reuse the chunks of entries that didn't change since the previous build
+	// of the same pack file, instead of reading and compressing them again.
+	void SetIncremental(const bool bIncremental);
+
+	bool Deduplicate(const uint8_t* pEntryBuffer, const VPKChunkHash_t& chunkHash, VPKChunkDescriptor_t& descriptor,
+		uint16_t& iPackFileIndex, const size_t chunkIndex);
 
 	void PackStore(const VPKPair_t& vpkPair, const char* workspaceName, const char* buildPath);
-	void UnpackStore(const VPKDir_t& vpkDir, const char* workspaceName = "");
+	void UnpackStore(const VPKDir_t& vpkDir, const char* workspaceName = "", const char* pEntryFilter = nullptr);
 
 private:
+	void FinalizeEntryBlock(VPKEntryBlock_t& entryBlock, const CUtlVector<uint16_t>& chunkPackFileIndices, FileHandle_t hPackFile);
+
+	void PackEntriesSerial(const CUtlVector<VPKKeyValues_t>& entryValues, CUtlVector<VPKEntryBlock_t>& entryBlocks,
+		const CUtlString& workspacePath, FileHandle_t hPackFile, size_t& nSharedTotal, size_t& nSharedCount);
+	void PackEntriesParallel(const CUtlVector<VPKKeyValues_t>& entryValues, CUtlVector<VPKEntryBlock_t>& entryBlocks,
+		const CUtlString& workspacePath, FileHandle_t hPackFile, size_t& nSharedTotal, size_t& nSharedCount);
+
+	bool InitIncrementalBuild(const CUtlString& dirFilePath, const CUtlString& packFilePath);
+	void ShutdownIncrementalBuild(const CUtlString& packFilePath, const bool bRestorePackFile);
+	bool LoadPrevChunkHashes(const CUtlString& packFilePath);
+
+	const VPKEntryBlock_t* FindUnchangedEntry(const VPKKeyValues_t& entryValue, const char* pEntryPath,
+		const VPKBuildCacheEntry_t& fileInfo, const uint8_t* pData) const;
+	void CopyUnchangedEntry(VPKEntryBlock_t& entryBlock, const VPKKeyValues_t& entryValue, FileHandle_t hPackFile);
+
+	bool LoadBuildCache(const CUtlString& dirFilePath);
+	bool SaveBuildCache(const CUtlString& dirFilePath) const;
+
 	lzham_compress_params   m_Encoder; // LZham compression parameters.
 	lzham_decompress_params m_Decoder; // LZham decompression parameters.
-	std::unordered_map<string, const VPKChunkDescriptor_t&> m_ChunkHashMap;
+	CPackedStoreDedupIndex  m_DedupIndex;
+
+	int      m_nNumPackWorkers;
+	uint16_t m_iPackFileIndex; // Pack file that is currently being built.
+
+	// Incremental builds.
+	bool         m_bIncremental;
+	int          m_nUnchangedCount;
+	FileHandle_t m_hPrevPackFile; // Previous build of the pack file.
+
+	std::unique_ptr<VPKDir_t>  m_pPrevDir;
+	std::unique_ptr<uint8_t[]> m_pCopyBuffer;
+
+	std::unordered_map<std::string, int>            m_PrevEntryMap;    // Entry path -> index into previous directory.
+	std::unordered_map<uint64_t, VPKChunkHash_t>    m_PrevChunkHashes; // Previous pack file offset -> chunk hash.
+	std::unordered_map<uint64_t, uint64_t>          m_CopiedChunkMap;  // Previous pack file offset -> new pack file offset.
+
+	std::unordered_map<std::string, VPKBuildCacheEntry_t> m_PrevBuildCache;
+	std::unordered_map<std::string, VPKBuildCacheEntry_t> m_BuildCache;
 };
 
 CUtlString PackedStore_GetDirBaseName(const CUtlString& dirFileName);
 CUtlString PackedStore_GetDirNameParts(const CUtlString& dirFileName, const int nCaptureGroup);
+CUtlString PackedStore_GetDedupIndexFileName(const CUtlString& packFileName);
+CUtlString PackedStore_GetBuildCacheFileName(const CUtlString& dirFileName);
+VPKChunkHash_t PackedStore_HashChunk(const uint8_t* pData, const size_t nLen);
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif // PACKEDSTORE_H
@@ -0,0 +1,471 @@
+//=============================================================================//
+//
+// Purpose: Read-only, memory mapped view of a VPK directory file
+//
+//=============================================================================//
+// packedstoreview.cpp
+//
+// Note: 'VPKDir_t' copies every entry in the directory tree into its own
+// 'VPKEntryBlock_t', with a heap allocated path and fragment list. For large
+// directory files this costs a lot of time and memory, while most users only
+// need to find a handful of entries. This view maps the directory file and
+// only records where each entry lives in the mapping.
+// 
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "vpklib/packedstoreview.h"
+
+// Size of a chunk descriptor in the directory tree,
+// followed by a 'PACKFILEINDEX_SEP' or 'PACKFILEINDEX_END'.
+static constexpr size_t VPK_DIR_DESCRIPTOR_SIZE = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint64_t) * 3;
+static constexpr size_t VPK_DIR_ENTRY_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint16_t) * 2;
+
+static constexpr uint32_t VPK_PATH_HASH_BASIS = 2166136261u;
+static constexpr uint32_t VPK_PATH_HASH_PRIME = 16777619u;
+
+//-----------------------------------------------------------------------------
+// Purpose: normalizes a path character for hashing and comparison
+//-----------------------------------------------------------------------------
+static inline uint8_t NormalizePathChar(const char c)
+{
+	return (c == '\\') ? '/' : static_cast<uint8_t>(tolower(static_cast<uint8_t>(c)));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: FNV-1a over the normalized characters of a path (or part of it)
+//-----------------------------------------------------------------------------
+static inline uint32_t HashPathChar(const uint32_t nHash, const char c)
+{
+	return (nHash ^ NormalizePathChar(c)) * VPK_PATH_HASH_PRIME;
+}
+
+static inline uint32_t HashPathPart(uint32_t nHash, const char* pPart)
+{
+	for (; *pPart; pPart++)
+		nHash = HashPathChar(nHash, *pPart);
+
+	return nHash;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: checks whether the directory part of an entry ends with a slash
+//-----------------------------------------------------------------------------
+static inline bool HasTrailingSlash(const char* pPath)
+{
+	const size_t nLen = strlen(pPath);
+	return nLen && PATHSEPARATOR(pPath[nLen - 1]);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 'CPackedStoreDirView' constructor
+//-----------------------------------------------------------------------------
+CPackedStoreDirView::CPackedStoreDirView()
+	: m_hFile(INVALID_HANDLE_VALUE)
+	, m_hMapping(NULL)
+	, m_pBase(nullptr)
+	, m_nSize(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 'CPackedStoreDirView' destructor
+//-----------------------------------------------------------------------------
+CPackedStoreDirView::~CPackedStoreDirView()
+{
+	Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: maps the directory file and indexes its entries
+// Input  : *pDirFilePath - 
+// Output : true on success, false otherwise
+//-----------------------------------------------------------------------------
+bool CPackedStoreDirView::Init(const char* pDirFilePath)
+{
+	Shutdown();
+
+	m_hFile = CreateFileA(pDirFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "Unable to open '%s' (insufficient rights?)\n", pDirFilePath);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	// Entries store 32-bit offsets into the mapping.
+	if (!GetFileSizeEx(m_hFile, &fileSize) ||
+		fileSize.QuadPart < LONGLONG(sizeof(VPKDirHeader_t)) ||
+		fileSize.QuadPart > LONGLONG(UINT32_MAX))
+	{
+		Error(eDLL_T::FS, NO_ERROR, "Unsupported VPK directory file '%s' (invalid size)\n", pDirFilePath);
+		Shutdown();
+
+		return false;
+	}
+
+	m_nSize = static_cast<size_t>(fileSize.QuadPart);
+	m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (m_hMapping)
+	{
+		m_pBase = reinterpret_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (!m_pBase)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "Unable to map '%s' (error '%lu')\n", pDirFilePath, GetLastError());
+		Shutdown();
+
+		return false;
+	}
+
+	VPKDirHeader_t header;
+	memcpy(&header, m_pBase, sizeof(header));
+
+	// Make sure this is an actual directory tree file, and one we support.
+	if (header.m_nHeaderMarker != VPK_HEADER_MARKER ||
+		header.m_nMajorVersion != VPK_MAJOR_VERSION ||
+		header.m_nMinorVersion != VPK_MINOR_VERSION)
+	{
+		Error(eDLL_T::FS, NO_ERROR, "Unsupported VPK directory file (invalid header criteria)\n");
+		Shutdown();
+
+		return false;
+	}
+
+	if (!ParseTree())
+	{
+		Error(eDLL_T::FS, NO_ERROR, "VPK directory file '%s' is truncated or corrupt\n", pDirFilePath);
+		Shutdown();
+
+		return false;
+	}
+
+	BuildHashTable();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: unmaps the directory file and clears the index
+//-----------------------------------------------------------------------------
+void CPackedStoreDirView::Shutdown(void)
+{
+	m_Entries.Purge();
+	m_Buckets.Purge();
+
+	if (m_pBase)
+	{
+		UnmapViewOfFile(m_pBase);
+		m_pBase = nullptr;
+	}
+
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	m_nSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads a null terminated string from the mapping
+// Input  : &nOffset       - advanced past the terminator
+//          &nStringOffset - 
+// Output : false if the string runs past the end of the mapping
+//-----------------------------------------------------------------------------
+bool CPackedStoreDirView::ReadString(size_t& nOffset, uint32_t& nStringOffset) const
+{
+	const void* pEnd = memchr(m_pBase + nOffset, '\0', m_nSize - nOffset);
+
+	if (!pEnd)
+		return false;
+
+	nStringOffset = static_cast<uint32_t>(nOffset);
+	nOffset = (reinterpret_cast<const uint8_t*>(pEnd) - m_pBase) + 1;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: walks the directory tree and records the location of each entry,
+//          see 'VPKDir_t::CTreeBuilder::WriteTree' for the layout
+// Output : false if the tree is truncated
+//-----------------------------------------------------------------------------
+bool CPackedStoreDirView::ParseTree(void)
+{
+	size_t nOffset = sizeof(VPKDirHeader_t);
+	VPKDirViewEntry_t entry;
+
+	for (;;)
+	{
+		if (nOffset >= m_nSize || !ReadString(nOffset, entry.m_nExtensionOffset))
+			return false;
+
+		if (!*GetString(entry.m_nExtensionOffset))
+			break;
+
+		for (;;)
+		{
+			if (nOffset >= m_nSize || !ReadString(nOffset, entry.m_nPathOffset))
+				return false;
+
+			if (!*GetString(entry.m_nPathOffset))
+				break;
+
+			for (;;)
+			{
+				if (nOffset >= m_nSize || !ReadString(nOffset, entry.m_nNameOffset))
+					return false;
+
+				if (!*GetString(entry.m_nNameOffset))
+					break;
+
+				if (m_nSize - nOffset < VPK_DIR_ENTRY_HEADER_SIZE)
+					return false;
+
+				entry.m_nDataOffset = static_cast<uint32_t>(nOffset);
+				entry.m_nFragmentCount = 0;
+
+				nOffset += VPK_DIR_ENTRY_HEADER_SIZE;
+				uint16_t nMarker;
+
+				do
+				{
+					if (m_nSize - nOffset < VPK_DIR_DESCRIPTOR_SIZE + sizeof(uint16_t))
+						return false;
+
+					memcpy(&nMarker, m_pBase + nOffset + VPK_DIR_DESCRIPTOR_SIZE, sizeof(nMarker));
+					nOffset += VPK_DIR_DESCRIPTOR_SIZE + sizeof(uint16_t);
+
+					entry.m_nFragmentCount++;
+
+				} while (nMarker != static_cast<uint16_t>(PACKFILEINDEX_END));
+
+				entry.m_nPathHash = HashEntry(entry);
+				m_Entries.AddToTail(entry);
+			}
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: builds the open addressing table at a load factor of at most 50%
+//-----------------------------------------------------------------------------
+void CPackedStoreDirView::BuildHashTable(void)
+{
+	int nBucketCount = 16;
+
+	while (nBucketCount < m_Entries.Count() * 2)
+		nBucketCount <<= 1;
+
+	m_Buckets.SetCount(nBucketCount);
+	m_Buckets.FillWithValue(-1);
+
+	const int nMask = nBucketCount - 1;
+
+	FOR_EACH_VEC(m_Entries, i)
+	{
+		int nBucket = m_Entries[i].m_nPathHash & nMask;
+
+		while (m_Buckets[nBucket] != -1)
+			nBucket = (nBucket + 1) & nMask;
+
+		m_Buckets[nBucket] = i;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: hashes the normalized entry path, equal to hashing the result of
+//          'GetEntryPath' directly
+// Input  : &entry - 
+// Output : hash
+//-----------------------------------------------------------------------------
+uint32_t CPackedStoreDirView::HashEntry(const VPKDirViewEntry_t& entry) const
+{
+	const char* pPath = GetString(entry.m_nPathOffset);
+	uint32_t nHash = VPK_PATH_HASH_BASIS;
+
+	if (pPath[0] != ' ')
+	{
+		nHash = HashPathPart(nHash, pPath);
+
+		if (!HasTrailingSlash(pPath))
+			nHash = HashPathChar(nHash, '/');
+	}
+
+	nHash = HashPathPart(nHash, GetString(entry.m_nNameOffset));
+	nHash = HashPathChar(nHash, '.');
+
+	return HashPathPart(nHash, GetString(entry.m_nExtensionOffset));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compares the normalized entry path against a path
+// Input  : &entry      - 
+//          *pEntryPath - 
+// Output : true if equal
+//-----------------------------------------------------------------------------
+bool CPackedStoreDirView::MatchesPath(const VPKDirViewEntry_t& entry, const char* pEntryPath) const
+{
+	const char* pQuery = pEntryPath;
+
+	const auto matchPart = [&pQuery](const char* pPart) -> bool
+	{
+		for (; *pPart; pPart++, pQuery++)
+		{
+			if (!*pQuery || NormalizePathChar(*pQuery) != NormalizePathChar(*pPart))
+				return false;
+		}
+
+		return true;
+	};
+
+	const auto matchChar = [&pQuery](const char c) -> bool
+	{
+		if (NormalizePathChar(*pQuery) != c)
+			return false;
+
+		pQuery++;
+		return true;
+	};
+
+	const char* pPath = GetString(entry.m_nPathOffset);
+
+	if (pPath[0] != ' ')
+	{
+		if (!matchPart(pPath))
+			return false;
+
+		if (!HasTrailingSlash(pPath) && !matchChar('/'))
+			return false;
+	}
+
+	return matchPart(GetString(entry.m_nNameOffset)) && matchChar('.') &&
+		matchPart(GetString(entry.m_nExtensionOffset)) && *pQuery == '\0';
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds an entry by path (case insensitive, either slash)
+// Input  : *pEntryPath - (e.g. "scripts/vscripts/mp/levels/mp_rr_box.nut")
+// Output : entry index, -1 if not found
+//-----------------------------------------------------------------------------
+int CPackedStoreDirView::Find(const char* pEntryPath) const
+{
+	if (m_Buckets.IsEmpty())
+		return -1;
+
+	const uint32_t nHash = HashPathPart(VPK_PATH_HASH_BASIS, pEntryPath);
+	const int nMask = m_Buckets.Count() - 1;
+
+	for (int nBucket = nHash & nMask; m_Buckets[nBucket] != -1; nBucket = (nBucket + 1) & nMask)
+	{
+		const VPKDirViewEntry_t& entry = m_Entries[m_Buckets[nBucket]];
+
+		if (entry.m_nPathHash == nHash && MatchesPath(entry, pEntryPath))
+			return m_Buckets[nBucket];
+	}
+
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: formats the path of an entry
+// Input  : iEntry - 
+// Output : entry path (e.g. "scripts/vscripts/mp/levels/mp_rr_box.nut")
+//-----------------------------------------------------------------------------
+CUtlString CPackedStoreDirView::GetEntryPath(const int iEntry) const
+{
+	const VPKDirViewEntry_t& entry = m_Entries[iEntry];
+	const char* pPath = GetString(entry.m_nPathOffset);
+
+	CUtlString result;
+
+	if (pPath[0] != ' ')
+	{
+		result = pPath;
+		result.AppendSlash('/');
+	}
+
+	result.Append(GetString(entry.m_nNameOffset));
+	result.Append('.');
+	result.Append(GetString(entry.m_nExtensionOffset));
+
+	result.FixSlashes('/');
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: entry block accessors, read straight from the mapping
+// Input  : iEntry - 
+//-----------------------------------------------------------------------------
+uint32_t CPackedStoreDirView::GetFileCRC(const int iEntry) const
+{
+	uint32_t nFileCRC;
+	memcpy(&nFileCRC, m_pBase + m_Entries[iEntry].m_nDataOffset, sizeof(nFileCRC));
+
+	return nFileCRC;
+}
+
+uint16_t CPackedStoreDirView::GetPreloadSize(const int iEntry) const
+{
+	uint16_t iPreloadSize;
+	memcpy(&iPreloadSize, m_pBase + m_Entries[iEntry].m_nDataOffset + sizeof(uint32_t), sizeof(iPreloadSize));
+
+	return iPreloadSize;
+}
+
+uint16_t CPackedStoreDirView::GetPackFileIndex(const int iEntry) const
+{
+	uint16_t iPackFileIndex;
+	memcpy(&iPackFileIndex, m_pBase + m_Entries[iEntry].m_nDataOffset + sizeof(uint32_t) + sizeof(uint16_t), sizeof(iPackFileIndex));
+
+	return iPackFileIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads a chunk descriptor of an entry
+// Input  : iEntry    - 
+//          iFragment - 
+// Output : chunk descriptor
+//-----------------------------------------------------------------------------
+VPKChunkDescriptor_t CPackedStoreDirView::GetFragment(const int iEntry, const int iFragment) const
+{
+	Assert(iFragment >= 0 && iFragment < m_Entries[iEntry].m_nFragmentCount);
+
+	const uint8_t* pData = m_pBase + m_Entries[iEntry].m_nDataOffset + VPK_DIR_ENTRY_HEADER_SIZE
+		+ iFragment * (VPK_DIR_DESCRIPTOR_SIZE + sizeof(uint16_t));
+
+	VPKChunkDescriptor_t descriptor;
+
+	memcpy(&descriptor.m_nLoadFlags, pData, sizeof(uint32_t));
+	pData += sizeof(uint32_t);
+	memcpy(&descriptor.m_nTextureFlags, pData, sizeof(uint16_t));
+	pData += sizeof(uint16_t);
+	memcpy(&descriptor.m_nPackFileOffset, pData, sizeof(uint64_t));
+	pData += sizeof(uint64_t);
+	memcpy(&descriptor.m_nCompressedSize, pData, sizeof(uint64_t));
+	pData += sizeof(uint64_t);
+	memcpy(&descriptor.m_nUncompressedSize, pData, sizeof(uint64_t));
+
+	return descriptor;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: gets the heap memory used by the view
+// Output : size in bytes
+//-----------------------------------------------------------------------------
+size_t CPackedStoreDirView::GetHeapSize(void) const
+{
+	return m_Entries.NumAllocated() * sizeof(VPKDirViewEntry_t) + m_Buckets.NumAllocated() * sizeof(int);
+}
@@ -0,0 +1,78 @@
+//=============================================================================//
+//
+// Purpose: Read-only, memory mapped view of a VPK directory file
+//
+//=============================================================================//
+#ifndef PACKEDSTOREVIEW_H
+#define PACKEDSTOREVIEW_H
+
+#include "vpklib/packedstore.h"
+
+//-----------------------------------------------------------------------------
+// An entry in the directory view. All offsets point into the mapped
+// directory file; the entry path is stored split up the same way as the
+// directory tree stores it (extension, path and file name).
+//-----------------------------------------------------------------------------
+struct VPKDirViewEntry_t
+{
+	uint32_t m_nExtensionOffset;
+	uint32_t m_nPathOffset;      // " " for entries in the root.
+	uint32_t m_nNameOffset;
+	uint32_t m_nDataOffset;      // Crc, preload size, pack file index and fragments.
+	uint32_t m_nPathHash;        // Hash of the normalized entry path.
+	uint16_t m_nFragmentCount;
+};
+
+//-----------------------------------------------------------------------------
+// Read-only view of a VPK directory file. Unlike 'VPKDir_t', the directory
+// file is memory mapped and never copied; entries reference the mapped tree
+// and are found through a hash table keyed on the normalized entry path
+// (lowercase, forward slashes).
+//-----------------------------------------------------------------------------
+class CPackedStoreDirView
+{
+public:
+	CPackedStoreDirView();
+	~CPackedStoreDirView();
+
+	bool Init(const char* pDirFilePath);
+	void Shutdown(void);
+
+	inline bool IsValid(void) const { return m_pBase != nullptr; }
+	inline int  Count(void) const { return m_Entries.Count(); }
+
+	int Find(const char* pEntryPath) const;
+
+	CUtlString GetEntryPath(const int iEntry) const;
+
+	uint32_t GetFileCRC(const int iEntry) const;
+	uint16_t GetPreloadSize(const int iEntry) const;
+	uint16_t GetPackFileIndex(const int iEntry) const;
+
+	inline int GetFragmentCount(const int iEntry) const { return m_Entries[iEntry].m_nFragmentCount; }
+	VPKChunkDescriptor_t GetFragment(const int iEntry, const int iFragment) const;
+
+	// Heap memory used by the view, the mapping itself is excluded.
+	size_t GetHeapSize(void) const;
+
+private:
+	bool ParseTree(void);
+	void BuildHashTable(void);
+
+	bool ReadString(size_t& nOffset, uint32_t& nStringOffset) const;
+	bool MatchesPath(const VPKDirViewEntry_t& entry, const char* pEntryPath) const;
+
+	uint32_t HashEntry(const VPKDirViewEntry_t& entry) const;
+
+	inline const char* GetString(const uint32_t nOffset) const { return reinterpret_cast<const char*>(m_pBase + nOffset); }
+
+	CUtlVector<VPKDirViewEntry_t> m_Entries;
+	CUtlVector<int>               m_Buckets; // Open addressing into 'm_Entries', -1 if empty.
+
+	HANDLE         m_hFile;
+	HANDLE         m_hMapping;
+	const uint8_t* m_pBase;
+	size_t         m_nSize;
+};
+
+#endif // PACKEDSTOREVIEW_H
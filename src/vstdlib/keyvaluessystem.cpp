@@ -57,19 +57,11 @@ void* g_pKeyValuesMemPool = nullptr;
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
 CKeyValuesSystem::CKeyValuesSystem() :
-	m_HashItemMemPool(sizeof(hash_item_t), 64, CUtlMemoryPool::GROW_FAST, "CKeyValuesSystem::m_HashItemMemPool"),
+	m_pSymbolTable(new SymbolTable_t(KEYVALUES_SYMBOL_TABLE_INITIAL_SIZE)),
 	m_KeyValuesTrackingList(0, 0, MemoryLeakTrackerLessFunc),
 	m_KvConditionalSymbolTable(DefLessFunc(HKeySymbol))
 {
 	MEM_ALLOC_CREDIT();
-	// initialize hash table
-	m_HashTable.AddMultipleToTail(2047);
-	for (int i = 0; i < m_HashTable.Count(); i++)
-	{
-		m_HashTable[i].stringIndex = 0;
-		m_HashTable[i].next = NULL;
-	}
-
 	m_Strings.Init("CKeyValuesSystem::m_Strings", 4 * 1024 * 1024, 64 * 1024, 0, 4);
 	// Make 0 stringIndex to never be returned, by allocating
 	// and wasting minimal number of alignment bytes now:
@@ -107,6 +99,10 @@ CKeyValuesSystem::~CKeyValuesSystem()
 
 	delete m_pMemPool;
 #endif
+
+	// Lookups can no longer run at this point, so the
+	// tables that were replaced can be freed as well
+	delete m_pSymbolTable.exchange(nullptr);
 }
 
 //-----------------------------------------------------------------------------
@@ -167,6 +163,134 @@ void CKeyValuesSystem::FreeKeyValuesMemory(void* const pMem)
 #endif
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: creates a symbol table with the given number of slots
+//-----------------------------------------------------------------------------
+CKeyValuesSystem::SymbolTable_t::SymbolTable_t(const uint32 nSlots)
+{
+	Assert(nSlots && !(nSlots & (nSlots - 1)));
+
+	nMask = nSlots - 1;
+	nCount = 0;
+
+	pSlots = new std::atomic<uint64_t>[nSlots];
+	pRetired = nullptr;
+
+	for (uint32 i = 0; i < nSlots; i++)
+	{
+		pSlots[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: frees the slots, and the tables this table replaced
+//-----------------------------------------------------------------------------
+CKeyValuesSystem::SymbolTable_t::~SymbolTable_t()
+{
+	delete[] pSlots;
+	delete pRetired;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds the symbol for a string, may be called from any thread
+// Input  : *pStringBase - 
+//			*name - 
+//			nHash - case folded hash of name
+// Output : symbol on success, INVALID_KEY_SYMBOL if not found
+//-----------------------------------------------------------------------------
+HKeySymbol CKeyValuesSystem::SymbolTable_t::Find(const char* const pStringBase, const char* const name, const uint32 nHash) const
+{
+	for (uint32 i = nHash & nMask;; i = (i + 1) & nMask)
+	{
+		// Acquire, so the string of the symbol is visible when we see it.
+		const uint64_t nSlot = pSlots[i].load(std::memory_order_acquire);
+
+		if (!nSlot)
+			return INVALID_KEY_SYMBOL;
+
+		if (uint32(nSlot >> 32) != nHash)
+			continue;
+
+		const HKeySymbol symbol = HKeySymbol(nSlot & 0xFFFFFFFF);
+
+		if (!stricmp(name, pStringBase + symbol))
+			return symbol;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: inserts a symbol, must be called with the mutex held
+// Input  : nHash - case folded hash of the symbol's string
+//			symbol - 
+//-----------------------------------------------------------------------------
+void CKeyValuesSystem::SymbolTable_t::Insert(const uint32 nHash, const HKeySymbol symbol)
+{
+	Assert(nCount < nMask);
+	uint32 i = nHash & nMask;
+
+	while (pSlots[i].load(std::memory_order_relaxed))
+		i = (i + 1) & nMask;
+
+	// Release, so the string is written before the slot is seen.
+	pSlots[i].store((uint64_t(nHash) << 32) | uint32(symbol), std::memory_order_release);
+	nCount++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: finds the symbol for a string without taking the mutex
+//-----------------------------------------------------------------------------
+HKeySymbol CKeyValuesSystem::FindSymbol(const char* const name, const uint32 nHash) const
+{
+	const SymbolTable_t* const pTable = m_pSymbolTable.load(std::memory_order_acquire);
+	return pTable->Find((const char*)m_Strings.GetBase(), name, nHash);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: creates the symbol for a string that isn't in the table yet, must
+//			be called with the mutex held
+// Input  : *name - 
+//			nHash - case folded hash of name
+// Output : symbol on success, INVALID_KEY_SYMBOL if out of string space
+//-----------------------------------------------------------------------------
+HKeySymbol CKeyValuesSystem::AddSymbol(const char* const name, const uint32 nHash)
+{
+	const size_t numStringBytes = strlen(name);
+	char* pString = (char*)m_Strings.Alloc(numStringBytes + 1 + 3);
+	if (!pString)
+	{
+		Error(eDLL_T::COMMON, EXIT_FAILURE, "Out of keyvalue string space");
+		return INVALID_KEY_SYMBOL;
+	}
+	memcpy(pString, name, numStringBytes);
+	*reinterpret_cast<uint32*>(pString + numStringBytes) = 0;	// string null-terminator + 3 alternative spelling bytes
+
+	const HKeySymbol symbol = HKeySymbol(pString - (char*)m_Strings.GetBase());
+	SymbolTable_t* pTable = m_pSymbolTable.load(std::memory_order_relaxed);
+
+	// Keep at least half of the slots free, so probe sequences stay short.
+	if ((pTable->nCount + 1) * 2 > pTable->nMask + 1)
+	{
+		SymbolTable_t* const pNewTable = new SymbolTable_t((pTable->nMask + 1) * 2);
+
+		for (uint32 i = 0; i <= pTable->nMask; i++)
+		{
+			const uint64_t nSlot = pTable->pSlots[i].load(std::memory_order_relaxed);
+
+			if (nSlot)
+				pNewTable->Insert(uint32(nSlot >> 32), HKeySymbol(nSlot & 0xFFFFFFFF));
+		}
+
+		// Lookups that already loaded the old table may still be probing it.
+		pNewTable->pRetired = pTable;
+		m_pSymbolTable.store(pNewTable, std::memory_order_release);
+
+		pTable = pNewTable;
+	}
+
+	pTable->Insert(nHash, symbol);
+	return symbol;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: symbol table access (used for key names)
 //-----------------------------------------------------------------------------
@@ -177,58 +301,26 @@ HKeySymbol CKeyValuesSystem::GetSymbolForString(const char* const name, const bo
 		return (-1);
 	}
 
-	AUTO_LOCK(m_Mutex);
-	MEM_ALLOC_CREDIT();
+	const uint32 nHash = CaseInsensitiveHash(name);
+	HKeySymbol symbol = FindSymbol(name, nHash);
 
-	int hash = CaseInsensitiveHash(name, m_HashTable.Count());
-	int i = 0;
-	hash_item_t* item = &m_HashTable[hash];
-	while (1)
+	if (symbol != INVALID_KEY_SYMBOL || !bCreate)
 	{
-		if (!stricmp(name, (char*)m_Strings.GetBase() + item->stringIndex))
-		{
-			return (HKeySymbol)item->stringIndex;
-		}
+		return symbol;
+	}
 
-		i++;
+	AUTO_LOCK(m_Mutex);
+	MEM_ALLOC_CREDIT();
 
-		if (item->next == NULL)
-		{
-			if (!bCreate)
-			{
-				// not found
-				return -1;
-			}
-
-			// we're not in the table
-			if (item->stringIndex != 0)
-			{
-				// first item is used, an new item
-				item->next = (hash_item_t*)m_HashItemMemPool.Alloc(sizeof(hash_item_t));
-				item = item->next;
-			}
-
-			// build up the new item
-			item->next = NULL;
-			const size_t numStringBytes = strlen(name);
-			char* pString = (char*)m_Strings.Alloc(numStringBytes + 1 + 3);
-			if (!pString)
-			{
-				Error(eDLL_T::COMMON, EXIT_FAILURE, "Out of keyvalue string space");
-				return -1;
-			}
-			item->stringIndex = pString - (char*)m_Strings.GetBase();
-			memcpy(pString, name, numStringBytes);
-			*reinterpret_cast<uint32*>(pString + numStringBytes) = 0;	// string null-terminator + 3 alternative spelling bytes
-			return (HKeySymbol)item->stringIndex;
-		}
+	// Another thread may have added it after we looked.
+	symbol = FindSymbol(name, nHash);
 
-		item = item->next;
+	if (symbol != INVALID_KEY_SYMBOL)
+	{
+		return symbol;
 	}
 
-	// shouldn't be able to get here
-	Assert(0);
-	return (-1);
+	return AddSymbol(name, nHash);
 }
 
 //-----------------------------------------------------------------------------
@@ -241,110 +333,88 @@ HKeySymbol CKeyValuesSystem::GetSymbolForStringCaseSensitive(HKeySymbol& hCaseIn
 		return (-1);
 	}
 
+	const uint32 nHash = CaseInsensitiveHash(name);
+	HKeySymbol symbol = FindSymbol(name, nHash);
+
+	// Exact case matches with the first capitalization are found without
+	// the mutex; alternative capitalizations are linked to it under the
+	// mutex, so these are walked with it held.
+	if (symbol != INVALID_KEY_SYMBOL && !strcmp(name, (char*)m_Strings.GetBase() + symbol))
+	{
+		hCaseInsensitiveSymbol = symbol;
+		return symbol;
+	}
+
+	if (symbol == INVALID_KEY_SYMBOL && !bCreate)
+	{
+		// not found
+		return -1;
+	}
+
 	AUTO_LOCK(m_Mutex);
 	MEM_ALLOC_CREDIT();
 
-	const int hash = CaseInsensitiveHash(name, m_HashTable.Count());
-
-	ssize_t numNameStringBytes = -1;
-	ssize_t i = 0;
-	hash_item_t* item = &m_HashTable[hash];
+	// Another thread may have added it after we looked.
+	if (symbol == INVALID_KEY_SYMBOL)
+	{
+		symbol = FindSymbol(name, nHash);
+	}
 
-	while (1)
+	if (symbol == INVALID_KEY_SYMBOL)
 	{
-		char* pCompareString = (char*)m_Strings.GetBase() + item->stringIndex;
-		const int iResultNegative = _V_stricmp_NegativeForUnequal(name, pCompareString);
-		if (iResultNegative == 0)
-		{
-			// strings are exactly equal matching every letter's case
-			hCaseInsensitiveSymbol = (HKeySymbol)item->stringIndex;
-			return (HKeySymbol)item->stringIndex;
-		}
-		else if (iResultNegative > 0)
-		{
-			// strings are equal in a case-insensitive compare, but have different case for some letters
-			// Need to walk the case-resolving chain
-			numNameStringBytes = Q_strlen(pCompareString);
-			uint32* pnCaseResolveIndex = reinterpret_cast<uint32*>(pCompareString + numNameStringBytes);
-			hCaseInsensitiveSymbol = (HKeySymbol)item->stringIndex;
-			while (int nAlternativeStringIndex = MEM_4BYTES_FROM_0_AND_3BYTES(*pnCaseResolveIndex))
-			{
-				pCompareString = (char*)m_Strings.GetBase() + nAlternativeStringIndex;
-				const int iResult = strcmp(name, pCompareString);
-				if (!iResult)
-				{
-					// found an exact match
-					return (HKeySymbol)nAlternativeStringIndex;
-				}
-				// Keep traversing alternative case-resolving chain
-				pnCaseResolveIndex = reinterpret_cast<uint32*>(pCompareString + numNameStringBytes);
-			}
-			// Reached the end of alternative case-resolving chain, pnCaseResolveIndex is pointing at 0 bytes
-			// indicating no further alternative stringIndex
-			if (!bCreate)
-			{
-				// If we aren't interested in creating the actual string index,
-				// then return symbol with default capitalization
-				// NOTE: this is not correct value, but it cannot be used to create a new value anyway,
-				// only for locating a pre-existing value and lookups are case-insensitive
-				return (HKeySymbol)item->stringIndex;
-			}
-			else
-			{
-				char* pString = (char*)m_Strings.Alloc(numNameStringBytes + 1 + 3);
-				if (!pString)
-				{
-					Error(eDLL_T::COMMON, EXIT_FAILURE, "Out of keyvalue string space");
-					return -1;
-				}
-				int64_t nNewAlternativeStringIndex = pString - (char*)m_Strings.GetBase();
-				memcpy(pString, name, numNameStringBytes);
-				*reinterpret_cast<uint32*>(pString + numNameStringBytes) = 0;	// string null-terminator + 3 alternative spelling bytes
-				*pnCaseResolveIndex = MEM_4BYTES_AS_0_AND_3BYTES(nNewAlternativeStringIndex);	// link previous spelling entry to the new entry
-				return (HKeySymbol)nNewAlternativeStringIndex;
-			}
-		}
+		// we're not in the table
+		symbol = AddSymbol(name, nHash);
+		hCaseInsensitiveSymbol = symbol;
+
+		return symbol;
+	}
 
-		i++;
+	// strings are equal in a case-insensitive compare, but have different case for some letters
+	// Need to walk the case-resolving chain
+	char* pCompareString = (char*)m_Strings.GetBase() + symbol;
+	const ssize_t numNameStringBytes = Q_strlen(pCompareString);
+	uint32* pnCaseResolveIndex = reinterpret_cast<uint32*>(pCompareString + numNameStringBytes);
+	hCaseInsensitiveSymbol = symbol;
+
+	if (!strcmp(name, pCompareString))
+	{
+		return symbol;
+	}
 
-		if (item->next == NULL)
+	while (int nAlternativeStringIndex = MEM_4BYTES_FROM_0_AND_3BYTES(*pnCaseResolveIndex))
+	{
+		pCompareString = (char*)m_Strings.GetBase() + nAlternativeStringIndex;
+		const int iResult = strcmp(name, pCompareString);
+		if (!iResult)
 		{
-			if (!bCreate)
-			{
-				// not found
-				return -1;
-			}
-
-			// we're not in the table
-			if (item->stringIndex != 0)
-			{
-				// first item is used, an new item
-				item->next = (hash_item_t*)m_HashItemMemPool.Alloc(sizeof(hash_item_t));
-				item = item->next;
-			}
-
-			// build up the new item
-			item->next = NULL;
-			size_t numStringBytes = strlen(name);
-			char* pString = (char*)m_Strings.Alloc(numStringBytes + 1 + 3);
-			if (!pString)
-			{
-				Error(eDLL_T::COMMON, EXIT_FAILURE, "Out of keyvalue string space");
-				return -1;
-			}
-			item->stringIndex = pString - (char*)m_Strings.GetBase();
-			memcpy(pString, name, numStringBytes);
-			*reinterpret_cast<uint32*>(pString + numStringBytes) = 0;	// string null-terminator + 3 alternative spelling bytes
-			hCaseInsensitiveSymbol = (HKeySymbol)item->stringIndex;
-			return (HKeySymbol)item->stringIndex;
+			// found an exact match
+			return (HKeySymbol)nAlternativeStringIndex;
 		}
-
-		item = item->next;
+		// Keep traversing alternative case-resolving chain
+		pnCaseResolveIndex = reinterpret_cast<uint32*>(pCompareString + numNameStringBytes);
+	}
+	// Reached the end of alternative case-resolving chain, pnCaseResolveIndex is pointing at 0 bytes
+	// indicating no further alternative stringIndex
+	if (!bCreate)
+	{
+		// If we aren't interested in creating the actual string index,
+		// then return symbol with default capitalization
+		// NOTE: this is not correct value, but it cannot be used to create a new value anyway,
+		// only for locating a pre-existing value and lookups are case-insensitive
+		return symbol;
 	}
 
-	// shouldn't be able to get here
-	Assert(0);
-	return (-1);
+	char* pString = (char*)m_Strings.Alloc(numNameStringBytes + 1 + 3);
+	if (!pString)
+	{
+		Error(eDLL_T::COMMON, EXIT_FAILURE, "Out of keyvalue string space");
+		return -1;
+	}
+	int64_t nNewAlternativeStringIndex = pString - (char*)m_Strings.GetBase();
+	memcpy(pString, name, numNameStringBytes);
+	*reinterpret_cast<uint32*>(pString + numNameStringBytes) = 0;	// string null-terminator + 3 alternative spelling bytes
+	*pnCaseResolveIndex = MEM_4BYTES_AS_0_AND_3BYTES(nNewAlternativeStringIndex);	// link previous spelling entry to the new entry
+	return (HKeySymbol)nNewAlternativeStringIndex;
 }
 
 //-----------------------------------------------------------------------------
@@ -385,26 +455,24 @@ void CKeyValuesSystem::RemoveKeyValuesFromMemoryLeakList(const void* const pMem)
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: generates a simple hash value for a string
+// Purpose: generates a case folded hash value for a string (FNV-1a)
 //-----------------------------------------------------------------------------
-int CKeyValuesSystem::CaseInsensitiveHash(const char* const string, const int iBounds)
+uint32 CKeyValuesSystem::CaseInsensitiveHash(const char* const string)
 {
-	unsigned int hash = 0;
+	uint32 hash = 2166136261u;
 	const char* iter = string;
 
 	for (; *iter != 0; iter++)
 	{
-		if (*iter >= 'A' && *iter <= 'Z')
-		{
-			hash = (hash << 1) + (*iter - 'A' + 'a');
-		}
-		else
-		{
-			hash = (hash << 1) + *iter;
-		}
+		uint8 c = uint8(*iter);
+
+		if (c >= 'A' && c <= 'Z')
+			c = c - 'A' + 'a';
+
+		hash = (hash ^ c) * 16777619u;
 	}
 
-	return hash % iBounds;
+	return hash;
 }
 
 //-----------------------------------------------------------------------------
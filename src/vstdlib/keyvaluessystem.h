@@ -2,10 +2,13 @@
 
 #include "public/ikeyvaluessystem.h"
 #include "tier1/memstack.h"
-#include "tier1/mempool.h"
 #include "tier1/utlvector.h"
 #include "tier1/utlmap.h"
 
+// Number of slots the symbol table starts with, must be a power of 2; the
+// table doubles once half of its slots are used
+#define KEYVALUES_SYMBOL_TABLE_INITIAL_SIZE 4096
+
 class CKeyValuesSystem;
 
 /* ==== KEYVALUESSYSTEM ================================================================================================================================================= */
@@ -52,12 +55,12 @@ private:
 	// string hash table
 	/*
 	Here's the way key values system data structures are laid out:
-	hash table with 2047 hash buckets:
-	[0] { hash_item_t }
+	open addressed hash table with a power of 2 number of slots:
+	[0] { case folded hash : 32 | stringIndex : 32 }
 	[1]
 	[2]
 	...
-	each hash_item_t's stringIndex is an offset in m_Strings memory
+	each slot's stringIndex is an offset in m_Strings memory
 	at that offset we store the actual null-terminated string followed
 	by another 3 bytes for an alternative capitalization.
 	These 3 trailing bytes are set to 0 if no alternative capitalization
@@ -69,24 +72,40 @@ private:
 	string memory represented by stringIndex
 
 	Getting a symbol for a string value:
-	1)	compute the hash
-	2)	start walking the hash-bucket using special version of stricmp
-		until a case insensitive match is found
+	1)	compute the case folded hash
+	2)	start probing the slots from the hash, only calling stricmp on
+		slots with the same hash, until a case insensitive match is found
 	3a) for case-insensitive lookup return the found stringIndex
 	3b) for case-sensitive lookup keep walking the list of alternative
 		capitalizations using strcmp until exact case match is found
+
+	Slots are written once and strings never move, so lookups run without
+	taking m_Mutex. Insertions and growing the table are done under the
+	mutex; a grown table is published atomically and the old one is kept
+	alive until shutdown, as lookups may still be probing it.
 	*/
 	CMemoryStack m_Strings;
 
-	struct hash_item_t
+	struct SymbolTable_t
 	{
-		int64_t stringIndex;
-		hash_item_t* next;
+		SymbolTable_t(const uint32 nSlots);
+		~SymbolTable_t();
+
+		HKeySymbol Find(const char* const pStringBase, const char* const name, const uint32 nHash) const;
+		void Insert(const uint32 nHash, const HKeySymbol symbol);
+
+		uint32 nMask;
+		uint32 nCount;
+
+		std::atomic<uint64_t>* pSlots;
+		SymbolTable_t* pRetired; // Table this one replaced.
 	};
 
-	CUtlMemoryPool m_HashItemMemPool;
-	CUtlVector<hash_item_t> m_HashTable;
-	int CaseInsensitiveHash(const char *const string, const int iBounds);
+	std::atomic<SymbolTable_t*> m_pSymbolTable;
+
+	static uint32 CaseInsensitiveHash(const char* const string);
+	HKeySymbol FindSymbol(const char* const name, const uint32 nHash) const;
+	HKeySymbol AddSymbol(const char* const name, const uint32 nHash);
 
 	struct MemoryLeakTracker_t
 	{